@@ -0,0 +1,181 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_clock.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rt_stats.h"
+#include "rt_time.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define RT_CLOCK_HAVE_TSC 1
+#else
+#define RT_CLOCK_HAVE_TSC 0
+#endif
+
+#define CALIBRATION_NS (50 * RT_NSEC_PER_MSEC)
+#define OVERHEAD_SAMPLES 10000
+
+static int use_tsc;
+static int64_t overhead_ns;
+static double tsc_ghz;
+
+// Привязка TSC к CLOCK_MONOTONIC под seqlock: нечетный seq - идет запись
+static atomic_uint anchor_seq;
+static _Atomic uint64_t anchor_tsc;
+static _Atomic int64_t anchor_ns;
+static _Atomic uint64_t anchor_mult; // нс на такт * 2^32
+static uint64_t resync_ticks;
+
+#if RT_CLOCK_HAVE_TSC
+static int tsc_is_reliable(void) {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) return 0;
+
+    // Если ядро не доверяет TSC (например, под гипервизором), не доверяем и мы
+    char source[32] = "";
+    FILE* f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (f) {
+        if (!fgets(source, sizeof(source), f)) source[0] = '\0';
+        fclose(f);
+    }
+    return strncmp(source, "tsc", 3) == 0;
+}
+
+// Пара (TSC, CLOCK_MONOTONIC) с наименьшим окном между чтениями TSC
+static void sample_pair(uint64_t* tsc, int64_t* ns) {
+    uint64_t best_width = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        _mm_lfence();
+        uint64_t before = __rdtsc();
+        int64_t now = rt_now_ns();
+        unsigned aux;
+        uint64_t after = __rdtscp(&aux);
+        if (after - before < best_width) {
+            best_width = after - before;
+            *tsc = before + (after - before) / 2;
+            *ns = now;
+        }
+    }
+}
+
+// Согласованный снимок привязки; возвращает его seq
+static unsigned anchor_load(uint64_t* base_tsc, int64_t* base_ns, uint64_t* mult) {
+    unsigned seq;
+    do {
+        seq = atomic_load_explicit(&anchor_seq, memory_order_acquire);
+        *base_tsc = atomic_load_explicit(&anchor_tsc, memory_order_relaxed);
+        *base_ns = atomic_load_explicit(&anchor_ns, memory_order_relaxed);
+        *mult = atomic_load_explicit(&anchor_mult, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&anchor_seq, memory_order_relaxed));
+    return seq;
+}
+
+static int64_t tsc_to_ns(uint64_t tsc) {
+    uint64_t base_tsc, mult;
+    int64_t base_ns;
+    anchor_load(&base_tsc, &base_ns, &mult);
+    return base_ns + (int64_t)(((__int128)(int64_t)(tsc - base_tsc) * mult) >> 32);
+}
+
+// Переанкеровка, если привязка старше RT_CLOCK_RESYNC_NS. Вызывается только
+// из rt_clock_now_ns() до чтения TSC: внутрь замера sample_pair не попадает
+static void tsc_resync_if_stale(void) {
+    uint64_t base_tsc, mult;
+    int64_t base_ns;
+    unsigned seq = anchor_load(&base_tsc, &base_ns, &mult);
+    if ((int64_t)(__rdtsc() - base_tsc) <= (int64_t)resync_ticks) return;
+
+    // Переанкеровку делает один поток: кто первым сделал seq нечетным
+    unsigned expected = seq;
+    if (!atomic_compare_exchange_strong(&anchor_seq, &expected, seq + 1)) return;
+    uint64_t new_tsc;
+    int64_t new_ns;
+    sample_pair(&new_tsc, &new_ns);
+    // Уточнить частоту по интервалу с прошлой привязки
+    uint64_t new_mult = (uint64_t)((((unsigned __int128)(new_ns - base_ns)) << 32) / (new_tsc - base_tsc));
+    atomic_store_explicit(&anchor_tsc, new_tsc, memory_order_relaxed);
+    atomic_store_explicit(&anchor_ns, new_ns, memory_order_relaxed);
+    atomic_store_explicit(&anchor_mult, new_mult, memory_order_relaxed);
+    atomic_store_explicit(&anchor_seq, seq + 2, memory_order_release);
+}
+#endif
+
+int64_t rt_clock_now_ns(void) {
+#if RT_CLOCK_HAVE_TSC
+    if (use_tsc) {
+        tsc_resync_if_stale();
+        _mm_lfence();
+        return tsc_to_ns(__rdtsc());
+    }
+#endif
+    return rt_now_ns();
+}
+
+int64_t rt_clock_end_ns(void) {
+#if RT_CLOCK_HAVE_TSC
+    if (use_tsc) {
+        unsigned aux;
+        uint64_t tsc = __rdtscp(&aux);
+        _mm_lfence();
+        return tsc_to_ns(tsc);
+    }
+#endif
+    return rt_now_ns();
+}
+
+static void measure_overhead(void) {
+    RtHistogram h;
+    rt_hist_init(&h);
+    for (int i = 0; i < OVERHEAD_SAMPLES; ++i) {
+        int64_t start = rt_clock_now_ns();
+        rt_hist_record(&h, rt_clock_end_ns() - start);
+    }
+    overhead_ns = rt_hist_percentile(&h, 50.0);
+}
+
+int rt_clock_init(void) {
+    use_tsc = 0;
+    tsc_ghz = 0.0;
+#if RT_CLOCK_HAVE_TSC
+    const char* env = getenv("RT_CLOCK");
+    if ((!env || strcmp(env, "monotonic") != 0) && tsc_is_reliable()) {
+        uint64_t tsc0, tsc1;
+        int64_t ns0, ns1;
+        sample_pair(&tsc0, &ns0);
+        struct timespec pause;
+        rt_ns_to_timespec(CALIBRATION_NS, &pause);
+        nanosleep(&pause, NULL);
+        sample_pair(&tsc1, &ns1);
+
+        double ghz = (double)(tsc1 - tsc0) / (double)(ns1 - ns0);
+        if (ghz > 0.1 && ghz < 10.0) {
+            atomic_store(&anchor_tsc, tsc1);
+            atomic_store(&anchor_ns, ns1);
+            atomic_store(&anchor_mult, (uint64_t)((((unsigned __int128)(ns1 - ns0)) << 32) / (tsc1 - tsc0)));
+            resync_ticks = (uint64_t)(RT_CLOCK_RESYNC_NS * ghz);
+            tsc_ghz = ghz;
+            use_tsc = 1;
+        }
+    }
+#endif
+    measure_overhead();
+    return use_tsc;
+}
+
+int64_t rt_clock_overhead_ns(void) {
+    return overhead_ns;
+}
+
+const char* rt_clock_source(void) {
+    return use_tsc ? "tsc" : "clock_gettime";
+}
+
+double rt_clock_tsc_ghz(void) {
+    return tsc_ghz;
+}
@@ -0,0 +1,47 @@
+#ifndef RT_CLOCK_H
+#define RT_CLOCK_H
+
+#include <stdint.h>
+
+// Как часто rt_clock_now_ns() заново привязывает TSC к CLOCK_MONOTONIC
+#define RT_CLOCK_RESYNC_NS 1000000000LL
+
+/**
+ * @brief Выбирает источник времени для горячего пути замеров.
+ *
+ * На x86 с invariant TSC (CPUID 0x80000007, EDX бит 8), если ядро само
+ * использует clocksource tsc, частота TSC калибруется по CLOCK_MONOTONIC
+ * (~50 мс), и rt_clock_now_ns() дальше читает rdtsc вместо системного
+ * вызова. Иначе, а также при RT_CLOCK=monotonic в окружении, используется
+ * clock_gettime(CLOCK_MONOTONIC) через vDSO.
+ *
+ * Показания в обоих случаях - наносекунды в шкале CLOCK_MONOTONIC, их можно
+ * сравнивать с дедлайнами clock_nanosleep. Раз в RT_CLOCK_RESYNC_NS привязка
+ * обновляется, поэтому коррекция NTP не накапливается. Обновление делает
+ * только rt_clock_now_ns() перед чтением TSC, rt_clock_end_ns() его не
+ * делает: калибровка не попадает внутрь замера.
+ *
+ * До вызова (или если он не вызывался) функции работают через clock_gettime.
+ *
+ * @return 1, если выбран TSC, 0 - clock_gettime.
+ */
+int rt_clock_init(void);
+
+// Время начала замера: при необходимости переанкеровка, затем lfence; rdtsc
+// (чтение не уходит раньше предыдущего кода)
+int64_t rt_clock_now_ns(void);
+
+// Время конца замера: rdtscp; lfence (измеряемый код завершился до чтения)
+int64_t rt_clock_end_ns(void);
+
+// Медиана интервала rt_clock_now_ns() -> rt_clock_end_ns() без работы между ними,
+// ее вычитают из каждого замера
+int64_t rt_clock_overhead_ns(void);
+
+// "tsc" или "clock_gettime"
+const char* rt_clock_source(void);
+
+// Откалиброванная частота TSC в ГГц, 0 - TSC не используется
+double rt_clock_tsc_ghz(void);
+
+#endif // RT_CLOCK_H
@@ -0,0 +1,209 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_init.h"
+#include <alloca.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Запас стека под сам rt_init и вызывающих сверх прогретого
+#define RT_INIT_STACK_MARGIN (64 * 1024)
+
+void rt_init_config_default(RtInitConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->policy = SCHED_FIFO;
+    config->priority = 50;
+    config->cpu = -1;
+    config->lock_memory = 1;
+    config->disable_thp = 1;
+    config->stack_bytes = 256 * 1024;
+}
+
+static void step_result(RtInitStep* step, int ok) {
+    step->status = ok ? RT_INIT_APPLIED : RT_INIT_FAILED;
+    step->error = ok ? 0 : errno;
+}
+
+static size_t page_size(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+}
+
+// noinline: кадр с alloca должен лежать ниже кадра вызывающего
+__attribute__((noinline)) void rt_prefault_stack(size_t bytes) {
+    if (bytes == 0) return;
+    volatile unsigned char* stack = alloca(bytes);
+    size_t page = page_size();
+    // От вершины вниз, в порядке роста стека: ядро расширяет его постранично
+    for (size_t off = bytes; off >= page; off -= page) stack[off - 1] = 0;
+    stack[0] = 0;
+}
+
+static int prefault_heap(size_t bytes) {
+    unsigned char* heap = malloc(bytes);
+    if (!heap) return -1;
+    size_t page = page_size();
+    for (size_t off = 0; off < bytes; off += page) ((volatile unsigned char*)heap)[off] = 0;
+    // После M_TRIM_THRESHOLD = -1 страницы остаются у malloc для следующих выделений
+    free(heap);
+    return 0;
+}
+
+// Одна строка файла без перевода строки; -1, если не прочитать
+static int read_line(const char* path, char* buf, size_t len) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char* line = fgets(buf, (int)len, f);
+    fclose(f);
+    if (!line) {
+        buf[0] = '\0';
+        return 0;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Есть ли cpu в списке вида "1-3,6"
+static int cpu_in_list(const char* list, int cpu) {
+    const char* p = list;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) return 0;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) return 0;
+        }
+        if (cpu >= first && cpu <= last) return 1;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',') break;
+    }
+    return 0;
+}
+
+// Выбранный режим из строки вида "always defer [madvise] never"
+static void bracketed(const char* line, char* out, size_t len) {
+    const char* open = strchr(line, '[');
+    const char* close = open ? strchr(open, ']') : NULL;
+    if (open && close) {
+        snprintf(out, len, "%.*s", (int)(close - open - 1), open + 1);
+    } else {
+        snprintf(out, len, "%.*s", (int)len - 1, line);
+    }
+}
+
+static void check_cpu(RtInitReport* r) {
+    r->cpu = sched_getcpu();
+    r->cpu_isolated = r->cpu_nohz_full = -1;
+    if (read_line("/sys/devices/system/cpu/isolated", r->isolated, sizeof(r->isolated)) == 0 && r->cpu >= 0) {
+        r->cpu_isolated = cpu_in_list(r->isolated, r->cpu);
+    }
+    if (read_line("/sys/devices/system/cpu/nohz_full", r->nohz_full, sizeof(r->nohz_full)) == 0 && r->cpu >= 0) {
+        // "(null)" - ядро собрано с NO_HZ_FULL, но список пуст
+        r->cpu_nohz_full = strcmp(r->nohz_full, "(null)") != 0 && cpu_in_list(r->nohz_full, r->cpu);
+    }
+    char line[128];
+    if (read_line("/sys/kernel/mm/transparent_hugepage/defrag", line, sizeof(line)) == 0) {
+        bracketed(line, r->thp_defrag, sizeof(r->thp_defrag));
+    }
+}
+
+int rt_init(const RtInitConfig* config, RtInitReport* report) {
+    RtInitReport local;
+    RtInitReport* r = report ? report : &local;
+    memset(r, 0, sizeof(*r));
+    r->config = *config;
+
+    if (config->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config->cpu, &set);
+        step_result(&r->affinity, sched_setaffinity(0, sizeof(set), &set) == 0);
+    }
+
+    if (config->disable_thp) step_result(&r->thp, prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) == 0);
+
+    if (config->heap_bytes) {
+        // Без этого free() вернет прогретые страницы, а крупный malloc возьмет новые через mmap
+        int ok = mallopt(M_TRIM_THRESHOLD, -1) && mallopt(M_MMAP_MAX, 0);
+        errno = ok ? 0 : EINVAL;
+        step_result(&r->malloc_tuning, ok);
+    }
+
+    if (config->lock_memory) step_result(&r->memlock, mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+
+    if (config->stack_bytes) {
+        size_t bytes = config->stack_bytes;
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+            bytes + RT_INIT_STACK_MARGIN > rl.rlim_cur) {
+            bytes = rl.rlim_cur > 2 * RT_INIT_STACK_MARGIN ? rl.rlim_cur - 2 * RT_INIT_STACK_MARGIN : 0;
+        }
+        r->config.stack_bytes = bytes;
+        rt_prefault_stack(bytes);
+        errno = ERANGE;
+        step_result(&r->stack, bytes == config->stack_bytes);
+    }
+
+    if (config->heap_bytes) step_result(&r->heap, prefault_heap(config->heap_bytes) == 0);
+
+    if (config->policy != SCHED_OTHER) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = config->priority;
+        step_result(&r->sched, sched_setscheduler(0, config->policy, &sp) == 0);
+    }
+
+    check_cpu(r);
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        r->minor_faults = ru.ru_minflt;
+        r->major_faults = ru.ru_majflt;
+    }
+
+    const RtInitStep* steps[] = {&r->affinity, &r->thp, &r->malloc_tuning, &r->memlock,
+                                 &r->stack, &r->heap, &r->sched};
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        if (steps[i]->status == RT_INIT_FAILED) return -1;
+    }
+    return 0;
+}
+
+static void print_step(FILE* out, const char* name, const RtInitStep* step, const char* detail) {
+    if (step->status == RT_INIT_SKIPPED) return;
+    fprintf(out, "  %-10s %-7s %s%s%s\n", name, step->status == RT_INIT_APPLIED ? "ok" : "FAILED", detail,
+            step->status == RT_INIT_FAILED ? ": " : "", step->status == RT_INIT_FAILED ? strerror(step->error) : "");
+}
+
+static const char* yes_no(int v) {
+    return v < 0 ? "unknown" : v ? "yes" : "no";
+}
+
+void rt_init_print_report(FILE* out, const RtInitReport* report) {
+    const RtInitConfig* c = &report->config;
+    char detail[64];
+    fprintf(out, "rt_init:\n");
+    snprintf(detail, sizeof(detail), "cpu %d", c->cpu);
+    print_step(out, "affinity", &report->affinity, detail);
+    print_step(out, "thp", &report->thp, "PR_SET_THP_DISABLE");
+    print_step(out, "malloc", &report->malloc_tuning, "no trim, no mmap");
+    print_step(out, "mlockall", &report->memlock, "MCL_CURRENT | MCL_FUTURE");
+    snprintf(detail, sizeof(detail), "%zu KB prefaulted", c->stack_bytes / 1024);
+    print_step(out, "stack", &report->stack, detail);
+    snprintf(detail, sizeof(detail), "%zu KB prefaulted", c->heap_bytes / 1024);
+    print_step(out, "heap", &report->heap, detail);
+    snprintf(detail, sizeof(detail), "%s %d", c->policy == SCHED_RR ? "SCHED_RR" : "SCHED_FIFO", c->priority);
+    print_step(out, "scheduler", &report->sched, detail);
+    fprintf(out, "  cpu %d: isolcpus %s, nohz_full %s; THP defrag %s\n", report->cpu, yes_no(report->cpu_isolated),
+            yes_no(report->cpu_nohz_full), report->thp_defrag[0] ? report->thp_defrag : "unknown");
+    fprintf(out, "  page faults so far: %ld minor, %ld major\n", report->minor_faults, report->major_faults);
+}
@@ -0,0 +1,84 @@
+#ifndef RT_INIT_H
+#define RT_INIT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Подготовка процесса реального времени одним вызовом в начале main(),
+ * до создания потоков.
+ *
+ * rt_init() по порядку: привязывает вызывающий поток к ядру (потоки,
+ * созданные после, наследуют маску), отключает прозрачные huge pages для
+ * процесса (khugepaged и компакция не трогают его страницы), запрещает
+ * malloc отдавать память системе и брать ее через mmap, блокирует память
+ * (mlockall), прогревает стек вызывающего потока и резерв кучи и последним
+ * шагом переключает поток на политику реального времени. Заодно читает из
+ * sysfs, изолировано ли ядро (isolcpus) и работает ли на нем nohz_full.
+ *
+ * Неудачный шаг не прерывает остальные: что применилось, видно в отчете
+ * RtInitReport, а решает - падать или продолжать - вызывающий.
+ *
+ * Стеки потоков, созданных позже, прогревает сам поток в начале своей
+ * функции через rt_prefault_stack(). Прогрев кучи касается основной арены
+ * malloc: потоки с собственными аренами получают страницы при первом
+ * обращении (mlockall с MCL_FUTURE блокирует их, но не заранее).
+ */
+
+typedef struct {
+    int policy;             // SCHED_FIFO или SCHED_RR; SCHED_OTHER - не менять
+    int priority;
+    int cpu;                // Ядро для привязки, -1 - не привязывать
+    int lock_memory;        // mlockall(MCL_CURRENT | MCL_FUTURE)
+    int disable_thp;        // prctl(PR_SET_THP_DISABLE)
+    size_t stack_bytes;     // Прогреть столько стека вызывающего потока
+    size_t heap_bytes;      // Прогреть и удержать столько кучи malloc
+} RtInitConfig;
+
+typedef enum {
+    RT_INIT_SKIPPED,        // Не запрошено
+    RT_INIT_APPLIED,
+    RT_INIT_FAILED
+} RtInitStatus;
+
+typedef struct {
+    RtInitStatus status;
+    int error;              // errno для RT_INIT_FAILED
+} RtInitStep;
+
+typedef struct {
+    RtInitConfig config;    // С чем вызван rt_init (stack_bytes - после ограничения RLIMIT_STACK)
+    RtInitStep affinity;
+    RtInitStep thp;
+    RtInitStep malloc_tuning;
+    RtInitStep memlock;
+    RtInitStep stack;
+    RtInitStep heap;
+    RtInitStep sched;
+    int cpu;                // Где поток выполняется после rt_init
+    int cpu_isolated;       // Ядро cpu в isolcpus: 1/0, -1 - неизвестно
+    int cpu_nohz_full;      // То же для nohz_full
+    char isolated[64];      // Списки ядер из /sys/devices/system/cpu
+    char nohz_full[64];
+    char thp_defrag[32];    // Режим дефрагментации THP системы
+    long minor_faults;      // ru_minflt процесса в конце rt_init
+    long major_faults;
+} RtInitReport;
+
+// SCHED_FIFO 50 без привязки, mlockall, без THP, 256 КБ стека, без резерва кучи
+void rt_init_config_default(RtInitConfig* config);
+
+/**
+ * @brief Применяет config к процессу и вызывающему потоку.
+ * @param report Может быть NULL.
+ * @return 0, если применилось все запрошенное, иначе -1 (подробности в report).
+ */
+int rt_init(const RtInitConfig* config, RtInitReport* report);
+
+// По строке на шаг: что запрошено, применилось ли и почему нет
+void rt_init_print_report(FILE* out, const RtInitReport* report);
+
+// Прогревает bytes стека текущего потока (в начале функции потока)
+void rt_prefault_stack(size_t bytes);
+
+#endif // RT_INIT_H
@@ -0,0 +1,384 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_isr.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "rt_time.h"
+
+#define RT_ISR_EPOLL_BATCH 32
+#define RT_ISR_SIGNAL_BATCH 16
+// Метки epoll для внутренних дескрипторов, после номеров источников
+#define TAG_SIGNALFD RT_ISR_MAX_SOURCES
+#define TAG_STOP     (RT_ISR_MAX_SOURCES + 1)
+
+typedef struct {
+    RtIsrKind kind;
+    int priority;
+    int fd;                 // Дескриптор пользователя или свой timerfd
+    int signo;
+    RtIsrFn fn;
+    void* arg;
+    int64_t period_ns;
+    int64_t next_ns;        // Для таймера - ближайший срок
+    RtIsrSourceStats stats;
+} Source;
+
+typedef struct {
+    RtDsrFn fn;
+    void* arg;
+    uint64_t data;
+    int64_t queued_ns;
+} Dsr;
+
+typedef struct {
+    Dsr items[RT_ISR_DSR_DEPTH];
+    unsigned head;
+    unsigned count;
+} DsrQueue;
+
+// Событие пробуждения до вызова ISR: сортируется по приоритету
+typedef struct {
+    Source* source;
+    RtIsrEvent event;
+    struct signalfd_siginfo info;
+} Pending;
+
+struct RtIsr {
+    int epoll_fd;
+    int signal_fd;
+    int stop_fd;
+    sigset_t signals;
+    int signal_source[_NSIG];   // signo -> номер источника + 1
+    Source sources[RT_ISR_MAX_SOURCES];
+    int count;
+    DsrQueue dsr[RT_ISR_LEVELS];
+    unsigned dsr_pending;
+    atomic_int stopping;
+    RtIsrStats stats;
+};
+
+RtIsr* rt_isr_create(void) {
+    RtIsr* isr = calloc(1, sizeof(*isr));
+    if (!isr) return NULL;
+    isr->signal_fd = -1;
+    sigemptyset(&isr->signals);
+    isr->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    isr->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = TAG_STOP};
+    if (isr->epoll_fd < 0 || isr->stop_fd < 0 || epoll_ctl(isr->epoll_fd, EPOLL_CTL_ADD, isr->stop_fd, &ev) < 0) {
+        int saved = errno;
+        rt_isr_destroy(isr);
+        errno = saved;
+        return NULL;
+    }
+    return isr;
+}
+
+void rt_isr_destroy(RtIsr* isr) {
+    if (!isr) return;
+    for (int i = 0; i < isr->count; i++) {
+        if (isr->sources[i].kind == RT_ISR_TIMER) close(isr->sources[i].fd);
+    }
+    if (isr->signal_fd >= 0) close(isr->signal_fd);
+    if (isr->stop_fd >= 0) close(isr->stop_fd);
+    if (isr->epoll_fd >= 0) close(isr->epoll_fd);
+    free(isr);
+}
+
+static Source* new_source(RtIsr* isr, RtIsrKind kind, int priority, RtIsrFn fn) {
+    if (priority < 0 || priority >= RT_ISR_LEVELS || !fn) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (isr->count == RT_ISR_MAX_SOURCES) {
+        errno = ENOSPC;
+        return NULL;
+    }
+    Source* s = &isr->sources[isr->count];
+    memset(s, 0, sizeof(*s));
+    s->kind = kind;
+    s->priority = priority;
+    s->fd = -1;
+    s->fn = fn;
+    s->stats.kind = kind;
+    s->stats.priority = priority;
+    return s;
+}
+
+static int watch(RtIsr* isr, int fd, uint32_t tag) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = tag};
+    return epoll_ctl(isr->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int rt_isr_add_signal(RtIsr* isr, int signo, int priority, RtIsrFn fn, void* arg) {
+    if (signo <= 0 || signo >= _NSIG || isr->signal_source[signo]) {
+        errno = EINVAL;
+        return -1;
+    }
+    Source* s = new_source(isr, RT_ISR_SIGNAL, priority, fn);
+    if (!s) return -1;
+    s->signo = signo;
+    s->arg = arg;
+
+    // Заблокированный сигнал не вызывает обработчик и ждет в signalfd
+    sigset_t one, old;
+    sigemptyset(&one);
+    sigaddset(&one, signo);
+    int rc = pthread_sigmask(SIG_BLOCK, &one, &old);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    sigaddset(&isr->signals, signo);
+    int fd = signalfd(isr->signal_fd, &isr->signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd >= 0 && isr->signal_fd < 0) {
+        if (watch(isr, fd, TAG_SIGNALFD) == 0) {
+            isr->signal_fd = fd;
+        } else {
+            int err = errno;
+            close(fd);
+            errno = err;
+            fd = -1;
+        }
+    }
+    if (fd < 0) {
+        // Не оставлять сигнал заблокированным: без источника его никто не прочтет
+        int err = errno;
+        sigdelset(&isr->signals, signo);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        errno = err;
+        return -1;
+    }
+    isr->signal_source[signo] = isr->count + 1;
+    return isr->count++;
+}
+
+int rt_isr_add_fd(RtIsr* isr, int fd, int priority, RtIsrFn fn, void* arg) {
+    Source* s = new_source(isr, RT_ISR_FD, priority, fn);
+    if (!s) return -1;
+    s->fd = fd;
+    s->arg = arg;
+    if (watch(isr, fd, (uint32_t)isr->count) < 0) return -1;
+    return isr->count++;
+}
+
+int rt_isr_add_timer(RtIsr* isr, int64_t period_ns, int64_t first_ns, int priority, RtIsrFn fn, void* arg) {
+    if (period_ns <= 0 || first_ns < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    Source* s = new_source(isr, RT_ISR_TIMER, priority, fn);
+    if (!s) return -1;
+    s->arg = arg;
+    s->period_ns = period_ns;
+    s->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (s->fd < 0) return -1;
+    // Абсолютные сроки: опоздание считается от них, период не дрейфует
+    s->next_ns = rt_now_ns() + (first_ns ? first_ns : period_ns);
+    struct itimerspec its;
+    rt_ns_to_timespec(s->next_ns, &its.it_value);
+    rt_ns_to_timespec(period_ns, &its.it_interval);
+    if (timerfd_settime(s->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0 || watch(isr, s->fd, (uint32_t)isr->count) < 0) {
+        int saved = errno;
+        close(s->fd);
+        errno = saved;
+        return -1;
+    }
+    return isr->count++;
+}
+
+int rt_isr_defer(RtIsr* isr, int priority, RtDsrFn fn, void* arg, uint64_t data) {
+    if (priority < 0 || priority >= RT_ISR_LEVELS || !fn) {
+        errno = EINVAL;
+        return -1;
+    }
+    DsrQueue* q = &isr->dsr[priority];
+    if (q->count == RT_ISR_DSR_DEPTH) {
+        isr->stats.dsr_dropped++;
+        errno = ENOBUFS;
+        return -1;
+    }
+    Dsr* d = &q->items[(q->head + q->count) % RT_ISR_DSR_DEPTH];
+    d->fn = fn;
+    d->arg = arg;
+    d->data = data;
+    d->queued_ns = rt_now_ns();
+    q->count++;
+    isr->dsr_pending++;
+    return 0;
+}
+
+void rt_isr_stop(RtIsr* isr) {
+    atomic_store(&isr->stopping, 1);
+    uint64_t one = 1;
+    ssize_t n = write(isr->stop_fd, &one, sizeof(one));
+    (void)n;
+}
+
+// Сигналы из signalfd: по событию на каждый, с приоритетом его источника
+static int collect_signals(RtIsr* isr, Pending* out, int room) {
+    struct signalfd_siginfo info[RT_ISR_SIGNAL_BATCH];
+    int got = 0;
+    while (got < room) {
+        int want = room - got < RT_ISR_SIGNAL_BATCH ? room - got : RT_ISR_SIGNAL_BATCH;
+        ssize_t n = read(isr->signal_fd, info, (size_t)want * sizeof(info[0]));
+        if (n <= 0) break;
+        for (size_t i = 0; i < (size_t)n / sizeof(info[0]); i++) {
+            int idx = info[i].ssi_signo < _NSIG ? isr->signal_source[info[i].ssi_signo] - 1 : -1;
+            if (idx < 0) continue;
+            Pending* p = &out[got++];
+            memset(&p->event, 0, sizeof(p->event));
+            p->source = &isr->sources[idx];
+            p->info = info[i];
+            p->event.fd = -1;
+        }
+        if ((size_t)n < (size_t)want * sizeof(info[0])) break;
+    }
+    return got;
+}
+
+static int collect_timer(Source* s, Pending* p, int64_t wake_ns) {
+    uint64_t expirations;
+    if (read(s->fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations) || expirations == 0) return 0;
+    memset(&p->event, 0, sizeof(p->event));
+    p->source = s;
+    p->event.count = expirations;
+    // Опоздание - от последнего из сработавших сроков
+    int64_t last_ns = s->next_ns + (int64_t)(expirations - 1) * s->period_ns;
+    p->event.late_ns = wake_ns - last_ns;
+    s->next_ns = last_ns + s->period_ns;
+    s->stats.overruns += expirations - 1;
+    if (p->event.late_ns > s->stats.max_late_ns) s->stats.max_late_ns = p->event.late_ns;
+    return 1;
+}
+
+static void dispatch(RtIsr* isr, const struct epoll_event* evs, int n) {
+    Pending pending[RT_ISR_EPOLL_BATCH + RT_ISR_SIGNAL_BATCH];
+    const int room = (int)(sizeof(pending) / sizeof(pending[0]));
+    int count = 0;
+    int64_t wake_ns = rt_now_ns();
+    isr->stats.wakeups++;
+
+    for (int i = 0; i < n && count < room; i++) {
+        uint32_t tag = evs[i].data.u32;
+        if (tag == TAG_STOP) continue;
+        if (tag == TAG_SIGNALFD) {
+            count += collect_signals(isr, &pending[count], room - count);
+            continue;
+        }
+        Source* s = &isr->sources[tag];
+        if (s->kind == RT_ISR_TIMER) {
+            count += collect_timer(s, &pending[count], wake_ns);
+            continue;
+        }
+        Pending* p = &pending[count++];
+        memset(&p->event, 0, sizeof(p->event));
+        p->source = s;
+        p->event.fd = s->fd;
+        p->event.events = evs[i].events;
+    }
+
+    // Вставками по убыванию приоритета, равные - в порядке прихода
+    for (int i = 1; i < count; i++) {
+        Pending tmp = pending[i];
+        int j = i;
+        for (; j > 0 && pending[j - 1].source->priority < tmp.source->priority; j--) pending[j] = pending[j - 1];
+        pending[j] = tmp;
+    }
+
+    for (int i = 0; i < count; i++) {
+        Pending* p = &pending[i];
+        Source* s = p->source;
+        p->event.kind = s->kind;
+        p->event.source = (int)(s - isr->sources);
+        p->event.wake_ns = wake_ns;
+        if (s->kind == RT_ISR_SIGNAL) p->event.info = &p->info;
+        int64_t start = rt_now_ns();
+        s->fn(isr, &p->event, s->arg);
+        int64_t took = rt_now_ns() - start;
+        s->stats.events++;
+        if (took > s->stats.max_isr_ns) s->stats.max_isr_ns = took;
+    }
+}
+
+// Одна DSR с самого высокого непустого уровня
+static void run_one_dsr(RtIsr* isr) {
+    for (int level = RT_ISR_LEVELS - 1; level >= 0; level--) {
+        DsrQueue* q = &isr->dsr[level];
+        if (q->count == 0) continue;
+        Dsr d = q->items[q->head];
+        q->head = (q->head + 1) % RT_ISR_DSR_DEPTH;
+        q->count--;
+        isr->dsr_pending--;
+        int64_t start = rt_now_ns();
+        if (start - d.queued_ns > isr->stats.max_dsr_wait_ns) isr->stats.max_dsr_wait_ns = start - d.queued_ns;
+        d.fn(isr, d.arg, d.data);
+        int64_t took = rt_now_ns() - start;
+        if (took > isr->stats.max_dsr_ns) isr->stats.max_dsr_ns = took;
+        isr->stats.dsr_run++;
+        return;
+    }
+}
+
+int rt_isr_run(RtIsr* isr) {
+    struct epoll_event evs[RT_ISR_EPOLL_BATCH];
+    while (!atomic_load(&isr->stopping)) {
+        // Есть отложенная работа - только проверить новые события, не спать
+        int n = epoll_wait(isr->epoll_fd, evs, RT_ISR_EPOLL_BATCH, isr->dsr_pending ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n > 0) dispatch(isr, evs, n);
+        if (isr->dsr_pending && !atomic_load(&isr->stopping)) run_one_dsr(isr);
+    }
+    uint64_t drained;
+    ssize_t r = read(isr->stop_fd, &drained, sizeof(drained));
+    (void)r;
+    atomic_store(&isr->stopping, 0);
+    return 0;
+}
+
+void rt_isr_get_stats(const RtIsr* isr, RtIsrStats* stats) {
+    *stats = isr->stats;
+}
+
+int rt_isr_source_stats(const RtIsr* isr, int source, RtIsrSourceStats* stats) {
+    if (source < 0 || source >= isr->count) return -1;
+    *stats = isr->sources[source].stats;
+    return 0;
+}
+
+void rt_isr_print_stats(FILE* out, const RtIsr* isr) {
+    static const char* kinds[] = {"signal", "fd", "timer"};
+    fprintf(out, "%-3s %-7s %4s %10s %12s %12s %9s\n", "id", "kind", "prio", "events", "max isr us", "max late us",
+            "overruns");
+    for (int i = 0; i < isr->count; i++) {
+        const Source* s = &isr->sources[i];
+        char what[16];
+        if (s->kind == RT_ISR_SIGNAL) {
+            snprintf(what, sizeof(what), "sig%d", s->signo);
+        } else {
+            snprintf(what, sizeof(what), "%s", kinds[s->kind]);
+        }
+        fprintf(out, "%-3d %-7s %4d %10llu %12.1f", i, what, s->priority, (unsigned long long)s->stats.events,
+                s->stats.max_isr_ns / 1e3);
+        if (s->kind == RT_ISR_TIMER) {
+            fprintf(out, " %12.1f %9llu\n", s->stats.max_late_ns / 1e3, (unsigned long long)s->stats.overruns);
+        } else {
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "%llu wakeups, %llu DSR run (max %.1f us, max wait %.1f us), %llu DSR dropped\n",
+            (unsigned long long)isr->stats.wakeups, (unsigned long long)isr->stats.dsr_run, isr->stats.max_dsr_ns / 1e3,
+            isr->stats.max_dsr_wait_ns / 1e3, (unsigned long long)isr->stats.dsr_dropped);
+}
@@ -0,0 +1,100 @@
+#ifndef RT_ISR_H
+#define RT_ISR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/signalfd.h>
+
+/*
+ * Служба "прерываний" в user space: сигналы (signalfd), дескрипторы
+ * (клавиатура, сокеты) и периодические таймеры (timerfd, CLOCK_MONOTONIC)
+ * ждут в одном epoll_wait одного потока. Ни флагов sig_atomic_t, ни
+ * опроса: поток спит, пока нет событий, и просыпается один раз на пачку.
+ *
+ * Как в RTOS, обработка разделена на две части:
+ *
+ *   ISR (RtIsrFn) - вызывается сразу после пробуждения, в порядке
+ *   приоритета источника (больше - раньше). Должна быть короткой:
+ *   забрать данные, отметить время и отложить остальное;
+ *
+ *   DSR (RtDsrFn) - отложенная работа из rt_isr_defer(). Очереди DSR по
+ *   уровням приоритета выполняются после всех ISR пробуждения, по одной
+ *   DSR за раз: между DSR служба без ожидания проверяет epoll, и новое
+ *   прерывание обслуживается раньше оставшейся отложенной работы.
+ *
+ * Время реакции ISR ограничено одним пробуждением плюс одной DSR, которая
+ * выполнялась в момент события. Сигналы блокируются rt_isr_add_signal()
+ * в вызывающем потоке: регистрируйте их до создания других потоков, чтобы
+ * те унаследовали маску и сигнал не ушел в обычный обработчик.
+ *
+ * Регистрация, rt_isr_defer() и rt_isr_run() - только из потока службы
+ * (или до запуска); rt_isr_stop() - из любого потока.
+ */
+
+#define RT_ISR_MAX_SOURCES 32
+#define RT_ISR_LEVELS      4    // Уровни приоритета 0..3 для ISR и DSR
+#define RT_ISR_DSR_DEPTH   64   // Отложенных работ на уровень
+
+typedef struct RtIsr RtIsr;
+
+typedef enum {
+    RT_ISR_SIGNAL,
+    RT_ISR_FD,
+    RT_ISR_TIMER
+} RtIsrKind;
+
+typedef struct {
+    RtIsrKind kind;
+    int source;             // Номер источника из rt_isr_add_*
+    int fd;                 // Для RT_ISR_FD - дескриптор (данные читает ISR)
+    uint32_t events;        // Для RT_ISR_FD - EPOLLIN/EPOLLHUP/...
+    const struct signalfd_siginfo* info; // Для RT_ISR_SIGNAL - кто и чем послал
+    uint64_t count;         // Для RT_ISR_TIMER - срабатываний с прошлого раза (> 1 - пропуски)
+    int64_t wake_ns;        // Когда служба проснулась (CLOCK_MONOTONIC)
+    int64_t late_ns;        // Для RT_ISR_TIMER - пробуждение после срока срабатывания
+} RtIsrEvent;
+
+typedef void (*RtIsrFn)(RtIsr* isr, const RtIsrEvent* event, void* arg);
+typedef void (*RtDsrFn)(RtIsr* isr, void* arg, uint64_t data);
+
+typedef struct {
+    RtIsrKind kind;
+    int priority;
+    uint64_t events;
+    int64_t max_isr_ns;     // Самая долгая ISR
+    int64_t max_late_ns;    // Для таймера - худшее опоздание пробуждения
+    uint64_t overruns;      // Для таймера - пропущенные срабатывания
+} RtIsrSourceStats;
+
+typedef struct {
+    uint64_t wakeups;
+    uint64_t dsr_run;
+    uint64_t dsr_dropped;   // Очередь уровня была полна
+    int64_t max_dsr_ns;     // Самая долгая DSR
+    int64_t max_dsr_wait_ns; // От rt_isr_defer до начала DSR
+} RtIsrStats;
+
+RtIsr* rt_isr_create(void);
+void rt_isr_destroy(RtIsr* isr);
+
+/**
+ * @brief Источники. priority - 0..RT_ISR_LEVELS-1, больше - раньше.
+ * @return Номер источника или -1 (errno).
+ */
+int rt_isr_add_signal(RtIsr* isr, int signo, int priority, RtIsrFn fn, void* arg);
+int rt_isr_add_fd(RtIsr* isr, int fd, int priority, RtIsrFn fn, void* arg);
+// Первое срабатывание через first_ns (0 - через period_ns), дальше каждые period_ns
+int rt_isr_add_timer(RtIsr* isr, int64_t period_ns, int64_t first_ns, int priority, RtIsrFn fn, void* arg);
+
+// Отложить fn на уровень priority; 0 или -1, если очередь уровня полна
+int rt_isr_defer(RtIsr* isr, int priority, RtDsrFn fn, void* arg, uint64_t data);
+
+// Цикл службы до rt_isr_stop(); 0 или -1 (ошибка epoll, errno)
+int rt_isr_run(RtIsr* isr);
+void rt_isr_stop(RtIsr* isr);
+
+void rt_isr_get_stats(const RtIsr* isr, RtIsrStats* stats);
+int rt_isr_source_stats(const RtIsr* isr, int source, RtIsrSourceStats* stats);
+void rt_isr_print_stats(FILE* out, const RtIsr* isr);
+
+#endif // RT_ISR_H
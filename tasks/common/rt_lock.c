@@ -0,0 +1,273 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_lock.h"
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "rt_stats.h"
+#include "rt_time.h"
+
+#define RT_LOCK_NO_OWNER INT_MAX    // Свободный мьютекс: ожидающий не считается срочнее
+
+struct RtLockStats {
+    RtHistogram wait;
+    RtHistogram hold;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t inversions;
+    int64_t max_hold_ns;
+    int max_hold_tid;
+};
+
+#if RT_LOCK_STATS
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static RtLock* registry;
+#endif
+
+const char* rt_lock_protocol_name(RtLockProtocol protocol) {
+    switch (protocol) {
+    case RT_LOCK_PLAIN: return "none";
+    case RT_LOCK_INHERIT: return "inherit";
+    case RT_LOCK_PROTECT: return "protect";
+    }
+    return "?";
+}
+
+int rt_lock_init(RtLock* lock, const char* name, RtLockProtocol protocol, int ceiling) {
+    memset(lock, 0, sizeof(*lock));
+    pthread_mutexattr_t attr;
+    int rc = pthread_mutexattr_init(&attr);
+    if (rc != 0) return rc;
+    if (protocol == RT_LOCK_INHERIT) {
+        rc = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    } else if (protocol == RT_LOCK_PROTECT) {
+        rc = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_PROTECT);
+        if (rc == 0) rc = pthread_mutexattr_setprioceiling(&attr, ceiling);
+    }
+    if (rc == 0) rc = pthread_mutex_init(&lock->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) return rc;
+
+#if RT_LOCK_STATS
+    lock->stats = calloc(1, sizeof(RtLockStats));
+    if (!lock->stats) {
+        pthread_mutex_destroy(&lock->mutex);
+        return ENOMEM;
+    }
+    rt_hist_init(&lock->stats->wait);
+    rt_hist_init(&lock->stats->hold);
+    lock->name = name ? name : "(unnamed)";
+    lock->protocol = protocol;
+    lock->owner_prio = RT_LOCK_NO_OWNER;
+
+    pthread_mutex_lock(&registry_lock);
+    lock->next = registry;
+    registry = lock;
+    pthread_mutex_unlock(&registry_lock);
+#else
+    (void)name;
+#endif
+    return 0;
+}
+
+void rt_lock_destroy(RtLock* lock) {
+#if RT_LOCK_STATS
+    pthread_mutex_lock(&registry_lock);
+    for (RtLock** p = &registry; *p; p = &(*p)->next) {
+        if (*p == lock) {
+            *p = lock->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    free(lock->stats);
+    lock->stats = NULL;
+#endif
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+#if RT_LOCK_STATS
+
+// Базовый (без наследования) приоритет вызывающего потока; 0 - не RT
+static int self_prio(void) {
+    int policy;
+    struct sched_param sp;
+    if (pthread_getschedparam(pthread_self(), &policy, &sp) != 0) return 0;
+    return (policy == SCHED_FIFO || policy == SCHED_RR) ? sp.sched_priority : 0;
+}
+
+static int self_tid(void) {
+    static _Thread_local int tid;
+    if (tid == 0) tid = (int)syscall(SYS_gettid);
+    return tid;
+}
+
+// Вызывается владельцем сразу после захвата
+static void mark_acquired(RtLock* lock, int64_t now, int64_t wait_ns, int contended, int inverted) {
+    RtLockStats* s = lock->stats;
+    s->acquisitions++;
+    s->contended += (uint64_t)contended;
+    s->inversions += (uint64_t)inverted;
+    rt_hist_record(&s->wait, wait_ns);
+    __atomic_store_n(&lock->owner_prio, self_prio(), __ATOMIC_RELAXED);
+    lock->owner_tid = self_tid();
+    lock->acquired_ns = now;
+}
+
+// Вызывается владельцем перед освобождением
+static void mark_released(RtLock* lock) {
+    RtLockStats* s = lock->stats;
+    int64_t hold = rt_now_ns() - lock->acquired_ns;
+    rt_hist_record(&s->hold, hold);
+    if (hold > s->max_hold_ns) {
+        s->max_hold_ns = hold;
+        s->max_hold_tid = lock->owner_tid;
+    }
+    __atomic_store_n(&lock->owner_prio, RT_LOCK_NO_OWNER, __ATOMIC_RELAXED);
+}
+
+int rt_lock_lock(RtLock* lock) {
+    int rc = pthread_mutex_trylock(&lock->mutex);
+    if (rc == 0) {
+        mark_acquired(lock, rt_now_ns(), 0, 0, 0);
+        return 0;
+    }
+    if (rc != EBUSY) return rc;
+
+    // Медленный путь: мьютекс занят, замеряем ожидание
+    int64_t start = rt_now_ns();
+    int inverted = self_prio() > __atomic_load_n(&lock->owner_prio, __ATOMIC_RELAXED);
+    rc = pthread_mutex_lock(&lock->mutex);
+    if (rc != 0) return rc;
+    int64_t now = rt_now_ns();
+    mark_acquired(lock, now, now - start, 1, inverted);
+    return 0;
+}
+
+int rt_lock_trylock(RtLock* lock) {
+    int rc = pthread_mutex_trylock(&lock->mutex);
+    if (rc == 0) mark_acquired(lock, rt_now_ns(), 0, 0, 0);
+    return rc;
+}
+
+int rt_lock_unlock(RtLock* lock) {
+    mark_released(lock);
+    return pthread_mutex_unlock(&lock->mutex);
+}
+
+int rt_lock_cond_wait(RtLock* lock, pthread_cond_t* cond) {
+    mark_released(lock);
+    int rc = pthread_cond_wait(cond, &lock->mutex);
+    // Повторный захват после сигнала не считается ожиданием мьютекса
+    mark_acquired(lock, rt_now_ns(), 0, 0, 0);
+    return rc;
+}
+
+int rt_lock_summary(RtLock* lock, RtLockSummary* out) {
+    memset(out, 0, sizeof(*out));
+    // Для RT_LOCK_PROTECT вызывающий выше потолка получит EINVAL: замеры не читаем
+    int rc = pthread_mutex_lock(&lock->mutex);
+    if (rc != 0) return rc;
+    const RtLockStats* s = lock->stats;
+    out->acquisitions = s->acquisitions;
+    out->contended = s->contended;
+    out->inversions = s->inversions;
+    out->wait_p50_ns = rt_hist_percentile(&s->wait, 50.0);
+    out->wait_p99_ns = rt_hist_percentile(&s->wait, 99.0);
+    out->wait_max_ns = s->wait.total ? s->wait.max : 0;
+    out->hold_p50_ns = rt_hist_percentile(&s->hold, 50.0);
+    out->hold_p99_ns = rt_hist_percentile(&s->hold, 99.0);
+    out->hold_max_ns = s->max_hold_ns;
+    out->max_hold_tid = s->max_hold_tid;
+    pthread_mutex_unlock(&lock->mutex);
+    return 0;
+}
+
+int rt_lock_reset(RtLock* lock) {
+    int rc = pthread_mutex_lock(&lock->mutex);
+    if (rc != 0) return rc;
+    RtLockStats* s = lock->stats;
+    memset(s, 0, sizeof(*s));
+    rt_hist_init(&s->wait);
+    rt_hist_init(&s->hold);
+    pthread_mutex_unlock(&lock->mutex);
+    return 0;
+}
+
+#else
+
+int rt_lock_summary(RtLock* lock, RtLockSummary* out) {
+    (void)lock;
+    memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+int rt_lock_reset(RtLock* lock) {
+    (void)lock;
+    return -1;
+}
+
+#endif // RT_LOCK_STATS
+
+void rt_lock_print(FILE* out, RtLock* lock) {
+#if RT_LOCK_STATS
+    RtLockSummary s;
+    int rc = rt_lock_summary(lock, &s);
+    if (rc != 0) {
+        fprintf(out, "%-20s %-7s summary: %s\n", lock->name, rt_lock_protocol_name(lock->protocol), strerror(rc));
+        return;
+    }
+    fprintf(out, "%-20s %-7s acq=%llu contended=%llu inversions=%llu wait p50/p99/max=%.1f/%.1f/%.1f us "
+            "hold p50/p99/max=%.1f/%.1f/%.1f us (tid %d)\n",
+            lock->name, rt_lock_protocol_name(lock->protocol), (unsigned long long)s.acquisitions,
+            (unsigned long long)s.contended, (unsigned long long)s.inversions, s.wait_p50_ns / 1e3,
+            s.wait_p99_ns / 1e3, s.wait_max_ns / 1e3, s.hold_p50_ns / 1e3, s.hold_p99_ns / 1e3,
+            s.hold_max_ns / 1e3, s.max_hold_tid);
+#else
+    (void)lock;
+    fprintf(out, "rt_lock: built with RT_LOCK_STATS=0\n");
+#endif
+}
+
+#if RT_LOCK_STATS
+typedef struct {
+    RtLock* lock;
+    int64_t wait_max_ns;
+} ReportEntry;
+
+static int cmp_wait_desc(const void* a, const void* b) {
+    int64_t x = ((const ReportEntry*)a)->wait_max_ns, y = ((const ReportEntry*)b)->wait_max_ns;
+    return (x < y) - (x > y);
+}
+#endif
+
+void rt_lock_report_all(FILE* out) {
+#if RT_LOCK_STATS
+    pthread_mutex_lock(&registry_lock);
+    size_t n = 0;
+    for (RtLock* l = registry; l; l = l->next) n++;
+    ReportEntry* entries = calloc(n ? n : 1, sizeof(ReportEntry));
+    if (!entries) {
+        pthread_mutex_unlock(&registry_lock);
+        return;
+    }
+    n = 0;
+    for (RtLock* l = registry; l; l = l->next) {
+        RtLockSummary s;
+        rt_lock_summary(l, &s);
+        entries[n].lock = l;
+        entries[n++].wait_max_ns = s.wait_max_ns;
+    }
+    qsort(entries, n, sizeof(ReportEntry), cmp_wait_desc);
+    for (size_t i = 0; i < n; ++i) rt_lock_print(out, entries[i].lock);
+    pthread_mutex_unlock(&registry_lock);
+    free(entries);
+#else
+    rt_lock_print(out, NULL);
+#endif
+}
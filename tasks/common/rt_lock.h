@@ -0,0 +1,123 @@
+#ifndef RT_LOCK_H
+#define RT_LOCK_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Мьютекс с протоколом против инверсии приоритетов и замерами.
+ *
+ * RT_LOCK_INHERIT - PTHREAD_PRIO_INHERIT: владелец временно получает
+ * приоритет самого срочного ожидающего. RT_LOCK_PROTECT -
+ * PTHREAD_PRIO_PROTECT: владелец сразу поднимается до потолка ceiling
+ * (наивысший приоритет среди потоков, берущих этот мьютекс).
+ *
+ * RtLock ведет гистограммы ожидания захвата и времени удержания, самое
+ * долгое удержание (tid владельца) и число блокировок, в которых
+ * ожидающий был срочнее владельца - кандидатов в инверсию. Статистика
+ * меняется только владельцем мьютекса, поэтому своей блокировки не
+ * требует. Все RtLock попадают в общий список для rt_lock_report_all().
+ *
+ * Сборка с -DRT_LOCK_STATS=0 убирает замеры: RtLock - обертка над
+ * pthread_mutex_t, захват и освобождение встраиваются.
+ */
+
+#ifndef RT_LOCK_STATS
+#define RT_LOCK_STATS 1
+#endif
+
+typedef enum {
+    RT_LOCK_PLAIN,          // Без протокола (PTHREAD_PRIO_NONE)
+    RT_LOCK_INHERIT,
+    RT_LOCK_PROTECT
+} RtLockProtocol;
+
+typedef struct RtLockStats RtLockStats;
+
+typedef struct RtLock {
+    pthread_mutex_t mutex;
+#if RT_LOCK_STATS
+    const char* name;
+    RtLockProtocol protocol;
+    int owner_prio;         // Базовый приоритет владельца на момент захвата
+    int owner_tid;
+    int64_t acquired_ns;
+    RtLockStats* stats;     // Гистограммы (~60 КБ) выделяются отдельно
+    struct RtLock* next;    // Общий список
+#endif
+} RtLock;
+
+/**
+ * @brief Инициализирует мьютекс с протоколом protocol.
+ *
+ * ceiling - потолок приоритета для RT_LOCK_PROTECT (SCHED_FIFO 1..99),
+ * иначе не используется. name должен жить не меньше мьютекса.
+ *
+ * @return 0 или код ошибки pthread (ENOTSUP - протокол не поддерживается).
+ */
+int rt_lock_init(RtLock* lock, const char* name, RtLockProtocol protocol, int ceiling);
+void rt_lock_destroy(RtLock* lock);
+
+const char* rt_lock_protocol_name(RtLockProtocol protocol);
+
+#if RT_LOCK_STATS
+
+int rt_lock_lock(RtLock* lock);
+int rt_lock_trylock(RtLock* lock);
+int rt_lock_unlock(RtLock* lock);
+
+// pthread_cond_wait: ожидание условия не считается удержанием
+int rt_lock_cond_wait(RtLock* lock, pthread_cond_t* cond);
+
+#else
+
+static inline int rt_lock_lock(RtLock* lock) {
+    return pthread_mutex_lock(&lock->mutex);
+}
+
+static inline int rt_lock_trylock(RtLock* lock) {
+    return pthread_mutex_trylock(&lock->mutex);
+}
+
+static inline int rt_lock_unlock(RtLock* lock) {
+    return pthread_mutex_unlock(&lock->mutex);
+}
+
+static inline int rt_lock_cond_wait(RtLock* lock, pthread_cond_t* cond) {
+    return pthread_cond_wait(cond, &lock->mutex);
+}
+
+#endif // RT_LOCK_STATS
+
+typedef struct {
+    uint64_t acquisitions;
+    uint64_t contended;     // Захватов, которым пришлось ждать
+    uint64_t inversions;    // Ожиданий, в которых ожидающий срочнее владельца
+    int64_t wait_p50_ns;
+    int64_t wait_p99_ns;
+    int64_t wait_max_ns;
+    int64_t hold_p50_ns;
+    int64_t hold_p99_ns;
+    int64_t hold_max_ns;
+    int max_hold_tid;       // Владелец при самом долгом удержании
+} RtLockSummary;
+
+/**
+ * @brief Сводка замеров; берет сам мьютекс, нельзя вызывать, удерживая его.
+ * @return 0, код ошибки pthread_mutex_lock (EINVAL - вызывающий выше
+ *         потолка RT_LOCK_PROTECT) или -1, если сборка без RT_LOCK_STATS.
+ */
+int rt_lock_summary(RtLock* lock, RtLockSummary* out);
+
+// Обнуляет замеры (например, после прогрева); коды возврата - как у rt_lock_summary
+int rt_lock_reset(RtLock* lock);
+
+// Строка сводки одного мьютекса
+void rt_lock_print(FILE* out, RtLock* lock);
+
+// Сводка всех живых RtLock, отсортированная по худшему ожиданию.
+// Берет каждый мьютекс по очереди: нельзя вызывать, удерживая RtLock.
+void rt_lock_report_all(FILE* out);
+
+#endif // RT_LOCK_H
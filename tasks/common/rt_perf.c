@@ -0,0 +1,190 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_perf.h"
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char* name;
+} counters[RT_PERF_COUNT] = {
+    [RT_PERF_MINOR_FAULTS] = {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN, "minor-faults"},
+    [RT_PERF_MAJOR_FAULTS] = {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ, "major-faults"},
+    [RT_PERF_CONTEXT_SWITCHES] = {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context-switches"},
+    [RT_PERF_CACHE_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+    [RT_PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+};
+
+static int open_event(RtPerfCounter counter, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counters[counter].type;
+    attr.config = counters[counter].config;
+    if (attr.type == PERF_TYPE_SOFTWARE) attr.read_format = PERF_FORMAT_GROUP;
+    // Без прав (perf_event_paranoid >= 2) можно считать только user space.
+    // Переключение контекста происходит в ядре: с exclude_kernel счетчик
+    // открывается, но всегда 0 - такой не нужен
+    int tries = counter == RT_PERF_CONTEXT_SWITCHES ? 1 : 2;
+    for (int exclude = 0; exclude < tries; exclude++) {
+        attr.exclude_kernel = (unsigned)exclude;
+        attr.exclude_hv = (unsigned)exclude;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+        if (fd >= 0 || (errno != EACCES && errno != EPERM)) return fd;
+    }
+    return -1;
+}
+
+int rt_perf_open(RtPerf* perf, unsigned mask) {
+    memset(perf, 0, sizeof(*perf));
+    perf->group_fd = -1;
+    for (int i = 0; i < RT_PERF_COUNT; i++) perf->fd[i] = -1;
+    int opened = 0;
+    int saved_errno = 0;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    for (int i = 0; i < RT_PERF_COUNT; i++) {
+        if (!(mask & (1u << i))) continue;
+        int software = counters[i].type == PERF_TYPE_SOFTWARE;
+        int fd = open_event((RtPerfCounter)i, software ? perf->group_fd : -1);
+        if (fd < 0 && i == RT_PERF_CONTEXT_SWITCHES) {
+            // Не в счет открытых: возврат 0 по-прежнему значит "perf недоступен"
+            saved_errno = errno;
+            perf->rusage |= 1u << i;
+            perf->opened |= 1u << i;
+            continue;
+        }
+        if (fd < 0) {
+            saved_errno = errno;
+            continue;
+        }
+        perf->fd[i] = fd;
+        perf->opened |= 1u << i;
+        opened++;
+        if (software) {
+            if (perf->group_fd < 0) perf->group_fd = fd;
+            perf->group[perf->group_size++] = (RtPerfCounter)i;
+            continue;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        void* page = mmap(NULL, (size_t)page_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (page != MAP_FAILED) {
+            perf->page[i] = page;
+            const struct perf_event_mmap_page* pc = page;
+            if (pc->cap_user_rdpmc) perf->rdpmc |= 1u << i;
+        }
+#else
+        (void)page_size;
+#endif
+    }
+    if (opened == 0) errno = saved_errno;
+    return opened;
+}
+
+void rt_perf_close(RtPerf* perf) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < RT_PERF_COUNT; i++) {
+        if (perf->page[i]) munmap(perf->page[i], (size_t)page_size);
+        if (perf->fd[i] >= 0) close(perf->fd[i]);
+        perf->page[i] = NULL;
+        perf->fd[i] = -1;
+    }
+    perf->group_fd = -1;
+    perf->opened = perf->rdpmc = perf->rusage = 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Значение счетчика без системного вызова; протокол из perf_event.h:
+// lock - seqlock, index - номер аппаратного счетчика + 1 (0 - не на PMU)
+static int read_rdpmc(const struct perf_event_mmap_page* pc, uint64_t* out) {
+    uint32_t seq;
+    uint64_t count;
+    do {
+        seq = pc->lock;
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+        uint32_t index = pc->index;
+        count = (uint64_t)pc->offset;
+        if (!pc->cap_user_rdpmc || index == 0) return -1;
+        uint32_t lo, hi;
+        __asm__ volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(index - 1));
+        uint64_t pmc = (uint64_t)hi << 32 | lo;
+        // Счетчик шириной pmc_width бит: расширяем знак
+        unsigned shift = 64 - pc->pmc_width;
+        count += (uint64_t)((int64_t)(pmc << shift) >> shift);
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+    } while (pc->lock != seq);
+    *out = count;
+    return 0;
+}
+#endif
+
+void rt_perf_read(const RtPerf* perf, RtPerfSample* out) {
+    memset(out, 0, sizeof(*out));
+    if (perf->group_fd >= 0) {
+        // PERF_FORMAT_GROUP: nr, затем значения в порядке открытия
+        uint64_t buf[1 + RT_PERF_COUNT];
+        ssize_t n = read(perf->group_fd, buf, sizeof(buf));
+        if (n >= (ssize_t)sizeof(uint64_t)) {
+            for (uint64_t i = 0; i < buf[0] && i < (uint64_t)perf->group_size; i++) {
+                out->value[perf->group[i]] = buf[1 + i];
+            }
+        }
+    }
+    for (int i = 0; i < RT_PERF_COUNT; i++) {
+        if (!(perf->opened & (1u << i)) || counters[i].type == PERF_TYPE_SOFTWARE) continue;
+#if defined(__x86_64__) || defined(__i386__)
+        if ((perf->rdpmc & (1u << i)) && read_rdpmc(perf->page[i], &out->value[i]) == 0) continue;
+#endif
+        uint64_t v;
+        if (read(perf->fd[i], &v, sizeof(v)) == (ssize_t)sizeof(v)) out->value[i] = v;
+    }
+    if (perf->rusage & (1u << RT_PERF_CONTEXT_SWITCHES)) {
+        struct rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+            out->value[RT_PERF_CONTEXT_SWITCHES] = (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
+        }
+    }
+}
+
+RtPerfCause rt_perf_classify(const RtPerf* perf, const RtPerfSample* delta, uint64_t cache_limit) {
+    if (delta->value[RT_PERF_MINOR_FAULTS] || delta->value[RT_PERF_MAJOR_FAULTS]) return RT_PERF_CAUSE_FAULT;
+    if (delta->value[RT_PERF_CONTEXT_SWITCHES]) return RT_PERF_CAUSE_PREEMPT;
+    if (rt_perf_has(perf, RT_PERF_CACHE_MISSES) && delta->value[RT_PERF_CACHE_MISSES] > cache_limit) {
+        return RT_PERF_CAUSE_CACHE;
+    }
+    return RT_PERF_CAUSE_UNKNOWN;
+}
+
+const char* rt_perf_counter_name(RtPerfCounter counter) {
+    return counter < RT_PERF_COUNT ? counters[counter].name : "?";
+}
+
+const char* rt_perf_cause_name(RtPerfCause cause) {
+    static const char* names[RT_PERF_CAUSE_COUNT] = {"page fault", "preemption", "cache misses", "unknown"};
+    return cause < RT_PERF_CAUSE_COUNT ? names[cause] : "?";
+}
+
+void rt_perf_print_status(FILE* out, const RtPerf* perf) {
+    fprintf(out, "perf:");
+    for (int i = 0; i < RT_PERF_COUNT; i++) {
+        if (!rt_perf_has(perf, (RtPerfCounter)i)) continue;
+        const char* how = (perf->rusage & (1u << i))                ? "getrusage"
+                          : counters[i].type == PERF_TYPE_SOFTWARE ? "group read"
+                          : (perf->rdpmc & (1u << i))           ? "rdpmc"
+                                                                 : "read";
+        fprintf(out, " %s (%s)", counters[i].name, how);
+    }
+    int missing = 0;
+    for (int i = 0; i < RT_PERF_COUNT; i++) {
+        if (rt_perf_has(perf, (RtPerfCounter)i)) continue;
+        fprintf(out, "%s %s", missing++ ? "," : "; unavailable:", counters[i].name);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,100 @@
+#ifndef RT_PERF_H
+#define RT_PERF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Счетчики perf_event_open вокруг горячего участка: page faults,
+ * переключения контекста, промахи кэша и такты вызывающего потока.
+ *
+ * Программные счетчики (faults, переключения) собраны в одну группу и
+ * читаются одним read() на всю группу. Аппаратные (такты, промахи кэша)
+ * читаются из user space инструкцией rdpmc через mmap-страницу события,
+ * без системного вызова; где rdpmc запрещен или нет x86 - через read().
+ * Чего нет (виртуальная машина без PMU, perf_event_paranoid), то не
+ * открывается: rt_perf_has() показывает, какие счетчики работают, а
+ * в выборке вместо них нули. Переключения контекста без прав на счет
+ * ядра (exclude_kernel всегда дает 0) берутся из getrusage(RUSAGE_THREAD) -
+ * лишний системный вызов на чтение.
+ *
+ * Типичный участок:
+ *
+ *   rt_perf_read(&perf, &before);
+ *   ... замеряемый код ...
+ *   rt_perf_read(&perf, &after);
+ *   rt_perf_delta(&before, &after, &delta);
+ *   cause = rt_perf_classify(&perf, &delta, cache_limit);
+ *
+ * Считаются события только потока, вызвавшего rt_perf_open, - на любом ядре.
+ */
+
+typedef enum {
+    RT_PERF_MINOR_FAULTS,
+    RT_PERF_MAJOR_FAULTS,
+    RT_PERF_CONTEXT_SWITCHES,
+    RT_PERF_CACHE_MISSES,
+    RT_PERF_CYCLES,
+    RT_PERF_COUNT
+} RtPerfCounter;
+
+#define RT_PERF_ALL ((1u << RT_PERF_COUNT) - 1)
+
+typedef struct {
+    uint64_t value[RT_PERF_COUNT];
+} RtPerfSample;
+
+typedef struct {
+    int fd[RT_PERF_COUNT];          // -1 - счетчик не открыт
+    void* page[RT_PERF_COUNT];      // mmap-страница аппаратного счетчика
+    int group_fd;                   // Лидер группы программных счетчиков
+    int group_size;
+    RtPerfCounter group[RT_PERF_COUNT]; // Порядок значений в read() группы
+    unsigned opened;                // Маска открытых счетчиков
+    unsigned rdpmc;                 // Маска читаемых через rdpmc
+    unsigned rusage;                // Маска заполняемых из getrusage(RUSAGE_THREAD)
+} RtPerf;
+
+// Почему участок был медленным
+typedef enum {
+    RT_PERF_CAUSE_FAULT,            // Был page fault
+    RT_PERF_CAUSE_PREEMPT,          // Поток вытесняли или он засыпал
+    RT_PERF_CAUSE_CACHE,            // Промахов кэша больше порога
+    RT_PERF_CAUSE_UNKNOWN,          // Ничего из этого: прерывание, SMI, частота
+    RT_PERF_CAUSE_COUNT
+} RtPerfCause;
+
+/**
+ * @brief Открывает счетчики из mask (биты 1 << RtPerfCounter) для потока.
+ * @return Число открытых счетчиков; 0 - perf_event_open недоступен (errno).
+ */
+int rt_perf_open(RtPerf* perf, unsigned mask);
+
+void rt_perf_close(RtPerf* perf);
+
+static inline int rt_perf_has(const RtPerf* perf, RtPerfCounter counter) {
+    return (perf->opened >> counter) & 1;
+}
+
+// Текущие значения открытых счетчиков; неоткрытые - 0
+void rt_perf_read(const RtPerf* perf, RtPerfSample* out);
+
+static inline void rt_perf_delta(const RtPerfSample* before, const RtPerfSample* after, RtPerfSample* out) {
+    for (int i = 0; i < RT_PERF_COUNT; i++) out->value[i] = after->value[i] - before->value[i];
+}
+
+/**
+ * @brief Причина медленного участка по разнице счетчиков.
+ *
+ * Приоритет: fault, затем вытеснение, затем промахи кэша больше
+ * cache_limit (например, несколько медиан по всем участкам).
+ */
+RtPerfCause rt_perf_classify(const RtPerf* perf, const RtPerfSample* delta, uint64_t cache_limit);
+
+const char* rt_perf_counter_name(RtPerfCounter counter);
+const char* rt_perf_cause_name(RtPerfCause cause);
+
+// "perf: minor-faults major-faults context-switches (group read), cycles (rdpmc); no cache-misses"
+void rt_perf_print_status(FILE* out, const RtPerf* perf);
+
+#endif // RT_PERF_H
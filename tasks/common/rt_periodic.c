@@ -0,0 +1,232 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_periodic.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rt_clock.h"
+#include "rt_time.h"
+
+// Поток задачи стартует через этот интервал после rt_sched_start(),
+// чтобы все потоки успели создаться до первого общего выпуска
+#define RT_SCHED_START_DELAY_NS (10 * RT_NSEC_PER_MSEC)
+#define RT_SCHED_RM_TOP_PRIORITY 90
+
+typedef struct {
+    RtTaskConfig config;
+    RtTaskStats stats;
+    RtScheduler* sched;
+    pthread_t thread;
+} RtTask;
+
+struct RtScheduler {
+    RtTask* tasks[RT_SCHED_MAX_TASKS];
+    int count;
+    int threads;    // Сколько потоков задач реально запущено
+    int started;
+    atomic_int running;
+    int64_t start_ns;
+};
+
+RtScheduler* rt_sched_create(void) {
+    return calloc(1, sizeof(RtScheduler));
+}
+
+int rt_sched_add(RtScheduler* sched, const RtTaskConfig* config) {
+    if (!config || !config->body || config->period_ns <= 0 || config->deadline_ns < 0 ||
+        config->phase_ns < 0 || config->priority < 0 || config->priority > 99) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (sched->started) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (sched->count == RT_SCHED_MAX_TASKS) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    RtTask* task = calloc(1, sizeof(RtTask));
+    if (!task) return -1;
+    task->config = *config;
+    if (task->config.deadline_ns == 0) task->config.deadline_ns = config->period_ns;
+    task->sched = sched;
+    rt_hist_init(&task->stats.release_latency);
+    rt_hist_init(&task->stats.response_time);
+    sched->tasks[sched->count] = task;
+    return sched->count++;
+}
+
+static void* task_thread(void* arg) {
+    RtTask* task = arg;
+    RtScheduler* sched = task->sched;
+    const RtTaskConfig* cfg = &task->config;
+    RtTaskStats* st = &task->stats;
+    int64_t release = sched->start_ns + cfg->phase_ns;
+
+    while (atomic_load_explicit(&sched->running, memory_order_relaxed)) {
+        struct timespec ts;
+        rt_ns_to_timespec(release, &ts);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        int64_t wake = rt_clock_now_ns();
+        if (!atomic_load_explicit(&sched->running, memory_order_relaxed)) break;
+
+        int64_t cpu_start = rt_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        cfg->body(cfg->arg);
+        int64_t cpu_end = rt_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        int64_t end = rt_clock_end_ns();
+
+        st->releases++;
+        st->exec_ns_total += (double)(cpu_end - cpu_start);
+        rt_hist_record(&st->release_latency, wake - release);
+        rt_hist_record(&st->response_time, end - release);
+        if (end - release > cfg->deadline_ns) st->missed_deadlines++;
+
+        release += cfg->period_ns;
+        if (end > release) {
+            // Пропустить все выпуски, которые наступили во время выполнения
+            int64_t behind = (end - release) / cfg->period_ns + 1;
+            st->overruns++;
+            st->skipped_releases += (uint64_t)behind;
+            release += behind * cfg->period_ns;
+        }
+    }
+    return NULL;
+}
+
+// Rate monotonic: ранг задачи среди автоматических по возрастанию периода
+static void assign_rm_priorities(RtScheduler* sched) {
+    for (int i = 0; i < sched->count; ++i) {
+        RtTask* task = sched->tasks[i];
+        if (task->config.priority != 0) {
+            task->stats.priority = task->config.priority;
+            continue;
+        }
+        int rank = 0;
+        for (int j = 0; j < sched->count; ++j) {
+            const RtTaskConfig* other = &sched->tasks[j]->config;
+            int shorter = other->priority == 0 && other->period_ns < task->config.period_ns;
+            // Считаем различные периоды только один раз
+            for (int k = 0; shorter && k < j; ++k) {
+                const RtTaskConfig* prev = &sched->tasks[k]->config;
+                if (prev->priority == 0 && prev->period_ns == other->period_ns) shorter = 0;
+            }
+            rank += shorter;
+        }
+        int priority = RT_SCHED_RM_TOP_PRIORITY - rank;
+        task->stats.priority = priority < 1 ? 1 : priority;
+    }
+}
+
+static int start_task(RtTask* task) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (task->config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(task->config.cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    struct sched_param sp = {.sched_priority = task->stats.priority};
+    pthread_attr_setschedparam(&attr, &sp);
+    int rc = pthread_create(&task->thread, &attr, task_thread, task);
+    if (rc == EPERM) {
+        fprintf(stderr, "WARNING: no permission for SCHED_FIFO, task '%s' runs with default policy\n",
+                task->config.name);
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(&task->thread, &attr, task_thread, task);
+    } else if (rc == 0) {
+        task->stats.realtime = 1;
+    }
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int rt_sched_start(RtScheduler* sched) {
+    if (sched->started) {
+        errno = EBUSY;
+        return -1;
+    }
+    assign_rm_priorities(sched);
+    sched->start_ns = rt_now_ns() + RT_SCHED_START_DELAY_NS;
+    atomic_store(&sched->running, 1);
+    sched->started = 1;
+
+    for (sched->threads = 0; sched->threads < sched->count; ++sched->threads) {
+        if (start_task(sched->tasks[sched->threads]) != 0) {
+            int saved = errno;
+            rt_sched_stop(sched);
+            errno = saved;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void rt_sched_stop(RtScheduler* sched) {
+    if (!sched->started) return;
+    atomic_store(&sched->running, 0);
+    for (int i = 0; i < sched->threads; ++i) pthread_join(sched->tasks[i]->thread, NULL);
+    sched->threads = 0;
+    sched->started = 0;
+}
+
+int rt_sched_task_count(const RtScheduler* sched) {
+    return sched->count;
+}
+
+const RtTaskConfig* rt_sched_task_config(const RtScheduler* sched, int id) {
+    return id >= 0 && id < sched->count ? &sched->tasks[id]->config : NULL;
+}
+
+const RtTaskStats* rt_sched_task_stats(const RtScheduler* sched, int id) {
+    return id >= 0 && id < sched->count ? &sched->tasks[id]->stats : NULL;
+}
+
+void rt_sched_print_report(const RtScheduler* sched, FILE* out) {
+    fprintf(out, "%-12s %9s %9s %4s %3s %9s %7s %7s %7s %9s %9s %9s %9s\n",
+            "task", "period_us", "dl_us", "prio", "cpu", "releases", "missed", "overrun",
+            "skipped", "rel_p99", "rel_max", "resp_p99", "resp_max");
+    double utilization = 0.0;
+    for (int i = 0; i < sched->count; ++i) {
+        const RtTask* task = sched->tasks[i];
+        const RtTaskConfig* c = &task->config;
+        const RtTaskStats* s = &task->stats;
+        fprintf(out, "%-12s %9" PRId64 " %9" PRId64 " %3d%c %3d %9" PRIu64 " %7" PRIu64 " %7" PRIu64
+                " %7" PRIu64, c->name ? c->name : "-", (int64_t)(c->period_ns / RT_NSEC_PER_USEC),
+                (int64_t)(c->deadline_ns / RT_NSEC_PER_USEC), s->priority, s->realtime ? ' ' : '*', c->cpu,
+                s->releases, s->missed_deadlines, s->overruns, s->skipped_releases);
+        fprintf(out, " %9" PRId64 " %9" PRId64 " %9" PRId64 " %9" PRId64 "\n",
+                rt_hist_percentile(&s->release_latency, 99.0), s->releases ? s->release_latency.max : 0,
+                rt_hist_percentile(&s->response_time, 99.0), s->releases ? s->response_time.max : 0);
+        if (s->releases) utilization += s->exec_ns_total / (double)s->releases / (double)c->period_ns;
+    }
+    fprintf(out, "(latencies in ns; '*' - SCHED_FIFO unavailable, default policy)\n");
+    if (sched->count > 0) {
+        double n = (double)sched->count;
+        fprintf(out, "Measured utilization (thread CPU time): %.3f, rate monotonic bound for %d tasks: %.3f\n",
+                utilization, sched->count, n * (pow(2.0, 1.0 / n) - 1.0));
+    }
+}
+
+void rt_sched_destroy(RtScheduler* sched) {
+    if (!sched) return;
+    rt_sched_stop(sched);
+    for (int i = 0; i < sched->count; ++i) free(sched->tasks[i]);
+    free(sched);
+}
@@ -0,0 +1,78 @@
+#ifndef RT_PERIODIC_H
+#define RT_PERIODIC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "rt_stats.h"
+
+// Сколько задач можно зарегистрировать в одном планировщике
+#define RT_SCHED_MAX_TASKS 64
+
+typedef struct RtScheduler RtScheduler;
+
+// Описание периодической задачи
+typedef struct {
+    const char* name;
+    int64_t period_ns;
+    int64_t deadline_ns;    // Относительный дедлайн, 0 - равен периоду
+    int64_t phase_ns;       // Смещение первого выпуска от общего старта
+    int priority;           // SCHED_FIFO 1..99, 0 - назначить по rate monotonic
+    int cpu;                // Ядро для привязки, -1 - без привязки
+    void (*body)(void* arg);
+    void* arg;
+} RtTaskConfig;
+
+// Статистика задачи; согласована после rt_sched_stop()
+typedef struct {
+    uint64_t releases;          // Сколько раз задача выполнилась
+    uint64_t missed_deadlines;  // Ответ позже release + deadline
+    uint64_t overruns;          // Выполнение залезло на следующий выпуск
+    uint64_t skipped_releases;  // Выпуски, пропущенные из-за overrun
+    double exec_ns_total;       // Суммарное процессорное время потока в body (без вытеснения)
+    int priority;               // Фактически назначенный приоритет
+    int realtime;               // 1, если поток получил SCHED_FIFO
+    RtHistogram release_latency; // Пробуждение относительно момента выпуска
+    RtHistogram response_time;   // Завершение body относительно момента выпуска
+} RtTaskStats;
+
+RtScheduler* rt_sched_create(void);
+
+/**
+ * @brief Регистрирует задачу. Вызывается только до rt_sched_start().
+ * @return Номер задачи или -1 (errno = EINVAL / ENOSPC / EBUSY).
+ */
+int rt_sched_add(RtScheduler* sched, const RtTaskConfig* config);
+
+/**
+ * @brief Запускает по потоку SCHED_FIFO на каждую задачу.
+ *
+ * Выпуски считаются от общего момента старта по абсолютному времени
+ * (clock_nanosleep(TIMER_ABSTIME)), поэтому период не дрейфует. Задачам с
+ * priority = 0 приоритеты назначаются по rate monotonic: меньше период -
+ * выше приоритет. Если SCHED_FIFO недоступен (нет прав), поток работает
+ * с обычной политикой, а в stderr выводится предупреждение.
+ *
+ * Замеры берутся через rt_clock_now_ns(): для TSC вызовите rt_clock_init()
+ * до старта.
+ *
+ * Если выполнение не успело до следующего выпуска, он считается overrun,
+ * а все уже прошедшие выпуски пропускаются: задача не «догоняет» очередь.
+ *
+ * @return 0 или -1 с errno.
+ */
+int rt_sched_start(RtScheduler* sched);
+
+// Останавливает все задачи и ждет завершения потоков
+void rt_sched_stop(RtScheduler* sched);
+
+int rt_sched_task_count(const RtScheduler* sched);
+const RtTaskConfig* rt_sched_task_config(const RtScheduler* sched, int id);
+const RtTaskStats* rt_sched_task_stats(const RtScheduler* sched, int id);
+
+// Таблица по задачам и суммарная загрузка против границы Лиу-Лейланда
+void rt_sched_print_report(const RtScheduler* sched, FILE* out);
+
+// Останавливает планировщик, если он запущен, и освобождает его
+void rt_sched_destroy(RtScheduler* sched);
+
+#endif // RT_PERIODIC_H
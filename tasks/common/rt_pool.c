@@ -0,0 +1,345 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_pool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rt_sync.h"
+
+#define POOL_CACHELINE 64
+#define STEAL_MAX      32   // Задач за один перехват
+
+typedef struct {
+    RtTaskFn fn;
+    void* arg;
+} Task;
+
+// Кольцо задач одной полосы; под мьютексом потока-владельца
+typedef struct {
+    Task* buf;
+    size_t cap;             // Степень двойки
+    size_t head;            // Следующая к выполнению
+    size_t count;
+} Queue;
+
+typedef struct {
+    _Alignas(POOL_CACHELINE) pthread_mutex_t lock;
+    Queue lanes[RT_POOL_LANES];
+    atomic_size_t queued[RT_POOL_LANES];    // Копия count для проверки без блокировки
+
+    _Alignas(POOL_CACHELINE) atomic_uint_fast64_t executed;
+    atomic_uint_fast64_t stolen;
+    atomic_uint_fast64_t steals;
+    atomic_uint_fast64_t parks;
+    pthread_t thread;
+    int index;
+    int started;
+    RtPool* pool;
+} Worker;
+
+struct RtPool {
+    Worker* workers;
+    int count;
+    int pin;
+    RtWord work;            // Счетчик событий: растет на каждую поставленную задачу
+    RtWord idle;            // Растет, когда pending падает до нуля
+    atomic_long pending;    // Поставлено и еще не выполнено
+    atomic_int stopping;
+    atomic_uint next;       // Круговой выбор потока для задач извне
+    atomic_uint_fast64_t submitted;
+};
+
+static _Thread_local Worker* current;
+
+static int queue_init(Queue* q, size_t capacity) {
+    size_t cap = 16;
+    while (cap < capacity) cap <<= 1;
+    q->buf = malloc(cap * sizeof(Task));
+    if (!q->buf) return -1;
+    q->cap = cap;
+    q->head = 0;
+    q->count = 0;
+    return 0;
+}
+
+static int queue_push(Queue* q, Task task) {
+    if (q->count == q->cap) {
+        // Удвоение с раскладкой по порядку: голова снова в начале
+        Task* buf = malloc(2 * q->cap * sizeof(Task));
+        if (!buf) return -1;
+        for (size_t i = 0; i < q->count; i++) buf[i] = q->buf[(q->head + i) & (q->cap - 1)];
+        free(q->buf);
+        q->buf = buf;
+        q->cap *= 2;
+        q->head = 0;
+    }
+    q->buf[(q->head + q->count) & (q->cap - 1)] = task;
+    q->count++;
+    return 0;
+}
+
+static Task queue_pop(Queue* q) {
+    Task task = q->buf[q->head];
+    q->head = (q->head + 1) & (q->cap - 1);
+    q->count--;
+    return task;
+}
+
+static void count(atomic_uint_fast64_t* counter, uint64_t n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static void run(Worker* w, Task task);
+
+static int pop_own(Worker* w, int lane, Task* out) {
+    if (atomic_load_explicit(&w->queued[lane], memory_order_relaxed) == 0) return 0;
+    pthread_mutex_lock(&w->lock);
+    int got = w->lanes[lane].count > 0;
+    if (got) {
+        *out = queue_pop(&w->lanes[lane]);
+        atomic_store_explicit(&w->queued[lane], w->lanes[lane].count, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return got;
+}
+
+// Забирает половину очереди lane у первого непустого соседа; первая задача - в out
+static int steal(Worker* w, int lane, Task* out) {
+    RtPool* pool = w->pool;
+    Task batch[STEAL_MAX];
+    for (int i = 1; i < pool->count; i++) {
+        Worker* victim = &pool->workers[(w->index + i) % pool->count];
+        if (atomic_load_explicit(&victim->queued[lane], memory_order_relaxed) == 0) continue;
+        pthread_mutex_lock(&victim->lock);
+        Queue* q = &victim->lanes[lane];
+        size_t n = (q->count + 1) / 2;
+        if (n > STEAL_MAX) n = STEAL_MAX;
+        for (size_t k = 0; k < n; k++) batch[k] = queue_pop(q);
+        atomic_store_explicit(&victim->queued[lane], q->count, memory_order_relaxed);
+        pthread_mutex_unlock(&victim->lock);
+        if (n == 0) continue;
+
+        *out = batch[0];
+        if (n > 1) {
+            pthread_mutex_lock(&w->lock);
+            for (size_t k = 1; k < n; k++) {
+                if (queue_push(&w->lanes[lane], batch[k]) < 0) {
+                    // Нет памяти на рост: остаток выполняем сразу
+                    pthread_mutex_unlock(&w->lock);
+                    for (size_t j = k; j < n; j++) run(w, batch[j]);
+                    pthread_mutex_lock(&w->lock);
+                    break;
+                }
+            }
+            atomic_store_explicit(&w->queued[lane], w->lanes[lane].count, memory_order_relaxed);
+            pthread_mutex_unlock(&w->lock);
+        }
+        count(&w->stolen, n);
+        count(&w->steals, 1);
+        return 1;
+    }
+    return 0;
+}
+
+static void run(Worker* w, Task task) {
+    task.fn(task.arg);
+    count(&w->executed, 1);
+    if (atomic_fetch_sub_explicit(&w->pool->pending, 1, memory_order_acq_rel) == 1) {
+        rt_word_bump(&w->pool->idle, UINT32_MAX);
+    }
+}
+
+// Полосы по порядку: своя очередь, затем чужие той же полосы
+static int run_one(Worker* w) {
+    Task task;
+    for (int lane = 0; lane < RT_POOL_LANES; lane++) {
+        if (pop_own(w, lane, &task) || steal(w, lane, &task)) {
+            run(w, task);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = arg;
+    RtPool* pool = w->pool;
+    current = w;
+    if (pool->pin) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->index % (ncpu > 0 ? ncpu : 1), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    for (;;) {
+        if (run_one(w)) continue;
+        // Значение счетчика до последней проверки: задача, поставленная
+        // после нее, изменит его, и ожидание сразу вернется
+        uint32_t seen = rt_word_load(&pool->work);
+        if (run_one(w)) continue;
+        if (atomic_load(&pool->stopping)) break;
+        count(&w->parks, 1);
+        rt_word_wait_while(&pool->work, seen);
+    }
+    current = NULL;
+    return NULL;
+}
+
+void rt_pool_config_default(RtPoolConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->capacity = 256;
+    cfg->spin_ns = 20000;
+}
+
+RtPool* rt_pool_create(const RtPoolConfig* cfg) {
+    int n = cfg->workers > 0 ? cfg->workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > RT_POOL_MAX_WORKERS) n = RT_POOL_MAX_WORKERS;
+
+    RtPool* pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+    pool->workers = aligned_alloc(POOL_CACHELINE, sizeof(Worker) * (size_t)n);
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, sizeof(Worker) * (size_t)n);
+    pool->pin = cfg->pin;
+    rt_word_init(&pool->work, 0, rt_sync_spin_for_ns(cfg->spin_ns));
+    rt_word_init(&pool->idle, 0, 0);
+
+    for (int i = 0; i < n; i++) {
+        Worker* w = &pool->workers[i];
+        w->index = i;
+        w->pool = pool;
+        pthread_mutex_init(&w->lock, NULL);
+        for (int lane = 0; lane < RT_POOL_LANES; lane++) {
+            if (queue_init(&w->lanes[lane], cfg->capacity) < 0) {
+                pool->count = i + 1;
+                rt_pool_destroy(pool);
+                errno = ENOMEM;
+                return NULL;
+            }
+        }
+        pool->count = i + 1;
+    }
+    for (int i = 0; i < n; i++) {
+        Worker* w = &pool->workers[i];
+        int rc = pthread_create(&w->thread, NULL, worker_main, w);
+        if (rc != 0) {
+            rt_pool_destroy(pool);
+            errno = rc;
+            return NULL;
+        }
+        w->started = 1;
+    }
+    return pool;
+}
+
+int rt_pool_submit(RtPool* pool, RtTaskFn fn, void* arg, RtPoolLane lane, int hint) {
+    if (!fn || (unsigned)lane >= RT_POOL_LANES) {
+        errno = EINVAL;
+        return -1;
+    }
+    int inside = current && current->pool == pool;
+    // После destroy новые задачи принимаются только от задач, которые еще дорабатывают
+    if (!inside && atomic_load(&pool->stopping)) {
+        errno = ESHUTDOWN;
+        return -1;
+    }
+    Worker* w;
+    if (hint >= 0) {
+        w = &pool->workers[hint % pool->count];
+    } else if (inside) {
+        w = current;
+    } else {
+        w = &pool->workers[atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed) % (unsigned)pool->count];
+    }
+
+    atomic_fetch_add_explicit(&pool->pending, 1, memory_order_relaxed);
+    pthread_mutex_lock(&w->lock);
+    int rc = queue_push(&w->lanes[lane], (Task){fn, arg});
+    atomic_store_explicit(&w->queued[lane], w->lanes[lane].count, memory_order_relaxed);
+    pthread_mutex_unlock(&w->lock);
+    if (rc < 0) {
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_relaxed);
+        errno = ENOMEM;
+        return -1;
+    }
+    count(&pool->submitted, 1);
+    rt_word_bump(&pool->work, 1);
+    return 0;
+}
+
+void rt_pool_wait_idle(RtPool* pool) {
+    for (;;) {
+        uint32_t seen = rt_word_load(&pool->idle);
+        if (atomic_load(&pool->pending) == 0) return;
+        rt_word_wait_while(&pool->idle, seen);
+    }
+}
+
+void rt_pool_destroy(RtPool* pool) {
+    if (!pool) return;
+    atomic_store(&pool->stopping, 1);
+    rt_word_bump(&pool->work, UINT32_MAX);
+    for (int i = 0; i < pool->count; i++) {
+        Worker* w = &pool->workers[i];
+        if (w->started) pthread_join(w->thread, NULL);
+        for (int lane = 0; lane < RT_POOL_LANES; lane++) free(w->lanes[lane].buf);
+        pthread_mutex_destroy(&w->lock);
+    }
+    free(pool->workers);
+    free(pool);
+}
+
+int rt_pool_workers(const RtPool* pool) {
+    return pool->count;
+}
+
+int rt_pool_current_worker(void) {
+    return current ? current->index : -1;
+}
+
+void rt_pool_get_worker_stats(const RtPool* pool, int worker, RtPoolWorkerStats* stats) {
+    const Worker* w = &pool->workers[worker];
+    stats->executed = atomic_load_explicit(&w->executed, memory_order_relaxed);
+    stats->stolen = atomic_load_explicit(&w->stolen, memory_order_relaxed);
+    stats->steals = atomic_load_explicit(&w->steals, memory_order_relaxed);
+    stats->parks = atomic_load_explicit(&w->parks, memory_order_relaxed);
+}
+
+void rt_pool_get_stats(const RtPool* pool, RtPoolStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->workers = pool->count;
+    stats->submitted = atomic_load_explicit(&pool->submitted, memory_order_relaxed);
+    for (int i = 0; i < pool->count; i++) {
+        RtPoolWorkerStats ws;
+        rt_pool_get_worker_stats(pool, i, &ws);
+        stats->total.executed += ws.executed;
+        stats->total.stolen += ws.stolen;
+        stats->total.steals += ws.steals;
+        stats->total.parks += ws.parks;
+    }
+}
+
+void rt_pool_print_stats(FILE* out, const RtPool* pool) {
+    RtPoolStats st;
+    rt_pool_get_stats(pool, &st);
+    fprintf(out, "pool: %d workers, %llu submitted, %llu executed, %llu stolen in %llu steals, %llu parks\n",
+            st.workers, (unsigned long long)st.submitted, (unsigned long long)st.total.executed,
+            (unsigned long long)st.total.stolen, (unsigned long long)st.total.steals,
+            (unsigned long long)st.total.parks);
+    for (int i = 0; i < pool->count; i++) {
+        RtPoolWorkerStats ws;
+        rt_pool_get_worker_stats(pool, i, &ws);
+        fprintf(out, "  worker %d: %llu executed, %llu stolen, %llu parks\n", i, (unsigned long long)ws.executed,
+                (unsigned long long)ws.stolen, (unsigned long long)ws.parks);
+    }
+}
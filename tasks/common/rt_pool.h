@@ -0,0 +1,103 @@
+#ifndef RT_POOL_H
+#define RT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Пул рабочих потоков с перехватом задач (work stealing) вместо потока
+ * на каждую роль.
+ *
+ * У каждого рабочего потока своя очередь задач на каждую полосу
+ * приоритета. Задача из рабочего потока без подсказки ставится в его же
+ * очередь (данные горячие в его кэше), извне - по кругу; подсказка hint
+ * направляет задачу к конкретному потоку (например, к тому, что ведет
+ * соединение). Поток берет задачи из своих очередей, а когда они пусты -
+ * забирает половину чужой очереди той же полосы: очереди выравниваются
+ * без общей блокировки. Полосы проверяются по старшинству: поток не
+ * начинает задачу ниже, пока видит в своей или чужой очереди ожидающую
+ * задачу RT_POOL_HIGH. Уже выполняемые задачи HIGH не в счет: пока одна
+ * идет на другом потоке, этот берет задачи ниже. Внутри полосы порядок FIFO:
+ * задачи здесь - события, и старые не должны ждать за новыми.
+ *
+ * Простаивающий поток паркуется на futex счетчика событий (RtWord из
+ * rt_sync): сначала короткий спин, затем сон; постановка задачи будит
+ * одного спящего и не делает системных вызовов, если спящих нет.
+ *
+ * Задача не должна надолго блокироваться (ввод-вывод с ожиданием, сон):
+ * она занимает рабочий поток целиком. Блокирующее ожидание остается за
+ * вызывающим (цикл epoll, чтение stdin), а в пул уходит обработка.
+ */
+
+#define RT_POOL_MAX_WORKERS 64
+#define RT_POOL_ANY (-1)
+
+typedef enum {
+    RT_POOL_HIGH,
+    RT_POOL_NORMAL,
+    RT_POOL_LOW,
+    RT_POOL_LANES
+} RtPoolLane;
+
+typedef void (*RtTaskFn)(void* arg);
+
+typedef struct RtPool RtPool;
+
+typedef struct {
+    int workers;            // 0 - по одному на ядро
+    int pin;                // Привязать поток i к ядру i по кругу
+    size_t capacity;        // Начальная емкость очереди полосы, растет по необходимости
+    int64_t spin_ns;        // Спин перед парковкой (см. rt_sync_spin_for_ns)
+} RtPoolConfig;
+
+typedef struct {
+    uint64_t executed;
+    uint64_t stolen;        // Задач, перехваченных из чужих очередей
+    uint64_t steals;        // Удачных перехватов (по половине очереди)
+    uint64_t parks;         // Уходов в ожидание без работы
+} RtPoolWorkerStats;
+
+typedef struct {
+    uint64_t submitted;
+    RtPoolWorkerStats total;
+    int workers;
+} RtPoolStats;
+
+// workers 0, pin 0, 256 задач, спин 20 мкс
+void rt_pool_config_default(RtPoolConfig* cfg);
+
+/**
+ * @brief Создает пул и запускает рабочие потоки.
+ * @return Пул или NULL (errno).
+ */
+RtPool* rt_pool_create(const RtPoolConfig* cfg);
+
+/**
+ * @brief Ставит fn(arg) в очередь полосы lane.
+ *
+ * hint - номер рабочего потока (по модулю числа потоков) или RT_POOL_ANY.
+ * Можно вызывать из любого потока, в том числе из задачи.
+ *
+ * @return 0 или -1 (errno: ENOMEM, ESHUTDOWN после rt_pool_destroy).
+ */
+int rt_pool_submit(RtPool* pool, RtTaskFn fn, void* arg, RtPoolLane lane, int hint);
+
+// Ждет, пока не останется поставленных и выполняющихся задач
+void rt_pool_wait_idle(RtPool* pool);
+
+// Выполняет оставшиеся задачи, останавливает потоки и освобождает пул
+void rt_pool_destroy(RtPool* pool);
+
+int rt_pool_workers(const RtPool* pool);
+
+// Номер рабочего потока пула, в котором выполняется вызов; -1 вне пула
+int rt_pool_current_worker(void);
+
+void rt_pool_get_stats(const RtPool* pool, RtPoolStats* stats);
+void rt_pool_get_worker_stats(const RtPool* pool, int worker, RtPoolWorkerStats* stats);
+
+// Сводка и строка на каждый рабочий поток
+void rt_pool_print_stats(FILE* out, const RtPool* pool);
+
+#endif // RT_POOL_H
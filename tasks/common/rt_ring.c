@@ -0,0 +1,119 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_ring.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+int rt_ring_init(RtRing* ring, size_t elem_size, size_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    ring->event_fd = -1;
+    if (elem_size == 0 || capacity == 0 || capacity > ((size_t)1 << 30)) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    ring->slots = aligned_alloc(RT_RING_CACHELINE, (cap * elem_size + RT_RING_CACHELINE - 1) &
+                                                       ~(size_t)(RT_RING_CACHELINE - 1));
+    if (!ring->slots) return -1;
+    ring->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ring->event_fd < 0) {
+        free(ring->slots);
+        ring->slots = NULL;
+        ring->event_fd = -1;
+        return -1;
+    }
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    return 0;
+}
+
+void rt_ring_destroy(RtRing* ring) {
+    if (ring->event_fd >= 0) close(ring->event_fd);
+    free(ring->slots);
+    ring->slots = NULL;
+    ring->event_fd = -1;
+}
+
+int rt_ring_push(RtRing* ring, const void* elem) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - ring->cached_tail > ring->mask) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail > ring->mask) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return -1;
+        }
+    }
+    memcpy(ring->slots + (head & ring->mask) * ring->elem_size, elem, ring->elem_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->pushed, 1, memory_order_relaxed);
+
+    // cached_tail отстает, и оценка завышена: уточняем tail, только когда
+    // оценка обновила бы максимум
+    size_t high = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+    if (head + 1 - ring->cached_tail > high) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        size_t used = head + 1 - ring->cached_tail;
+        if (used > high) atomic_store_explicit(&ring->high_water, used, memory_order_relaxed);
+    }
+
+    // Пара к барьеру в rt_ring_wait: либо потребитель увидит новый head,
+    // либо мы увидим sleeping и разбудим его
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleeping, memory_order_relaxed)) {
+        uint64_t one = 1;
+        if (write(ring->event_fd, &one, sizeof(one)) == (ssize_t)sizeof(one)) {
+            atomic_fetch_add_explicit(&ring->wakeups, 1, memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+int rt_ring_pop(RtRing* ring, void* elem) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail == ring->cached_head) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == ring->cached_head) return -1;
+    }
+    memcpy(elem, ring->slots + (tail & ring->mask) * ring->elem_size, ring->elem_size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+int rt_ring_wait(RtRing* ring, int timeout_ms) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail != atomic_load_explicit(&ring->head, memory_order_acquire)) return 1;
+
+    atomic_store_explicit(&ring->sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int ready = tail != atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (!ready) {
+        struct pollfd pfd = {.fd = ring->event_fd, .events = POLLIN};
+        poll(&pfd, 1, timeout_ms);
+    }
+    atomic_store_explicit(&ring->sleeping, 0, memory_order_relaxed);
+
+    uint64_t value;
+    while (read(ring->event_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+    }
+    return tail != atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+size_t rt_ring_count(RtRing* ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+void rt_ring_get_stats(RtRing* ring, RtRingStats* stats) {
+    stats->pushed = atomic_load_explicit(&ring->pushed, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    stats->wakeups = atomic_load_explicit(&ring->wakeups, memory_order_relaxed);
+    stats->high_water = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+}
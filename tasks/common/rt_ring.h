@@ -0,0 +1,85 @@
+#ifndef RT_RING_H
+#define RT_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Кольцевая очередь записей фиксированного размера: один производитель,
+ * один потребитель, без блокировок.
+ *
+ * Производитель (например, поток чтения устройств) никогда не ждет: на
+ * полной очереди запись отбрасывается и учитывается в dropped, так что
+ * медленный потребитель не тормозит захват. Несколько потребителей -
+ * несколько очередей, в каждую производитель кладет свою копию.
+ *
+ * Потребитель забирает записи в своем темпе и может уснуть на пустой
+ * очереди в rt_ring_wait(): производитель будит его через eventfd только
+ * тогда, когда потребитель действительно спит, - запись в непустую или
+ * активно читаемую очередь обходится без системных вызовов. Дескриптор
+ * rt_ring_fd() можно добавить в epoll/poll потребителя.
+ */
+
+#define RT_RING_CACHELINE 64
+
+typedef struct {
+    uint64_t pushed;        // Принято записей
+    uint64_t dropped;       // Отброшено на полной очереди
+    uint64_t wakeups;       // Записей в eventfd
+    size_t high_water;      // Наибольшая наблюдавшаяся заполненность
+} RtRingStats;
+
+typedef struct {
+    // Сторона производителя
+    _Alignas(RT_RING_CACHELINE) atomic_size_t head;
+    size_t cached_tail;     // Копия tail: реже трогаем чужую кэш-линию
+    atomic_uint_fast64_t pushed;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t wakeups;
+    atomic_size_t high_water;
+
+    // Сторона потребителя
+    _Alignas(RT_RING_CACHELINE) atomic_size_t tail;
+    size_t cached_head;
+    atomic_int sleeping;    // Потребитель ждет в rt_ring_wait
+
+    _Alignas(RT_RING_CACHELINE) size_t mask;
+    size_t elem_size;
+    int event_fd;
+    unsigned char* slots;
+} RtRing;
+
+/**
+ * @brief Создает очередь на capacity записей по elem_size байт.
+ *
+ * capacity округляется вверх до степени двойки.
+ *
+ * @return 0 или -1 (errno).
+ */
+int rt_ring_init(RtRing* ring, size_t elem_size, size_t capacity);
+void rt_ring_destroy(RtRing* ring);
+
+// Только производитель. 0 - записано, -1 - очередь полна, запись отброшена
+int rt_ring_push(RtRing* ring, const void* elem);
+
+// Только потребитель. 0 - запись скопирована в elem, -1 - очередь пуста
+int rt_ring_pop(RtRing* ring, void* elem);
+
+/**
+ * @brief Только потребитель: ждет записи до timeout_ms (-1 - без предела).
+ * @return 1 - есть записи, 0 - истек таймаут или прервано сигналом.
+ */
+int rt_ring_wait(RtRing* ring, int timeout_ms);
+
+// Записей в очереди (приблизительно, если читать с чужой стороны)
+size_t rt_ring_count(RtRing* ring);
+
+// eventfd пробуждения потребителя
+static inline int rt_ring_fd(const RtRing* ring) {
+    return ring->event_fd;
+}
+
+void rt_ring_get_stats(RtRing* ring, RtRingStats* stats);
+
+#endif // RT_RING_H
@@ -0,0 +1,49 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_sleep.h"
+#include <errno.h>
+#include <string.h>
+#include "rt_clock.h"
+#include "rt_time.h"
+
+static void sleep_until(int64_t deadline_ns) {
+    struct timespec ts;
+    rt_ns_to_timespec(deadline_ns, &ts);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+int64_t rt_sleep_until(const RtSleepPolicy* policy, int64_t deadline_ns) {
+    switch (policy->mode) {
+    case RT_SLEEP_PLAIN:
+        sleep_until(deadline_ns);
+        return 0;
+    case RT_SLEEP_HYBRID:
+        if (deadline_ns - policy->margin_ns > rt_now_ns()) sleep_until(deadline_ns - policy->margin_ns);
+        break;
+    case RT_SLEEP_SPIN:
+        break;
+    }
+
+    int64_t spin_start = rt_clock_now_ns();
+    int64_t now = spin_start;
+    while (now < deadline_ns) {
+        rt_cpu_relax();
+        now = rt_clock_now_ns();
+    }
+    return now - spin_start;
+}
+
+static const char* const mode_names[] = {"plain", "hybrid", "spin"};
+
+int rt_sleep_parse_mode(const char* name) {
+    for (int i = 0; i < (int)(sizeof(mode_names) / sizeof(mode_names[0])); ++i) {
+        if (strcmp(name, mode_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char* rt_sleep_mode_name(RtSleepMode mode) {
+    return (unsigned)mode < sizeof(mode_names) / sizeof(mode_names[0]) ? mode_names[mode] : "?";
+}
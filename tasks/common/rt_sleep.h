@@ -0,0 +1,44 @@
+#ifndef RT_SLEEP_H
+#define RT_SLEEP_H
+
+#include <stdint.h>
+
+// Как ждать момента выпуска
+typedef enum {
+    RT_SLEEP_PLAIN,   // clock_nanosleep(TIMER_ABSTIME) до самого дедлайна
+    RT_SLEEP_HYBRID,  // сон до (дедлайн - margin), дальше активное ожидание
+    RT_SLEEP_SPIN     // только активное ожидание, ядро занято полностью
+} RtSleepMode;
+
+typedef struct {
+    RtSleepMode mode;
+    int64_t margin_ns;  // Для RT_SLEEP_HYBRID: запас на задержку пробуждения
+} RtSleepPolicy;
+
+// Подсказка процессору внутри цикла активного ожидания
+static inline void rt_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * @brief Ждет до абсолютного момента deadline_ns по CLOCK_MONOTONIC.
+ *
+ * В гибридном режиме margin стоит выбирать чуть больше типичной задержки
+ * пробуждения (p99 из sched_fifo_jitter в режиме plain): тогда поток
+ * просыпается заранее и добирает остаток в спине, а ошибка выпуска
+ * сводится к стоимости одного чтения часов. Спин читает rt_clock_now_ns(),
+ * т.е. TSC, если был вызван rt_clock_init().
+ *
+ * @return Сколько наносекунд поток провел в активном ожидании.
+ */
+int64_t rt_sleep_until(const RtSleepPolicy* policy, int64_t deadline_ns);
+
+// "plain", "hybrid", "spin" -> режим; -1 для неизвестной строки
+int rt_sleep_parse_mode(const char* name);
+const char* rt_sleep_mode_name(RtSleepMode mode);
+
+#endif // RT_SLEEP_H
@@ -0,0 +1,220 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_slog.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_time.h"
+
+_Static_assert(sizeof(RtSlogHeader) <= RT_SLOG_HEADER_SIZE, "header does not fit its page");
+_Static_assert(sizeof(RtSlogRecord) == 16, "record layout is part of the file format");
+
+static void copy_field(char* dst, size_t size, const char* src) {
+    memset(dst, 0, size);
+    if (src) strncpy(dst, src, size - 1);
+}
+
+void rt_slog_flush(RtSampleLog* log) {
+    if (!log->stage) return;
+    pthread_mutex_lock(&log->flush_lock);
+    uint64_t t = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    uint64_t h = atomic_load_explicit(&log->head, memory_order_acquire);
+    while (t < h) {
+        uint64_t at = t & log->stage_mask;
+        uint64_t n = h - t < log->stage_mask + 1 - at ? h - t : log->stage_mask + 1 - at;
+        memcpy(&log->records[t], &log->stage[at], (size_t)n * sizeof(RtSlogRecord));
+        t += n;
+    }
+    log->hdr->dropped = atomic_load_explicit(&log->dropped, memory_order_relaxed);
+    atomic_store_explicit(&log->hdr->count, h, memory_order_release);
+    atomic_store_explicit(&log->tail, h, memory_order_release);
+    pthread_mutex_unlock(&log->flush_lock);
+}
+
+static void* flusher_main(void* arg) {
+    RtSampleLog* log = arg;
+    const struct timespec period = {0, RT_SLOG_FLUSH_MS * 1000000L};
+    while (!atomic_load_explicit(&log->stopping, memory_order_acquire)) {
+        nanosleep(&period, NULL);
+        rt_slog_flush(log);
+    }
+    return NULL;
+}
+
+// Каждая страница отображения - записью: page_mkwrite срабатывает сейчас, а не при переносе
+static void prefault_write(void* map, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t off = 0; off < size; off += (size_t)page) {
+        volatile char* p = (char*)map + off;
+        *p = *p;
+    }
+}
+
+int rt_slog_create(RtSampleLog* log, const char* path, uint64_t capacity, const char* description) {
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    if (capacity == 0 || capacity > (SIZE_MAX - RT_SLOG_HEADER_SIZE) / sizeof(RtSlogRecord)) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    size_t size = RT_SLOG_HEADER_SIZE + (size_t)capacity * sizeof(RtSlogRecord);
+    // Блоки выделяются сейчас: иначе файловая система отводила бы их при
+    // первой записи в каждую страницу, уже внутри замера
+    int rc = posix_fallocate(fd, 0, (off_t)size);
+    if (rc == EOPNOTSUPP || rc == EINVAL) rc = ftruncate(fd, (off_t)size) < 0 ? errno : 0;
+    if (rc != 0) {
+        close(fd);
+        errno = rc;
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    prefault_write(map, size);
+
+    uint64_t stage_records = 2;
+    while (stage_records < capacity && stage_records < RT_SLOG_STAGE_RECORDS) stage_records <<= 1;
+    size_t stage_size = (size_t)stage_records * sizeof(RtSlogRecord);
+    void* stage = mmap(NULL, stage_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (stage == MAP_FAILED) {
+        int err = errno;
+        munmap(map, size);
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    // Без права на mlock кольцо остается просто заполненным: ошибкой это не считается
+    (void)mlock(stage, stage_size);
+
+    RtSlogHeader* hdr = map;
+    memcpy(hdr->magic, RT_SLOG_MAGIC, sizeof(hdr->magic));
+    hdr->version = RT_SLOG_VERSION;
+    hdr->record_size = sizeof(RtSlogRecord);
+    hdr->capacity = capacity;
+    atomic_store(&hdr->count, 0);
+    hdr->start_mono_ns = rt_now_ns();
+    hdr->start_real_ns = rt_clock_ns(CLOCK_REALTIME);
+    copy_field(hdr->unit, sizeof(hdr->unit), "ns");
+    copy_field(hdr->description, sizeof(hdr->description), description);
+
+    log->hdr = hdr;
+    log->records = (RtSlogRecord*)((char*)map + RT_SLOG_HEADER_SIZE);
+    log->capacity = capacity;
+    log->start_ns = hdr->start_mono_ns;
+    log->map_size = size;
+    log->fd = fd;
+    log->writable = 1;
+    log->stage = stage;
+    log->stage_mask = stage_records - 1;
+    pthread_mutex_init(&log->flush_lock, NULL);
+
+    // Журнал больше кольца - переносить по ходу записи
+    if (capacity > stage_records) {
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old); // Поток наследует маску: сигналы процесса ему не нужны
+        int rc = pthread_create(&log->flusher, NULL, flusher_main, log);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (rc != 0) {
+            rt_slog_close(log);
+            errno = rc;
+            return -1;
+        }
+        log->has_flusher = 1;
+    }
+    return 0;
+}
+
+void rt_slog_set_tag_name(RtSampleLog* log, unsigned tag, const char* name) {
+    if (tag < RT_SLOG_MAX_TAGS) copy_field(log->hdr->tag_names[tag], RT_SLOG_TAG_NAME, name);
+}
+
+void rt_slog_set_unit(RtSampleLog* log, const char* unit) {
+    copy_field(log->hdr->unit, sizeof(log->hdr->unit), unit);
+}
+
+int rt_slog_close(RtSampleLog* log) {
+    if (!log->hdr) return 0;
+    int rc = 0;
+    if (log->writable) {
+        if (log->has_flusher) {
+            atomic_store_explicit(&log->stopping, 1, memory_order_release);
+            pthread_join(log->flusher, NULL);
+        }
+        rt_slog_flush(log);
+        munmap(log->stage, (size_t)(log->stage_mask + 1) * sizeof(RtSlogRecord));
+        pthread_mutex_destroy(&log->flush_lock);
+        // Емкость в заголовке - по обрезанному файлу
+        uint64_t used = rt_slog_count(log);
+        log->hdr->capacity = used;
+        munmap(log->hdr, log->map_size);
+        if (ftruncate(log->fd, (off_t)(RT_SLOG_HEADER_SIZE + used * sizeof(RtSlogRecord))) < 0) rc = -1;
+    } else {
+        munmap(log->hdr, log->map_size);
+    }
+    if (log->fd >= 0) close(log->fd);
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    return rc;
+}
+
+int rt_slog_open(RtSampleLog* log, const char* path) {
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < RT_SLOG_HEADER_SIZE) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    RtSlogHeader* hdr = map;
+    uint64_t fits = ((uint64_t)st.st_size - RT_SLOG_HEADER_SIZE) / sizeof(RtSlogRecord);
+    if (memcmp(hdr->magic, RT_SLOG_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != RT_SLOG_VERSION ||
+        hdr->record_size != sizeof(RtSlogRecord)) {
+        munmap(map, (size_t)st.st_size);
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    log->hdr = hdr;
+    log->records = (RtSlogRecord*)((char*)map + RT_SLOG_HEADER_SIZE);
+    // Не больше, чем есть в файле: заголовок мог быть записан раньше данных
+    log->capacity = hdr->capacity < fits ? hdr->capacity : fits;
+    log->start_ns = hdr->start_mono_ns;
+    log->map_size = (size_t)st.st_size;
+    log->fd = fd;
+    return 0;
+}
+
+const char* rt_slog_tag_name(const RtSampleLog* log, unsigned tag, char* buf, size_t size) {
+    if (tag < RT_SLOG_MAX_TAGS && log->hdr->tag_names[tag][0]) {
+        snprintf(buf, size, "%.*s", RT_SLOG_TAG_NAME, log->hdr->tag_names[tag]);
+    } else {
+        snprintf(buf, size, "%u", tag);
+    }
+    return buf;
+}
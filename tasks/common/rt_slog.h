@@ -0,0 +1,162 @@
+#ifndef RT_SLOG_H
+#define RT_SLOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Двоичный журнал замеров в файле, отображенном в память.
+ *
+ * Вместо printf на каждой итерации цикл пишет 16-байтную запись (время,
+ * значение, метка): ни системных вызовов, ни форматирования. Разбор,
+ * гистограммы и графики - потом, отдельной программой (task5/slog_analyze).
+ *
+ * Запись идет не в страницы файла: страница MAP_SHARED после MAP_POPULATE
+ * отображена только для чтения, первая запись в нее - отказ через
+ * page_mkwrite файловой системы (может ждать журнал ФС), а writeback снова
+ * защищает ее от записи. Поэтому цикл пишет в анонимное кольцо (MAP_POPULATE
+ * + mlock), а в файл записи переносит rt_slog_flush, фоновый поток журнала
+ * или rt_slog_close. Кольцо - на весь журнал, но не больше
+ * RT_SLOG_STAGE_RECORDS; поток нужен, только если журнал больше кольца, и
+ * переносит записи каждые RT_SLOG_FLUSH_MS. Страницы файла при создании
+ * заранее записываются, чтобы и перенос не ловил отказы.
+ *
+ * Формат: заголовок RT_SLOG_HEADER_SIZE байт (RtSlogHeader), затем записи
+ * RtSlogRecord подряд. Счетчик записей в заголовке растет при каждом
+ * переносе: если процесс упал, перенесенное до падения остается в page
+ * cache и читается. rt_slog_close обрезает файл до записанного.
+ *
+ * Писатель - один поток на журнал (для нескольких потоков - по журналу на
+ * поток). На полном журнале или кольце, которое перенос не успел
+ * освободить, записи не пишутся, а считаются в dropped.
+ */
+
+#define RT_SLOG_MAGIC       "RTSLOG01"
+#define RT_SLOG_VERSION     1
+#define RT_SLOG_HEADER_SIZE 4096
+#define RT_SLOG_MAX_TAGS    32          // Имена меток 0..31; сами метки - до 65535
+#define RT_SLOG_TAG_NAME    24
+#define RT_SLOG_TAG_BITS    16
+#define RT_SLOG_STAGE_RECORDS (1u << 18) // Кольцо до 4 МБ
+#define RT_SLOG_FLUSH_MS    10
+#define RT_SLOG_TIME_MAX    ((1ull << (64 - RT_SLOG_TAG_BITS)) - 1) // ~78 ч от начала журнала
+
+typedef struct {
+    uint64_t stamp;         // (нс от start_mono_ns) << 16 | метка
+    int64_t value;
+} RtSlogRecord;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    _Atomic uint64_t count; // Записано, release после каждой записи
+    uint64_t dropped;       // Не поместилось
+    int64_t start_mono_ns;  // Нулевой момент времени записей (CLOCK_MONOTONIC)
+    int64_t start_real_ns;  // Тот же момент в CLOCK_REALTIME - для отчетов
+    char unit[16];          // Единица value, по умолчанию "ns"
+    char description[256];
+    char tag_names[RT_SLOG_MAX_TAGS][RT_SLOG_TAG_NAME];
+} RtSlogHeader;
+
+typedef struct {
+    RtSlogHeader* hdr;
+    RtSlogRecord* records;  // Записи в файле
+    uint64_t capacity;
+    int64_t start_ns;
+    size_t map_size;
+    int fd;
+    int writable;
+
+    // Писатель: кольцо, индексы - номера записей от начала журнала
+    RtSlogRecord* stage;
+    uint64_t stage_mask;
+    _Atomic uint64_t head;      // Пишет только писатель
+    _Atomic uint64_t tail;      // Перенесено в файл
+    uint64_t tail_cache;        // Последний увиденный писателем tail
+    _Atomic uint64_t dropped;
+    pthread_mutex_t flush_lock;
+    pthread_t flusher;
+    atomic_int stopping;
+    int has_flusher;
+} RtSampleLog;
+
+/**
+ * @brief Создает журнал на capacity записей (файл перезаписывается).
+ *
+ * Страницы файла заранее выделяются и записываются, кольцо записей
+ * выделяется и закрепляется (mlock, без ошибки, если не вышло); после
+ * возврата rt_slog_append не делает системных вызовов и не трогает файл.
+ *
+ * @return 0 или -1 с errno.
+ */
+int rt_slog_create(RtSampleLog* log, const char* path, uint64_t capacity, const char* description);
+
+// Имя метки для отчетов (tag < RT_SLOG_MAX_TAGS) и единица значений
+void rt_slog_set_tag_name(RtSampleLog* log, unsigned tag, const char* name);
+void rt_slog_set_unit(RtSampleLog* log, const char* unit);
+
+/**
+ * @brief Добавляет запись. time_ns - CLOCK_MONOTONIC (rt_now_ns, rt_clock_now_ns).
+ * @return 0 или -1, если журнал полон.
+ */
+static inline int rt_slog_append(RtSampleLog* log, int64_t time_ns, unsigned tag, int64_t value) {
+    uint64_t i = atomic_load_explicit(&log->head, memory_order_relaxed);
+    if (i - log->tail_cache > log->stage_mask) {
+        log->tail_cache = atomic_load_explicit(&log->tail, memory_order_acquire);
+    }
+    if (i >= log->capacity || i - log->tail_cache > log->stage_mask) {
+        atomic_store_explicit(&log->dropped, atomic_load_explicit(&log->dropped, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+        return -1;
+    }
+    uint64_t t = time_ns > log->start_ns ? (uint64_t)(time_ns - log->start_ns) : 0;
+    if (t > RT_SLOG_TIME_MAX) t = RT_SLOG_TIME_MAX;
+    RtSlogRecord* r = &log->stage[i & log->stage_mask];
+    r->stamp = t << RT_SLOG_TAG_BITS | (tag & ((1u << RT_SLOG_TAG_BITS) - 1));
+    r->value = value;
+    atomic_store_explicit(&log->head, i + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * @brief Переносит записанное из кольца в файл и обновляет заголовок.
+ *        Не для цикла замеров; после него rt_slog_count и records видят все записи.
+ */
+void rt_slog_flush(RtSampleLog* log);
+
+/**
+ * @brief Писатель: останавливает перенос, переносит остаток, обрезает файл
+ *        до записанного, снимает отображение.
+ *        Читатель: снимает отображение.
+ * @return 0 или -1 с errno.
+ */
+int rt_slog_close(RtSampleLog* log);
+
+/**
+ * @brief Открывает журнал для чтения (в том числе еще пишущийся).
+ * @return 0 или -1 с errno (EINVAL - не журнал или другая версия).
+ */
+int rt_slog_open(RtSampleLog* log, const char* path);
+
+static inline uint64_t rt_slog_count(const RtSampleLog* log) {
+    uint64_t n = atomic_load_explicit(&log->hdr->count, memory_order_acquire);
+    return n < log->capacity ? n : log->capacity;
+}
+
+// Время записи от начала журнала, нс
+static inline int64_t rt_slog_time(const RtSlogRecord* r) {
+    return (int64_t)(r->stamp >> RT_SLOG_TAG_BITS);
+}
+
+static inline unsigned rt_slog_tag(const RtSlogRecord* r) {
+    return (unsigned)(r->stamp & ((1u << RT_SLOG_TAG_BITS) - 1));
+}
+
+// Имя метки или ее номер (в buf), если имени нет
+const char* rt_slog_tag_name(const RtSampleLog* log, unsigned tag, char* buf, size_t size);
+
+#endif // RT_SLOG_H
@@ -0,0 +1,429 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_stats.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RT_STATS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define RT_STATS_NEON 1
+#endif
+
+enum { SIMD_SCALAR, SIMD_AVX2, SIMD_NEON };
+
+static int simd_enabled = 1;
+
+static int bucket_index(uint64_t v) {
+    if (v < (1u << RT_HIST_SUB_BITS)) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int exp = msb - RT_HIST_SUB_BITS + 1;
+    return exp * RT_HIST_HALF + (int)(v >> exp);
+}
+
+// Наибольшее значение, попадающее в корзину index
+static uint64_t bucket_upper(int index) {
+    if (index < (1 << RT_HIST_SUB_BITS)) return (uint64_t)index;
+    int exp = index / RT_HIST_HALF - 1;
+    uint64_t mantissa = (uint64_t)(index % RT_HIST_HALF + RT_HIST_HALF);
+    return ((mantissa + 1) << exp) - 1;
+}
+
+void rt_hist_init(RtHistogram* h) {
+    memset(h, 0, sizeof(*h));
+    h->min = INT64_MAX;
+    h->max = INT64_MIN;
+}
+
+void rt_hist_record(RtHistogram* h, int64_t value) {
+    h->counts[bucket_index(value > 0 ? (uint64_t)value : 0)]++;
+    h->total++;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+
+    double delta = (double)value - h->mean;
+    h->mean += delta / (double)h->total;
+    h->m2 += delta * ((double)value - h->mean);
+}
+
+// Объединение моментов по Chan et al.; корзины - забота вызывающего
+static void merge_moments(RtHistogram* dst, uint64_t total, double mean, double m2, int64_t min, int64_t max) {
+    double n_a = (double)dst->total, n_b = (double)total;
+    double delta = mean - dst->mean;
+    dst->total += total;
+    dst->mean += delta * n_b / (double)dst->total;
+    dst->m2 += m2 + delta * delta * n_a * n_b / (double)dst->total;
+
+    if (min < dst->min) dst->min = min;
+    if (max > dst->max) dst->max = max;
+}
+
+void rt_hist_merge(RtHistogram* dst, const RtHistogram* src) {
+    if (src->total == 0) return;
+    for (int i = 0; i < RT_HIST_BUCKETS; ++i) dst->counts[i] += src->counts[i];
+    merge_moments(dst, src->total, src->mean, src->m2, src->min, src->max);
+}
+
+int64_t rt_hist_percentile(const RtHistogram* h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+    uint64_t seen = 0;
+    for (int i = 0; i < RT_HIST_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            int64_t upper = (int64_t)bucket_upper(i);
+            if (upper > h->max) return h->max;
+            return upper < h->min ? h->min : upper;
+        }
+    }
+    return h->max;
+}
+
+double rt_hist_mean(const RtHistogram* h) {
+    return h->total ? h->mean : 0.0;
+}
+
+double rt_hist_stddev(const RtHistogram* h) {
+    return h->total > 1 ? sqrt(h->m2 / (double)h->total) : 0.0;
+}
+
+/* --- массивы замеров --- */
+
+static int simd_level(void) {
+    if (!simd_enabled) return SIMD_SCALAR;
+#if defined(RT_STATS_X86)
+    return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SCALAR;
+#elif defined(RT_STATS_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+const char* rt_stats_simd_name(void) {
+    switch (simd_level()) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_NEON: return "neon";
+        default: return "scalar";
+    }
+}
+
+void rt_stats_use_simd(int enable) {
+    simd_enabled = enable;
+}
+
+// Суммы считаются от shift (первого значения): s2 - s1^2/n не теряет
+// точность, когда разброс мал по сравнению с самими значениями
+typedef struct {
+    int64_t min;
+    int64_t max;
+    double s1;
+    double s2;
+} Sums;
+
+static void sums_scalar(const int64_t* v, size_t n, int64_t shift, Sums* out) {
+    int64_t mn = INT64_MAX, mx = INT64_MIN;
+    double s1 = 0.0, s2 = 0.0, base = (double)shift;
+    for (size_t i = 0; i < n; ++i) {
+        if (v[i] < mn) mn = v[i];
+        if (v[i] > mx) mx = v[i];
+        double d = (double)v[i] - base;
+        s1 += d;
+        s2 += d * d;
+    }
+    out->min = mn;
+    out->max = mx;
+    out->s1 = s1;
+    out->s2 = s2;
+}
+
+static void buckets_scalar(uint64_t* counts, const int64_t* v, size_t n) {
+    for (size_t i = 0; i < n; ++i) counts[bucket_index(v[i] > 0 ? (uint64_t)v[i] : 0)]++;
+}
+
+#if defined(RT_STATS_X86)
+// 2^52 + 2^51: прибавление к целому |x| < 2^51 дает битовый образ double
+// (2^52 + 2^51 + x) - перевод int64 -> double без AVX-512
+#define MAGIC_I2D 6755399441055744.0
+
+__attribute__((target("avx2"))) static void sums_avx2(const int64_t* v, size_t n, int64_t shift, Sums* out) {
+    __m256i min_a = _mm256_set1_epi64x(INT64_MAX), max_a = _mm256_set1_epi64x(INT64_MIN);
+    __m256i min_b = min_a, max_b = max_a;
+    const __m256i base = _mm256_set1_epi64x(shift);
+    const __m256d magic_d = _mm256_set1_pd(MAGIC_I2D);
+    const __m256i magic_i = _mm256_castpd_si256(magic_d);
+    __m256d s1_a = _mm256_setzero_pd(), s2_a = _mm256_setzero_pd();
+    __m256d s1_b = s1_a, s2_b = s2_a;
+    size_t i = 0;
+    // Две независимые цепочки: сложения не ждут друг друга
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(v + i + 4));
+        min_a = _mm256_blendv_epi8(min_a, x, _mm256_cmpgt_epi64(min_a, x));
+        max_a = _mm256_blendv_epi8(max_a, x, _mm256_cmpgt_epi64(x, max_a));
+        min_b = _mm256_blendv_epi8(min_b, y, _mm256_cmpgt_epi64(min_b, y));
+        max_b = _mm256_blendv_epi8(max_b, y, _mm256_cmpgt_epi64(y, max_b));
+        __m256d dx = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(_mm256_sub_epi64(x, base), magic_i)), magic_d);
+        __m256d dy = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(_mm256_sub_epi64(y, base), magic_i)), magic_d);
+        s1_a = _mm256_add_pd(s1_a, dx);
+        s2_a = _mm256_add_pd(s2_a, _mm256_mul_pd(dx, dx));
+        s1_b = _mm256_add_pd(s1_b, dy);
+        s2_b = _mm256_add_pd(s2_b, _mm256_mul_pd(dy, dy));
+    }
+    min_a = _mm256_blendv_epi8(min_a, min_b, _mm256_cmpgt_epi64(min_a, min_b));
+    max_a = _mm256_blendv_epi8(max_a, max_b, _mm256_cmpgt_epi64(max_b, max_a));
+    int64_t mins[4], maxs[4];
+    double s1[4], s2[4];
+    _mm256_storeu_si256((__m256i*)mins, min_a);
+    _mm256_storeu_si256((__m256i*)maxs, max_a);
+    _mm256_storeu_pd(s1, _mm256_add_pd(s1_a, s1_b));
+    _mm256_storeu_pd(s2, _mm256_add_pd(s2_a, s2_b));
+
+    Sums tail;
+    sums_scalar(v + i, n - i, shift, &tail);
+    for (int k = 0; k < 4; ++k) {
+        if (mins[k] < tail.min) tail.min = mins[k];
+        if (maxs[k] > tail.max) tail.max = maxs[k];
+        tail.s1 += s1[k];
+        tail.s2 += s2[k];
+    }
+    *out = tail;
+}
+
+// Номер корзины для 4 значений: старший бит - из показателя double(x),
+// точного при x < 2^52 (AVX2 не умеет lzcnt по 64-битным элементам)
+__attribute__((target("avx2"))) static void buckets_avx2(uint64_t* counts, const int64_t* v, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i exact = _mm256_set1_epi64x(1ll << RT_HIST_SUB_BITS);
+    const __m256i high = _mm256_set1_epi64x(~((1ll << 52) - 1));
+    const __m256i exp_bits = _mm256_set1_epi64x(0x4330000000000000ll); // double 2^52
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    const __m256i bias = _mm256_set1_epi64x(1023 + RT_HIST_SUB_BITS - 1);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+        x = _mm256_blendv_epi8(x, zero, _mm256_cmpgt_epi64(zero, x));
+        if (!_mm256_testz_si256(x, high)) {
+            buckets_scalar(counts, v + i, 4); // Больше 2^52 нс - 52 суток; точный путь
+            continue;
+        }
+        __m256d d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(x, exp_bits)), two52);
+        __m256i exp = _mm256_sub_epi64(_mm256_srli_epi64(_mm256_castpd_si256(d), 52), bias);
+        __m256i idx = _mm256_add_epi64(_mm256_slli_epi64(exp, RT_HIST_SUB_BITS - 1), _mm256_srlv_epi64(x, exp));
+        idx = _mm256_blendv_epi8(idx, x, _mm256_cmpgt_epi64(exact, x));
+        uint64_t out[4];
+        _mm256_storeu_si256((__m256i*)out, idx);
+        counts[out[0]]++;
+        counts[out[1]]++;
+        counts[out[2]]++;
+        counts[out[3]]++;
+    }
+    buckets_scalar(counts, v + i, n - i);
+}
+#endif
+
+#if defined(RT_STATS_NEON)
+static void sums_neon(const int64_t* v, size_t n, int64_t shift, Sums* out) {
+    int64x2_t mn = vdupq_n_s64(INT64_MAX), mx = vdupq_n_s64(INT64_MIN);
+    const int64x2_t base = vdupq_n_s64(shift);
+    float64x2_t s1_a = vdupq_n_f64(0.0), s2_a = s1_a, s1_b = s1_a, s2_b = s1_a;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int64x2_t x = vld1q_s64(v + i), y = vld1q_s64(v + i + 2);
+        mn = vbslq_s64(vcgtq_s64(mn, x), x, mn);
+        mx = vbslq_s64(vcgtq_s64(x, mx), x, mx);
+        mn = vbslq_s64(vcgtq_s64(mn, y), y, mn);
+        mx = vbslq_s64(vcgtq_s64(y, mx), y, mx);
+        float64x2_t dx = vcvtq_f64_s64(vsubq_s64(x, base)), dy = vcvtq_f64_s64(vsubq_s64(y, base));
+        s1_a = vaddq_f64(s1_a, dx);
+        s2_a = vfmaq_f64(s2_a, dx, dx);
+        s1_b = vaddq_f64(s1_b, dy);
+        s2_b = vfmaq_f64(s2_b, dy, dy);
+    }
+    Sums tail;
+    sums_scalar(v + i, n - i, shift, &tail);
+    for (int k = 0; k < 2; ++k) {
+        int64_t lo = k ? vgetq_lane_s64(mn, 1) : vgetq_lane_s64(mn, 0);
+        int64_t hi = k ? vgetq_lane_s64(mx, 1) : vgetq_lane_s64(mx, 0);
+        if (lo < tail.min) tail.min = lo;
+        if (hi > tail.max) tail.max = hi;
+    }
+    tail.s1 += vaddvq_f64(vaddq_f64(s1_a, s1_b));
+    tail.s2 += vaddvq_f64(vaddq_f64(s2_a, s2_b));
+    *out = tail;
+}
+
+// Как в AVX2: 64-битного clz в NEON нет, старший бит - из показателя double
+static void buckets_neon(uint64_t* counts, const int64_t* v, size_t n) {
+    const int64x2_t zero = vdupq_n_s64(0);
+    const uint64x2_t exact = vdupq_n_u64(1ull << RT_HIST_SUB_BITS);
+    const uint64x2_t limit = vdupq_n_u64(1ull << 52);
+    const int64x2_t bias = vdupq_n_s64(1023 + RT_HIST_SUB_BITS - 1);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        int64x2_t s = vld1q_s64(v + i);
+        uint64x2_t x = vreinterpretq_u64_s64(vbslq_s64(vcgtq_s64(zero, s), zero, s));
+        if (vmaxvq_u32(vreinterpretq_u32_u64(vcgeq_u64(x, limit))) != 0) {
+            buckets_scalar(counts, v + i, 2);
+            continue;
+        }
+        float64x2_t d = vcvtq_f64_u64(x);
+        int64x2_t exp = vsubq_s64(vreinterpretq_s64_u64(vshrq_n_u64(vreinterpretq_u64_f64(d), 52)), bias);
+        uint64x2_t idx = vaddq_u64(vreinterpretq_u64_s64(vshlq_n_s64(exp, RT_HIST_SUB_BITS - 1)),
+                                   vshlq_u64(x, vnegq_s64(exp)));
+        idx = vbslq_u64(vcltq_u64(x, exact), x, idx);
+        counts[vgetq_lane_u64(idx, 0)]++;
+        counts[vgetq_lane_u64(idx, 1)]++;
+    }
+    buckets_scalar(counts, v + i, n - i);
+}
+#endif
+
+void rt_stats_compute(const int64_t* values, size_t n, RtSampleStats* out) {
+    memset(out, 0, sizeof(*out));
+    out->min = INT64_MAX;
+    out->max = INT64_MIN;
+    if (n == 0) return;
+    int64_t shift = values[0];
+    Sums sums;
+    switch (simd_level()) {
+#if defined(RT_STATS_X86)
+        case SIMD_AVX2:
+            sums_avx2(values, n, shift, &sums);
+            // Разброс больше 2^51: векторный перевод в double был неточен
+            if ((uint64_t)sums.max - (uint64_t)sums.min >= (1ull << 51)) sums_scalar(values, n, shift, &sums);
+            break;
+#endif
+#if defined(RT_STATS_NEON)
+        case SIMD_NEON: sums_neon(values, n, shift, &sums); break;
+#endif
+        default: sums_scalar(values, n, shift, &sums); break;
+    }
+    out->count = n;
+    out->min = sums.min;
+    out->max = sums.max;
+    out->mean = (double)shift + sums.s1 / (double)n;
+    out->m2 = sums.s2 - sums.s1 * sums.s1 / (double)n;
+    if (out->m2 < 0.0) out->m2 = 0.0;
+}
+
+void rt_hist_record_bulk(RtHistogram* h, const int64_t* values, size_t n) {
+    if (n == 0) return;
+    switch (simd_level()) {
+#if defined(RT_STATS_X86)
+        case SIMD_AVX2: buckets_avx2(h->counts, values, n); break;
+#endif
+#if defined(RT_STATS_NEON)
+        case SIMD_NEON: buckets_neon(h->counts, values, n); break;
+#endif
+        default: buckets_scalar(h->counts, values, n); break;
+    }
+    RtSampleStats st;
+    rt_stats_compute(values, n, &st);
+    merge_moments(h, st.count, st.mean, st.m2, st.min, st.max);
+}
+
+/* --- выбор k-го значения --- */
+
+#define SELECT_SMALL 16
+
+static int cmp_i64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void swap_i64(int64_t* a, int64_t* b) {
+    int64_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Quickselect: разбиение Хоара вокруг медианы трех; если разбиения раз за
+// разом неудачны (глубина больше 2 log2 n), остаток сортируется - O(n log n)
+// в худшем случае вместо O(n^2)
+static int64_t select_range(int64_t* v, size_t lo, size_t hi, size_t k) {
+    int depth = 8;
+    for (size_t len = hi - lo; len > 1; len >>= 1) depth += 2;
+    while (hi - lo > SELECT_SMALL) {
+        if (depth-- == 0) {
+            qsort(v + lo, hi - lo, sizeof(*v), cmp_i64);
+            return v[k];
+        }
+        size_t mid = lo + (hi - 1 - lo) / 2;
+        if (v[mid] < v[lo]) swap_i64(&v[mid], &v[lo]);
+        if (v[hi - 1] < v[lo]) swap_i64(&v[hi - 1], &v[lo]);
+        if (v[hi - 1] < v[mid]) swap_i64(&v[hi - 1], &v[mid]);
+        int64_t pivot = v[mid];
+        size_t i = lo - 1, j = hi;
+        for (;;) {
+            do ++i; while (v[i] < pivot);
+            do --j; while (v[j] > pivot);
+            if (i >= j) break;
+            swap_i64(&v[i], &v[j]);
+        }
+        // [lo, j] <= pivot <= [j + 1, hi)
+        if (k <= j) {
+            hi = j + 1;
+        } else {
+            lo = j + 1;
+        }
+    }
+    for (size_t i = lo + 1; i < hi; ++i) {
+        int64_t x = v[i];
+        size_t j = i;
+        for (; j > lo && v[j - 1] > x; --j) v[j] = v[j - 1];
+        v[j] = x;
+    }
+    return v[k];
+}
+
+int64_t rt_stats_select(int64_t* values, size_t n, size_t k) {
+    if (n == 0) return 0;
+    if (k >= n) k = n - 1;
+    return select_range(values, 0, n, k);
+}
+
+void rt_stats_percentiles(int64_t* values, size_t n, const double* p, int count, int64_t* out) {
+    if (count <= 0) return;
+    int order[count];
+    for (int i = 0; i < count; ++i) {
+        int j = i;
+        for (; j > 0 && p[order[j - 1]] > p[i]; --j) order[j] = order[j - 1];
+        order[j] = i;
+    }
+    // После выбора k все правее не меньше v[k]: следующий (больший) ранг
+    // ищется только в [k, n)
+    size_t lo = 0;
+    for (int i = 0; i < count; ++i) {
+        int q = order[i];
+        if (n == 0) {
+            out[q] = 0;
+            continue;
+        }
+        uint64_t rank = (uint64_t)(p[q] / 100.0 * (double)n + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > n) rank = n;
+        size_t k = (size_t)rank - 1;
+        out[q] = select_range(values, lo, n, k);
+        lo = k;
+    }
+}
+
+void rt_hist_print_summary(FILE* out, const char* label, const RtHistogram* h) {
+    if (h->total == 0) {
+        fprintf(out, "%s: no samples\n", label);
+        return;
+    }
+    fprintf(out, "%s: n=%" PRIu64 " min=%" PRId64 " avg=%.1f stddev=%.1f p50=%" PRId64
+            " p99=%" PRId64 " p99.9=%" PRId64 " max=%" PRId64 " ns\n",
+            label, h->total, h->min, rt_hist_mean(h), rt_hist_stddev(h),
+            rt_hist_percentile(h, 50.0), rt_hist_percentile(h, 99.0),
+            rt_hist_percentile(h, 99.9), h->max);
+}
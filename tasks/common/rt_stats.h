@@ -0,0 +1,86 @@
+#ifndef RT_STATS_H
+#define RT_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Потоковая гистограмма задержек фиксированного размера в стиле HDR:
+// значения до 2^RT_HIST_SUB_BITS хранятся точно, дальше каждая степень
+// двойки делится на 2^(RT_HIST_SUB_BITS-1) корзин. Относительная
+// погрешность перцентилей не хуже 1/64 (~1.6%) на всем диапазоне int64,
+// память не зависит от числа замеров (~30 КБ), запись - O(1) без аллокаций.
+#define RT_HIST_SUB_BITS 7
+#define RT_HIST_HALF (1 << (RT_HIST_SUB_BITS - 1))
+#define RT_HIST_BUCKETS ((64 - RT_HIST_SUB_BITS + 2) * RT_HIST_HALF)
+
+typedef struct {
+    uint64_t counts[RT_HIST_BUCKETS];
+    uint64_t total;
+    int64_t min;
+    int64_t max;
+    double mean;    // Онлайн-среднее и сумма квадратов отклонений (Welford)
+    double m2;
+} RtHistogram;
+
+void rt_hist_init(RtHistogram* h);
+
+// Отрицательные значения попадают в нулевую корзину, но учитываются в min/mean
+void rt_hist_record(RtHistogram* h, int64_t value);
+
+// Добавить src к dst (например, гистограммы потоков в общую)
+void rt_hist_merge(RtHistogram* dst, const RtHistogram* src);
+
+// Значение перцентиля p (0..100): верхняя граница корзины, но не больше max
+int64_t rt_hist_percentile(const RtHistogram* h, double p);
+
+double rt_hist_mean(const RtHistogram* h);
+double rt_hist_stddev(const RtHistogram* h);
+
+/*
+ * Обработка массивов замеров после прогона (миллионы значений):
+ * min/max/сумма/сумма квадратов и раскладка по корзинам гистограммы -
+ * векторные ядра AVX2 (выбираются при запуске по CPUID) или NEON, иначе
+ * скалярный вариант с тем же результатом. Перцентили по массиву - выбором
+ * (quickselect, O(n) в среднем) вместо полной сортировки.
+ */
+
+typedef struct {
+    uint64_t count;
+    int64_t min;
+    int64_t max;
+    double mean;
+    double m2;      // Сумма квадратов отклонений от среднего: stddev = sqrt(m2 / count)
+} RtSampleStats;
+
+void rt_stats_compute(const int64_t* values, size_t n, RtSampleStats* out);
+
+// То же, что n вызовов rt_hist_record, но векторно и с одним обновлением моментов
+void rt_hist_record_bulk(RtHistogram* h, const int64_t* values, size_t n);
+
+/**
+ * @brief k-е по возрастанию значение (k от 0), переставляя values.
+ *
+ * После вызова слева от k - не больше, справа - не меньше его.
+ */
+int64_t rt_stats_select(int64_t* values, size_t n, size_t k);
+
+/**
+ * @brief Перцентили p[0..count) (0..100, в любом порядке) в out.
+ *
+ * Ранг - как у rt_hist_percentile: ближайший к p/100 * n, от 1 до n.
+ * Переставляет values; на всех перцентилях вместе - один проход выбора
+ * по сужающимся диапазонам.
+ */
+void rt_stats_percentiles(int64_t* values, size_t n, const double* p, int count, int64_t* out);
+
+// "avx2", "neon" или "scalar" - что сейчас используют ядра
+const char* rt_stats_simd_name(void);
+
+// 0 - принудительно скалярные ядра (для сравнения), 1 - по возможностям CPU
+void rt_stats_use_simd(int enable);
+
+// Однострочная сводка: count, min, avg, stddev, p50, p99, p99.9, max
+void rt_hist_print_summary(FILE* out, const char* label, const RtHistogram* h);
+
+#endif // RT_STATS_H
@@ -0,0 +1,464 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_stress.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "rt_time.h"
+
+#define DEFAULT_PERIOD_NS (10 * RT_NSEC_PER_MSEC)
+#define DEFAULT_RATE      10000
+#define MEMBW_SIZE        (64u << 20)  // Заведомо больше LLC
+#define CACHE_SIZE        (8u << 20)   // Порядка LLC
+#define IO_BLOCK          (1u << 20)
+#define IO_FILE_SIZE      (64u << 20)  // Файл пишется по кругу
+#define IO_SYNC_BYTES     (8u << 20)   // fdatasync после стольких байт
+#define MEMBW_CHUNK       (1u << 20)
+#define CACHE_CHUNK_LINES 4096
+#define CPU_CHUNK_ITERS   20000
+#define SYSCALL_CHUNK     256
+
+typedef struct {
+    RtStressWorker cfg;
+    RtStress* stress;
+    pthread_t thread;
+    unsigned char* buf;
+    size_t buf_size;
+    int fd;                 // io - файл, irq - timerfd
+    uint64_t rng;
+    size_t pos;             // Смещение в буфере/файле
+    size_t unsynced;
+    atomic_uint_fast64_t ops;
+    atomic_uint_fast64_t bytes;
+    _Atomic int64_t cpu_ns;
+    _Atomic int64_t end_ns; // 0 - поток работает
+    atomic_int cpu_now;
+    int64_t start_ns;
+    int error;
+} Worker;
+
+struct RtStress {
+    Worker* workers;
+    int count;
+    int threads;            // Сколько потоков реально запущено
+    atomic_int stopping;
+    // Старт: потоки отмечаются в arrived и ждут released. Не барьер: при
+    // ошибке pthread_create участников меньше, чем задумано
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int arrived;
+    int released;
+};
+
+static const char* const kind_names[RT_STRESS_KINDS] = {"cpu", "membw", "cache", "io", "syscall", "irq"};
+
+// Готовые профили; без привязки - ядра выбирает планировщик
+static const struct {
+    const char* name;
+    const char* spec;
+} presets[] = {
+    {"light", "cpu:duty=25,irq:rate=1000"},
+    // Как noise.sh: обход ФС (системные вызовы), dd | md5sum (счет), head | tr (память)
+    {"mixed", "syscall:duty=50,cpu:duty=50,membw:duty=50"},
+    {"heavy", "cpu,membw,cache,io,syscall,irq:rate=20000"},
+};
+
+static volatile uint64_t sink;
+
+const char* rt_stress_kind_name(RtStressKind kind) {
+    return (unsigned)kind < RT_STRESS_KINDS ? kind_names[kind] : "?";
+}
+
+/* --- разбор профиля --- */
+
+static int parse_size(const char* s, size_t* out) {
+    char* end;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s) return -1;
+    switch (*end) {
+        case 'K': case 'k': v <<= 10; end++; break;
+        case 'M': case 'm': v <<= 20; end++; break;
+        case 'G': case 'g': v <<= 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || v == 0) return -1;
+    *out = (size_t)v;
+    return 0;
+}
+
+static int parse_item(char* item, RtStressProfile* profile, char* err, size_t err_len) {
+    char* save;
+    char* name = strtok_r(item, ":", &save);
+    RtStressWorker w = {.cpu = -1, .duty = 100};
+    int kind = -1;
+    for (int k = 0; name && k < RT_STRESS_KINDS; k++) {
+        if (strcmp(name, kind_names[k]) == 0) kind = k;
+    }
+    if (kind < 0) {
+        snprintf(err, err_len, "unknown load '%s' (cpu, membw, cache, io, syscall, irq)", name ? name : "");
+        return -1;
+    }
+    w.kind = (RtStressKind)kind;
+    long n = 1;
+    for (char* kv = strtok_r(NULL, ":", &save); kv; kv = strtok_r(NULL, ":", &save)) {
+        char* value = strchr(kv, '=');
+        if (!value) {
+            snprintf(err, err_len, "%s: expected key=value, got '%s'", name, kv);
+            return -1;
+        }
+        *value++ = '\0';
+        char* end;
+        long v = strtol(value, &end, 10);
+        int ok = end != value && *end == '\0';
+        if (strcmp(kv, "n") == 0 && ok && v > 0) {
+            n = v;
+        } else if (strcmp(kv, "cpu") == 0 && ok && v >= -1 && v < CPU_SETSIZE) {
+            w.cpu = (int)v;
+        } else if (strcmp(kv, "duty") == 0 && ok && v >= 1 && v <= 100) {
+            w.duty = (int)v;
+        } else if (strcmp(kv, "period") == 0 && ok && v > 0) {
+            w.period_ns = v * RT_NSEC_PER_USEC;
+        } else if (strcmp(kv, "rate") == 0 && ok && v > 0 && v <= 1000000) {
+            w.rate = (uint32_t)v;
+        } else if (strcmp(kv, "size") == 0 && parse_size(value, &w.size) == 0) {
+        } else {
+            snprintf(err, err_len, "%s: bad %s=%s", name, kv, value);
+            return -1;
+        }
+    }
+    for (long i = 0; i < n; i++) {
+        if (profile->count == RT_STRESS_MAX_WORKERS) {
+            snprintf(err, err_len, "more than %d workers", RT_STRESS_MAX_WORKERS);
+            return -1;
+        }
+        profile->workers[profile->count++] = w;
+    }
+    return 0;
+}
+
+int rt_stress_parse(const char* spec, RtStressProfile* profile, char* err, size_t err_len) {
+    memset(profile, 0, sizeof(*profile));
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        if (strcmp(spec, presets[i].name) == 0) spec = presets[i].spec;
+    }
+    char* copy = strdup(spec);
+    if (!copy) {
+        snprintf(err, err_len, "out of memory");
+        return -1;
+    }
+    int rc = 0;
+    char* save;
+    for (char* item = strtok_r(copy, ",", &save); item && rc == 0; item = strtok_r(NULL, ",", &save)) {
+        rc = parse_item(item, profile, err, err_len);
+    }
+    free(copy);
+    if (rc == 0 && profile->count == 0) {
+        snprintf(err, err_len, "empty profile");
+        rc = -1;
+    }
+    return rc;
+}
+
+/* --- нагрузка: порция работы в десятки микросекунд --- */
+
+static void chunk_cpu(Worker* w) {
+    double x = 1.0;
+    uint64_t h = w->rng;
+    for (int i = 0; i < CPU_CHUNK_ITERS; i++) {
+        x = x * 1.0000001 + 0.5;
+        h = h * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    w->rng = h;
+    sink = h + (uint64_t)x;
+    atomic_fetch_add_explicit(&w->ops, CPU_CHUNK_ITERS, memory_order_relaxed);
+}
+
+// Копия MEMBW_CHUNK из одной половины буфера в другую, по кругу
+static void chunk_membw(Worker* w) {
+    size_t half = w->buf_size / 2;
+    memcpy(w->buf + half + w->pos, w->buf + w->pos, MEMBW_CHUNK);
+    sink = w->buf[half + w->pos];
+    w->pos = (w->pos + MEMBW_CHUNK) % half;
+    atomic_fetch_add_explicit(&w->bytes, MEMBW_CHUNK, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->ops, 1, memory_order_relaxed);
+}
+
+// Запись в случайные строки: каждая вытесняет чью-то строку из LLC
+static void chunk_cache(Worker* w) {
+    size_t lines = w->buf_size / 64;
+    uint64_t x = w->rng;
+    for (int i = 0; i < CACHE_CHUNK_LINES; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        w->buf[(x % lines) * 64]++;
+    }
+    w->rng = x;
+    atomic_fetch_add_explicit(&w->ops, CACHE_CHUNK_LINES, memory_order_relaxed);
+}
+
+static void chunk_io(Worker* w) {
+    ssize_t n = pwrite(w->fd, w->buf, w->buf_size, (off_t)w->pos);
+    if (n <= 0) return;
+    w->pos = (w->pos + (size_t)n) % IO_FILE_SIZE;
+    w->unsynced += (size_t)n;
+    if (w->unsynced >= IO_SYNC_BYTES) {
+        fdatasync(w->fd);
+        w->unsynced = 0;
+    }
+    atomic_fetch_add_explicit(&w->bytes, (uint64_t)n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->ops, 1, memory_order_relaxed);
+}
+
+static void chunk_syscall(Worker* w) {
+    for (int i = 0; i < SYSCALL_CHUNK; i++) syscall(SYS_getppid);
+    atomic_fetch_add_explicit(&w->ops, SYSCALL_CHUNK, memory_order_relaxed);
+}
+
+static void (*const chunks[RT_STRESS_KINDS])(Worker*) = {
+    chunk_cpu, chunk_membw, chunk_cache, chunk_io, chunk_syscall, NULL,
+};
+
+static void update_cpu(Worker* w) {
+    atomic_store_explicit(&w->cpu_ns, rt_clock_ns(CLOCK_THREAD_CPUTIME_ID), memory_order_relaxed);
+    atomic_store_explicit(&w->cpu_now, sched_getcpu(), memory_order_relaxed);
+}
+
+// duty % каждого периода - порции работы, остаток - сон до начала следующего
+static void run_duty(Worker* w) {
+    RtStress* stress = w->stress;
+    int64_t period = w->cfg.period_ns;
+    int64_t busy = period * w->cfg.duty / 100;
+    int64_t start = rt_now_ns();
+    while (!atomic_load_explicit(&stress->stopping, memory_order_relaxed)) {
+        int64_t now;
+        do {
+            chunks[w->cfg.kind](w);
+            now = rt_now_ns();
+        } while (now - start < busy && !atomic_load_explicit(&stress->stopping, memory_order_relaxed));
+        update_cpu(w);
+        start += period;
+        if (w->cfg.duty < 100) {
+            // Отстали больше чем на период (ядро было занято) - не догоняем
+            if (start < now) start = now;
+            struct timespec ts;
+            rt_ns_to_timespec(start, &ts);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+            }
+        } else {
+            start = now;
+        }
+    }
+}
+
+// Частые короткие пробуждения по timerfd: таймерные прерывания и переключения
+static void run_irq(Worker* w) {
+    RtStress* stress = w->stress;
+    while (!atomic_load_explicit(&stress->stopping, memory_order_relaxed)) {
+        uint64_t expirations;
+        if (read(w->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+        // Немного работы в "обработчике": строка кэша и счетчик
+        w->rng = w->rng * 6364136223846793005ull + expirations;
+        sink = w->rng;
+        if (atomic_fetch_add_explicit(&w->ops, expirations, memory_order_relaxed) % 256 < expirations) {
+            update_cpu(w);
+        }
+    }
+}
+
+static int prepare(Worker* w) {
+    const RtStressWorker* c = &w->cfg;
+    if (c->kind == RT_STRESS_MEMBW || c->kind == RT_STRESS_CACHE || c->kind == RT_STRESS_IO) {
+        size_t def = c->kind == RT_STRESS_MEMBW ? MEMBW_SIZE : c->kind == RT_STRESS_CACHE ? CACHE_SIZE : IO_BLOCK;
+        w->buf_size = c->size ? c->size : def;
+        if (c->kind == RT_STRESS_MEMBW && w->buf_size < 2 * MEMBW_CHUNK) w->buf_size = 2 * MEMBW_CHUNK;
+        if (c->kind == RT_STRESS_MEMBW) w->buf_size -= w->buf_size % (2 * MEMBW_CHUNK);
+        if (c->kind == RT_STRESS_CACHE && w->buf_size < 64) w->buf_size = 64;
+        if (c->kind == RT_STRESS_IO && w->buf_size > IO_FILE_SIZE) w->buf_size = IO_FILE_SIZE;
+        if (!(w->buf = malloc(w->buf_size))) return ENOMEM;
+        // Первое касание в своем потоке: страницы на узле NUMA своего ядра
+        memset(w->buf, 1, w->buf_size);
+    }
+    if (c->kind == RT_STRESS_IO) {
+        const char* dir = getenv("TMPDIR");
+        char path[256];
+        snprintf(path, sizeof(path), "%s/rt_stress_XXXXXX", dir && *dir ? dir : "/tmp");
+        if ((w->fd = mkstemp(path)) < 0) return errno;
+        unlink(path);
+    }
+    if (c->kind == RT_STRESS_IRQ) {
+        if ((w->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) < 0) return errno;
+        struct itimerspec its;
+        rt_ns_to_timespec(RT_NSEC_PER_SEC / (c->rate ? c->rate : DEFAULT_RATE), &its.it_value);
+        its.it_interval = its.it_value;
+        if (timerfd_settime(w->fd, 0, &its, NULL) < 0) return errno;
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = arg;
+    // Политика наследуется от создателя: после rt_init это был бы SCHED_FIFO
+    struct sched_param sp = {.sched_priority = 0};
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+    if (w->cfg.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cfg.cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) w->error = EINVAL;
+    }
+    if (!w->error) w->error = prepare(w);
+    RtStress* stress = w->stress;
+    pthread_mutex_lock(&stress->lock);
+    stress->arrived++;
+    pthread_cond_broadcast(&stress->cond);
+    while (!stress->released) pthread_cond_wait(&stress->cond, &stress->lock);
+    pthread_mutex_unlock(&stress->lock);
+    if (w->error || atomic_load(&stress->stopping)) return NULL;
+
+    w->start_ns = rt_now_ns();
+    update_cpu(w);
+    if (w->cfg.kind == RT_STRESS_IRQ) {
+        run_irq(w);
+    } else {
+        run_duty(w);
+    }
+    update_cpu(w);
+    atomic_store_explicit(&w->end_ns, rt_now_ns(), memory_order_release);
+    return NULL;
+}
+
+RtStress* rt_stress_start(const RtStressProfile* profile) {
+    if (!profile || profile->count <= 0 || profile->count > RT_STRESS_MAX_WORKERS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    RtStress* stress = calloc(1, sizeof(*stress));
+    Worker* workers = calloc((size_t)profile->count, sizeof(Worker));
+    if (!stress || !workers) {
+        free(stress);
+        free(workers);
+        errno = ENOMEM;
+        return NULL;
+    }
+    stress->workers = workers;
+    stress->count = profile->count;
+    for (int i = 0; i < profile->count; i++) {
+        Worker* w = &workers[i];
+        w->cfg = profile->workers[i];
+        if (w->cfg.period_ns <= 0) w->cfg.period_ns = DEFAULT_PERIOD_NS;
+        if (w->cfg.duty < 1 || w->cfg.duty > 100) w->cfg.duty = 100;
+        if (w->cfg.kind == RT_STRESS_IRQ && w->cfg.rate == 0) w->cfg.rate = DEFAULT_RATE;
+        w->stress = stress;
+        w->fd = -1;
+        w->rng = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1); // Одинаковая последовательность в каждом прогоне
+    }
+
+    pthread_mutex_init(&stress->lock, NULL);
+    pthread_cond_init(&stress->cond, NULL);
+    int rc = 0;
+    for (; stress->threads < stress->count; stress->threads++) {
+        rc = pthread_create(&workers[stress->threads].thread, NULL, worker_main, &workers[stress->threads]);
+        if (rc != 0) break;
+    }
+    // Ждем только запущенных; при ошибке они выйдут сразу после старта
+    pthread_mutex_lock(&stress->lock);
+    while (stress->arrived < stress->threads) pthread_cond_wait(&stress->cond, &stress->lock);
+    if (rc != 0) atomic_store(&stress->stopping, 1);
+    stress->released = 1;
+    pthread_cond_broadcast(&stress->cond);
+    pthread_mutex_unlock(&stress->lock);
+    for (int i = 0; i < stress->threads && rc == 0; i++) rc = workers[i].error;
+    if (rc != 0) {
+        rt_stress_destroy(stress);
+        errno = rc;
+        return NULL;
+    }
+    return stress;
+}
+
+void rt_stress_stop(RtStress* stress) {
+    atomic_store(&stress->stopping, 1);
+    for (int i = 0; i < stress->threads; i++) pthread_join(stress->workers[i].thread, NULL);
+    stress->threads = 0;
+}
+
+void rt_stress_destroy(RtStress* stress) {
+    if (!stress) return;
+    rt_stress_stop(stress);
+    for (int i = 0; i < stress->count; i++) {
+        free(stress->workers[i].buf);
+        if (stress->workers[i].fd >= 0) close(stress->workers[i].fd);
+    }
+    pthread_cond_destroy(&stress->cond);
+    pthread_mutex_destroy(&stress->lock);
+    free(stress->workers);
+    free(stress);
+}
+
+int rt_stress_workers(const RtStress* stress) {
+    return stress->count;
+}
+
+void rt_stress_get_stats(const RtStress* stress, int worker, RtStressStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (worker < 0 || worker >= stress->count) return;
+    Worker* w = &stress->workers[worker];
+    stats->kind = w->cfg.kind;
+    stats->cpu = atomic_load_explicit(&w->cpu_now, memory_order_relaxed);
+    stats->ops = atomic_load_explicit(&w->ops, memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&w->bytes, memory_order_relaxed);
+    stats->cpu_ns = atomic_load_explicit(&w->cpu_ns, memory_order_relaxed);
+    if (w->start_ns) {
+        int64_t end = atomic_load_explicit(&w->end_ns, memory_order_acquire);
+        stats->wall_ns = (end ? end : rt_now_ns()) - w->start_ns;
+    }
+}
+
+void rt_stress_print_report(FILE* out, const RtStress* stress) {
+    fprintf(out, "load: %d workers\n", stress->count);
+    fprintf(out, "  %2s %-8s %4s %5s %9s  %-24s %8s\n", "#", "kind", "pin", "duty", "size/rate", "achieved", "cpu use");
+    for (int i = 0; i < stress->count; i++) {
+        const RtStressWorker* c = &stress->workers[i].cfg;
+        RtStressStats st;
+        rt_stress_get_stats(stress, i, &st);
+        double s = st.wall_ns > 0 ? st.wall_ns / 1e9 : 0;
+        char pin[12], param[24], achieved[40];
+        if (c->cpu >= 0) {
+            snprintf(pin, sizeof(pin), "%d", c->cpu);
+        } else {
+            snprintf(pin, sizeof(pin), "any");
+        }
+        size_t size = stress->workers[i].buf_size;
+        if (c->kind == RT_STRESS_IRQ) {
+            snprintf(param, sizeof(param), "%u/s", c->rate);
+        } else if (size && size % (1u << 20) == 0) {
+            snprintf(param, sizeof(param), "%zuM", size >> 20);
+        } else if (size) {
+            snprintf(param, sizeof(param), "%zuK", size >> 10);
+        } else {
+            snprintf(param, sizeof(param), "-");
+        }
+        double rate = s > 0 ? st.ops / s : 0;
+        double bw = s > 0 ? st.bytes / s : 0;
+        switch (c->kind) {
+            case RT_STRESS_CPU: snprintf(achieved, sizeof(achieved), "%.1f M iter/s", rate / 1e6); break;
+            case RT_STRESS_MEMBW: snprintf(achieved, sizeof(achieved), "%.2f GB/s copied", bw / 1e9); break;
+            case RT_STRESS_CACHE: snprintf(achieved, sizeof(achieved), "%.1f M lines/s", rate / 1e6); break;
+            case RT_STRESS_IO: snprintf(achieved, sizeof(achieved), "%.1f MB/s synced", bw / 1e6); break;
+            case RT_STRESS_SYSCALL: snprintf(achieved, sizeof(achieved), "%.2f M calls/s", rate / 1e6); break;
+            default: snprintf(achieved, sizeof(achieved), "%.0f wakeups/s", rate); break;
+        }
+        fprintf(out, "  %2d %-8s %4s %4d%% %9s  %-24s %7.1f%%\n", i, rt_stress_kind_name(c->kind), pin,
+                c->kind == RT_STRESS_IRQ ? 100 : c->duty, param, achieved,
+                st.wall_ns > 0 ? 100.0 * st.cpu_ns / st.wall_ns : 0.0);
+    }
+}
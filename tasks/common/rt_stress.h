@@ -0,0 +1,98 @@
+#ifndef RT_STRESS_H
+#define RT_STRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Генератор фоновой нагрузки с воспроизводимыми профилями - замена
+ * noise.sh, который без ограничений порождает find/dd/tr каждые 0.5 с.
+ *
+ * Профиль - набор рабочих потоков, каждый нагружает один ресурс:
+ *   cpu     - счет на FPU/ALU;
+ *   membw   - копирование буфера больше кэша (пропускная способность памяти);
+ *   cache   - случайная запись по буферу размером с LLC (вытеснение чужих строк);
+ *   io      - запись файла блоками с fdatasync (блочный уровень, журнал ФС);
+ *   syscall - короткие системные вызовы подряд (входы в ядро, TLB, кэш);
+ *   irq     - пробуждения по timerfd с частотой rate (таймерные прерывания
+ *             и переключения на ядре - аналог частого IRQ).
+ * Поток привязывается к ядру (cpu=N) и работает с заданной долей каждого
+ * периода (duty=%): нагрузка постоянна и одинакова от прогона к прогону,
+ * а сколько ее реально удалось создать, показывает отчет - если ядро было
+ * занято кем-то еще, это видно, а не подразумевается.
+ *
+ * Потоки генератора работают с обычной политикой (SCHED_OTHER) и не
+ * вытесняют RT-задачи, которые должны переживать эту нагрузку.
+ *
+ * Текстовая запись профиля (rt_stress_parse) - элементы через запятую:
+ *   вид[:ключ=значение]...  ключи: n (потоков), cpu, duty, size (K/M/G), rate
+ * или имя готового профиля: light, mixed (как noise.sh), heavy. Пример:
+ *   cpu:cpu=2:duty=50,membw:cpu=3:size=64M,irq:cpu=2:rate=20000
+ */
+
+#define RT_STRESS_MAX_WORKERS 64
+
+typedef enum {
+    RT_STRESS_CPU,
+    RT_STRESS_MEMBW,
+    RT_STRESS_CACHE,
+    RT_STRESS_IO,
+    RT_STRESS_SYSCALL,
+    RT_STRESS_IRQ,
+    RT_STRESS_KINDS
+} RtStressKind;
+
+typedef struct {
+    RtStressKind kind;
+    int cpu;                // Ядро, -1 - без привязки
+    int duty;               // Доля каждого периода под нагрузкой, 1..100 %
+    int64_t period_ns;      // Период скважности; 0 - 10 мс
+    size_t size;            // Буфер membw/cache, блок io; 0 - по умолчанию вида
+    uint32_t rate;          // Для irq - пробуждений в секунду; 0 - 10000
+} RtStressWorker;
+
+typedef struct {
+    RtStressWorker workers[RT_STRESS_MAX_WORKERS];
+    int count;
+} RtStressProfile;
+
+// Что поток реально сделал
+typedef struct {
+    RtStressKind kind;
+    int cpu;                // Где поток работал в конце (sched_getcpu)
+    uint64_t ops;           // Итераций счета, строк кэша, вызовов, пробуждений
+    uint64_t bytes;         // Для membw/io - переданных байт
+    int64_t wall_ns;
+    int64_t cpu_ns;         // Процессорное время потока
+} RtStressStats;
+
+typedef struct RtStress RtStress;
+
+const char* rt_stress_kind_name(RtStressKind kind);
+
+/**
+ * @brief Разбирает запись профиля в profile (см. начало файла).
+ * @return 0 или -1 с описанием в err.
+ */
+int rt_stress_parse(const char* spec, RtStressProfile* profile, char* err, size_t err_len);
+
+/**
+ * @brief Выделяет буферы, запускает потоки и ждет, пока все не начнут работу.
+ * @return Генератор или NULL (errno).
+ */
+RtStress* rt_stress_start(const RtStressProfile* profile);
+
+// Останавливает и дожидается потоков; статистика после этого окончательна
+void rt_stress_stop(RtStress* stress);
+void rt_stress_destroy(RtStress* stress);
+
+int rt_stress_workers(const RtStress* stress);
+
+// Можно и во время работы: снимок счетчиков
+void rt_stress_get_stats(const RtStress* stress, int worker, RtStressStats* stats);
+
+// По строке на поток: заказано и достигнуто
+void rt_stress_print_report(FILE* out, const RtStress* stress);
+
+#endif // RT_STRESS_H
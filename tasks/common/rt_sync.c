@@ -0,0 +1,186 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_sync.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "rt_sleep.h"
+#include "rt_time.h"
+
+#define CALIBRATE_ITERATIONS 100000
+
+static void futex_wait(_Atomic uint32_t* addr, uint32_t expected) {
+    // EAGAIN (значение уже другое) и EINTR - вызывающий перепроверит условие
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t* addr, uint32_t n) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n > INT_MAX ? INT_MAX : (int)n, NULL, NULL, 0);
+}
+
+static void count(atomic_uint_fast64_t* counter, uint64_t n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static void copy_stats(const RtSyncCounters* c, RtSyncStats* stats) {
+    stats->fast = atomic_load_explicit(&c->fast, memory_order_relaxed);
+    stats->spun = atomic_load_explicit(&c->spun, memory_order_relaxed);
+    stats->slept = atomic_load_explicit(&c->slept, memory_order_relaxed);
+    stats->wakeups = atomic_load_explicit(&c->wakeups, memory_order_relaxed);
+    stats->items = atomic_load_explicit(&c->items, memory_order_relaxed);
+}
+
+static void reset_stats(RtSyncCounters* c) {
+    atomic_init(&c->fast, 0);
+    atomic_init(&c->spun, 0);
+    atomic_init(&c->slept, 0);
+    atomic_init(&c->wakeups, 0);
+    atomic_init(&c->items, 0);
+}
+
+uint32_t rt_sync_spin_for_ns(int64_t ns) {
+    static _Atomic int64_t relax_ps;  // Пикосекунд на одну итерацию
+    if (ns <= 0 || sysconf(_SC_NPROCESSORS_ONLN) < 2) return 0;
+    int64_t ps = atomic_load_explicit(&relax_ps, memory_order_relaxed);
+    if (ps == 0) {
+        int64_t start = rt_now_ns();
+        for (int i = 0; i < CALIBRATE_ITERATIONS; i++) rt_cpu_relax();
+        ps = (rt_now_ns() - start) * 1000 / CALIBRATE_ITERATIONS;
+        if (ps < 1) ps = 1;
+        atomic_store_explicit(&relax_ps, ps, memory_order_relaxed);
+    }
+    int64_t spin = ns * 1000 / ps;
+    return spin > UINT32_MAX ? UINT32_MAX : (uint32_t)spin;
+}
+
+// --- RtSem ---
+
+void rt_sem_init(RtSem* sem, uint32_t value, uint32_t spin) {
+    atomic_init(&sem->count, value);
+    atomic_init(&sem->waiters, 0);
+    sem->spin = spin;
+    reset_stats(&sem->stats);
+}
+
+static uint32_t try_take(RtSem* sem, uint32_t max) {
+    uint32_t c = atomic_load_explicit(&sem->count, memory_order_relaxed);
+    while (c > 0) {
+        uint32_t take = c < max ? c : max;
+        if (atomic_compare_exchange_weak_explicit(&sem->count, &c, c - take, memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            return take;
+        }
+    }
+    return 0;
+}
+
+void rt_sem_post_batch(RtSem* sem, uint32_t n) {
+    if (n == 0) return;
+    atomic_fetch_add_explicit(&sem->count, n, memory_order_release);
+    // Пара к барьеру в wait: либо ждущий увидит count, либо мы - waiters
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&sem->waiters, memory_order_relaxed) > 0) {
+        futex_wake(&sem->count, n);
+        count(&sem->stats.wakeups, 1);
+    }
+}
+
+uint32_t rt_sem_wait_batch(RtSem* sem, uint32_t max) {
+    if (max == 0) max = 1;
+    uint32_t got = try_take(sem, max);
+    if (got) {
+        count(&sem->stats.fast, 1);
+        count(&sem->stats.items, got);
+        return got;
+    }
+    for (uint32_t i = 0; i < sem->spin; i++) {
+        rt_cpu_relax();
+        if (atomic_load_explicit(&sem->count, memory_order_relaxed) > 0 && (got = try_take(sem, max))) {
+            count(&sem->stats.spun, 1);
+            count(&sem->stats.items, got);
+            return got;
+        }
+    }
+    atomic_fetch_add_explicit(&sem->waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!(got = try_take(sem, max))) futex_wait(&sem->count, 0);
+    atomic_fetch_sub_explicit(&sem->waiters, 1, memory_order_relaxed);
+    count(&sem->stats.slept, 1);
+    count(&sem->stats.items, got);
+    return got;
+}
+
+int rt_sem_trywait(RtSem* sem) {
+    if (!try_take(sem, 1)) return 0;
+    count(&sem->stats.fast, 1);
+    count(&sem->stats.items, 1);
+    return 1;
+}
+
+void rt_sem_get_stats(const RtSem* sem, RtSyncStats* stats) {
+    copy_stats(&sem->stats, stats);
+}
+
+// --- RtWord ---
+
+void rt_word_init(RtWord* word, uint32_t value, uint32_t spin) {
+    atomic_init(&word->value, value);
+    atomic_init(&word->waiters, 0);
+    word->spin = spin;
+    reset_stats(&word->stats);
+}
+
+static void wake_word(RtWord* word, uint32_t n) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&word->waiters, memory_order_relaxed) > 0) {
+        futex_wake(&word->value, n);
+        count(&word->stats.wakeups, 1);
+    }
+}
+
+void rt_word_store(RtWord* word, uint32_t value) {
+    atomic_store_explicit(&word->value, value, memory_order_release);
+    wake_word(word, UINT32_MAX);
+}
+
+uint32_t rt_word_bump(RtWord* word, uint32_t wake) {
+    uint32_t v = atomic_fetch_add_explicit(&word->value, 1, memory_order_release) + 1;
+    wake_word(word, wake);
+    return v;
+}
+
+int rt_word_cas(RtWord* word, uint32_t expected, uint32_t value) {
+    if (!atomic_compare_exchange_strong_explicit(&word->value, &expected, value, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        return 0;
+    }
+    wake_word(word, UINT32_MAX);
+    return 1;
+}
+
+uint32_t rt_word_wait_while(RtWord* word, uint32_t old) {
+    uint32_t v = rt_word_load(word);
+    if (v != old) {
+        count(&word->stats.fast, 1);
+        return v;
+    }
+    for (uint32_t i = 0; i < word->spin; i++) {
+        rt_cpu_relax();
+        if ((v = rt_word_load(word)) != old) {
+            count(&word->stats.spun, 1);
+            return v;
+        }
+    }
+    atomic_fetch_add_explicit(&word->waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((v = rt_word_load(word)) == old) futex_wait(&word->value, old);
+    atomic_fetch_sub_explicit(&word->waiters, 1, memory_order_relaxed);
+    count(&word->stats.slept, 1);
+    return v;
+}
+
+void rt_word_get_stats(const RtWord* word, RtSyncStats* stats) {
+    copy_stats(&word->stats, stats);
+}
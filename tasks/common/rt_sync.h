@@ -0,0 +1,123 @@
+#ifndef RT_SYNC_H
+#define RT_SYNC_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Адаптивные примитивы передачи управления между потоками одного процесса:
+ * сначала ограниченный спин, затем сон на futex.
+ *
+ * sem_wait/pthread_cond_wait на каждой передаче засыпают в ядре, и
+ * передача стоит пробуждения и переключения контекста (5-20 мкс). Если
+ * производитель и потребитель сидят на своих ядрах и событие приходит
+ * чаще, чем за время переключения, ждущий дольше спит, чем ждет. Здесь
+ * ждущий сначала крутится spin итераций rt_cpu_relax(), и только если
+ * событие не пришло, уходит в FUTEX_WAIT. Сторона post делает FUTEX_WAKE,
+ * только когда кто-то действительно спит, - передача спинящемуся
+ * обходится без системных вызовов с обеих сторон.
+ *
+ * spin подбирается rt_sync_spin_for_ns(): на бюджет порядка стоимости
+ * переключения контекста. На одном ядре спин только отнимает время у
+ * потока, который должен подать событие, и функция возвращает 0.
+ *
+ * RtSem - счетный семафор с пакетными post/wait: одно пробуждение несет
+ * сразу много единиц. RtWord - 32-битное слово состояния с ожиданием
+ * смены значения (замена condvar для машин состояний: каждый поток ждет
+ * "своего" значения).
+ *
+ * Каждый объект считает, каким путем завершилось ожидание (RtSyncStats).
+ */
+
+typedef struct {
+    uint64_t fast;      // Событие уже было, ожидания не понадобилось
+    uint64_t spun;      // Дождались в спине
+    uint64_t slept;     // Уснули на futex
+    uint64_t wakeups;   // FUTEX_WAKE со стороны post/store
+    uint64_t items;     // Для RtSem: единиц, полученных wait
+} RtSyncStats;
+
+typedef struct {
+    atomic_uint_fast64_t fast;
+    atomic_uint_fast64_t spun;
+    atomic_uint_fast64_t slept;
+    atomic_uint_fast64_t wakeups;
+    atomic_uint_fast64_t items;
+} RtSyncCounters;
+
+typedef struct {
+    _Atomic uint32_t count;     // Слово futex
+    _Atomic uint32_t waiters;   // Спят в FUTEX_WAIT
+    uint32_t spin;
+    RtSyncCounters stats;
+} RtSem;
+
+typedef struct {
+    _Atomic uint32_t value;     // Слово futex
+    _Atomic uint32_t waiters;
+    uint32_t spin;
+    RtSyncCounters stats;
+} RtWord;
+
+// Итераций спина на ns наносекунд (калибруется при первом вызове); 0 на одном ядре
+uint32_t rt_sync_spin_for_ns(int64_t ns);
+
+void rt_sem_init(RtSem* sem, uint32_t value, uint32_t spin);
+
+// Добавить n единиц; будит до n спящих
+void rt_sem_post_batch(RtSem* sem, uint32_t n);
+
+/**
+ * @brief Ждет хотя бы одну единицу и забирает до max сразу.
+ * @return Сколько единиц получено (1..max).
+ */
+uint32_t rt_sem_wait_batch(RtSem* sem, uint32_t max);
+
+// 1 - единица получена, 0 - семафор пуст
+int rt_sem_trywait(RtSem* sem);
+
+static inline void rt_sem_post(RtSem* sem) {
+    rt_sem_post_batch(sem, 1);
+}
+
+static inline void rt_sem_wait(RtSem* sem) {
+    rt_sem_wait_batch(sem, 1);
+}
+
+void rt_sem_get_stats(const RtSem* sem, RtSyncStats* stats);
+
+void rt_word_init(RtWord* word, uint32_t value, uint32_t spin);
+
+static inline uint32_t rt_word_load(const RtWord* word) {
+    return atomic_load_explicit(&word->value, memory_order_acquire);
+}
+
+// Записать значение (release) и разбудить всех ждущих
+void rt_word_store(RtWord* word, uint32_t value);
+
+// Как rt_word_store, но только если значение равно expected; 1 - записано
+int rt_word_cas(RtWord* word, uint32_t expected, uint32_t value);
+
+/**
+ * @brief Увеличивает значение на 1 и будит до wake ждущих.
+ *
+ * Слово как счетчик событий (eventcount): ждущий читает значение,
+ * перепроверяет свое условие и ждет rt_word_wait_while(старое) - событие,
+ * поданное между проверкой и сном, не теряется.
+ *
+ * @return Новое значение.
+ */
+uint32_t rt_word_bump(RtWord* word, uint32_t wake);
+
+/**
+ * @brief Ждет, пока значение отличается от old.
+ *
+ * Запись, сделанная до rt_word_store, видна после возврата (acquire).
+ *
+ * @return Новое значение.
+ */
+uint32_t rt_word_wait_while(RtWord* word, uint32_t old);
+
+void rt_word_get_stats(const RtWord* word, RtSyncStats* stats);
+
+#endif // RT_SYNC_H
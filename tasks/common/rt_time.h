@@ -0,0 +1,35 @@
+#ifndef RT_TIME_H
+#define RT_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define RT_NSEC_PER_SEC 1000000000LL
+#define RT_NSEC_PER_MSEC 1000000LL
+#define RT_NSEC_PER_USEC 1000LL
+
+static inline int64_t rt_timespec_to_ns(const struct timespec* ts) {
+    return (int64_t)ts->tv_sec * RT_NSEC_PER_SEC + (int64_t)ts->tv_nsec;
+}
+
+static inline void rt_ns_to_timespec(int64_t ns, struct timespec* ts) {
+    ts->tv_sec = (time_t)(ns / RT_NSEC_PER_SEC);
+    ts->tv_nsec = (long)(ns % RT_NSEC_PER_SEC);
+}
+
+static inline int64_t rt_timespec_diff_ns(const struct timespec* start, const struct timespec* end) {
+    return rt_timespec_to_ns(end) - rt_timespec_to_ns(start);
+}
+
+// Текущее время указанных часов в наносекундах
+static inline int64_t rt_clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return rt_timespec_to_ns(&ts);
+}
+
+static inline int64_t rt_now_ns(void) {
+    return rt_clock_ns(CLOCK_MONOTONIC);
+}
+
+#endif // RT_TIME_H
@@ -0,0 +1,278 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_timer_wheel.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "rt_time.h"
+
+#define RT_WHEEL_BITS   8
+#define RT_WHEEL_SIZE   (1u << RT_WHEEL_BITS)
+#define RT_WHEEL_MASK   (RT_WHEEL_SIZE - 1)
+#define RT_WHEEL_LEVELS 4
+#define RT_WHEEL_WORDS  (RT_WHEEL_SIZE / 64)
+// Дальше старшего уровня таймер ставится на его край и переносится по мере хода колеса
+#define RT_WHEEL_SPAN   ((uint64_t)1 << (RT_WHEEL_BITS * RT_WHEEL_LEVELS))
+
+struct RtTimerWheel {
+    int64_t tick_ns;
+    int64_t origin_ns;
+    uint64_t now_tick;      // Следующий необработанный тик
+    int64_t slack_ns;
+    int64_t armed_ns;       // На что взведен timerfd, 0 - не взведен
+    RtTimerWheelStats stats;
+    uint64_t occupied[RT_WHEEL_LEVELS][RT_WHEEL_WORDS]; // Непустые ячейки
+    RtTimerLink slots[RT_WHEEL_LEVELS * RT_WHEEL_SIZE];
+};
+
+static void list_init(RtTimerLink* head) {
+    head->next = head->prev = head;
+}
+
+static void list_add_tail(RtTimerLink* head, RtTimerLink* link) {
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void list_unlink(RtTimerLink* link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link->prev = NULL;
+}
+
+static void slot_mark(RtTimerWheel* wheel, unsigned slot) {
+    wheel->occupied[slot / RT_WHEEL_SIZE][(slot % RT_WHEEL_SIZE) / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void slot_clear(RtTimerWheel* wheel, unsigned slot) {
+    wheel->occupied[slot / RT_WHEEL_SIZE][(slot % RT_WHEEL_SIZE) / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+// Расстояние от индекса from до ближайшей непустой ячейки уровня (по кругу), -1 - пусто
+static int level_next(const RtTimerWheel* wheel, int level, unsigned from) {
+    const uint64_t* bits = wheel->occupied[level];
+    for (unsigned step = 0; step <= RT_WHEEL_WORDS; ++step) {
+        unsigned word = ((from / 64) + step) % RT_WHEEL_WORDS;
+        uint64_t mask = bits[word];
+        if (step == 0) {
+            mask &= ~(uint64_t)0 << (from % 64);
+        } else if (step == RT_WHEEL_WORDS) {
+            mask &= ((uint64_t)1 << (from % 64)) - 1; // Начало первого слова, пропущенное на шаге 0
+        }
+        if (mask) {
+            unsigned index = word * 64 + (unsigned)__builtin_ctzll(mask);
+            return (int)((index - from) & RT_WHEEL_MASK);
+        }
+    }
+    return -1;
+}
+
+static void place(RtTimerWheel* wheel, RtTimer* timer) {
+    uint64_t expires = timer->expires_tick;
+    if (expires < wheel->now_tick) expires = wheel->now_tick;
+    uint64_t delta = expires - wheel->now_tick;
+    if (delta >= RT_WHEEL_SPAN) expires = wheel->now_tick + RT_WHEEL_SPAN - 1;
+
+    int level = 0;
+    while (level < RT_WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (RT_WHEEL_BITS * (level + 1)))) level++;
+    unsigned slot = (unsigned)level * RT_WHEEL_SIZE +
+                    (unsigned)((expires >> (RT_WHEEL_BITS * level)) & RT_WHEEL_MASK);
+    timer->slot = slot;
+    list_add_tail(&wheel->slots[slot], &timer->link);
+    slot_mark(wheel, slot);
+}
+
+// Переносит таймеры ячейки index уровня level на младшие уровни
+static void cascade(RtTimerWheel* wheel, int level, unsigned index) {
+    unsigned slot = (unsigned)level * RT_WHEEL_SIZE + index;
+    RtTimerLink* head = &wheel->slots[slot];
+    RtTimerLink pending;
+    if (head->next == head) return;
+    // Сначала отцепить всю ячейку: таймеры могут вернуться в нее же (край старшего уровня)
+    pending.next = head->next;
+    pending.prev = head->prev;
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    list_init(head);
+    slot_clear(wheel, slot);
+    while (pending.next != &pending) {
+        RtTimer* timer = (RtTimer*)pending.next;
+        list_unlink(&timer->link);
+        place(wheel, timer);
+        wheel->stats.cascaded++;
+    }
+}
+
+// Ближайший тик, на котором колесу есть что делать; UINT64_MAX - пусто
+static uint64_t next_tick(const RtTimerWheel* wheel) {
+    if (wheel->stats.pending == 0) return UINT64_MAX;
+    uint64_t best = UINT64_MAX;
+    int offset = level_next(wheel, 0, (unsigned)(wheel->now_tick & RT_WHEEL_MASK));
+    if (offset >= 0) best = wheel->now_tick + (uint64_t)offset;
+    for (int level = 1; level < RT_WHEEL_LEVELS; ++level) {
+        int shift = RT_WHEEL_BITS * level;
+        uint64_t block = wheel->now_tick >> shift;
+        // Ячейка текущего блока уже осыпана (set_now): ищем, начиная со следующего
+        offset = level_next(wheel, level, (unsigned)((block + 1) & RT_WHEEL_MASK));
+        if (offset < 0) continue;
+        uint64_t start = (block + 1 + (uint64_t)offset) << shift;
+        if (start < best) best = start;
+    }
+    return best;
+}
+
+/*
+ * Сдвигает текущее время колеса на tick. Если tick - начало блока
+ * старшего уровня, ячейка этого блока осыпается вниз сразу: next_tick()
+ * считает ячейку текущего блока уже разобранной.
+ */
+static void set_now(RtTimerWheel* wheel, uint64_t tick) {
+    wheel->now_tick = tick;
+    for (int level = 1; level < RT_WHEEL_LEVELS; ++level) {
+        int shift = RT_WHEEL_BITS * level;
+        if (tick & (((uint64_t)1 << shift) - 1)) break;
+        cascade(wheel, level, (unsigned)((tick >> shift) & RT_WHEEL_MASK));
+    }
+}
+
+static size_t process_tick(RtTimerWheel* wheel, uint64_t tick) {
+    set_now(wheel, tick);
+    unsigned slot = (unsigned)(tick & RT_WHEEL_MASK);
+    RtTimerLink* head = &wheel->slots[slot];
+    RtTimerLink expired;
+    list_init(&expired);
+    if (head->next != head) {
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        list_init(head);
+        slot_clear(wheel, slot);
+    }
+    // Время сдвигается до вызова обработчиков: таймер, поставленный
+    // обработчиком "на сейчас", сработает на следующем тике, а не в этом цикле
+    set_now(wheel, tick + 1);
+
+    size_t fired = 0;
+    while (expired.next != &expired) {
+        RtTimer* timer = (RtTimer*)expired.next;
+        list_unlink(&timer->link);
+        wheel->stats.pending--;
+        wheel->stats.fired++;
+        fired++;
+        timer->fn(timer, timer->arg);
+    }
+    return fired;
+}
+
+RtTimerWheel* rt_wheel_create(int64_t tick_ns, int64_t now_ns) {
+    if (tick_ns <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    RtTimerWheel* wheel = calloc(1, sizeof(RtTimerWheel));
+    if (!wheel) return NULL;
+    wheel->tick_ns = tick_ns;
+    wheel->origin_ns = now_ns;
+    for (unsigned i = 0; i < RT_WHEEL_LEVELS * RT_WHEEL_SIZE; ++i) list_init(&wheel->slots[i]);
+    return wheel;
+}
+
+void rt_wheel_destroy(RtTimerWheel* wheel) {
+    free(wheel);
+}
+
+void rt_wheel_set_slack(RtTimerWheel* wheel, int64_t slack_ns) {
+    wheel->slack_ns = slack_ns > 0 ? slack_ns : 0;
+}
+
+void rt_timer_init(RtTimer* timer, RtTimerFn fn, void* arg) {
+    memset(timer, 0, sizeof(*timer));
+    timer->fn = fn;
+    timer->arg = arg;
+}
+
+void rt_wheel_schedule(RtTimerWheel* wheel, RtTimer* timer, int64_t expires_ns) {
+    if (rt_timer_pending(timer)) {
+        unsigned slot = timer->slot;
+        list_unlink(&timer->link);
+        if (wheel->slots[slot].next == &wheel->slots[slot]) slot_clear(wheel, slot);
+    } else {
+        wheel->stats.pending++;
+    }
+    timer->expires_ns = expires_ns;
+    // Округление вверх: таймер не срабатывает раньше срока
+    int64_t offset = expires_ns - wheel->origin_ns;
+    timer->expires_tick = offset <= 0 ? 0 : (uint64_t)((offset + wheel->tick_ns - 1) / wheel->tick_ns);
+    place(wheel, timer);
+    wheel->stats.scheduled++;
+}
+
+void rt_wheel_cancel(RtTimerWheel* wheel, RtTimer* timer) {
+    if (!rt_timer_pending(timer)) return;
+    unsigned slot = timer->slot;
+    list_unlink(&timer->link);
+    if (wheel->slots[slot].next == &wheel->slots[slot]) slot_clear(wheel, slot);
+    wheel->stats.pending--;
+    wheel->stats.cancelled++;
+}
+
+size_t rt_wheel_advance(RtTimerWheel* wheel, int64_t now_ns) {
+    if (now_ns < wheel->origin_ns) return 0;
+    uint64_t target = (uint64_t)((now_ns - wheel->origin_ns) / wheel->tick_ns);
+    if (target < wheel->now_tick) return 0;
+    wheel->stats.advances++;
+
+    size_t fired = 0;
+    // Пустые тики пропускаются целиком: стоимость не зависит от длины простоя
+    for (;;) {
+        uint64_t tick = next_tick(wheel);
+        if (tick > target) break;
+        fired += process_tick(wheel, tick);
+    }
+    if (wheel->now_tick <= target) set_now(wheel, target + 1);
+    return fired;
+}
+
+int64_t rt_wheel_next_expiry(const RtTimerWheel* wheel) {
+    uint64_t tick = next_tick(wheel);
+    if (tick == UINT64_MAX) return -1;
+    return wheel->origin_ns + (int64_t)tick * wheel->tick_ns;
+}
+
+int rt_wheel_timerfd_create(void) {
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+int rt_wheel_timerfd_arm(RtTimerWheel* wheel, int fd) {
+    int64_t next = rt_wheel_next_expiry(wheel);
+    if (next < 0) return 0; // Пусто: взведенный таймер просто даст одно лишнее пробуждение
+    if (wheel->slack_ns > 0) next = (next + wheel->slack_ns - 1) / wheel->slack_ns * wheel->slack_ns;
+    if (next <= 0) next = 1; // 0 в it_value снимает timerfd
+    if (wheel->armed_ns != 0 && wheel->armed_ns <= next) return 0;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    rt_ns_to_timespec(next, &spec.it_value);
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) return -1;
+    wheel->armed_ns = next;
+    wheel->stats.timerfd_arms++;
+    return 0;
+}
+
+size_t rt_wheel_timerfd_fire(RtTimerWheel* wheel, int fd, int64_t now_ns) {
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations) || errno == EAGAIN) {
+        wheel->armed_ns = 0;
+    }
+    return rt_wheel_advance(wheel, now_ns);
+}
+
+void rt_wheel_get_stats(const RtTimerWheel* wheel, RtTimerWheelStats* stats) {
+    *stats = wheel->stats;
+}
@@ -0,0 +1,120 @@
+#ifndef RT_TIMER_WHEEL_H
+#define RT_TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Иерархическое колесо таймеров для цикла событий.
+ *
+ * Время делится на тики по tick_ns. Четыре уровня по 256 ячеек покрывают
+ * 256, 256^2, 256^3 и 256^4 тиков вперед; таймер попадает в ячейку того
+ * уровня, в диапазон которого укладывается его срок, а при переходе
+ * младшего уровня через ноль ячейка старшего "осыпается" вниз. Постановка
+ * и отмена - O(1) (вставка в двусвязный список ячейки), таймеры одной
+ * ячейки срабатывают пачкой в одном rt_wheel_advance().
+ *
+ * Таймер встраивается в объект пользователя (RtTimer внутри соединения),
+ * колесо ничего не выделяет на таймер. Колесо не потокобезопасно: им
+ * пользуется один поток цикла событий.
+ *
+ * Колесо ведется одним timerfd (CLOCK_MONOTONIC), взведенным на ближайший
+ * срок: rt_wheel_timerfd_arm() после обработки событий и
+ * rt_wheel_timerfd_fire(), когда timerfd сработал. Грубый режим
+ * (rt_wheel_set_slack) округляет момент пробуждения вверх до кратного
+ * slack, и таймеры из одного окна срабатывают за одно пробуждение.
+ * Таймер никогда не срабатывает раньше своего срока.
+ */
+
+typedef struct RtTimerWheel RtTimerWheel;
+typedef struct RtTimer RtTimer;
+
+typedef void (*RtTimerFn)(RtTimer* timer, void* arg);
+
+typedef struct RtTimerLink {
+    struct RtTimerLink* next;
+    struct RtTimerLink* prev;
+} RtTimerLink;
+
+struct RtTimer {
+    RtTimerLink link;       // Первым полем: ячейка хранит списки RtTimerLink
+    int64_t expires_ns;
+    uint64_t expires_tick;
+    unsigned slot;          // Ячейка колеса (уровень * 256 + индекс)
+    RtTimerFn fn;
+    void* arg;
+};
+
+typedef struct {
+    size_t pending;         // Таймеров в колесе
+    uint64_t scheduled;     // Вызовов rt_wheel_schedule
+    uint64_t cancelled;
+    uint64_t fired;
+    uint64_t cascaded;      // Перемещений таймеров между уровнями
+    uint64_t advances;      // Вызовов rt_wheel_advance, сдвинувших время
+    uint64_t timerfd_arms;  // Вызовов timerfd_settime
+} RtTimerWheelStats;
+
+/**
+ * @brief Создает колесо с разрешением tick_ns и началом отсчета now_ns.
+ * @return Колесо или NULL (errno).
+ */
+RtTimerWheel* rt_wheel_create(int64_t tick_ns, int64_t now_ns);
+void rt_wheel_destroy(RtTimerWheel* wheel);
+
+// Окно объединения пробуждений (0 - точный режим)
+void rt_wheel_set_slack(RtTimerWheel* wheel, int64_t slack_ns);
+
+void rt_timer_init(RtTimer* timer, RtTimerFn fn, void* arg);
+
+static inline int rt_timer_pending(const RtTimer* timer) {
+    return timer->link.next != NULL;
+}
+
+/**
+ * @brief Ставит таймер на абсолютный момент expires_ns (CLOCK_MONOTONIC).
+ *
+ * Если таймер уже стоит, он переносится. Срок в прошлом сработает при
+ * следующем rt_wheel_advance().
+ */
+void rt_wheel_schedule(RtTimerWheel* wheel, RtTimer* timer, int64_t expires_ns);
+
+// Снимает таймер; для неактивного таймера ничего не делает
+void rt_wheel_cancel(RtTimerWheel* wheel, RtTimer* timer);
+
+/**
+ * @brief Сдвигает время колеса до now_ns и вызывает истекшие таймеры.
+ *
+ * Обработчик может ставить и отменять любые таймеры, в том числе свой.
+ *
+ * @return Сколько таймеров сработало.
+ */
+size_t rt_wheel_advance(RtTimerWheel* wheel, int64_t now_ns);
+
+/**
+ * @brief Ближайший момент, когда rt_wheel_advance() может что-то сделать.
+ *
+ * Для таймеров младшего уровня это точный срок; для старших - начало
+ * ячейки, где колесо перенесет их ниже. -1, если колесо пусто.
+ */
+int64_t rt_wheel_next_expiry(const RtTimerWheel* wheel);
+
+// timerfd (CLOCK_MONOTONIC, неблокирующий) для rt_wheel_timerfd_arm/fire
+int rt_wheel_timerfd_create(void);
+
+/**
+ * @brief Взводит timerfd на rt_wheel_next_expiry() с учетом slack.
+ *
+ * Системный вызов делается, только если новый момент раньше уже
+ * взведенного: лишнее раннее пробуждение дешевле вызова на каждый перенос.
+ *
+ * @return 0 или -1 (errno от timerfd_settime).
+ */
+int rt_wheel_timerfd_arm(RtTimerWheel* wheel, int fd);
+
+// Вычитывает сработавший timerfd и вызывает rt_wheel_advance(now_ns)
+size_t rt_wheel_timerfd_fire(RtTimerWheel* wheel, int fd, int64_t now_ns);
+
+void rt_wheel_get_stats(const RtTimerWheel* wheel, RtTimerWheelStats* stats);
+
+#endif // RT_TIMER_WHEEL_H
@@ -0,0 +1,52 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_wait.h"
+#include <errno.h>
+
+void rt_wait_remaining(int64_t deadline_ns, struct timespec* ts) {
+    int64_t left = deadline_ns - rt_now_ns();
+    rt_ns_to_timespec(left > 0 ? left : 0, ts);
+}
+
+int rt_cond_init_monotonic(pthread_cond_t* cond, int pshared) {
+    pthread_condattr_t attr;
+    int rc = pthread_condattr_init(&attr);
+    if (rc != 0) return rc;
+    rc = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (rc == 0) rc = pthread_condattr_setpshared(&attr, pshared);
+    if (rc == 0) rc = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return rc;
+}
+
+int rt_cond_wait_until(pthread_cond_t* cond, pthread_mutex_t* mutex, int64_t deadline_ns) {
+    // Абсолютный срок в шкале часов condvar - CLOCK_MONOTONIC
+    struct timespec ts;
+    rt_ns_to_timespec(deadline_ns, &ts);
+    return pthread_cond_timedwait(cond, mutex, &ts);
+}
+
+int rt_poll_until(struct pollfd* fds, nfds_t nfds, int64_t deadline_ns, const sigset_t* sigmask) {
+    struct timespec ts;
+    rt_wait_remaining(deadline_ns, &ts);
+    return ppoll(fds, nfds, &ts, sigmask);
+}
+
+ssize_t rt_mq_receive_until(mqd_t mq, char* buf, size_t len, unsigned* prio, int64_t deadline_ns) {
+    // Срок для mq_timedreceive уже прошел: сообщение есть - оно вернется,
+    // нет - ETIMEDOUT сразу, без сна по CLOCK_REALTIME
+    static const struct timespec expired = {0, 0};
+    struct pollfd pfd = {.fd = (int)mq, .events = POLLIN};
+    for (;;) {
+        ssize_t n = mq_timedreceive(mq, buf, len, prio, &expired);
+        if (n >= 0) return n;
+        if (errno != ETIMEDOUT && errno != EAGAIN && errno != EINTR) return -1;
+        int rc = rt_poll_until(&pfd, 1, deadline_ns, NULL);
+        if (rc == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (rc < 0 && errno != EINTR) return -1;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef RT_WAIT_H
+#define RT_WAIT_H
+
+#include <mqueue.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "rt_time.h"
+
+/*
+ * Ожидание до абсолютного дедлайна по CLOCK_MONOTONIC для всех примитивов
+ * task2: условной переменной, poll/ppoll и очереди POSIX MQ.
+ *
+ * Дедлайн - int64_t в наносекундах в шкале rt_now_ns(). Он считается один
+ * раз, и повтор ожидания после ложного пробуждения или EINTR не продлевает
+ * таймаут. Шаг CLOCK_REALTIME (NTP, date -s) таймауты не растягивает и не
+ * обрезает:
+ *   - condvar создается с pthread_condattr_setclock(CLOCK_MONOTONIC);
+ *   - poll/ppoll получают остаток до дедлайна с точностью до наносекунды
+ *     (poll с таймаутом в мс округлил бы его вверх до миллисекунды);
+ *   - mq_timedreceive принимает только CLOCK_REALTIME, поэтому очередь
+ *     ждется через ppoll на ее дескрипторе (в Linux mqd_t - это fd), а
+ *     сообщение забирается mq_timedreceive с уже прошедшим сроком - без
+ *     блокировки.
+ */
+
+static inline int64_t rt_deadline_after_ns(int64_t ns) {
+    return rt_now_ns() + ns;
+}
+
+static inline int64_t rt_deadline_after_ms(int64_t ms) {
+    return rt_now_ns() + ms * RT_NSEC_PER_MSEC;
+}
+
+// Остаток до дедлайна, не меньше нуля
+void rt_wait_remaining(int64_t deadline_ns, struct timespec* ts);
+
+/**
+ * @brief Инициализирует condvar, ждущую по CLOCK_MONOTONIC.
+ * @param pshared PTHREAD_PROCESS_PRIVATE или PTHREAD_PROCESS_SHARED.
+ * @return 0 или код ошибки pthread.
+ */
+int rt_cond_init_monotonic(pthread_cond_t* cond, int pshared);
+
+/**
+ * @brief pthread_cond_timedwait до deadline_ns.
+ *
+ * cond должна быть создана rt_cond_init_monotonic. Как и timedwait, может
+ * вернуться без сигнала: предикат проверяет вызывающий, в цикле с тем же
+ * дедлайном.
+ *
+ * @return 0, ETIMEDOUT или код ошибки pthread.
+ */
+int rt_cond_wait_until(pthread_cond_t* cond, pthread_mutex_t* mutex, int64_t deadline_ns);
+
+/**
+ * @brief ppoll до deadline_ns; sigmask - маска на время ожидания или NULL.
+ *
+ * EINTR возвращается вызывающему (по нему ppoll и используют); повтор
+ * с тем же дедлайном ждет только остаток.
+ *
+ * @return Как у poll: число готовых дескрипторов, 0 - дедлайн, -1 - errno.
+ */
+int rt_poll_until(struct pollfd* fds, nfds_t nfds, int64_t deadline_ns, const sigset_t* sigmask);
+
+/**
+ * @brief Принимает сообщение из mq, ожидая не дольше deadline_ns.
+ *
+ * Ожидание идет ppoll на дескрипторе очереди, EINTR повторяется внутри.
+ * Если сообщение между пробуждением и приемом забрал другой читатель,
+ * ожидание продолжается до того же дедлайна.
+ *
+ * @return Длина сообщения или -1: errno ETIMEDOUT по дедлайну или ошибка
+ *         mq_timedreceive/ppoll.
+ */
+ssize_t rt_mq_receive_until(mqd_t mq, char* buf, size_t len, unsigned* prio, int64_t deadline_ns);
+
+#endif // RT_WAIT_H
@@ -0,0 +1,335 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rt_watchdog.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "rt_ring.h"
+#include "rt_time.h"
+
+#define RT_WD_MIN_CHECK_NS     (100 * RT_NSEC_PER_USEC)
+#define RT_WD_DEFAULT_CHECK_NS (10 * RT_NSEC_PER_MSEC)
+
+typedef struct {
+    RtHeartbeat hb;
+    RtWatchdogTarget target;
+    atomic_int active;
+    atomic_int reset;       // Начать отсчет молчания заново (регистрация, включение)
+
+    // Только поток сторожа
+    uint64_t last_word;
+    int64_t last_change_ns;
+    uint64_t streak;        // Промахов в текущей серии
+
+    // Счетчики для rt_watchdog_get_stats
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t episodes;
+    _Atomic int64_t max_gap_ns;
+    atomic_int stalled;
+} Target;
+
+struct RtWatchdog {
+    Target targets[RT_WD_MAX_TARGETS];
+    atomic_int count;
+    pthread_mutex_t add_lock;
+    RtWatchdogConfig cfg;
+    int64_t check_ns;
+    RtRing log;
+    int timer_fd;
+    int stop_fd;
+    pthread_t thread;
+    int running;
+};
+
+void rt_watchdog_config_default(RtWatchdogConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->cpu = -1;
+}
+
+RtWatchdog* rt_watchdog_create(const RtWatchdogConfig* cfg) {
+    if (cfg->check_ns < 0 || cfg->priority < 0 || cfg->priority > 99) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // Пульсы выровнены по кэш-линиям - calloc этого не гарантирует
+    RtWatchdog* wd = aligned_alloc(64, sizeof(RtWatchdog));
+    if (!wd) return NULL;
+    memset(wd, 0, sizeof(*wd));
+    wd->cfg = *cfg;
+    wd->timer_fd = wd->stop_fd = -1;
+    pthread_mutex_init(&wd->add_lock, NULL);
+    if (rt_ring_init(&wd->log, sizeof(RtWatchdogEvent), RT_WD_LOG_DEPTH) < 0) {
+        int saved = errno;
+        free(wd);
+        errno = saved;
+        return NULL;
+    }
+    return wd;
+}
+
+int rt_watchdog_add(RtWatchdog* wd, const RtWatchdogTarget* target) {
+    if (!target || target->period_ns <= 0 || target->timeout_ns < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock(&wd->add_lock);
+    int id = atomic_load_explicit(&wd->count, memory_order_relaxed);
+    if (id == RT_WD_MAX_TARGETS) {
+        pthread_mutex_unlock(&wd->add_lock);
+        errno = ENOSPC;
+        return -1;
+    }
+    Target* t = &wd->targets[id];
+    t->target = *target;
+    if (t->target.timeout_ns == 0) t->target.timeout_ns = 2 * target->period_ns;
+    atomic_store_explicit(&t->reset, 1, memory_order_relaxed);
+    atomic_store_explicit(&t->active, 1, memory_order_relaxed);
+    // Сторож видит цель только заполненной
+    atomic_store_explicit(&wd->count, id + 1, memory_order_release);
+    pthread_mutex_unlock(&wd->add_lock);
+    return id;
+}
+
+RtHeartbeat* rt_watchdog_heartbeat(RtWatchdog* wd, int id) {
+    if (id < 0 || id >= atomic_load_explicit(&wd->count, memory_order_acquire)) return NULL;
+    return &wd->targets[id].hb;
+}
+
+void rt_watchdog_set_active(RtWatchdog* wd, int id, int active) {
+    if (id < 0 || id >= atomic_load_explicit(&wd->count, memory_order_acquire)) return;
+    Target* t = &wd->targets[id];
+    if (active) atomic_store_explicit(&t->reset, 1, memory_order_release);
+    atomic_store_explicit(&t->active, active, memory_order_release);
+}
+
+static void emit(RtWatchdog* wd, Target* t, RtWatchdogEventKind kind, int64_t now, int64_t silent, uint32_t checkpoint) {
+    RtWatchdogEvent ev = {
+        .time_ns = now,
+        .silent_ns = silent,
+        .misses = t->streak,
+        .checkpoint = checkpoint,
+        .id = (int)(t - wd->targets),
+        .kind = kind,
+    };
+    rt_ring_push(&wd->log, &ev);
+    if (t->target.on_miss) t->target.on_miss(&ev, t->target.arg);
+}
+
+static void check_target(RtWatchdog* wd, Target* t, int64_t now) {
+    uint64_t word = atomic_load_explicit(&t->hb.word, memory_order_relaxed);
+    if (atomic_exchange_explicit(&t->reset, 0, memory_order_acquire)) {
+        t->last_word = word;
+        t->last_change_ns = now;
+        t->streak = 0;
+        atomic_store_explicit(&t->stalled, 0, memory_order_relaxed);
+        return;
+    }
+
+    int64_t silent = now - t->last_change_ns;
+    if (word != t->last_word) {
+        if (silent > atomic_load_explicit(&t->max_gap_ns, memory_order_relaxed)) {
+            atomic_store_explicit(&t->max_gap_ns, silent, memory_order_relaxed);
+        }
+        if (t->streak) {
+            emit(wd, t, RT_WD_RECOVER, now, silent, (uint32_t)(t->last_word >> 32));
+            t->streak = 0;
+            atomic_store_explicit(&t->stalled, 0, memory_order_relaxed);
+        }
+        t->last_word = word;
+        t->last_change_ns = now;
+        return;
+    }
+
+    // Опоздавший сторож засчитывает все истекшие таймауты сразу
+    uint64_t due = (uint64_t)(silent / t->target.timeout_ns);
+    if (due <= t->streak) return;
+    atomic_fetch_add_explicit(&t->misses, due - t->streak, memory_order_relaxed);
+    int first = t->streak == 0;
+    t->streak = due;
+    if (first) {
+        atomic_fetch_add_explicit(&t->episodes, 1, memory_order_relaxed);
+        atomic_store_explicit(&t->stalled, 1, memory_order_relaxed);
+        emit(wd, t, RT_WD_MISS, now, silent, (uint32_t)(word >> 32));
+    }
+}
+
+static void* monitor_main(void* arg) {
+    RtWatchdog* wd = arg;
+    struct pollfd fds[2] = {
+        {.fd = wd->timer_fd, .events = POLLIN},
+        {.fd = wd->stop_fd, .events = POLLIN},
+    };
+    for (;;) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents & POLLIN) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+        uint64_t expirations;
+        if (read(wd->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+
+        int64_t now = rt_now_ns();
+        int count = atomic_load_explicit(&wd->count, memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            Target* t = &wd->targets[i];
+            if (atomic_load_explicit(&t->active, memory_order_acquire)) check_target(wd, t, now);
+        }
+    }
+    return NULL;
+}
+
+static int64_t pick_check_ns(RtWatchdog* wd) {
+    if (wd->cfg.check_ns > 0) return wd->cfg.check_ns;
+    int64_t check = 0;
+    int count = atomic_load_explicit(&wd->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        int64_t quarter = wd->targets[i].target.timeout_ns / 4;
+        if (check == 0 || quarter < check) check = quarter;
+    }
+    if (check == 0) return RT_WD_DEFAULT_CHECK_NS;
+    return check < RT_WD_MIN_CHECK_NS ? RT_WD_MIN_CHECK_NS : check;
+}
+
+int rt_watchdog_start(RtWatchdog* wd) {
+    if (wd->running) {
+        errno = EBUSY;
+        return -1;
+    }
+    wd->check_ns = pick_check_ns(wd);
+    wd->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    wd->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct itimerspec its;
+    rt_ns_to_timespec(wd->check_ns, &its.it_value);
+    its.it_interval = its.it_value;
+    if (wd->timer_fd < 0 || wd->stop_fd < 0 || timerfd_settime(wd->timer_fd, 0, &its, NULL) < 0) {
+        int saved = errno;
+        rt_watchdog_stop(wd);
+        errno = saved;
+        return -1;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (wd->cfg.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(wd->cfg.cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    if (wd->cfg.priority > 0) {
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        struct sched_param sp = {.sched_priority = wd->cfg.priority};
+        pthread_attr_setschedparam(&attr, &sp);
+    }
+    int rc = pthread_create(&wd->thread, &attr, monitor_main, wd);
+    if (rc == EPERM && wd->cfg.priority > 0) {
+        fprintf(stderr, "WARNING: no permission for SCHED_FIFO, watchdog runs with default policy\n");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(&wd->thread, &attr, monitor_main, wd);
+    }
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        rt_watchdog_stop(wd);
+        errno = rc;
+        return -1;
+    }
+    wd->running = 1;
+    return 0;
+}
+
+void rt_watchdog_stop(RtWatchdog* wd) {
+    if (wd->running) {
+        uint64_t one = 1;
+        ssize_t n = write(wd->stop_fd, &one, sizeof(one));
+        (void)n; // Переполнить eventfd одной записью нельзя
+        pthread_join(wd->thread, NULL);
+        wd->running = 0;
+    }
+    if (wd->timer_fd >= 0) close(wd->timer_fd);
+    if (wd->stop_fd >= 0) close(wd->stop_fd);
+    wd->timer_fd = wd->stop_fd = -1;
+}
+
+void rt_watchdog_destroy(RtWatchdog* wd) {
+    if (!wd) return;
+    rt_watchdog_stop(wd);
+    rt_ring_destroy(&wd->log);
+    pthread_mutex_destroy(&wd->add_lock);
+    free(wd);
+}
+
+int rt_watchdog_pop_event(RtWatchdog* wd, RtWatchdogEvent* out) {
+    return rt_ring_pop(&wd->log, out);
+}
+
+int rt_watchdog_wait_event(RtWatchdog* wd, int timeout_ms) {
+    return rt_ring_wait(&wd->log, timeout_ms);
+}
+
+const char* rt_watchdog_name(const RtWatchdog* wd, int id) {
+    if (id < 0 || id >= atomic_load_explicit(&wd->count, memory_order_acquire)) return "?";
+    const char* name = wd->targets[id].target.name;
+    return name ? name : "?";
+}
+
+const char* rt_watchdog_checkpoint_name(const RtWatchdog* wd, int id, uint32_t checkpoint, char* buf,
+                                        size_t size) {
+    if (id >= 0 && id < atomic_load_explicit(&wd->count, memory_order_acquire)) {
+        const RtWatchdogTarget* t = &wd->targets[id].target;
+        if (t->checkpoint_names && checkpoint < t->checkpoint_count && t->checkpoint_names[checkpoint]) {
+            return t->checkpoint_names[checkpoint];
+        }
+    }
+    snprintf(buf, size, "%" PRIu32, checkpoint);
+    return buf;
+}
+
+void rt_watchdog_get_stats(const RtWatchdog* wd, int id, RtWatchdogStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (id < 0 || id >= atomic_load_explicit(&wd->count, memory_order_acquire)) return;
+    const Target* t = &wd->targets[id];
+    stats->misses = atomic_load_explicit(&t->misses, memory_order_relaxed);
+    stats->episodes = atomic_load_explicit(&t->episodes, memory_order_relaxed);
+    stats->max_gap_ns = atomic_load_explicit(&t->max_gap_ns, memory_order_relaxed);
+    stats->checkpoint = (uint32_t)(atomic_load_explicit(&t->hb.word, memory_order_relaxed) >> 32);
+    stats->stalled = atomic_load_explicit(&t->stalled, memory_order_relaxed);
+}
+
+void rt_watchdog_format_event(const RtWatchdog* wd, const RtWatchdogEvent* event, char* buf, size_t size) {
+    char cp[16];
+    const char* where = rt_watchdog_checkpoint_name(wd, event->id, event->checkpoint, cp, sizeof(cp));
+    if (event->kind == RT_WD_MISS) {
+        snprintf(buf, size, "[watchdog] %s: miss at %s, silent %.1f ms", rt_watchdog_name(wd, event->id), where,
+                 event->silent_ns / 1e6);
+    } else {
+        snprintf(buf, size, "[watchdog] %s: recovered after %.1f ms (%" PRIu64 " misses), was at %s",
+                 rt_watchdog_name(wd, event->id), event->silent_ns / 1e6, event->misses, where);
+    }
+}
+
+void rt_watchdog_print_stats(FILE* out, const RtWatchdog* wd) {
+    int count = atomic_load_explicit(&wd->count, memory_order_acquire);
+    fprintf(out, "watchdog: %d targets, check every %.3f ms\n", count,
+            (wd->check_ns ? wd->check_ns : wd->cfg.check_ns) / 1e6);
+    fprintf(out, "  %-16s %10s %10s %8s %8s %12s  %s\n", "target", "period ms", "timeout ms", "misses", "episodes",
+            "max gap ms", "checkpoint");
+    for (int i = 0; i < count; i++) {
+        const RtWatchdogTarget* t = &wd->targets[i].target;
+        RtWatchdogStats st;
+        rt_watchdog_get_stats(wd, i, &st);
+        char cp[16];
+        fprintf(out, "  %-16s %10.3f %10.3f %8" PRIu64 " %8" PRIu64 " %12.3f  %s%s\n", rt_watchdog_name(wd, i),
+                t->period_ns / 1e6, t->timeout_ns / 1e6, st.misses, st.episodes, st.max_gap_ns / 1e6,
+                rt_watchdog_checkpoint_name(wd, i, st.checkpoint, cp, sizeof(cp)), st.stalled ? " (stalled)" : "");
+    }
+}
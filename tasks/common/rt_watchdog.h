@@ -0,0 +1,147 @@
+#ifndef RT_WATCHDOG_H
+#define RT_WATCHDOG_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Сторожевой таймер для периодических потоков: замечает, что цикл
+ * перестал продвигаться или надолго задержался.
+ *
+ * Поток регистрирует пульс (RtHeartbeat) с ожидаемым периодом и на каждом
+ * витке вызывает rt_heartbeat(hb, checkpoint). Это одна relaxed-запись
+ * слова (отметка << 32 | номер пульса): ни часов, ни системных вызовов,
+ * ни барьеров на пути наблюдаемого потока. Время читает только сторож.
+ *
+ * Сторож - отдельный поток (обычно SCHED_FIFO выше наблюдаемых), который
+ * по timerfd каждые check_ns сравнивает слова пульсов с прошлым
+ * значением. Слово не менялось дольше timeout_ns - промах: в журнал
+ * событий пишется запись с последней отметкой потока (где он застрял), и
+ * вызывается on_miss - например, перевести выходы в безопасное состояние.
+ * Каждый следующий timeout_ns молчания - еще один промах той же серии.
+ * Первый пульс после серии - событие восстановления.
+ *
+ * Точность обнаружения - check_ns: промах замечается через timeout_ns ..
+ * timeout_ns + check_ns после последнего пульса. Задержку, не дотянувшую
+ * до таймаута, видно в max_gap_ns.
+ *
+ * Журнал - кольцо rt_ring: сторож не ждет читателя, на полном кольце
+ * событие отбрасывается (счетчики промахов при этом точны). Читатель -
+ * один поток, rt_watchdog_pop_event/rt_watchdog_wait_event.
+ */
+
+#define RT_WD_MAX_TARGETS 64
+#define RT_WD_LOG_DEPTH   256
+
+typedef struct RtWatchdog RtWatchdog;
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t word; // Читает сторож
+    uint32_t seq;                       // Пишет только владелец
+} RtHeartbeat;
+
+// Один виток цикла пройден; checkpoint - где поток сейчас (0..UINT32_MAX)
+static inline void rt_heartbeat(RtHeartbeat* hb, uint32_t checkpoint) {
+    atomic_store_explicit(&hb->word, (uint64_t)checkpoint << 32 | ++hb->seq, memory_order_relaxed);
+}
+
+typedef enum {
+    RT_WD_MISS,             // Первый промах серии
+    RT_WD_RECOVER           // Пульс после серии промахов
+} RtWatchdogEventKind;
+
+typedef struct {
+    int64_t time_ns;        // Когда заметил сторож (CLOCK_MONOTONIC)
+    int64_t silent_ns;      // Молчание: до промаха или вся пауза для RECOVER
+    uint64_t misses;        // Промахов в серии (для RECOVER - всего в ней)
+    uint32_t checkpoint;    // Последняя отметка до молчания
+    int id;
+    RtWatchdogEventKind kind;
+} RtWatchdogEvent;
+
+// Вызывается в потоке сторожа: должна быть короткой и не блокироваться
+typedef void (*RtWatchdogFn)(const RtWatchdogEvent* event, void* arg);
+
+typedef struct {
+    const char* name;
+    int64_t period_ns;      // Ожидаемый период пульса
+    int64_t timeout_ns;     // Молчание, после которого промах; 0 - два периода
+    const char* const* checkpoint_names; // Для отчетов, может быть NULL
+    uint32_t checkpoint_count;
+    RtWatchdogFn on_miss;   // Промах и восстановление; может быть NULL
+    void* arg;
+} RtWatchdogTarget;
+
+typedef struct {
+    int64_t check_ns;       // Период проверки; 0 - четверть наименьшего таймаута при старте
+    int priority;           // SCHED_FIFO сторожа; 0 - обычное планирование
+    int cpu;                // Ядро для привязки, -1 - без привязки
+} RtWatchdogConfig;
+
+typedef struct {
+    uint64_t misses;        // Всего просроченных таймаутов
+    uint64_t episodes;      // Серий промахов
+    int64_t max_gap_ns;     // Самый долгий интервал между замеченными пульсами
+    uint32_t checkpoint;    // Последняя отметка
+    int stalled;            // Сейчас идет серия промахов
+} RtWatchdogStats;
+
+// check_ns 0, priority 0, cpu -1
+void rt_watchdog_config_default(RtWatchdogConfig* cfg);
+
+RtWatchdog* rt_watchdog_create(const RtWatchdogConfig* cfg);
+
+/**
+ * @brief Регистрирует поток. Можно и после старта, из любого потока.
+ *
+ * Отсчет молчания идет от регистрации; строки name и checkpoint_names
+ * должны жить дольше сторожа.
+ *
+ * @return Номер или -1 (errno = EINVAL / ENOSPC).
+ */
+int rt_watchdog_add(RtWatchdog* wd, const RtWatchdogTarget* target);
+
+RtHeartbeat* rt_watchdog_heartbeat(RtWatchdog* wd, int id);
+
+/**
+ * @brief Включает и выключает наблюдение (поток закончил работу или
+ *        законно ждет без пульса). После включения отсчет молчания заново.
+ */
+void rt_watchdog_set_active(RtWatchdog* wd, int id, int active);
+
+/**
+ * @brief Запускает поток сторожа.
+ *
+ * Если SCHED_FIFO недоступен (нет прав), сторож работает с обычной
+ * политикой, а в stderr выводится предупреждение.
+ *
+ * @return 0 или -1 с errno.
+ */
+int rt_watchdog_start(RtWatchdog* wd);
+
+// Останавливает поток сторожа; счетчики сохраняются
+void rt_watchdog_stop(RtWatchdog* wd);
+void rt_watchdog_destroy(RtWatchdog* wd);
+
+// Один читатель. 0 - событие в out, -1 - журнал пуст
+int rt_watchdog_pop_event(RtWatchdog* wd, RtWatchdogEvent* out);
+
+// Ждет событие до timeout_ms (-1 - без предела); 1 - есть события
+int rt_watchdog_wait_event(RtWatchdog* wd, int timeout_ms);
+
+// Имя цели и отметки (номер, если имен нет); buf - для номера
+const char* rt_watchdog_name(const RtWatchdog* wd, int id);
+const char* rt_watchdog_checkpoint_name(const RtWatchdog* wd, int id, uint32_t checkpoint, char* buf,
+                                        size_t size);
+
+void rt_watchdog_get_stats(const RtWatchdog* wd, int id, RtWatchdogStats* stats);
+
+// Строка события: "[watchdog] <имя>: miss at <отметка>, silent N ms"
+void rt_watchdog_format_event(const RtWatchdog* wd, const RtWatchdogEvent* event, char* buf, size_t size);
+
+// Таблица по целям: промахи, серии, худший интервал, последняя отметка
+void rt_watchdog_print_stats(FILE* out, const RtWatchdog* wd);
+
+#endif // RT_WATCHDOG_H
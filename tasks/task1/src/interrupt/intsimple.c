@@ -1,23 +1,31 @@
 // Демонстрация обработки "прерываний" на Linux: сигналы и ввод с клавиатуры.
+//
+// Все источники - сигналы (signalfd), клавиатура (stdin) и периодический
+// таймер (timerfd) - ждут в одном epoll_wait службы rt_isr: процесс спит,
+// пока нет событий, и реагирует за одно пробуждение, а не за период опроса.
+// ISR только забирает событие и откладывает вывод в DSR (как ISR/DSR в RTOS).
 
+#define _GNU_SOURCE
 #include <errno.h>
-#include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include "rt_isr.h"
+#include "rt_time.h"
 
 static const char *progname = "intsimple";
 
-// Флаги сигналов (устанавливаются в обработчиках, читаются в основном цикле)
-static volatile sig_atomic_t got_sigint = 0;
-static volatile sig_atomic_t got_sigterm = 0;
-static volatile sig_atomic_t got_sigusr1 = 0;
-static volatile sig_atomic_t got_sigusr2 = 0;
+// Приоритеты источников и их DSR: больше - раньше
+enum { PRIO_KEYBOARD = 1, PRIO_USER_SIGNAL = 2, PRIO_TICK = 2, PRIO_TERMINATE = 3 };
+
+#define TICK_NS RT_NSEC_PER_SEC
 
 static struct termios orig_termios;
+static int exit_code = EXIT_SUCCESS;
+static unsigned long ticks;
 
 static void restore_terminal(void) {
   tcsetattr(STDIN_FILENO, TCSANOW, &orig_termios);
@@ -27,101 +35,142 @@ static int enable_raw_mode(void) {
   if (tcgetattr(STDIN_FILENO, &orig_termios) == -1) return -1;
   struct termios raw = orig_termios;
   raw.c_lflag &= ~(ICANON | ECHO);
-  raw.c_cc[VMIN] = 0;   // неблокирующее чтение
-  raw.c_cc[VTIME] = 0;  // без таймаута
+  raw.c_cc[VMIN] = 1;   // read() после epoll всегда получит байт
+  raw.c_cc[VTIME] = 0;
   if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == -1) return -1;
   atexit(restore_terminal);
   return 0;
 }
 
-static void handle_sigint(int signo) { (void)signo; got_sigint = 1; }
-static void handle_sigterm(int signo) { (void)signo; got_sigterm = 1; }
-static void handle_sigusr1(int signo) { (void)signo; got_sigusr1 = 1; }
-static void handle_sigusr2(int signo) { (void)signo; got_sigusr2 = 1; }
+// --- DSR: вывод и реакция, вне ISR ---
+
+static void dsr_signal(RtIsr *isr, void *arg, uint64_t data) {
+  (void)arg;
+  switch ((int)data) {
+    case SIGINT:
+      printf("%s: получен SIGINT (Ctrl+C) - обработка прерывания\n", progname);
+      break;
+    case SIGTERM:
+      printf("%s: получен SIGTERM - запрос на завершение работы\n", progname);
+      printf("%s: завершение работы по получению SIGTERM\n", progname);
+      rt_isr_stop(isr);
+      break;
+    case SIGUSR1:
+      printf("%s: получен SIGUSR1 - пользовательский сигнал 1\n", progname);
+      break;
+    case SIGUSR2:
+      printf("%s: получен SIGUSR2 - пользовательский сигнал 2\n", progname);
+      break;
+  }
+}
+
+static void dsr_key(RtIsr *isr, void *arg, uint64_t data) {
+  (void)arg;
+  char ch = (char)data;
+  switch (ch) {
+    case 'q': case 'Q':
+      printf("%s: выход по клавише 'q'\n", progname);
+      rt_isr_stop(isr);
+      return;
+    case 'c': case 'C':
+      printf("%s: имитация Ctrl+C по клавише 'c'\n", progname);
+      raise(SIGINT);
+      return;
+    case '1':
+      printf("%s: имитация SIGUSR1 по клавише '1'\n", progname);
+      raise(SIGUSR1);
+      return;
+    case '2':
+      printf("%s: имитация SIGUSR2 по клавише '2'\n", progname);
+      raise(SIGUSR2);
+      return;
+    case 't': case 'T':
+      printf("%s: имитация SIGTERM по клавише 't'\n", progname);
+      raise(SIGTERM);
+      return;
+    case 's': case 'S':
+      printf("%s: %lu тиков таймера\n", progname, ticks);
+      rt_isr_print_stats(stdout, isr);
+      return;
+    case '\n': case '\r':
+      return;  // игнорировать переводы строк
+    default:
+      printf("%s: клавиша '%c'\n", progname, ch);
+  }
+}
+
+// --- ISR: только забрать событие и отложить работу ---
+
+static void isr_signal(RtIsr *isr, const RtIsrEvent *ev, void *arg) {
+  int priority = (int)(intptr_t)arg;
+  rt_isr_defer(isr, priority, dsr_signal, NULL, ev->info->ssi_signo);
+}
+
+static void isr_keyboard(RtIsr *isr, const RtIsrEvent *ev, void *arg) {
+  (void)arg;
+  char buf[64];
+  ssize_t n = read(ev->fd, buf, sizeof(buf));
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+    if (n < 0) {
+      perror("read");
+      exit_code = EXIT_FAILURE;
+    }
+    rt_isr_stop(isr);  // Конец ввода
+    return;
+  }
+  for (ssize_t i = 0; i < n; i++) rt_isr_defer(isr, PRIO_KEYBOARD, dsr_key, NULL, (unsigned char)buf[i]);
+}
+
+static void isr_tick(RtIsr *isr, const RtIsrEvent *ev, void *arg) {
+  (void)isr;
+  (void)arg;
+  ticks += ev->count;
+}
 
 int main(void) {
   setvbuf(stdout, NULL, _IOLBF, 0);
   printf("%s: starting...\n", progname);
   printf("Поддерживаемые сигналы: SIGINT(Ctrl+C), SIGTERM, SIGUSR1, SIGUSR2.\n");
   printf("Замечание: SIGKILL нельзя перехватить или обработать на Linux.\n");
-  printf("Нажмите 'q' для выхода.\n");
+  printf("Нажмите 'q' для выхода, 's' - статистика службы прерываний.\n");
 
-  if (enable_raw_mode() == -1) {
+  // Не терминал (ввод из канала) - без raw mode
+  if (isatty(STDIN_FILENO) && enable_raw_mode() == -1) {
     perror("termios");
     return EXIT_FAILURE;
   }
 
-  struct sigaction sa = {0};
-  sa.sa_handler = handle_sigint; sigemptyset(&sa.sa_mask); sa.sa_flags = 0;
-  sigaction(SIGINT, &sa, NULL);
-  sa.sa_handler = handle_sigterm; sigaction(SIGTERM, &sa, NULL);
-  sa.sa_handler = handle_sigusr1; sigaction(SIGUSR1, &sa, NULL);
-  sa.sa_handler = handle_sigusr2; sigaction(SIGUSR2, &sa, NULL);
-
-  // Основной цикл: опрашиваем stdin и проверяем флаги сигналов
-  for (;;) {
-    // Проверка сигналов
-    if (got_sigint)  { 
-        got_sigint = 0;  
-        printf("%s: получен SIGINT (Ctrl+C) - обработка прерывания\n", progname); 
-    }
-    if (got_sigterm) { 
-        got_sigterm = 0; 
-        printf("%s: получен SIGTERM - запрос на завершение работы\n", progname); 
-    }
-    if (got_sigusr1) { 
-        got_sigusr1 = 0; 
-        printf("%s: получен SIGUSR1 - пользовательский сигнал 1\n", progname); 
-    }
-    if (got_sigusr2) { 
-        got_sigusr2 = 0; 
-        printf("%s: получен SIGUSR2 - пользовательский сигнал 2\n", progname); 
-    }
-
-    // Неблокирующее чтение клавиатуры
-    char ch;
-    ssize_t n = read(STDIN_FILENO, &ch, 1);
-    if (n == 1) {
-      if (ch == 'q' || ch == 'Q') {
-        printf("%s: выход по клавише 'q'\n", progname);
-        break;
-      }
-      if (ch == 'c' || ch == 'C') {
-        printf("%s: имитация Ctrl+C по клавише 'c'\n", progname);
-        raise(SIGINT);
-      }
-      if (ch == '1') {
-        printf("%s: имитация SIGUSR1 по клавише '1'\n", progname);
-        raise(SIGUSR1);
-      }
-      if (ch == '2') {
-        printf("%s: имитация SIGUSR2 по клавише '2'\n", progname);
-        raise(SIGUSR2);
-      }
-      if (ch == 't' || ch == 'T') {
-        printf("%s: имитация SIGTERM по клавише 't'\n", progname);
-        raise(SIGTERM);
-      }
-      if (ch == '\n' || ch == '\r') {
-        // игнорировать переводы строк
-      } else {
-        printf("%s: клавиша '%c'\n", progname, ch);
-      }
-    } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-      perror("read");
-      break;
-    }
-
-    // Проверка на завершение по SIGTERM
-    if (got_sigterm) {
-        printf("%s: завершение работы по получению SIGTERM\n", progname);
-        break;
+  RtIsr *isr = rt_isr_create();
+  if (!isr) {
+    perror("rt_isr_create");
+    return EXIT_FAILURE;
+  }
+  const struct { int signo; int priority; } signals[] = {
+    {SIGINT, PRIO_TERMINATE}, {SIGTERM, PRIO_TERMINATE}, {SIGUSR1, PRIO_USER_SIGNAL}, {SIGUSR2, PRIO_USER_SIGNAL},
+  };
+  for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+    if (rt_isr_add_signal(isr, signals[i].signo, signals[i].priority, isr_signal,
+                          (void *)(intptr_t)signals[i].priority) < 0) {
+      perror("rt_isr_add_signal");
+      return EXIT_FAILURE;
     }
+  }
+  // Обычный файл или /dev/null epoll не принимает - тогда только сигналы
+  if (rt_isr_add_fd(isr, STDIN_FILENO, PRIO_KEYBOARD, isr_keyboard, NULL) < 0) {
+    perror("stdin (keyboard disabled)");
+  }
+  if (rt_isr_add_timer(isr, TICK_NS, 0, PRIO_TICK, isr_tick, NULL) < 0) {
+    perror("rt_isr_add_timer");
+    return EXIT_FAILURE;
+  }
 
-    // Немного подождём, чтобы не крутить CPU
-    usleep(10 * 1000);
+  if (rt_isr_run(isr) < 0) {
+    perror("rt_isr_run");
+    exit_code = EXIT_FAILURE;
   }
 
+  rt_isr_print_stats(stdout, isr);
+  rt_isr_destroy(isr);
   printf("%s: exiting...\n", progname);
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+  return exit_code;
+}
@@ -3,11 +3,18 @@
 #include <pthread.h> // потоки POSIX
 #include <sched.h>   // приоритеты потоков
 #include <unistd.h>  // pause(), usleep()
+#include <poll.h>    // poll() в режиме -p
+#include <stdint.h>
+#include "rt_pool.h" // пул рабочих потоков (режим -p)
+#include "rt_time.h"
  
 void *sense(void* arg); 
 void *stateOutput(void* arg); 
 void *userInterface(void* arg); 
 short isRealState(char s); 
+void printState(char s); 
+void drawState(char s); 
+int runPool(int workers); 
  
 char state; 
 short changed; 
@@ -21,6 +28,11 @@ int main(int argc, char *argv[]) {
  
 printf("Hello World!\n"); 
  
+// intro -p [N]: те же роли как задачи пула из N потоков (0 - по ядру)
+if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'p') {
+return runPool(argc > 2 ? atoi(argv[2]) : 0);
+}
+ 
 // Инициализация переменных
 state = 'N';  // Ставим начальное состояние - не готово
 pthread_cond_init(&stateCond, NULL); 
@@ -113,13 +125,7 @@ pthread_cond_wait(&stateCond, &stateMutex);
 } 
  
 // Вывод нового состояния
-printf("Состояние изменилось. Теперь оно: "); 
-if (state == 'n' || state == 'N') //Not ready 
-printf("Не готово\n"); 
-else if (state == 'r' || state == 'R') //Ready 
-printf("Готово\n"); 
-else if (state == 'd' || state == 'D') //Run Mode 
-printf("Режим работы\n"); 
+printState(state); 
  
 // Сбрасываем флаг 'changed' и снова ждём изменений
 changed = FALSE; 
@@ -133,13 +139,102 @@ return NULL;
 // Поток "userInterface" выводит простую визуализацию состояния
 void *userInterface(void* arg) { 
 while (TRUE) { 
-if (state == 'n' || state == 'N') //Not ready 
+drawState(state); 
+usleep(1000 * 1000);
+} 
+return NULL; 
+} 
+ 
+void printState(char s) { 
+printf("Состояние изменилось. Теперь оно: "); 
+if (s == 'n' || s == 'N') //Not ready 
+printf("Не готово\n"); 
+else if (s == 'r' || s == 'R') //Ready 
+printf("Готово\n"); 
+else if (s == 'd' || s == 'D') //Run Mode 
+printf("Режим работы\n"); 
+} 
+ 
+void drawState(char s) { 
+if (s == 'n' || s == 'N') //Not ready 
 printf("___________________________________________________\n"); 
-else if (state == 'r' || state == 'R') //Ready 
+else if (s == 'r' || s == 'R') //Ready 
 printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n"); 
-else if (state == 'd' || state == 'D') //Run Mode 
+else if (s == 'd' || s == 'D') //Run Mode 
 printf("\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/^\\_/\n");
-usleep(1000 * 1000);
 } 
-return NULL; 
+ 
+// ---------------------------------------------------------------------------
+// Режим -p: роли - задачи пула rt_pool, а не поток на роль. Ждет только
+// главный поток (poll на stdin с таймаутом до следующей перерисовки);
+// символ ввода - задача sense (высокая полоса), смена состояния - задача
+// вывода, перерисовка раз в секунду - задача низкой полосы. Состояние
+// читается и меняется только под stateMutex, и задача вывода получает
+// снимок состояния, а не читает его позже.
+// ---------------------------------------------------------------------------
+ 
+static RtPool *pool; 
+static char poolPrevState = ' '; // под stateMutex 
+ 
+static void stateOutputTask(void* arg) { 
+printState((char)(intptr_t)arg); 
+} 
+ 
+static void senseTask(void* arg) { 
+char tempState = (char)(intptr_t)arg; 
+pthread_mutex_lock(&stateMutex); 
+if (isRealState(tempState)) {
+state = tempState;
+}
+if (poolPrevState != state && poolPrevState != (state ^ ' ')) { 
+rt_pool_submit(pool, stateOutputTask, (void*)(intptr_t)state, RT_POOL_NORMAL, RT_POOL_ANY); 
+} 
+poolPrevState = state; 
+pthread_mutex_unlock(&stateMutex); 
+} 
+ 
+static void userInterfaceTask(void* arg) { 
+(void)arg; 
+pthread_mutex_lock(&stateMutex); 
+char s = state; 
+pthread_mutex_unlock(&stateMutex); 
+drawState(s); 
+} 
+ 
+int runPool(int workers) { 
+RtPoolConfig cfg; 
+rt_pool_config_default(&cfg); 
+cfg.workers = workers; 
+pool = rt_pool_create(&cfg); 
+if (!pool) { 
+perror("rt_pool_create"); 
+return EXIT_FAILURE; 
+} 
+printf("Пул: %d рабочих потоков\n", rt_pool_workers(pool)); 
+ 
+struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN}; 
+int64_t nextDraw = rt_now_ns(); 
+while (TRUE) { 
+int64_t now = rt_now_ns(); 
+if (now >= nextDraw) { 
+rt_pool_submit(pool, userInterfaceTask, NULL, RT_POOL_LOW, RT_POOL_ANY); 
+nextDraw += RT_NSEC_PER_SEC; 
+continue; 
+} 
+int rc = poll(&pfd, 1, (int)((nextDraw - now + RT_NSEC_PER_MSEC - 1) / RT_NSEC_PER_MSEC)); 
+if (rc <= 0) continue; 
+char buf[64]; 
+ssize_t n = read(STDIN_FILENO, buf, sizeof(buf)); 
+if (n <= 0) break; // Конец ввода 
+// Символы одного чтения - к одному потоку: обычно выполнятся по порядку 
+for (ssize_t i = 0; i < n; i++) { 
+rt_pool_submit(pool, senseTask, (void*)(intptr_t)buf[i], RT_POOL_HIGH, 0); 
+} 
+} 
+ 
+rt_pool_wait_idle(pool); 
+rt_pool_print_stats(stdout, pool); 
+rt_pool_destroy(pool); 
+printf("Успешный выход из системы!\n"); 
+return EXIT_SUCCESS; 
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+/*
+ * Замер инверсии приоритетов: сколько высокоприоритетный T2 ждет мьютекс.
+ *
+ * В отличие от scenario_1/2, работа здесь - настоящий счет: потоки
+ * крутятся заданное время процессорного времени потока
+ * (CLOCK_THREAD_CPUTIME_ID), а не спят. Все потоки закреплены на одном
+ * ядре (-c), SCHED_FIFO:
+ *
+ *   SERVER (10) захватывает мьютекс и считает -H мкс;
+ *   T2     (30) пытается захватить мьютекс и блокируется;
+ *   T1     (20) не трогает мьютекс и считает -M мкс.
+ *
+ * Без протокола T1 вытесняет SERVER и ожидание T2 ~ остаток H + M. С
+ * PTHREAD_PRIO_INHERIT SERVER наследует 30, с PTHREAD_PRIO_PROTECT
+ * (потолок 30) получает его при захвате - ожидание T2 ограничено
+ * остатком критической секции. Порядок задает управляющий поток на
+ * приоритете 40: каждый шаг запускает поток, который сразу выполняется.
+ *
+ * Запуск (root): inv_bench [-n runs] [-H hold_us] [-M mid_us] [-c cpu]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rt_init.h"
+#include "rt_lock.h"
+#include "rt_stats.h"
+#include "rt_time.h"
+
+#define PRIO_SERVER 10
+#define PRIO_T1     20
+#define PRIO_T2     30
+#define PRIO_MAIN   40
+#define SETTLE_US   100     // Фора SERVER до запуска T2
+
+typedef struct {
+    RtLock lock;
+    int64_t hold_ns;
+    int64_t mid_ns;
+    atomic_int held;        // SERVER захватил мьютекс
+    int64_t wait_ns;        // Ожидание T2 в этом прогоне
+} bench_run_t;
+
+static int cpu = 0;
+
+// Счет заданного процессорного времени потока: вытеснение его не съедает
+static void spin_cpu_ns(int64_t ns)
+{
+    int64_t end = rt_clock_ns(CLOCK_THREAD_CPUTIME_ID) + ns;
+    while (rt_clock_ns(CLOCK_THREAD_CPUTIME_ID) < end) {
+    }
+}
+
+static void *server(void *arg)
+{
+    bench_run_t *run = arg;
+    rt_lock_lock(&run->lock);
+    atomic_store(&run->held, 1);
+    spin_cpu_ns(run->hold_ns);
+    rt_lock_unlock(&run->lock);
+    return NULL;
+}
+
+static void *t1(void *arg)
+{
+    bench_run_t *run = arg;
+    spin_cpu_ns(run->mid_ns);
+    return NULL;
+}
+
+static void *t2(void *arg)
+{
+    bench_run_t *run = arg;
+    int64_t start = rt_now_ns();
+    rt_lock_lock(&run->lock);
+    run->wait_ns = rt_now_ns() - start;
+    rt_lock_unlock(&run->lock);
+    return NULL;
+}
+
+static int start_thread(pthread_t *th, int prio, void *(*fn)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    struct sched_param sp;
+    cpu_set_t set;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = prio;
+    pthread_attr_setschedparam(&attr, &sp);
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    int rc = pthread_create(th, &attr, fn, arg);
+    pthread_attr_destroy(&attr);
+    return rc;
+}
+
+static void sleep_us(long us)
+{
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+// Один прогон сценария; -1 - не удалось создать поток
+static int run_once(bench_run_t *run)
+{
+    pthread_t th_server, th_t1, th_t2;
+    atomic_store(&run->held, 0);
+    run->wait_ns = -1;
+    if (start_thread(&th_server, PRIO_SERVER, server, run) != 0) return -1;
+    // Управляющий поток спит - SERVER получает ядро и захватывает мьютекс
+    while (!atomic_load(&run->held)) sleep_us(SETTLE_US);
+    if (start_thread(&th_t2, PRIO_T2, t2, run) != 0 || start_thread(&th_t1, PRIO_T1, t1, run) != 0) {
+        return -1;
+    }
+    pthread_join(th_t2, NULL);
+    pthread_join(th_t1, NULL);
+    pthread_join(th_server, NULL);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int runs = 200;
+    long hold_us = 1000, mid_us = 5000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:H:M:c:")) != -1) {
+        switch (opt) {
+            case 'n': runs = atoi(optarg); break;
+            case 'H': hold_us = atol(optarg); break;
+            case 'M': mid_us = atol(optarg); break;
+            case 'c': cpu = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n runs] [-H hold_us] [-M mid_us] [-c cpu]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (runs < 1 || hold_us <= SETTLE_US || mid_us < 0) {
+        fprintf(stderr, "runs >= 1, hold_us > %d, mid_us >= 0\n", SETTLE_US);
+        return EXIT_FAILURE;
+    }
+
+    // Управляющий поток выше всех участников и на том же ядре; участники
+    // наследуют ядро, память заблокирована и прогрета до первого прогона
+    RtInitConfig init;
+    rt_init_config_default(&init);
+    init.priority = PRIO_MAIN;
+    init.cpu = cpu;
+    RtInitReport report;
+    if (rt_init(&init, &report) != 0) rt_init_print_report(stderr, &report);
+    // Фатальны только SCHED_FIFO и привязка; память - предупреждение
+    if (report.sched.status == RT_INIT_FAILED || report.affinity.status == RT_INIT_FAILED) {
+        fprintf(stderr, "SCHED_FIFO/affinity: нужен root или CAP_SYS_NICE\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("inv_bench: %d runs, SERVER holds %ld us CPU, T1 spins %ld us, CPU %d\n", runs, hold_us, mid_us, cpu);
+    printf("%-9s %6s %10s %10s %10s %10s %10s %11s\n", "protocol", "runs", "min us", "p50 us", "p90 us", "p99 us",
+           "max us", "inversions");
+
+    const RtLockProtocol protocols[] = {RT_LOCK_PLAIN, RT_LOCK_INHERIT, RT_LOCK_PROTECT};
+    static bench_run_t run;
+    run.hold_ns = hold_us * RT_NSEC_PER_USEC;
+    run.mid_ns = mid_us * RT_NSEC_PER_USEC;
+    int failed = 0;
+    for (size_t p = 0; p < sizeof(protocols) / sizeof(protocols[0]); ++p) {
+        int rc = rt_lock_init(&run.lock, "inv_bench", protocols[p], PRIO_T2);
+        if (rc != 0) {
+            printf("%-9s %s\n", rt_lock_protocol_name(protocols[p]), strerror(rc));
+            continue;
+        }
+        RtHistogram wait;
+        rt_hist_init(&wait);
+        for (int i = 0; i < runs; ++i) {
+            if (run_once(&run) != 0) {
+                fprintf(stderr, "pthread_create: нужен root для SCHED_FIFO\n");
+                return EXIT_FAILURE;
+            }
+            if (run.wait_ns < 0) failed = 1;
+            rt_hist_record(&wait, run.wait_ns);
+            sleep_us(1000); // Пауза между прогонами: SCHED_OTHER не голодает
+        }
+        RtLockSummary s;
+        rt_lock_summary(&run.lock, &s);
+        printf("%-9s %6d %10.1f %10.1f %10.1f %10.1f %10.1f %11llu\n", rt_lock_protocol_name(protocols[p]), runs,
+               wait.min / 1e3, rt_hist_percentile(&wait, 50.0) / 1e3, rt_hist_percentile(&wait, 90.0) / 1e3,
+               rt_hist_percentile(&wait, 99.0) / 1e3, wait.max / 1e3, (unsigned long long)s.inversions);
+        rt_lock_destroy(&run.lock);
+    }
+    printf("bound: with inherit/protect T2 waits at most the remaining critical section (< %ld us)\n", hold_us);
+    return failed ? EXIT_FAILURE : 0;
+}
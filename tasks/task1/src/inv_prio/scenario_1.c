@@ -1,4 +1,5 @@
 #include "working.h"
+#include "rt_init.h"
 #include <errno.h>
 #include <pthread.h>
 #include <sched.h>
@@ -25,6 +26,17 @@ int main(int argc, char *argv[]) {
   const int prio_t1 = 20;
   const int prio_t2 = 30;
 
+  // Все потоки на одном ядре (инверсия видна только когда T1 и SERVER
+  // делят процессор), память заблокирована; приоритеты - через атрибуты
+  RtInitConfig init;
+  rt_init_config_default(&init);
+  init.policy = SCHED_OTHER;
+  init.cpu = 0;
+  RtInitReport report;
+  if (rt_init(&init, &report) != 0) {
+    rt_init_print_report(stderr, &report);
+  }
+
   // Мьютекс без наследования приоритета — демонстрация инверсии
   if (init_resource_mutex(0) != 0) {
     perror("init_resource_mutex");
@@ -68,6 +80,7 @@ int main(int argc, char *argv[]) {
   pthread_join(th_t2, &st);
   pthread_join(th_server, &st);
 
+  report_resource_lock(stdout);
   printf("scenario_1: завершено. Наблюдайте временную задержку у t2 из-за t1 (инверсия приоритетов).\n");
   return EXIT_SUCCESS;
 }
\ No newline at end of file
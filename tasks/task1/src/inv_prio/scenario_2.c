@@ -1,4 +1,5 @@
 #include "working.h"
+#include "rt_init.h"
 #include <errno.h>
 #include <pthread.h>
 #include <sched.h>
@@ -25,6 +26,17 @@ int main(int argc, char *argv[]) {
   const int prio_t1 = 20;
   const int prio_t2 = 30;
 
+  // Все потоки на одном ядре (инверсия видна только когда T1 и SERVER
+  // делят процессор), память заблокирована; приоритеты - через атрибуты
+  RtInitConfig init;
+  rt_init_config_default(&init);
+  init.policy = SCHED_OTHER;
+  init.cpu = 0;
+  RtInitReport report;
+  if (rt_init(&init, &report) != 0) {
+    rt_init_print_report(stderr, &report);
+  }
+
   // Мьютекс с наследованием приоритета - предотвращаем инверсию
   printf("scenario_2: Инициализация мьютекса с наследованием приоритета\n");
   if (init_resource_mutex(1) != 0) {  // ВКЛЮЧАЕМ наследование приоритета
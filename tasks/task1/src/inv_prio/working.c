@@ -6,25 +6,27 @@
 #include <time.h>
 #include <unistd.h>
 
-static pthread_mutex_t resource_mutex;
+static RtLock resource_mutex;
 
-int init_resource_mutex(int enable_prio_inherit)
+int init_resource_lock(RtLockProtocol protocol, int ceiling)
 {
-  pthread_mutexattr_t attr;
-  if (pthread_mutexattr_init(&attr) != 0) return -1;
-#ifdef PTHREAD_PRIO_INHERIT
-  if (enable_prio_inherit) {
-    // Попробуем включить наследование приоритета, если система поддерживает
-    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
-  }
-#else
-  (void)enable_prio_inherit;
-#endif
-  int rc = pthread_mutex_init(&resource_mutex, &attr);
-  pthread_mutexattr_destroy(&attr);
+  int rc = rt_lock_init(&resource_mutex, "resource_mutex", protocol, ceiling);
+  if (rc != 0) errno = rc;
   return rc == 0 ? 0 : -1;
 }
 
+int init_resource_mutex(int enable_prio_inherit)
+{
+  // Наследование приоритета, если система поддерживает
+  if (enable_prio_inherit && init_resource_lock(RT_LOCK_INHERIT, 0) == 0) return 0;
+  return init_resource_lock(RT_LOCK_PLAIN, 0);
+}
+
+void report_resource_lock(FILE *out)
+{
+  rt_lock_print(out, &resource_mutex);
+}
+
 static void busy_ms(int ms)
 {
   struct timespec ts;
@@ -49,10 +51,10 @@ void *server(void *arg)
 {
   (void)arg;
   printf("[SERVER] стартует и захватывает ресурс\n");
-  pthread_mutex_lock(&resource_mutex);
+  rt_lock_lock(&resource_mutex);
   // Держим ресурс достаточно долго, чтобы высокий приоритет т2 подождал
   working(0);
-  pthread_mutex_unlock(&resource_mutex);
+  rt_lock_unlock(&resource_mutex);
   printf("[SERVER] освободил ресурс\n");
   return NULL;
 }
@@ -75,10 +77,10 @@ void *t2(void *arg)
 {
   (void)arg;
   printf("[T2 high] пытается получить ресурс\n");
-  pthread_mutex_lock(&resource_mutex);
+  rt_lock_lock(&resource_mutex);
   printf("[T2 high] получил ресурс\n");
   busy_ms(20);
-  pthread_mutex_unlock(&resource_mutex);
+  rt_lock_unlock(&resource_mutex);
   printf("[T2 high] освободил ресурс и завершился\n");
   return NULL;
 }
\ No newline at end of file
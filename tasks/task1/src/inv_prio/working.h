@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "rt_lock.h"
 
 #define LOOP_COUNT 30
 #define SLEEP_TIME 1000
@@ -15,6 +16,12 @@ typedef struct _msg_priority {
 // enable_prio_inherit = 0 — обычный мьютекс; 1 — попытка включить наследование приоритета.
 int init_resource_mutex(int enable_prio_inherit);
 
+// То же с явным протоколом: RT_LOCK_PROTECT поднимает владельца до ceiling
+int init_resource_lock(RtLockProtocol protocol, int ceiling);
+
+// Замеры мьютекса ресурса: ожидание, удержание, инверсии (rt_lock)
+void report_resource_lock(FILE *out);
+
 // Имитируем работу с ресурсом (внутри критической секции)
 void working(int process_id);
 
@@ -1,26 +1,159 @@
+/*
+ * Клиент менеджера ресурсов.
+ *
+ * Все команды из командной строки (-n раз подряд) уходят одним send, не
+ * дожидаясь ответов; затем клиент закрывает запись и читает ответы до
+ * закрытия соединения сервером. -b - бинарный протокол (resmgr_proto.h).
+ * При -n > 1 ответы не печатаются, выводится время и их число.
+ */
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
+#include "resmgr_proto.h"
 
 #define EXAMPLE_SOCK_PATH "/tmp/example_resmgr.sock"
 #define BUFFER_SIZE 1024
 
+static const char *op_names[RESMGR_OP_COUNT] = {
+    [RESMGR_OP_READ] = "READ",
+    [RESMGR_OP_DATA] = "DATA",
+    [RESMGR_OP_CLEAR] = "CLEAR",
+    [RESMGR_OP_STATUS] = "STATUS",
+    [RESMGR_OP_SET_ACCESS] = "SET_ACCESS",
+    [RESMGR_OP_HELP] = "HELP",
+    [RESMGR_OP_OPEN] = "OPEN",
+};
+
+static int optb = 0;
+static long optn = 1;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Использование: %s [-b] [-n повторов] <команда> [команда...]\n", prog);
+    fprintf(stderr, "Примеры:\n");
+    fprintf(stderr, "  %s \"HELP\"\n", prog);
+    fprintf(stderr, "  %s \"READ\"\n", prog);
+    fprintf(stderr, "  %s \"DATA Привет мир!\"\n", prog);
+    fprintf(stderr, "  %s \"STATUS\"\n", prog);
+    fprintf(stderr, "  %s \"CLEAR\"\n", prog);
+    fprintf(stderr, "  %s -b \"DATA abc\" READ     # бинарный протокол\n", prog);
+    fprintf(stderr, "  %s -n 10000 READ           # 10000 запросов конвейером\n", prog);
+}
+
+// Дописывает запрос в буфер out, возвращает новую длину или 0 при ошибке
+static size_t append_request(char *out, size_t len, size_t cap, const char *cmd, uint32_t id)
+{
+    if (!optb) {
+        size_t n = strlen(cmd);
+        if (len + n + 1 > cap) return 0;
+        memcpy(out + len, cmd, n);
+        out[len + n] = '\n';
+        return len + n + 1;
+    }
+
+    const char *sp = strchr(cmd, ' ');
+    size_t name_len = sp ? (size_t)(sp - cmd) : strlen(cmd);
+    const char *arg = sp ? sp + 1 : "";
+    int op = 1;
+    while (op < RESMGR_OP_COUNT && (strlen(op_names[op]) != name_len || strncmp(op_names[op], cmd, name_len) != 0)) {
+        op++;
+    }
+    if (op == RESMGR_OP_COUNT) {
+        fprintf(stderr, "Неизвестная команда: %s\n", cmd);
+        return 0;
+    }
+    resmgr_frame_t hdr;
+    hdr.magic = RESMGR_MAGIC;
+    hdr.opcode = (uint8_t)op;
+    hdr.status = 0;
+    hdr.len = (uint32_t)strlen(arg);
+    hdr.id = id;
+    // READ <смещение>: в кадре смещение - 8 байт
+    uint64_t offset;
+    if (op == RESMGR_OP_READ && hdr.len) {
+        offset = strtoull(arg, NULL, 10);
+        arg = (const char *)&offset;
+        hdr.len = sizeof(offset);
+    }
+    if (hdr.len > RESMGR_FRAME_MAX || len + sizeof(hdr) + hdr.len > cap) return 0;
+    memcpy(out + len, &hdr, sizeof(hdr));
+    memcpy(out + len + sizeof(hdr), arg, hdr.len);
+    return len + sizeof(hdr) + hdr.len;
+}
+
+// Печатает целые кадры из buf, возвращает, сколько байт разобрано
+static size_t print_frames(const char *buf, size_t len, long *replies)
+{
+    size_t used = 0;
+    while (len - used >= sizeof(resmgr_frame_t)) {
+        resmgr_frame_t hdr;
+        memcpy(&hdr, buf + used, sizeof(hdr));
+        if (len - used < sizeof(hdr) + hdr.len) break;
+        if (optn == 1) {
+            const char *data = buf + used + sizeof(hdr);
+            int data_len = (int)hdr.len;
+            printf("Ответ #%u [%s, status=%u]: ", hdr.id,
+                   hdr.opcode < RESMGR_OP_COUNT && op_names[hdr.opcode] ? op_names[hdr.opcode] : "?",
+                   hdr.status);
+            if (hdr.opcode == RESMGR_OP_READ && hdr.status == RESMGR_OK && hdr.len >= sizeof(uint64_t)) {
+                uint64_t offset;
+                memcpy(&offset, data, sizeof(offset));
+                printf("@%llu ", (unsigned long long)offset);
+                data += sizeof(offset);
+                data_len -= (int)sizeof(offset);
+            }
+            printf("%.*s\n", data_len, data);
+        }
+        (*replies)++;
+        used += sizeof(hdr) + hdr.len;
+    }
+    return used;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
-        fprintf(stderr, "Использование: %s <команда> [аргументы]\n", argv[0]);
-        fprintf(stderr, "Примеры:\n");
-        fprintf(stderr, "  %s \"HELP\"\n", argv[0]);
-        fprintf(stderr, "  %s \"READ\"\n", argv[0]);
-        fprintf(stderr, "  %s \"DATA Привет мир!\"\n", argv[0]);
-        fprintf(stderr, "  %s \"STATUS\"\n", argv[0]);
-        fprintf(stderr, "  %s \"CLEAR\"\n", argv[0]);
+    int opt;
+    while ((opt = getopt(argc, argv, "bn:")) != -1) {
+        switch (opt) {
+            case 'b':
+                optb = 1;
+                break;
+            case 'n':
+                optn = atol(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || optn < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Запросы собираются заранее и уходят одним send
+    size_t cap = (size_t)optn * (size_t)(argc - optind) * (sizeof(resmgr_frame_t) + 64) + BUFFER_SIZE;
+    char *out = malloc(cap);
+    if (!out) {
+        perror("malloc");
         return EXIT_FAILURE;
     }
+    size_t out_len = 0;
+    uint32_t id = 0;
+    for (long r = 0; r < optn; ++r) {
+        for (int i = optind; i < argc; ++i) {
+            out_len = append_request(out, out_len, cap, argv[i], ++id);
+            if (out_len == 0) {
+                fprintf(stderr, "Слишком длинная команда: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
 
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (fd == -1) {
@@ -39,33 +172,73 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    // Получаем приветственное сообщение
-    char buf[BUFFER_SIZE];
-    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
-    if (n > 0) {
-        buf[n] = '\0';
-        printf("Сервер: %s\n", buf);
+    // Получаем приветственное сообщение (одна строка)
+    char buf[BUFFER_SIZE * 4];
+    size_t have = 0;
+    char *nl = NULL;
+    while (!nl && have < sizeof(buf) - 1) {
+        ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+        if (n <= 0) break;
+        have += (size_t)n;
+        nl = memchr(buf, '\n', have);
     }
-
-    // Отправляем команду
-    const char *cmd = argv[1];
-    if (send(fd, cmd, strlen(cmd), 0) == -1) {
-        perror("send");
+    if (!nl) {
+        fprintf(stderr, "Нет приветствия от сервера\n");
         close(fd);
         return EXIT_FAILURE;
     }
+    printf("Сервер: %.*s\n", (int)(nl - buf), buf);
+    have -= (size_t)(nl + 1 - buf);
+    memmove(buf, nl + 1, have);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Отправляем команды и закрываем запись: сервер ответит на все и закроет сокет
+    for (size_t off = 0; off < out_len;) {
+        ssize_t n = send(fd, out + off, out_len - off, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("send");
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        off += (size_t)n;
+    }
+    shutdown(fd, SHUT_WR);
 
-    // Получаем ответ на команду (блокирующее чтение)
-    n = recv(fd, buf, sizeof(buf) - 1, 0);
-    if (n > 0) {
-        buf[n] = '\0';
-        printf("Ответ: %s\n", buf);
-    } else if (n == 0) {
-        printf("Сервер закрыл соединение\n");
-    } else {
-        perror("recv");
+    // Получаем ответы до закрытия соединения
+    long replies = 0;
+    size_t total = 0;
+    for (;;) {
+        ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("recv");
+            break;
+        }
+        if (n == 0) break;
+        have += (size_t)n;
+        total += (size_t)n;
+        if (optb) {
+            size_t used = print_frames(buf, have, &replies);
+            have -= used;
+            memmove(buf, buf + used, have);
+        } else {
+            for (size_t i = 0; i < have; ++i) replies += buf[i] == '\n';
+            if (optn == 1) printf("%s%.*s", total == (size_t)n ? "Ответ: " : "", (int)have, buf);
+            have = 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (total == 0) printf("Сервер закрыл соединение\n");
+    if (optn > 1) {
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        printf("%ld запросов, %s%ld ответов за %.2f мс (%.0f в секунду)\n", (long)id,
+               optb ? "" : "строк ", replies, ms, id / (ms / 1e3));
     }
 
+    free(out);
     close(fd);
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -7,48 +7,193 @@
  *  - Команды управления (очистка буфера, получение статуса)
  *  - Симуляция прав доступа
  *  - Ведение статистики операций
+ *
+ *  Режим -w N: вместо потока на клиента - N рабочих потоков (0 - по
+ *  одному на ядро), у каждого свой epoll, как в task3/epoll_server.c.
+ *  Слушающий сокет добавлен во все epoll с EPOLLEXCLUSIVE, соединение
+ *  живет в потоке, который его принял. Состояние соединения (OCB) берется
+ *  из пула потока и занимает несколько десятков байт; буфер приема общий
+ *  на поток, а очередь вывода выделяется, только если ответ не влез в
+ *  сокет. Подключение больше не стоит создания потока.
+ *
+ *  Режим -p N: обработка на пуле rt_pool из N потоков (0 - по ядру).
+ *  Ждет только главный поток - один epoll на всех клиентов с
+ *  EPOLLONESHOT; готовность соединения становится задачей пула с
+ *  подсказкой "домашнего" потока соединения (его OCB горячий в кэше
+ *  этого ядра), а простаивающие потоки перехватывают задачи у занятых.
+ *  Досылка вывода идет в высокой полосе: она освобождает память. Из-за
+ *  EPOLLONESHOT соединение обслуживает не больше одной задачи сразу.
+ *
+ *  Доступ к устройству - seqlock: читатели (READ, STATUS) не берут
+ *  блокировок и копируют состояние, повторяя копию, если ее перебила
+ *  запись; мьютекс упорядочивает только писателей. Счетчики операций -
+ *  по слоту на поток, STATUS их суммирует. Ответ формируется в локальном
+ *  буфере и отправляется уже вне критической секции.
+ *
+ *  Устройств много: каждое - именованный канал с кольцевым буфером своей
+ *  емкости (OPEN <имя> [емкость]). Устройства лежат в хеш-таблице,
+ *  разбитой на сегменты со своим мьютексом, который нужен только при
+ *  OPEN; у каждого устройства свой seqlock, и несвязанные каналы не
+ *  пересекаются ни на одной блокировке. write_pos - смещение следующего
+ *  записываемого байта (всего записано), read_pos - старейшего хранимого.
+ *  READ отдает данные с курсора соединения и сдвигает его: читатель
+ *  забирает только новое, а не весь буфер заново.
+ *
+ *  Текстовая команда - строка до '\n', сколько бы recv ее ни несли;
+ *  последнюю строку без '\n' завершает конец потока. Ключ -l включает
+ *  совместимость с клиентами старого образца, которые шлют команду без
+ *  '\n' и ждут ответ: recv без '\n' при пустом буфере - целая команда.
  */
 
+#define _GNU_SOURCE
 #include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include "resmgr_proto.h"
+#include "rt_pool.h"
 
 #define EXAMPLE_SOCK_PATH "/tmp/example_resmgr.sock"
-#define DEVICE_BUFFER_SIZE 1024
+#define DEVICE_BUFFER_SIZE 1024     // Емкость по умолчанию и наибольший ответ READ
+#define DEVICE_CAPACITY_MIN 16
+#define DEVICE_CAPACITY_MAX (1024 * 1024)
+#define DEVICE_NAME_MAX 64
+#define DEVICE_SHARDS 64
+#define SHARD_BUCKETS 256
+#define DEFAULT_DEVICE "default"    // Устройство соединения до первого OPEN
 #define MAX_CLIENTS 10
 
+#define MAX_WORKERS  64
+#define EVENT_BATCH  64     // Событий за один epoll_wait
+#define ACCEPT_BURST 16     // Подключений за одно пробуждение: остальные достанутся другим потокам
+#define OCB_CHUNK    256    // OCB выделяются пачками и не возвращаются системе
+#define OUT_MAX      (64 * 1024) // Неотправленных байт, после которых клиент отключается
+#define OUT_BATCH    (16 * 1024) // Ответов за один send
+#define RECV_SIZE    4096
+#define IN_MAX       (sizeof(resmgr_frame_t) + RESMGR_FRAME_MAX + 64) // Самое длинное сообщение
+
+#define GREETING "Подключение к менеджеру ресурсов установлено. Используйте HELP для справки."
+
+enum { PROTO_UNKNOWN, PROTO_TEXT, PROTO_BINARY };
+
 static const char *progname = "resmgr";
 static int optv = 0;
+static int optw = -1; // -1 - поток на клиента, 0 - по потоку на ядро
+static int optp = -1; // -1 - без пула, 0 - по потоку пула на ядро
+static int optl = 0;  // Клиенты без '\n': recv без '\n' - целая команда
 static int listen_fd = -1;
+static char listen_tag; // Метка слушающего сокета в data.ptr
 
-// Структура для хранения состояния устройства
-typedef struct {
-    char buffer[DEVICE_BUFFER_SIZE];
-    size_t buffer_size;
-    size_t read_pos;
-    size_t write_pos;
+#define COUNTER_SLOTS 256 // Потоков со своим слотом счетчиков; остальные делят слот 0
+
+/*
+ * Устройство - кольцевой буфер. Память под данные выделяется вместе со
+ * структурой, а устройства не удаляются: читатель seqlock может копировать
+ * из кольца без блокировок, не опасаясь, что его освободят.
+ */
+typedef struct device {
+    atomic_uint seq;        // Нечетный - идет запись
+    pthread_mutex_t mutex;  // Только между писателями
+    uint64_t read_pos;      // Смещение старейшего хранимого байта
+    uint64_t write_pos;     // Смещение следующего записываемого байта
     int access_level; // 0 - read-only, 1 - read-write
-    unsigned long read_count;
-    unsigned long write_count;
-    pthread_mutex_t mutex;
+    size_t capacity;
+    struct device *next;    // Цепочка корзины
+    char name[DEVICE_NAME_MAX];
+    char ring[];
 } device_t;
 
-static device_t device;
+// Сегмент хеш-таблицы устройств
+typedef struct {
+    pthread_mutex_t lock;
+    device_t *buckets[SHARD_BUCKETS];
+} device_shard_t;
+
+// Согласованная копия состояния для читателя
+typedef struct {
+    uint64_t read_pos;
+    uint64_t write_pos;
+    int access_level;
+} device_view_t;
+
+// Счетчики операций потока: пишет владелец, STATUS суммирует
+typedef struct {
+    _Alignas(64) atomic_ulong read_count;
+    atomic_ulong write_count;
+    atomic_int in_use;
+} op_counters_t;
+
+static device_shard_t shards[DEVICE_SHARDS];
+static atomic_ulong device_count;
+static device_t *default_device;
+static op_counters_t counters[COUNTER_SLOTS];
+static _Thread_local op_counters_t *my_counters;
+
+typedef struct worker worker_t;
+
+// Контекст соединения (OCB)
+typedef struct ocb {
+    int fd;
+    int nonblock;       // Режим -w: неотправленное уходит в очередь, а не блокирует поток
+    int want_out;       // В epoll зарегистрирован EPOLLOUT
+    int failed;         // Ошибка записи или переполнение очереди: закрыть; -1 - закрыть после ответа
+    int eof;            // Клиент закрыл запись: досылаем очередь и закрываем
+    int proto;          // PROTO_*, определяется первым байтом
+    int registered;     // Режим -p: fd уже добавлен в epoll
+    uint32_t events;    // Режим -p: события для задачи пула
+    char *out;          // Очередь вывода, NULL - пуста
+    size_t out_off;
+    size_t out_len;
+    char *in;           // Незавершенное сообщение, NULL - нет
+    size_t in_len;
+    device_t *device;   // Выбранное OPEN устройство
+    uint64_t cursor;    // Смещение следующего READ без аргумента
+    worker_t *worker;
+    struct ocb *next_free;
+} ocb_t;
+
+struct worker {
+    pthread_t thread;
+    int epoll_fd;
+    int index;
+    pthread_mutex_t lock; // Режим -p: free_ocbs берут главный поток и задачи
+    ocb_t *free_ocbs;
+    char in[RECV_SIZE]; // Буфер приема общий на поток: соединению остается только хвост
+};
+
+// Ответы, накопленные за один разбор
+typedef struct {
+    size_t len;
+    char data[OUT_BATCH];
+} out_batch_t;
+
+static _Thread_local out_batch_t out_batch;
 
 // Прототипы функций
 static void options(int argc, char *argv[]);
 static void install_signals(void);
 static void on_signal(int signo);
 static void *client_thread(void *arg);
+static int run_workers(int n_workers);
+static int run_pool(int n_workers);
 static void device_init(void);
-static int handle_command(int client_fd, const char *cmd, size_t cmd_len);
-static void send_response(int client_fd, const char *response);
+static void counters_release(void);
+static void process_input(ocb_t *ocb, const char *data, size_t n);
+static void process_eof(ocb_t *ocb);
+static void batch_flush(ocb_t *ocb);
+static void send_response(ocb_t *ocb, const char *response);
 
 int main(int argc, char *argv[])
 {
@@ -80,7 +225,7 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    if (listen(listen_fd, MAX_CLIENTS) == -1) {
+    if (listen(listen_fd, optw >= 0 || optp >= 0 ? SOMAXCONN : MAX_CLIENTS) == -1) {
         perror("listen");
         close(listen_fd);
         unlink(EXAMPLE_SOCK_PATH);
@@ -95,6 +240,9 @@ int main(int argc, char *argv[])
     printf("  STATUS - получение статистики\n");
     printf("  HELP - справка по командам\n");
 
+    if (optp >= 0) return run_pool(optp);
+    if (optw >= 0) return run_workers(optw);
+
     while (1) {
         int client_fd = accept(listen_fd, NULL, NULL);
         if (client_fd == -1) {
@@ -118,139 +266,643 @@ int main(int argc, char *argv[])
 
     if (listen_fd != -1) close(listen_fd);
     unlink(EXAMPLE_SOCK_PATH);
-    pthread_mutex_destroy(&device.mutex);
     return EXIT_SUCCESS;
 }
 
+static uint32_t name_hash(const char *name, size_t len)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; ++i) h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+/*
+ * Ищет устройство по имени и создает его, если нет (capacity 0 -
+ * емкость по умолчанию). Емкость существующего устройства не меняется.
+ */
+static device_t *device_open(const char *name, size_t len, size_t capacity)
+{
+    uint32_t h = name_hash(name, len);
+    device_shard_t *shard = &shards[h % DEVICE_SHARDS];
+    device_t **bucket = &shard->buckets[(h / DEVICE_SHARDS) % SHARD_BUCKETS];
+
+    pthread_mutex_lock(&shard->lock);
+    device_t *d = *bucket;
+    while (d && (strlen(d->name) != len || memcmp(d->name, name, len) != 0)) d = d->next;
+    if (!d) {
+        if (capacity == 0) capacity = DEVICE_BUFFER_SIZE;
+        d = calloc(1, sizeof(device_t) + capacity);
+        if (d) {
+            pthread_mutex_init(&d->mutex, NULL);
+            d->access_level = 1; // read-write по умолчанию
+            d->capacity = capacity;
+            memcpy(d->name, name, len);
+            d->next = *bucket;
+            *bucket = d;
+            atomic_fetch_add_explicit(&device_count, 1, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return d;
+}
+
+// Копирует len байт кольца начиная со смещения off
+static void ring_copy(const device_t *d, uint64_t off, char *dst, size_t len)
+{
+    size_t pos = (size_t)(off % d->capacity);
+    size_t first = d->capacity - pos < len ? d->capacity - pos : len;
+    memcpy(dst, d->ring + pos, first);
+    memcpy(dst + first, d->ring, len - first);
+}
+
+// Запись в кольцо; старые данные вытесняются, read_pos сдвигается
+static void ring_append(device_t *d, const char *src, size_t len)
+{
+    if (len > d->capacity) {
+        src += len - d->capacity;
+        d->write_pos += len - d->capacity;
+        len = d->capacity;
+    }
+    size_t pos = (size_t)(d->write_pos % d->capacity);
+    size_t first = d->capacity - pos < len ? d->capacity - pos : len;
+    memcpy(d->ring + pos, src, first);
+    memcpy(d->ring, src + first, len - first);
+    d->write_pos += len;
+    if (d->write_pos - d->read_pos > d->capacity) d->read_pos = d->write_pos - d->capacity;
+}
+
 // Инициализация устройства
 static void device_init(void)
 {
-    memset(&device, 0, sizeof(device));
-    device.access_level = 1; // read-write по умолчанию
-    pthread_mutex_init(&device.mutex, NULL);
-    strcpy(device.buffer, "Добро пожаловать в менеджер ресурсов!");
-    device.buffer_size = strlen(device.buffer);
+    for (int i = 0; i < DEVICE_SHARDS; ++i) pthread_mutex_init(&shards[i].lock, NULL);
+    default_device = device_open(DEFAULT_DEVICE, strlen(DEFAULT_DEVICE), 0);
+    if (!default_device) {
+        perror("device_open");
+        exit(EXIT_FAILURE);
+    }
+    const char *welcome = "Добро пожаловать в менеджер ресурсов!";
+    ring_append(default_device, welcome, strlen(welcome));
 }
 
-// Обработка команд клиента
-static int handle_command(int client_fd, const char *cmd, size_t cmd_len)
+// Слот счетчиков текущего потока; занимается при первой операции
+static op_counters_t *counters_self(void)
 {
-    char command[64];
-    char argument[DEVICE_BUFFER_SIZE];
-    
-    // Парсинг команды
-    if (sscanf(cmd, "%63s %1023[^\n]", command, argument) < 1) {
-        send_response(client_fd, "ERROR: Неверный формат команды");
-        return -1;
+    if (my_counters) return my_counters;
+    for (int i = 1; i < COUNTER_SLOTS; ++i) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&counters[i].in_use, &expected, 1)) {
+            return my_counters = &counters[i];
+        }
     }
+    return my_counters = &counters[0];
+}
 
-    pthread_mutex_lock(&device.mutex);
+// Слот освобождается вместе с потоком, накопленное в нем остается в сумме
+static void counters_release(void)
+{
+    if (my_counters && my_counters != &counters[0]) atomic_store(&my_counters->in_use, 0);
+    my_counters = NULL;
+}
 
-    if (strcmp(command, "READ") == 0) {
-        // Чтение из буфера устройства
-        device.read_count++;
-        if (device.buffer_size == 0) {
-            send_response(client_fd, "BUFFER_EMPTY");
-        } else {
-            char response[DEVICE_BUFFER_SIZE + 64];
-            snprintf(response, sizeof(response), "DATA: %.*s", 
-                    (int)device.buffer_size, device.buffer);
-            send_response(client_fd, response);
+static void counters_sum(unsigned long *reads, unsigned long *writes)
+{
+    *reads = *writes = 0;
+    for (int i = 0; i < COUNTER_SLOTS; ++i) {
+        *reads += atomic_load_explicit(&counters[i].read_count, memory_order_relaxed);
+        *writes += atomic_load_explicit(&counters[i].write_count, memory_order_relaxed);
+    }
+}
+
+/*
+ * Копия состояния без блокировок. Копия, пересекшаяся с записью, может
+ * быть рваной - тогда seq изменился и чтение повторяется; длина
+ * ограничивается емкостью заранее, чтобы рваные смещения не вывели
+ * копирование за кольцо.
+ *
+ * dst != NULL: до max байт начиная с *offset (сдвигается к read_pos,
+ * если данные уже вытеснены); в *offset - фактическое начало.
+ */
+static size_t device_read(device_t *d, device_view_t *view, uint64_t *offset, char *dst, size_t max)
+{
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&d->seq, memory_order_acquire);
+        if (seq & 1) {
+            sched_yield(); // Писатель вытеснен посреди записи: на одном ядре спин бесполезен
+            continue;
+        }
+        view->read_pos = d->read_pos;
+        view->write_pos = d->write_pos;
+        view->access_level = d->access_level;
+        size_t len = 0;
+        uint64_t off = 0;
+        if (dst) {
+            off = *offset;
+            if (off < view->read_pos) off = view->read_pos;
+            if (off < view->write_pos) len = (size_t)(view->write_pos - off);
+            if (len > max) len = max;
+            if (len > d->capacity) len = d->capacity;
+            ring_copy(d, off, dst, len);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&d->seq, memory_order_relaxed) == seq) {
+            if (dst) *offset = off;
+            return len;
         }
     }
-    else if (strcmp(command, "DATA") == 0) {
-        // Запись в буфер устройства
-        if (device.access_level == 0) {
-            send_response(client_fd, "ERROR: Устройство доступно только для чтения");
-        } else {
-            size_t len = strlen(argument);
-            if (len >= DEVICE_BUFFER_SIZE) {
-                len = DEVICE_BUFFER_SIZE - 1;
+}
+
+// Запись: писатели устройства по очереди, читатели видят seq нечетным
+static void device_write_begin(device_t *d)
+{
+    pthread_mutex_lock(&d->mutex);
+    atomic_store_explicit(&d->seq, atomic_load_explicit(&d->seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void device_write_end(device_t *d)
+{
+    atomic_store_explicit(&d->seq, atomic_load_explicit(&d->seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+    pthread_mutex_unlock(&d->mutex);
+}
+
+// Ответ команды: для бинарного протокола - status и data, для текстового - prefix и data
+typedef struct {
+    uint16_t status;
+    const char *prefix;
+    size_t len;
+    char prefix_buf[32];
+    char data[DEVICE_BUFFER_SIZE + 64];
+} reply_t;
+
+typedef void (*command_fn)(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r);
+
+typedef struct {
+    const char *name;
+    command_fn fn;
+} command_t;
+
+static void reply_printf(reply_t *r, uint16_t status, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void reply_printf(reply_t *r, uint16_t status, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(r->data, sizeof(r->data), fmt, ap);
+    va_end(ap);
+    r->status = status;
+    r->len = n < 0 ? 0 : (size_t)n < sizeof(r->data) ? (size_t)n : sizeof(r->data) - 1;
+}
+
+// Десятичное число из аргумента; -1 - не число
+static long long parse_number(const char *arg, size_t len, size_t *used)
+{
+    size_t i = 0;
+    long long v = 0;
+    while (i < len && arg[i] >= '0' && arg[i] <= '9' && v < (1ll << 56)) v = v * 10 + (arg[i++] - '0');
+    if (i == 0) return -1;
+    if (used) *used = i;
+    return v;
+}
+
+/*
+ * READ - с курсора соединения, курсор сдвигается за прочитанное.
+ * READ <смещение> - с заданного смещения, курсор не трогается; в ответе
+ * фактическое начало (данные до read_pos уже вытеснены). В бинарном
+ * протоколе смещение - 8 байт uint64_t, ответ начинается с 8 байт начала.
+ */
+static void cmd_read(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    int binary = ocb->proto == PROTO_BINARY;
+    int explicit = arg_len > 0;
+    uint64_t offset = ocb->cursor;
+    if (binary && explicit) {
+        if (arg_len != sizeof(offset)) {
+            reply_printf(r, RESMGR_EINVAL, "ERROR: Смещение - 8 байт");
+            return;
+        }
+        memcpy(&offset, arg, sizeof(offset));
+    } else if (explicit) {
+        long long v = parse_number(arg, arg_len, NULL);
+        if (v < 0) {
+            reply_printf(r, RESMGR_EINVAL, "ERROR: Неверное смещение");
+            return;
+        }
+        offset = (uint64_t)v;
+    }
+
+    device_view_t view;
+    size_t head = binary ? sizeof(offset) : 0;
+    size_t max = RESMGR_FRAME_MAX - head;
+    size_t len = device_read(ocb->device, &view, &offset, r->data + head, max);
+    atomic_fetch_add_explicit(&counters_self()->read_count, 1, memory_order_relaxed);
+    if (!explicit) ocb->cursor = offset + len;
+
+    r->status = RESMGR_OK;
+    r->len = head + len;
+    if (binary) memcpy(r->data, &offset, sizeof(offset));
+    if (len == 0) {
+        r->prefix = "BUFFER_EMPTY";
+    } else if (explicit) {
+        snprintf(r->prefix_buf, sizeof(r->prefix_buf), "DATA %llu: ", (unsigned long long)offset);
+        r->prefix = r->prefix_buf;
+    } else {
+        r->prefix = "DATA: ";
+    }
+}
+
+static void cmd_data(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    device_t *d = ocb->device;
+    int written = 0;
+    device_write_begin(d);
+    if (d->access_level != 0) {
+        ring_append(d, arg, arg_len);
+        written = 1;
+    }
+    device_write_end(d);
+    if (written) {
+        atomic_fetch_add_explicit(&counters_self()->write_count, 1, memory_order_relaxed);
+        reply_printf(r, RESMGR_OK, "WRITTEN: %zu bytes", arg_len);
+    } else {
+        reply_printf(r, RESMGR_EACCES, "ERROR: Устройство доступно только для чтения");
+    }
+}
+
+static void cmd_clear(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    (void)arg;
+    (void)arg_len;
+    device_t *d = ocb->device;
+    int cleared = 0;
+    device_write_begin(d);
+    if (d->access_level != 0) {
+        // Смещения не сбрасываются: курсоры читателей остаются верными
+        d->read_pos = d->write_pos;
+        cleared = 1;
+    }
+    device_write_end(d);
+    if (cleared) {
+        reply_printf(r, RESMGR_OK, "BUFFER_CLEARED");
+    } else {
+        reply_printf(r, RESMGR_EACCES, "ERROR: Устройство доступно только для чтения");
+    }
+}
+
+static void cmd_status(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    (void)arg;
+    (void)arg_len;
+    device_view_t view;
+    unsigned long reads, writes;
+    device_read(ocb->device, &view, NULL, NULL, 0);
+    counters_sum(&reads, &writes);
+    reply_printf(r, RESMGR_OK, "STATUS: buffer_size=%llu, reads=%lu, writes=%lu, access=%s, "
+            "device=%s, capacity=%zu, read_pos=%llu, write_pos=%llu, devices=%lu",
+            (unsigned long long)(view.write_pos - view.read_pos), reads, writes,
+            view.access_level ? "read-write" : "read-only", ocb->device->name, ocb->device->capacity,
+            (unsigned long long)view.read_pos, (unsigned long long)view.write_pos,
+            atomic_load_explicit(&device_count, memory_order_relaxed));
+}
+
+static void cmd_set_access(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    int level = -1;
+    if (arg_len == 9 && memcmp(arg, "read-only", 9) == 0) level = 0;
+    else if (arg_len == 10 && memcmp(arg, "read-write", 10) == 0) level = 1;
+    if (level < 0) {
+        reply_printf(r, RESMGR_EINVAL, "ERROR: Неверный уровень доступа (read-only/read-write)");
+        return;
+    }
+    device_write_begin(ocb->device);
+    ocb->device->access_level = level;
+    device_write_end(ocb->device);
+    reply_printf(r, RESMGR_OK, "ACCESS_SET: %s", level ? "read-write" : "read-only");
+}
+
+// OPEN <имя> [емкость]: выбрать устройство, создав его при необходимости
+static void cmd_open(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    size_t name_len = 0;
+    while (name_len < arg_len && arg[name_len] != ' ') {
+        char c = arg[name_len];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == '-' || c == '.')) {
+            name_len = 0;
+            break;
+        }
+        name_len++;
+    }
+    if (name_len == 0 || name_len >= DEVICE_NAME_MAX) {
+        reply_printf(r, RESMGR_EINVAL, "ERROR: Имя устройства - до %d символов [A-Za-z0-9_.-]", DEVICE_NAME_MAX - 1);
+        return;
+    }
+    long long capacity = 0;
+    size_t pos = name_len;
+    while (pos < arg_len && arg[pos] == ' ') pos++;
+    if (pos < arg_len) {
+        size_t used = 0;
+        capacity = parse_number(arg + pos, arg_len - pos, &used);
+        if (capacity < DEVICE_CAPACITY_MIN || capacity > DEVICE_CAPACITY_MAX || pos + used != arg_len) {
+            reply_printf(r, RESMGR_EINVAL, "ERROR: Емкость - от %d до %d байт", DEVICE_CAPACITY_MIN,
+                    DEVICE_CAPACITY_MAX);
+            return;
+        }
+    }
+    device_t *d = device_open(arg, name_len, (size_t)capacity);
+    if (!d) {
+        reply_printf(r, RESMGR_EINVAL, "ERROR: Нет памяти под устройство");
+        return;
+    }
+    ocb->device = d;
+    ocb->cursor = 0;
+    reply_printf(r, RESMGR_OK, "OPENED: %s capacity=%zu", d->name, d->capacity);
+}
+
+static void cmd_help(ocb_t *ocb, const char *arg, size_t arg_len, reply_t *r)
+{
+    (void)ocb;
+    (void)arg;
+    (void)arg_len;
+    reply_printf(r, RESMGR_OK, "%s",
+        "Доступные команды:\n"
+        "OPEN <name> [capacity] - выбор устройства (создается при первом OPEN)\n"
+        "READ [offset] - чтение новых данных (или с заданного смещения)\n"
+        "DATA <text> - запись данных\n" 
+        "CLEAR - очистка буфера\n"
+        "STATUS - статистика устройства\n"
+        "SET_ACCESS <read-only|read-write> - установка уровня доступа\n"
+        "HELP - эта справка");
+}
+
+// Индекс - код операции бинарного протокола; текстовый ищет по имени
+static const command_t commands[RESMGR_OP_COUNT] = {
+    [RESMGR_OP_READ]       = {"READ", cmd_read},
+    [RESMGR_OP_DATA]       = {"DATA", cmd_data},
+    [RESMGR_OP_CLEAR]      = {"CLEAR", cmd_clear},
+    [RESMGR_OP_STATUS]     = {"STATUS", cmd_status},
+    [RESMGR_OP_SET_ACCESS] = {"SET_ACCESS", cmd_set_access},
+    [RESMGR_OP_HELP]       = {"HELP", cmd_help},
+    [RESMGR_OP_OPEN]       = {"OPEN", cmd_open},
+};
+
+// Добавляет данные в очередь вывода; слишком медленный клиент отключается
+static void ocb_queue(ocb_t *ocb, const char *data, size_t len)
+{
+    size_t pending = ocb->out_len - ocb->out_off;
+    if (pending + len > OUT_MAX) {
+        ocb->failed = 1;
+        return;
+    }
+    char *out = malloc(pending + len);
+    if (!out) {
+        ocb->failed = 1;
+        return;
+    }
+    if (pending) memcpy(out, ocb->out + ocb->out_off, pending);
+    memcpy(out + pending, data, len);
+    free(ocb->out);
+    ocb->out = out;
+    ocb->out_off = 0;
+    ocb->out_len = pending + len;
+}
+
+// Запись в сокет: в режиме -w не влезшее уходит в очередь
+static void ocb_write(ocb_t *ocb, const char *data, size_t len)
+{
+    if (ocb->failed > 0 || len == 0) return;
+    if (!ocb->nonblock) {
+        while (len > 0) {
+            ssize_t n = send(ocb->fd, data, len, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("send response");
+                ocb->failed = 1;
+                return;
             }
-            memcpy(device.buffer, argument, len);
-            device.buffer[len] = '\0';
-            device.buffer_size = len;
-            device.write_count++;
-            
-            char response[64];
-            snprintf(response, sizeof(response), "WRITTEN: %zu bytes", len);
-            send_response(client_fd, response);
-        }
-    }
-    else if (strcmp(command, "CLEAR") == 0) {
-        // Очистка буфера
-        if (device.access_level == 0) {
-            send_response(client_fd, "ERROR: Устройство доступно только для чтения");
-        } else {
-            device.buffer[0] = '\0';
-            device.buffer_size = 0;
-            device.read_pos = 0;
-            device.write_pos = 0;
-            send_response(client_fd, "BUFFER_CLEARED");
-        }
-    }
-    else if (strcmp(command, "STATUS") == 0) {
-        // Получение статистики
-        char status[256];
-        snprintf(status, sizeof(status),
-                "STATUS: buffer_size=%zu, reads=%lu, writes=%lu, access=%s",
-                device.buffer_size, device.read_count, device.write_count,
-                device.access_level ? "read-write" : "read-only");
-        send_response(client_fd, status);
-    }
-    else if (strcmp(command, "SET_ACCESS") == 0) {
-        // Установка уровня доступа
-        if (strcmp(argument, "read-only") == 0) {
-            device.access_level = 0;
-            send_response(client_fd, "ACCESS_SET: read-only");
-        } else if (strcmp(argument, "read-write") == 0) {
-            device.access_level = 1;
-            send_response(client_fd, "ACCESS_SET: read-write");
+            data += n;
+            len -= (size_t)n;
+        }
+        return;
+    }
+    size_t sent = 0;
+    if (ocb->out == NULL) {
+        // Очередь пуста: сразу в сокет, в очередь - только то, что не влезло
+        ssize_t n = send(ocb->fd, data, len, MSG_NOSIGNAL);
+        if (n == (ssize_t)len) return;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ocb->failed = 1;
+            return;
+        }
+        if (n > 0) sent = (size_t)n;
+    }
+    ocb_queue(ocb, data + sent, len - sent);
+}
+
+// Ответы, накопленные за разбор одного recv, уходят одним send
+static void batch_flush(ocb_t *ocb)
+{
+    ocb_write(ocb, out_batch.data, out_batch.len);
+    out_batch.len = 0;
+}
+
+static void batch_append(ocb_t *ocb, const void *data, size_t len)
+{
+    if (out_batch.len + len > sizeof(out_batch.data)) batch_flush(ocb);
+    memcpy(out_batch.data + out_batch.len, data, len);
+    out_batch.len += len;
+}
+
+// Отправка текстового ответа клиенту (строка с '\n')
+static void send_response(ocb_t *ocb, const char *response)
+{
+    batch_append(ocb, response, strlen(response));
+    batch_append(ocb, "\n", 1);
+}
+
+static void reply_text(ocb_t *ocb, const reply_t *r)
+{
+    if (r->prefix) batch_append(ocb, r->prefix, strlen(r->prefix));
+    batch_append(ocb, r->data, r->len);
+    batch_append(ocb, "\n", 1);
+}
+
+static void reply_binary(ocb_t *ocb, const resmgr_frame_t *req, const reply_t *r)
+{
+    resmgr_frame_t hdr;
+    hdr.magic = RESMGR_MAGIC;
+    hdr.opcode = req->opcode;
+    hdr.status = r->status;
+    hdr.len = (uint32_t)r->len;
+    hdr.id = req->id;
+    batch_append(ocb, &hdr, sizeof(hdr));
+    batch_append(ocb, r->data, r->len);
+}
+
+// Строка текстового протокола без '\n': "CMD аргумент"
+static void text_command(ocb_t *ocb, const char *line, size_t len)
+{
+    static _Thread_local reply_t r;
+    if (len && line[len - 1] == '\r') len--;
+    if (optv) printf("%s: получена команда: %.*s\n", progname, (int)len, line);
+
+    size_t pos = 0;
+    while (pos < len && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+    size_t name = pos;
+    while (pos < len && line[pos] != ' ' && line[pos] != '\t') pos++;
+    size_t name_len = pos - name;
+    while (pos < len && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+    if (name_len == 0) {
+        send_response(ocb, "ERROR: Неверный формат команды");
+        return;
+    }
+
+    for (int op = 1; op < RESMGR_OP_COUNT; ++op) {
+        const command_t *c = &commands[op];
+        if (strlen(c->name) == name_len && memcmp(c->name, line + name, name_len) == 0) {
+            r.prefix = NULL;
+            c->fn(ocb, line + pos, len - pos, &r);
+            reply_text(ocb, &r);
+            return;
+        }
+    }
+    send_response(ocb, "ERROR: Неизвестная команда. Используйте HELP для справки.");
+}
+
+static size_t parse_text(ocb_t *ocb, const char *buf, size_t len)
+{
+    size_t used = 0;
+    while (used < len && !ocb->failed) {
+        const char *nl = memchr(buf + used, '\n', len - used);
+        if (!nl) break; // Строка без '\n' ждет продолжения или конца потока
+        if (nl > buf + used) text_command(ocb, buf + used, (size_t)(nl - (buf + used)));
+        used = (size_t)(nl - buf) + 1;
+    }
+    return used;
+}
+
+static size_t parse_binary(ocb_t *ocb, const char *buf, size_t len)
+{
+    static _Thread_local reply_t r;
+    size_t used = 0;
+    while (len - used >= sizeof(resmgr_frame_t) && !ocb->failed) {
+        resmgr_frame_t req;
+        memcpy(&req, buf + used, sizeof(req));
+        if (req.magic != RESMGR_MAGIC || req.len > RESMGR_FRAME_MAX) {
+            reply_printf(&r, RESMGR_E2BIG, "ERROR: Неверный кадр");
+            reply_binary(ocb, &req, &r);
+            ocb->failed = -1; // Границы кадров потеряны: закрыть, отправив ответ
+            break;
+        }
+        if (len - used < sizeof(req) + req.len) break;
+        const char *arg = buf + used + sizeof(req);
+        if (optv) printf("%s: получен кадр: op=%u len=%u id=%u\n", progname, req.opcode, req.len, req.id);
+        if (req.opcode > 0 && req.opcode < RESMGR_OP_COUNT) {
+            r.prefix = NULL;
+            commands[req.opcode].fn(ocb, arg, req.len, &r);
         } else {
-            send_response(client_fd, "ERROR: Неверный уровень доступа (read-only/read-write)");
+            reply_printf(&r, RESMGR_ENOSYS, "ERROR: Неизвестная команда");
         }
+        reply_binary(ocb, &req, &r);
+        used += sizeof(req) + req.len;
     }
-    else if (strcmp(command, "HELP") == 0) {
-        // Справка по командам
-        send_response(client_fd, 
-            "Доступные команды:\n"
-            "READ - чтение данных\n"
-            "DATA <text> - запись данных\n" 
-            "CLEAR - очистка буфера\n"
-            "STATUS - статистика устройства\n"
-            "SET_ACCESS <read-only|read-write> - установка уровня доступа\n"
-            "HELP - эта справка");
+    return used;
+}
+
+// Разбирает целые сообщения, возвращает, сколько байт съедено
+static size_t parse_messages(ocb_t *ocb, const char *buf, size_t len)
+{
+    if (ocb->proto == PROTO_UNKNOWN) {
+        ocb->proto = (unsigned char)buf[0] == RESMGR_MAGIC ? PROTO_BINARY : PROTO_TEXT;
     }
-    else {
-        send_response(client_fd, "ERROR: Неизвестная команда. Используйте HELP для справки.");
+    if (ocb->proto == PROTO_BINARY) return parse_binary(ocb, buf, len);
+    return parse_text(ocb, buf, len);
+}
+
+/*
+ * Прием потока: сообщения собираются по '\n' или по длине кадра, сколько
+ * бы их ни пришло за один recv; незавершенный хвост ждет в ocb->in,
+ * который выделяется только на это время.
+ */
+static void process_input(ocb_t *ocb, const char *data, size_t n)
+{
+    // -l: клиент старого образца не завершает команду и ждет ответ
+    if (optl && ocb->in_len == 0 && ocb->proto != PROTO_BINARY && (unsigned char)data[0] != RESMGR_MAGIC &&
+        memchr(data, '\n', n) == NULL) {
+        ocb->proto = PROTO_TEXT;
+        text_command(ocb, data, n);
+        batch_flush(ocb);
+        return;
     }
+    while (n > 0 && ocb->failed == 0) {
+        const char *buf = data;
+        size_t len = n, take = n;
+        if (ocb->in_len) {
+            take = n < IN_MAX - ocb->in_len ? n : IN_MAX - ocb->in_len;
+            memcpy(ocb->in + ocb->in_len, data, take);
+            ocb->in_len += take;
+            buf = ocb->in;
+            len = ocb->in_len;
+        }
+        data += take;
+        n -= take;
 
-    pthread_mutex_unlock(&device.mutex);
-    return 0;
+        size_t used = parse_messages(ocb, buf, len);
+        size_t rest = len - used;
+        if (rest == 0 || ocb->failed) {
+            ocb->in_len = 0;
+        } else if (rest >= IN_MAX) {
+            send_response(ocb, "ERROR: Слишком длинная команда");
+            ocb->failed = -1;
+        } else {
+            if (!ocb->in && !(ocb->in = malloc(IN_MAX))) {
+                ocb->failed = 1;
+                break;
+            }
+            memmove(ocb->in, buf + used, rest);
+            ocb->in_len = rest;
+        }
+    }
+    if (ocb->in_len == 0) {
+        free(ocb->in);
+        ocb->in = NULL;
+    }
+    batch_flush(ocb);
 }
 
-// Отправка ответа клиенту
-static void send_response(int client_fd, const char *response)
+// Конец потока завершает последнюю строку: в ocb->in остался только хвост без '\n'
+static void process_eof(ocb_t *ocb)
 {
-    size_t len = strlen(response);
-    if (send(client_fd, response, len, 0) != (ssize_t)len) {
-        perror("send response");
+    if (ocb->in_len && ocb->proto == PROTO_TEXT && ocb->failed == 0) {
+        text_command(ocb, ocb->in, ocb->in_len);
     }
+    ocb->in_len = 0;
+    free(ocb->in);
+    ocb->in = NULL;
+    batch_flush(ocb);
 }
 
 // Поток обработки клиента
 static void *client_thread(void *arg)
 {
-    int fd = (int)(long)arg;
-    char buf[1024];
+    ocb_t ocb;
+    memset(&ocb, 0, sizeof(ocb));
+    ocb.fd = (int)(long)arg;
+    ocb.device = default_device;
+    int fd = ocb.fd;
+    char buf[RECV_SIZE];
 
     // Приветственное сообщение
-    send_response(fd, "Подключение к менеджеру ресурсов установлено. Используйте HELP для справки.");
+    send_response(&ocb, GREETING);
+    batch_flush(&ocb);
 
     for (;;) {
-        ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
         if (n == 0) {
             if (optv) printf("%s: клиент отключился (fd=%d)\n", progname, fd);
+            process_eof(&ocb);
             break;
         }
         if (n < 0) {
@@ -259,32 +911,343 @@ static void *client_thread(void *arg)
             break;
         }
         
-        buf[n] = '\0';
-        
-        // Удаляем символы новой строки
-        if (buf[n-1] == '\n') buf[n-1] = '\0';
-        if (buf[n-2] == '\r') buf[n-2] = '\0';
+        process_input(&ocb, buf, (size_t)n);
+        if (ocb.failed) break;
+    }
 
-        if (optv) {
-            printf("%s: получена команда: %s\n", progname, buf);
+    free(ocb.in);
+    close(fd);
+    counters_release();
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Режим -w: рабочие потоки на epoll
+// ---------------------------------------------------------------------------
+
+static ocb_t *ocb_alloc(worker_t *w)
+{
+    if (optp >= 0) pthread_mutex_lock(&w->lock);
+    if (!w->free_ocbs) {
+        ocb_t *chunk = calloc(OCB_CHUNK, sizeof(ocb_t));
+        if (!chunk) {
+            if (optp >= 0) pthread_mutex_unlock(&w->lock);
+            return NULL;
         }
+        for (int i = 0; i < OCB_CHUNK; ++i) {
+            chunk[i].next_free = w->free_ocbs;
+            w->free_ocbs = &chunk[i];
+        }
+    }
+    ocb_t *ocb = w->free_ocbs;
+    w->free_ocbs = ocb->next_free;
+    if (optp >= 0) pthread_mutex_unlock(&w->lock);
+    memset(ocb, 0, sizeof(*ocb));
+    ocb->worker = w;
+    ocb->nonblock = 1;
+    ocb->device = default_device;
+    return ocb;
+}
 
-        handle_command(fd, buf, n);
+static void ocb_release(worker_t *w, ocb_t *ocb)
+{
+    if (optv) printf("%s: клиент отключился (fd=%d)\n", progname, ocb->fd);
+    close(ocb->fd); // Закрытие удаляет fd из epoll
+    free(ocb->out);
+    free(ocb->in);
+    ocb->out = NULL;
+    ocb->in = NULL;
+    if (optp >= 0) pthread_mutex_lock(&w->lock);
+    ocb->next_free = w->free_ocbs;
+    w->free_ocbs = ocb;
+    if (optp >= 0) pthread_mutex_unlock(&w->lock);
+}
+
+// Досылает очередь вывода; пустая очередь освобождается
+static void ocb_flush(ocb_t *ocb)
+{
+    while (ocb->out && ocb->failed <= 0) {
+        ssize_t n = send(ocb->fd, ocb->out + ocb->out_off, ocb->out_len - ocb->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) ocb->failed = 1;
+            return;
+        }
+        ocb->out_off += (size_t)n;
+        if (ocb->out_off == ocb->out_len) {
+            free(ocb->out);
+            ocb->out = NULL;
+            ocb->out_off = ocb->out_len = 0;
+        }
     }
+}
 
-    close(fd);
+// Режим -p: EPOLLONESHOT - событие взводится заново после каждой обработки
+static int ocb_set_out(worker_t *w, ocb_t *ocb, int want_out)
+{
+    if (ocb->want_out == want_out && optp < 0) return 0;
+    struct epoll_event event;
+    event.data.ptr = ocb;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want_out ? EPOLLOUT : 0) | (optp >= 0 ? EPOLLONESHOT : 0);
+    int op = optp >= 0 && !ocb->registered ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(w->epoll_fd, op, ocb->fd, &event) == -1) return -1;
+    ocb->registered = 1;
+    ocb->want_out = want_out;
+    return 0;
+}
+
+// В режиме ET читаем до EAGAIN: о данных, оставленных в сокете, уведомления не будет
+static void ocb_service(worker_t *w, ocb_t *ocb, uint32_t events)
+{
+    if (events & EPOLLOUT) ocb_flush(ocb);
+    while (!ocb->eof) {
+        ssize_t n = recv(ocb->fd, w->in, sizeof(w->in), 0);
+        if (n > 0) {
+            process_input(ocb, w->in, (size_t)n);
+            if (ocb->failed) break;
+            continue;
+        }
+        if (n == 0) {
+            process_eof(ocb);
+            ocb->eof = 1;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) ocb->failed = 1;
+        break;
+    }
+    // Закрытие по ошибке протокола ждет отправки ответа с ошибкой, как и EOF
+    if (ocb->failed < 0) ocb->eof = 1;
+    if (ocb->failed > 0 || (ocb->eof && ocb->out == NULL) ||
+        ocb_set_out(w, ocb, ocb->out != NULL) == -1) {
+        ocb_release(w, ocb);
+    }
+}
+
+static void accept_clients(worker_t *w)
+{
+    for (int i = 0; i < ACCEPT_BURST; ++i) {
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            // EAGAIN: подключение забрал другой поток или очередь пуста
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+            return;
+        }
+        ocb_t *ocb = ocb_alloc(w);
+        if (!ocb) {
+            close(client_fd);
+            continue;
+        }
+        ocb->fd = client_fd;
+        struct epoll_event event;
+        event.data.ptr = ocb;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) == -1) {
+            ocb_release(w, ocb);
+            continue;
+        }
+        if (optv) printf("%s: новое подключение (fd=%d)\n", progname, client_fd);
+        send_response(ocb, GREETING);
+        batch_flush(ocb);
+        // Клиент мог успеть прислать команду до регистрации: ET об этом не сообщит
+        ocb_service(w, ocb, 0);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    struct epoll_event events[EVENT_BATCH];
+    for (;;) {
+        int n = epoll_wait(w->epoll_fd, events, EVENT_BATCH, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == &listen_tag) {
+                accept_clients(w);
+            } else {
+                ocb_service(w, events[i].data.ptr, events[i].events);
+            }
+        }
+    }
     return NULL;
 }
 
+static int run_workers(int n_workers)
+{
+    static worker_t workers[MAX_WORKERS];
+    if (n_workers == 0) n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_workers < 1) n_workers = 1;
+    if (n_workers > MAX_WORKERS) n_workers = MAX_WORKERS;
+
+    // Тысячи клиентов - тысячи дескрипторов
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    // Подключение забирает первый проснувшийся поток, остальные получают EAGAIN
+    int flags = fcntl(listen_fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        perror("fcntl");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < n_workers; ++i) {
+        worker_t *w = &workers[i];
+        if ((w->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+            perror("epoll_create1");
+            return EXIT_FAILURE;
+        }
+        struct epoll_event event;
+        event.data.ptr = &listen_tag;
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == -1) {
+            perror("epoll_ctl");
+            return EXIT_FAILURE;
+        }
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    }
+    printf("%s: %d рабочих потоков на epoll, OCB %zu байт\n", progname, n_workers, sizeof(ocb_t));
+
+    // Завершение - по сигналу (on_signal)
+    for (int i = 0; i < n_workers; ++i) pthread_join(workers[i].thread, NULL);
+    return EXIT_SUCCESS;
+}
+
+// ---------------------------------------------------------------------------
+// Режим -p: один epoll в главном потоке, обработка - задачи пула rt_pool
+// ---------------------------------------------------------------------------
+
+static worker_t pool_contexts[RT_POOL_MAX_WORKERS]; // По контексту (буфер приема, OCB) на поток пула
+
+static void pool_service(void *arg)
+{
+    ocb_t *ocb = arg;
+    ocb_service(&pool_contexts[rt_pool_current_worker()], ocb, ocb->events);
+}
+
+static void pool_submit(RtPool *pool, ocb_t *ocb, uint32_t events)
+{
+    ocb->events = events;
+    RtPoolLane lane = events & EPOLLOUT ? RT_POOL_HIGH : RT_POOL_NORMAL;
+    if (rt_pool_submit(pool, pool_service, ocb, lane, ocb->worker->index) == -1) {
+        perror("rt_pool_submit");
+        // Снять с epoll до освобождения: OCB уйдет в список свободных, а
+        // событие по старому fd не должно до него дойти
+        if (ocb->registered) epoll_ctl(ocb->worker->epoll_fd, EPOLL_CTL_DEL, ocb->fd, NULL);
+        ocb_release(ocb->worker, ocb);
+    }
+}
+
+static int run_pool(int n_workers)
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    int flags = fcntl(listen_fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        perror("fcntl");
+        return EXIT_FAILURE;
+    }
+
+    RtPoolConfig cfg;
+    rt_pool_config_default(&cfg);
+    cfg.workers = n_workers;
+    RtPool *pool = rt_pool_create(&cfg);
+    if (!pool) {
+        perror("rt_pool_create");
+        return EXIT_FAILURE;
+    }
+    int n = rt_pool_workers(pool);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < n; ++i) {
+        pool_contexts[i].epoll_fd = epoll_fd;
+        pool_contexts[i].index = i;
+        pthread_mutex_init(&pool_contexts[i].lock, NULL);
+    }
+    struct epoll_event event;
+    event.data.ptr = &listen_tag;
+    event.events = EPOLLIN;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == -1) {
+        perror("epoll_ctl");
+        return EXIT_FAILURE;
+    }
+    printf("%s: пул из %d потоков, один epoll в главном потоке\n", progname, n);
+
+    // Завершение - по сигналу (on_signal)
+    unsigned next_home = 0;
+    struct epoll_event events[EVENT_BATCH];
+    for (;;) {
+        int count = epoll_wait(epoll_fd, events, EVENT_BATCH, -1);
+        if (count == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr != &listen_tag) {
+                pool_submit(pool, events[i].data.ptr, events[i].events);
+                continue;
+            }
+            for (int k = 0; k < ACCEPT_BURST; ++k) {
+                int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (client_fd == -1) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+                    break;
+                }
+                // Домашний поток соединения - по кругу
+                ocb_t *ocb = ocb_alloc(&pool_contexts[next_home++ % (unsigned)n]);
+                if (!ocb) {
+                    close(client_fd);
+                    continue;
+                }
+                ocb->fd = client_fd;
+                if (optv) printf("%s: новое подключение (fd=%d)\n", progname, client_fd);
+                send_response(ocb, GREETING);
+                batch_flush(ocb);
+                // Первая задача читает то, что клиент успел прислать, и регистрирует fd
+                pool_submit(pool, ocb, 0);
+            }
+        }
+    }
+    rt_pool_destroy(pool);
+    return EXIT_FAILURE;
+}
+
 static void options(int argc, char *argv[])
 {
     int opt;
     optv = 0;
-    while ((opt = getopt(argc, argv, "v")) != -1) {
+    while ((opt = getopt(argc, argv, "vw:p:l")) != -1) {
         switch (opt) {
             case 'v':
                 optv++;
                 break;
+            case 'w':
+                optw = atoi(optarg);
+                if (optw < 0) optw = 0;
+                break;
+            case 'p':
+                optp = atoi(optarg);
+                if (optp < 0) optp = 0;
+                break;
+            case 'l':
+                optl = 1;
+                break;
         }
     }
 }
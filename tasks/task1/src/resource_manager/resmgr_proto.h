@@ -0,0 +1,54 @@
+#ifndef RESMGR_PROTO_H
+#define RESMGR_PROTO_H
+
+#include <stdint.h>
+
+/*
+ * Бинарный протокол менеджера ресурсов.
+ *
+ * Протокол выбирается первым байтом соединения после приветствия:
+ * RESMGR_MAGIC - бинарный, иначе текстовый (строки, завершенные '\n').
+ * Приветствие всегда текстовое, одной строкой до '\n'.
+ *
+ * Запрос и ответ - заголовок resmgr_frame_t и len байт данных. Порядок
+ * байт - родной для машины: сокет локальный. Запросы можно слать подряд,
+ * не дожидаясь ответов; ответы приходят в том же порядке, id копируется
+ * из запроса. Данные DATA - записываемые байты, SET_ACCESS - строка
+ * "read-only" или "read-write", OPEN - "имя [емкость]". READ без данных
+ * читает с курсора соединения, с 8 байтами uint64_t - с этого смещения;
+ * ответ READ - 8 байт фактического начала и данные. Ответы остальных
+ * команд - текст, как в текстовом протоколе.
+ */
+
+#define RESMGR_MAGIC     0xB1
+#define RESMGR_FRAME_MAX 1024   // Предел данных в одном кадре
+
+enum {
+    RESMGR_OP_READ = 1,
+    RESMGR_OP_DATA,
+    RESMGR_OP_CLEAR,
+    RESMGR_OP_STATUS,
+    RESMGR_OP_SET_ACCESS,
+    RESMGR_OP_HELP,
+    RESMGR_OP_OPEN,
+    RESMGR_OP_COUNT
+};
+
+// Коды status в ответе
+enum {
+    RESMGR_OK = 0,
+    RESMGR_EINVAL,      // Неверный формат или аргумент
+    RESMGR_EACCES,      // Устройство только для чтения
+    RESMGR_ENOSYS,      // Неизвестная команда
+    RESMGR_E2BIG        // Кадр длиннее RESMGR_FRAME_MAX; соединение закрывается
+};
+
+typedef struct {
+    uint8_t magic;      // RESMGR_MAGIC
+    uint8_t opcode;
+    uint16_t status;    // В запросе 0
+    uint32_t len;       // Байт данных после заголовка
+    uint32_t id;        // Возвращается в ответе без изменений
+} resmgr_frame_t;
+
+#endif // RESMGR_PROTO_H
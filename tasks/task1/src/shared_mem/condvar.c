@@ -20,11 +20,17 @@
  *      same state variable and condition variable for notification of
  *      change in the state variable.
  *
+ *      condvar -a: состояние хранится в слове rt_sync (спин, затем futex)
+ *      без мьютекса - переход делает только поток, владеющий текущим
+ *      состоянием. При выходе печатается, каким путем завершались ожидания.
+ *
  */ 
 #include <stdio.h>
  #include <unistd.h>
  #include <pthread.h>
  #include <sched.h>
+ #include <string.h>
+ #include "rt_sync.h"
  
  volatile int counter = 0;
  volatile int        state;          // which state we are in
@@ -35,10 +41,41 @@
  void    *state_2 (void *);
  void    *state_3 (void *);
  char    *progname = "condvar";
+ RtWord  stateWord;
+ int     adaptive = 0;
+
+ // Ждать своего состояния; без -a возвращается с захваченным мьютексом
+ static void enter_state (int s)
+ {
+     if (adaptive) {
+         uint32_t v = rt_word_load (&stateWord);
+         while (v != (uint32_t)s) {
+             v = rt_word_wait_while (&stateWord, v);
+         }
+         return;
+     }
+     pthread_mutex_lock (&mutex);
+     while (state != s) {
+         pthread_cond_wait (&cond, &mutex);
+     }
+ }
+
+ // Передать управление потоку нового состояния (state уже записано)
+ static void leave_state (void)
+ {
+     if (adaptive) {
+         rt_word_store (&stateWord, (uint32_t)state);
+         return;
+     }
+     pthread_cond_broadcast (&cond);
+     pthread_mutex_unlock (&mutex);
+ }
  
- int main ()
+ int main (int argc, char *argv[])
  {
      setvbuf (stdout, NULL, _IOLBF, 0);
+     adaptive = argc > 1 && strcmp (argv[1], "-a") == 0;
+     rt_word_init (&stateWord, 0, rt_sync_spin_for_ns (20000));
      state = 0;
      pthread_t t_state0, t_state1, t_state2, t_state3 ;
      pthread_create (&t_state0, NULL, state_0, NULL);
@@ -46,9 +83,14 @@
      pthread_create (&t_state2, NULL, state_2, NULL);
      pthread_create (&t_state3, NULL, state_3, NULL);
      sleep (20); 
-    
-
 
+     if (adaptive) {
+         RtSyncStats st;
+         rt_word_get_stats (&stateWord, &st);
+         printf ("%s:  waits: %llu fast, %llu spun, %llu slept; %llu futex wakes\n", progname,
+                 (unsigned long long)st.fast, (unsigned long long)st.spun,
+                 (unsigned long long)st.slept, (unsigned long long)st.wakeups);
+     }
      printf ("%s:  main, exiting\n", progname);
      return 0;
  }
@@ -60,16 +102,12 @@
  void *state_0 (void *arg)
  {
      while (1) {
-        pthread_mutex_lock (&mutex);
-        while (state != 0) {
-            pthread_cond_wait (&cond, &mutex);
-        }
+        enter_state (0);
         printf ("%s:  transit 0 -> 1\n", progname);
         state = 1;
         counter++;
         usleep(100 * 1000);
-        pthread_cond_broadcast (&cond);
-        pthread_mutex_unlock (&mutex);
+        leave_state ();
     }
     return (NULL);
  }
@@ -81,11 +119,7 @@
  void *state_1 (void *arg)
  {
     while (1) {
-        pthread_mutex_lock (&mutex);
-
-        while (state != 1) {
-            pthread_cond_wait (&cond, &mutex);
-        }
+        enter_state (1);
 
         if(counter % 2 == 0){
             printf ("%s:  transit 1 -> 2\n", progname);
@@ -99,8 +133,7 @@
 
         counter++;
         usleep(100 * 1000);
-        pthread_cond_broadcast (&cond);
-        pthread_mutex_unlock (&mutex);
+        leave_state ();
     }
     return (NULL);
  }
@@ -112,18 +145,14 @@
  void *state_2 (void *arg)
  {
     while (1) {
-        pthread_mutex_lock (&mutex);
-        while (state != 2) {
-            pthread_cond_wait (&cond, &mutex);
-        }
+        enter_state (2);
 
         printf ("%s:  transit 2 -> 0\n", progname);
         state = 0;
 
         counter++;
         usleep(100 * 1000);
-        pthread_cond_broadcast (&cond);
-        pthread_mutex_unlock (&mutex);
+        leave_state ();
     }
     return (NULL);
  }
@@ -135,16 +164,12 @@
  void *state_3 (void *arg)
  {
      while (1) {
-        pthread_mutex_lock (&mutex);
-        while (state != 3) {
-            pthread_cond_wait (&cond, &mutex);
-        }
+        enter_state (3);
         printf ("%s:  transit 3 -> 0\n", progname);
         state = 0;
         counter++;
         usleep(100 * 1000);
-        pthread_cond_broadcast (&cond);
-        pthread_mutex_unlock (&mutex);
+        leave_state ();
     }
     return (NULL);
  }
\ No newline at end of file
@@ -0,0 +1,262 @@
+/*
+ *  Стоимость передачи управления между двумя потоками.
+ *
+ *  Пинг-понг, как в prodcons.c, но без работы между ходами: поток A
+ *  передает ход B, B сразу возвращает его A. Половина круга - задержка
+ *  одной передачи. Варианты:
+ *    sem_t    - пара POSIX-семафоров (semex.c);
+ *    condvar  - mutex + condvar + переменная хода (condvar.c, prodcons.c);
+ *    RtSem    - пара адаптивных семафоров rt_sync;
+ *    RtWord   - слово хода rt_sync.
+ *  Затем пакетная передача: производитель выдает -b единиц за раз
+ *  (rt_sem_post_batch), потребитель забирает сколько есть одним
+ *  rt_sem_wait_batch; рядом - то же по одной единице через sem_t.
+ *
+ *  Потоки привязываются к ядрам -c A,B. Выигрыш спина виден, только когда
+ *  у каждого потока свое ядро: на одном ядре rt_sync_spin_for_ns() дает 0,
+ *  и адаптивные варианты сразу спят на futex.
+ *
+ *  Запуск: handoff [-n rounds] [-c cpuA,cpuB] [-s spin_us] [-b batch]
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rt_stats.h"
+#include "rt_sync.h"
+#include "rt_time.h"
+
+static uint32_t spin;
+
+// --- варианты передачи хода: give - отдать ход потоку to, take - ждать своего ---
+
+static sem_t posix_sems[2];
+
+static void posix_init (void) { sem_init (&posix_sems[0], 0, 0); sem_init (&posix_sems[1], 0, 0); }
+static void posix_give (int to) { sem_post (&posix_sems[to]); }
+static void posix_take (int me) { sem_wait (&posix_sems[me]); }
+
+static pthread_mutex_t cond_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_cv = PTHREAD_COND_INITIALIZER;
+static int cond_turn;
+
+static void cond_init (void) { cond_turn = 0; }
+
+static void cond_give (int to)
+{
+  pthread_mutex_lock (&cond_mutex);
+  cond_turn = to;
+  pthread_cond_signal (&cond_cv);
+  pthread_mutex_unlock (&cond_mutex);
+}
+
+static void cond_take (int me)
+{
+  pthread_mutex_lock (&cond_mutex);
+  while (cond_turn != me) {
+    pthread_cond_wait (&cond_cv, &cond_mutex);
+  }
+  pthread_mutex_unlock (&cond_mutex);
+}
+
+static RtSem rt_sems[2];
+
+static void rtsem_init (void) { rt_sem_init (&rt_sems[0], 0, spin); rt_sem_init (&rt_sems[1], 0, spin); }
+static void rtsem_give (int to) { rt_sem_post (&rt_sems[to]); }
+static void rtsem_take (int me) { rt_sem_wait (&rt_sems[me]); }
+
+static void rtsem_stats (RtSyncStats *st)
+{
+  RtSyncStats b;
+  rt_sem_get_stats (&rt_sems[0], st);
+  rt_sem_get_stats (&rt_sems[1], &b);
+  st->fast += b.fast;
+  st->spun += b.spun;
+  st->slept += b.slept;
+  st->wakeups += b.wakeups;
+}
+
+static RtWord rt_turn;
+
+static void rtword_init (void) { rt_word_init (&rt_turn, 0, spin); }
+static void rtword_give (int to) { rt_word_store (&rt_turn, (uint32_t)to); }
+
+static void rtword_take (int me)
+{
+  uint32_t v = rt_word_load (&rt_turn);
+  while (v != (uint32_t)me) {
+    v = rt_word_wait_while (&rt_turn, v);
+  }
+}
+
+static void rtword_stats (RtSyncStats *st) { rt_word_get_stats (&rt_turn, st); }
+
+typedef struct {
+  const char *name;
+  void (*init) (void);
+  void (*give) (int to);
+  void (*take) (int me);
+  void (*stats) (RtSyncStats *st);  // NULL - у POSIX-примитивов счетчиков нет
+} Handoff;
+
+static const Handoff handoffs[] = {
+  {"sem_t", posix_init, posix_give, posix_take, NULL},
+  {"condvar", cond_init, cond_give, cond_take, NULL},
+  {"RtSem", rtsem_init, rtsem_give, rtsem_take, rtsem_stats},
+  {"RtWord", rtword_init, rtword_give, rtword_take, rtword_stats},
+};
+
+static const Handoff *current;
+static long rounds = 100000;
+static long batch = 64;
+static int cpus[2] = {0, 1};
+
+static void pin (int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+}
+
+// Поток B: вернуть каждый ход
+static void *echo (void *arg)
+{
+  (void)arg;
+  pin (cpus[1]);
+  for (long i = 0; i < rounds; i++) {
+    current->take (1);
+    current->give (0);
+  }
+  return NULL;
+}
+
+static int run_pingpong (const Handoff *h)
+{
+  static RtHistogram hist;
+  pthread_t th;
+  current = h;
+  h->init ();
+  rt_hist_init (&hist);
+  if (pthread_create (&th, NULL, echo, NULL) != 0) {
+    perror ("pthread_create");
+    return -1;
+  }
+  for (long i = 0; i < rounds; i++) {
+    int64_t t0 = rt_now_ns ();
+    h->give (1);
+    h->take (0);
+    rt_hist_record (&hist, (rt_now_ns () - t0) / 2);
+  }
+  pthread_join (th, NULL);
+
+  printf ("%-8s p50 %7.2f us  p99 %7.2f us  max %8.2f us", h->name,
+          rt_hist_percentile (&hist, 50.0) / 1e3, rt_hist_percentile (&hist, 99.0) / 1e3, hist.max / 1e3);
+  if (h->stats) {
+    RtSyncStats st;
+    h->stats (&st);
+    uint64_t waits = st.fast + st.spun + st.slept;
+    printf ("  waits: %.1f%% fast, %.1f%% spun, %.1f%% slept", 100.0 * st.fast / waits,
+            100.0 * st.spun / waits, 100.0 * st.slept / waits);
+  }
+  printf ("\n");
+  return 0;
+}
+
+// --- пакетная передача: total единиц от производителя к потребителю ---
+
+static sem_t batch_posix;
+static RtSem batch_rt;
+static int batch_adaptive;
+
+static void *batch_producer (void *arg)
+{
+  long total = *(long *)arg;
+  pin (cpus[1]);
+  for (long sent = 0; sent < total; sent += batch) {
+    long n = total - sent < batch ? total - sent : batch;
+    if (batch_adaptive) {
+      rt_sem_post_batch (&batch_rt, (uint32_t)n);
+    } else {
+      for (long i = 0; i < n; i++) sem_post (&batch_posix);
+    }
+  }
+  return NULL;
+}
+
+static void run_batch (int adaptive)
+{
+  long total = rounds * batch;
+  pthread_t th;
+  batch_adaptive = adaptive;
+  sem_init (&batch_posix, 0, 0);
+  rt_sem_init (&batch_rt, 0, spin);
+  int64_t t0 = rt_now_ns ();
+  pthread_create (&th, NULL, batch_producer, &total);
+  for (long got = 0; got < total;) {
+    if (adaptive) {
+      got += rt_sem_wait_batch (&batch_rt, (uint32_t)batch);
+    } else {
+      sem_wait (&batch_posix);
+      got++;
+    }
+  }
+  double ns = (double)(rt_now_ns () - t0);
+  pthread_join (th, NULL);
+  printf ("%-24s %6.1f ns/item", adaptive ? "RtSem post/wait_batch" : "sem_t post/wait", ns / total);
+  if (adaptive) {
+    RtSyncStats st;
+    rt_sem_get_stats (&batch_rt, &st);
+    uint64_t waits = st.fast + st.spun + st.slept;
+    printf ("  %.1f items/wait, %llu slept, %llu futex wakes", (double)st.items / waits,
+            (unsigned long long)st.slept, (unsigned long long)st.wakeups);
+  }
+  printf ("\n");
+  sem_destroy (&batch_posix);
+}
+
+int main (int argc, char *argv[])
+{
+  long spin_us = 20;
+  int opt;
+  while ((opt = getopt (argc, argv, "n:c:s:b:")) != -1) {
+    switch (opt) {
+      case 'n': rounds = atol (optarg); break;
+      case 'c':
+        if (sscanf (optarg, "%d,%d", &cpus[0], &cpus[1]) != 2) {
+          fprintf (stderr, "-c expects cpuA,cpuB\n");
+          return 1;
+        }
+        break;
+      case 's': spin_us = atol (optarg); break;
+      case 'b': batch = atol (optarg); break;
+      default:
+        fprintf (stderr, "Usage: %s [-n rounds] [-c cpuA,cpuB] [-s spin_us] [-b batch]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (rounds < 1 || batch < 1 || spin_us < 0) {
+    fprintf (stderr, "rounds and batch must be positive\n");
+    return 1;
+  }
+  long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+  if (ncpu < 2) cpus[0] = cpus[1] = 0;
+  pin (cpus[0]);
+  spin = rt_sync_spin_for_ns (spin_us * RT_NSEC_PER_USEC);
+  setvbuf (stdout, NULL, _IOLBF, 0);
+
+  printf ("%ld rounds, cpus %d,%d (%ld online), spin %u iterations (%ld us)\n", rounds, cpus[0], cpus[1], ncpu,
+          spin, spin_us);
+  for (size_t i = 0; i < sizeof (handoffs) / sizeof (handoffs[0]); i++) {
+    if (run_pingpong (&handoffs[i]) < 0) return 1;
+  }
+  printf ("batch %ld:\n", batch);
+  run_batch (0);
+  run_batch (1);
+  return 0;
+}
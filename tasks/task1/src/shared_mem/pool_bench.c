@@ -0,0 +1,108 @@
+/*
+ *  Масштабирование пула rt_pool на пачках коротких задач.
+ *
+ *  Главный поток ставит пачку из -b задач по -t нс счета каждая и ждет,
+ *  пока пул не опустеет (rt_pool_wait_idle), затем пауза -g мкс - поток
+ *  событий "всплесками", как запросы к resmgr. По умолчанию вся пачка
+ *  ставится к потоку 0 (как задачи одного соединения): остальные потоки
+ *  получают работу только перехватом. -r - ставить по кругу.
+ *
+ *  Для 1, 2, 4, ... -w потоков выводится время пачки (p50/p99),
+ *  пропускная способность, доля перехваченных задач и парковки.
+ *  В паузах между пачками потоки спят на futex и не занимают ядра.
+ *
+ *  Запуск: pool_bench [-w max_workers] [-b burst] [-n bursts] [-t task_ns] [-g gap_us] [-r] [-p]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_pool.h"
+#include "rt_stats.h"
+#include "rt_time.h"
+
+static int64_t task_ns = 2000;
+
+// Короткая задача: счет в течение task_ns
+static void task (void *arg)
+{
+  (void)arg;
+  int64_t end = rt_now_ns () + task_ns;
+  while (rt_now_ns () < end) {
+  }
+}
+
+int main (int argc, char *argv[])
+{
+  long max_workers = sysconf (_SC_NPROCESSORS_ONLN);
+  long burst = 1000, bursts = 200, gap_us = 1000;
+  int round_robin = 0, pin = 0;
+  int opt;
+  while ((opt = getopt (argc, argv, "w:b:n:t:g:rp")) != -1) {
+    switch (opt) {
+      case 'w': max_workers = atol (optarg); break;
+      case 'b': burst = atol (optarg); break;
+      case 'n': bursts = atol (optarg); break;
+      case 't': task_ns = atol (optarg); break;
+      case 'g': gap_us = atol (optarg); break;
+      case 'r': round_robin = 1; break;
+      case 'p': pin = 1; break;
+      default:
+        fprintf (stderr, "Usage: %s [-w max_workers] [-b burst] [-n bursts] [-t task_ns] [-g gap_us] [-r] [-p]\n",
+                 argv[0]);
+        return 1;
+    }
+  }
+  if (max_workers < 1 || burst < 1 || bursts < 1 || task_ns < 0 || gap_us < 0) {
+    fprintf (stderr, "workers, burst and bursts must be positive\n");
+    return 1;
+  }
+  if (max_workers > RT_POOL_MAX_WORKERS) max_workers = RT_POOL_MAX_WORKERS;
+  setvbuf (stdout, NULL, _IOLBF, 0);
+
+  printf ("%ld bursts of %ld tasks x %lld ns, gap %ld us, submit %s\n", bursts, burst, (long long)task_ns,
+          gap_us, round_robin ? "round-robin" : "to worker 0");
+  printf ("%7s | %10s %10s | %12s | %7s | %7s\n", "workers", "burst p50", "p99 (us)", "tasks/s", "stolen", "parks");
+
+  static RtHistogram hist;
+  struct timespec gap;
+  rt_ns_to_timespec (gap_us * RT_NSEC_PER_USEC, &gap);
+  for (long workers = 1;; workers = workers * 2 < max_workers ? workers * 2 : max_workers) {
+    RtPoolConfig cfg;
+    rt_pool_config_default (&cfg);
+    cfg.workers = (int)workers;
+    cfg.pin = pin;
+    cfg.capacity = (size_t)burst;
+    RtPool *pool = rt_pool_create (&cfg);
+    if (!pool) {
+      perror ("rt_pool_create");
+      return 1;
+    }
+    rt_hist_init (&hist);
+    int64_t busy = 0;
+    for (long i = 0; i < bursts; i++) {
+      int64_t t0 = rt_now_ns ();
+      for (long k = 0; k < burst; k++) {
+        if (rt_pool_submit (pool, task, NULL, RT_POOL_NORMAL, round_robin ? RT_POOL_ANY : 0) < 0) {
+          perror ("rt_pool_submit");
+          return 1;
+        }
+      }
+      rt_pool_wait_idle (pool);
+      int64_t dt = rt_now_ns () - t0;
+      busy += dt;
+      rt_hist_record (&hist, dt);
+      if (gap_us > 0) nanosleep (&gap, NULL);
+    }
+    RtPoolStats st;
+    rt_pool_get_stats (pool, &st);
+    printf ("%7ld | %10.1f %10.1f | %12.0f | %6.1f%% | %7llu\n", workers, rt_hist_percentile (&hist, 50.0) / 1e3,
+            rt_hist_percentile (&hist, 99.0) / 1e3, (double)st.total.executed * 1e9 / busy,
+            100.0 * st.total.stolen / st.total.executed, (unsigned long long)st.total.parks);
+    rt_pool_destroy (pool);
+    if (workers >= max_workers) break;
+  }
+  return 0;
+}
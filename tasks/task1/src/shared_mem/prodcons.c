@@ -4,6 +4,10 @@
  *  в любой момент работы одного из них мы можем просто использовать вызов
  *  pthread_cond_signal для пробуждения второго потока.
  *
+ *  prodcons -a: очередь хода хранится в слове rt_sync (спин, затем futex)
+ *  вместо mutex + condvar; при выходе печатается, каким путем завершались
+ *  ожидания.
+ *
 */
 
 #include <stdio.h>
@@ -11,6 +15,11 @@
 #include <sched.h>
 #include <unistd.h>
 #include <signal.h>
+#include <string.h>
+#include "rt_sync.h"
+
+// -a: значение слова - чей ход (state), STATE_SHUTDOWN - завершение
+#define STATE_SHUTDOWN 2
 
 // mutex и условная переменная
 pthread_mutex_t     mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -24,26 +33,82 @@ void    *consumer (void *);
 void    do_producer_work (void);
 void    do_consumer_work (void);
 char    *progname = "prodcons";
+RtWord  stateWord;
+int     adaptive = 0;
+
+// Ждать своего хода (state == turn); 0 - пора завершаться.
+// Без -a возвращает 1 с захваченным мьютексом
+static int wait_turn (int turn)
+{
+  if (adaptive) {
+    uint32_t v = rt_word_load (&stateWord);
+    while (v != (uint32_t)turn && v != STATE_SHUTDOWN) {
+      v = rt_word_wait_while (&stateWord, v);
+    }
+    return v != STATE_SHUTDOWN;
+  }
+  pthread_mutex_lock (&mutex);
+  // добавляем проверку флага завершения к условию ожидания
+  while (state != turn && !shutdown) {
+    pthread_cond_wait (&cond, &mutex);
+  }
+  // проверяем флаг завершения и выходим из цикла
+  if (shutdown) {
+    pthread_mutex_unlock (&mutex);
+    return 0;
+  }
+  return 1;
+}
+
+// Передать ход другому потоку
+static void pass_turn (int next)
+{
+  state = next;
+  if (adaptive) {
+    // CAS, чтобы не затереть STATE_SHUTDOWN, записанный main
+    rt_word_cas (&stateWord, (uint32_t)(1 - next), (uint32_t)next);
+    return;
+  }
+  pthread_cond_signal (&cond);
+  pthread_mutex_unlock (&mutex);
+}
 
-int main ()
+int main (int argc, char *argv[])
 {
   pthread_t producer_thread, consumer_thread; // сохраняем идентификаторы потоков
   
   setvbuf (stdout, NULL, _IOLBF, 0);
+  adaptive = argc > 1 && strcmp (argv[1], "-a") == 0;
+  rt_word_init (&stateWord, 0, rt_sync_spin_for_ns (20000));
   pthread_create (&producer_thread, NULL, producer, NULL);  // сохраняем ID потока
   pthread_create (&consumer_thread, NULL, consumer, NULL);  // сохраняем ID потока
   
   sleep (20);     // Позволим потокам выполнить "работу"
   
   // Корректное завершение потоков
-  pthread_mutex_lock (&mutex);
-  shutdown = 1; // устанавливаем флаг завершения
-  pthread_cond_broadcast (&cond); // будим все ожидающие потоки
-  pthread_mutex_unlock (&mutex);
+  if (adaptive) {
+    uint32_t v = rt_word_load (&stateWord);
+    while (!rt_word_cas (&stateWord, v, STATE_SHUTDOWN)) {
+      v = rt_word_load (&stateWord);
+    }
+  } else {
+    pthread_mutex_lock (&mutex);
+    shutdown = 1; // устанавливаем флаг завершения
+    pthread_cond_broadcast (&cond); // будим все ожидающие потоки
+    pthread_mutex_unlock (&mutex);
+  }
   
   // Ожидаем завершения рабочих потоков
   pthread_join (producer_thread, NULL);
   pthread_join (consumer_thread, NULL);
+
+  if (adaptive) {
+    RtSyncStats st;
+    rt_word_get_stats (&stateWord, &st);
+    printf ("%s:  waits: %llu fast, %llu spun, %llu slept; %llu futex wakes\n", progname,
+            (unsigned long long)st.fast, (unsigned long long)st.spun,
+            (unsigned long long)st.slept, (unsigned long long)st.wakeups);
+  }
   
   printf ("%s:  main, exiting\n", progname);
   return 0;
@@ -52,23 +117,9 @@ int main ()
 // Производитель
 void *producer (void *arg)
 {
-  while (1) {
-    pthread_mutex_lock (&mutex);
-    // добавляем проверку флага завершения к условию ожидания
-    while (state == 1 && !shutdown) {
-      pthread_cond_wait (&cond, &mutex);
-    }
-    
-    // проверяем флаг завершения и выходим из цикла
-    if (shutdown) {
-      pthread_mutex_unlock (&mutex);
-      break;
-    }
-    
+  while (wait_turn (0)) {
     printf ("%s:  produced %d, state %d\n", progname, ++product, state);
-    state = 1;
-    pthread_cond_signal (&cond);
-    pthread_mutex_unlock (&mutex);
+    pass_turn (1);
     do_producer_work ();
   }
   printf ("%s: producer exiting\n", progname); // сообщение о завершении
@@ -78,23 +129,9 @@ void *producer (void *arg)
 // Потребитель
 void *consumer (void *arg)
 {
-  while (1) {
-    pthread_mutex_lock (&mutex);
-    // добавляем проверку флага завершения к условию ожидания
-    while (state == 0 && !shutdown) {
-      pthread_cond_wait (&cond, &mutex);
-    }
-    
-    // проверяем флаг завершения и выходим из цикла
-    if (shutdown) {
-      pthread_mutex_unlock (&mutex);
-      break;
-    }
-    
+  while (wait_turn (1)) {
     printf ("%s:  consumed %d, state %d\n", progname, product, state);
-    state = 0;
-    pthread_cond_signal (&cond);
-    pthread_mutex_unlock (&mutex);
+    pass_turn (0);
     do_consumer_work ();
   }
   printf ("%s: consumer exiting\n", progname); // сообщение о завершении
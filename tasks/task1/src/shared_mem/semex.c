@@ -7,6 +7,12 @@
  *      the semaphore.  
  *      A producer thread is created, which periodically posts
  *      the semaphore, unblocking one of the consumer threads.
+ *
+ *  semex -a: тот же сценарий на адаптивном семафоре rt_sync (спин, затем
+ *  futex); при выходе печатается, каким путем завершались ожидания.
+ *
+ *  semex -p: вместо пяти потоков-потребителей - пул rt_pool; каждый post
+ *  ставит задачу потребителя, ее выполняет любой свободный поток пула.
 */
 
 #include <stdio.h>
@@ -15,9 +21,15 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include "rt_pool.h"
+#include "rt_sync.h"
 
 sem_t   *mySemaphore;
+RtSem   adaptiveSem;
+int     adaptive = 0;
+RtPool  *pool;          // -p: потребители - задачи пула
 void    *producer (void *);
 void    *consumer (void *);
 char    *progname = "semex";
@@ -26,10 +38,22 @@ char    *progname = "semex";
 // Для совместимости с Linux/macOS используем именованные семафоры по умолчанию
 #define Named 1
 
-int main ()
+int main (int argc, char *argv[])
 {
     int     i;
     setvbuf (stdout, NULL, _IOLBF, 0);
+    adaptive = argc > 1 && strcmp (argv[1], "-a") == 0;
+    if (argc > 1 && strcmp (argv[1], "-p") == 0) {
+        RtPoolConfig cfg;
+        rt_pool_config_default (&cfg);
+        cfg.workers = 5;
+        if (!(pool = rt_pool_create (&cfg))) {
+            perror ("rt_pool_create");
+            return 1;
+        }
+    }
+    // Спин порядка стоимости пробуждения из futex
+    rt_sem_init (&adaptiveSem, 0, rt_sync_spin_for_ns (20000));
 #ifdef  Named
     mySemaphore = sem_open (SEM_NAME, O_CREAT, S_IRWXU, 0);
     /* not sharing with other process, so immediately unlink */
@@ -41,21 +65,38 @@ int main ()
 
     pthread_t consumers[5];
     pthread_t producerThread;
-    for (i = 0; i < 5; i++) {
+    for (i = 0; i < 5 && !pool; i++) {
         pthread_create (&consumers[i], NULL, consumer, (void *)(long)i);
     }
     pthread_create (&producerThread, NULL, producer, (void *) 1);
     sleep (20);     // let the threads run
+    if (adaptive) {
+        RtSyncStats st;
+        rt_sem_get_stats (&adaptiveSem, &st);
+        printf ("%s:  waits: %llu fast, %llu spun, %llu slept; %llu futex wakes\n", progname,
+                (unsigned long long)st.fast, (unsigned long long)st.spun,
+                (unsigned long long)st.slept, (unsigned long long)st.wakeups);
+    }
+    if (pool) rt_pool_print_stats (stdout, pool);
     printf ("%s:  main, exiting\n", progname);
     return 0;
 }
 
+// Задача-потребитель режима -p
+static void consume_task (void *arg)
+{
+    (void)arg;
+    printf ("%s:  (consumer task on worker %d) got semaphore\n", progname, rt_pool_current_worker ());
+}
+
 void *producer (void *i)
 {
     while (1) {
         sleep (1);
         printf ("%s:  (producer %ld), posted semaphore\n", progname, (long)i);
-        sem_post (mySemaphore);
+        if (pool) rt_pool_submit (pool, consume_task, NULL, RT_POOL_NORMAL, RT_POOL_ANY);
+        else if (adaptive) rt_sem_post (&adaptiveSem);
+        else sem_post (mySemaphore);
     }
     return (NULL);
 }
@@ -63,7 +104,8 @@ void *producer (void *i)
 void *consumer (void *i)
 {
     while (1) {
-        sem_wait (mySemaphore);
+        if (adaptive) rt_sem_wait (&adaptiveSem);
+        else sem_wait (mySemaphore);
         printf ("%s:  (consumer %ld) got semaphore\n", progname, (long)i);
     }
     return (NULL);
@@ -43,4 +43,20 @@ kill "$(cat "$BIN_DIR/.resmgr.pid" 2>/dev/null)" 2>/dev/null || true
 rm -f "$BIN_DIR/.resmgr.pid"
 pass "resmgr echo"
 
+# resource manager: epoll workers (-w)
+( "$BIN_DIR/resmgr" -w 2 >/dev/null 2>&1 & echo $! > "$BIN_DIR/.resmgr.pid" ) || true
+sleep 0.2
+"$BIN_DIR/resmgr_client" "STATUS" 2>/dev/null | grep -q "STATUS" || fail "resmgr -w"
+kill "$(cat "$BIN_DIR/.resmgr.pid" 2>/dev/null)" 2>/dev/null || true
+rm -f "$BIN_DIR/.resmgr.pid"
+pass "resmgr -w status"
+
+# resource manager: rt_pool workers (-p)
+( "$BIN_DIR/resmgr" -p 2 >/dev/null 2>&1 & echo $! > "$BIN_DIR/.resmgr.pid" ) || true
+sleep 0.2
+"$BIN_DIR/resmgr_client" "STATUS" 2>/dev/null | grep -q "STATUS" || fail "resmgr -p"
+kill "$(cat "$BIN_DIR/.resmgr.pid" 2>/dev/null)" 2>/dev/null || true
+rm -f "$BIN_DIR/.resmgr.pid"
+pass "resmgr -p status"
+
 printf "[tests] all tests passed\n"
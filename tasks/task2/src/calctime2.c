@@ -23,33 +23,27 @@
 #include <errno.h>
 #include <stdint.h>
 #include <inttypes.h>
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include "rt_stats.h"
+#include "rt_time.h"
 
-#define BILLION 1000000000LL
-#define MILLION 1000000LL
 #define NUM_SAMPLES 5000 // 5000 * 2 ms ≈ 10 секунд эксперимента 
-
-static inline int64_t timespec_to_ns(const struct timespec *ts) {
-    return (int64_t)ts->tv_sec * BILLION + (int64_t)ts->tv_nsec;
-}
-
-static inline void ns_to_timespec(int64_t ns, struct timespec *ts) {
-    ts->tv_sec = (time_t)(ns / BILLION);
-    ts->tv_nsec = (long)(ns % BILLION);
-}
+#define FIRST_SAMPLES 10 // Сколько первых дельт вывести для наглядности
 
 #ifdef __linux__
 int main(void) {
     struct timespec res_rt = {0}, res_mono = {0};
     struct timespec t_next = {0}, now = {0}, prev = {0};
-    const int64_t period_ns = 2 * MILLION; // 2 ms 
-    int64_t deltas_ns[NUM_SAMPLES];
+    const int64_t period_ns = 2 * RT_NSEC_PER_MSEC; // 2 ms 
+    int64_t first_ns[FIRST_SAMPLES + 1];
+    RtHistogram deltas;
     int samples = 0;
 
+    rt_hist_init(&deltas);
+
     setvbuf(stdout, NULL, _IOLBF, 0);
 
     if (clock_getres(CLOCK_REALTIME, &res_rt) != 0) {
@@ -70,10 +64,10 @@ int main(void) {
         return EXIT_FAILURE;
     }
 
-    int64_t next_ns = timespec_to_ns(&prev) + period_ns; /* стартуем через один период */
+    int64_t next_ns = rt_timespec_to_ns(&prev) + period_ns; /* стартуем через один период */
     
     for (samples = 0; samples < NUM_SAMPLES; ++samples) {
-        ns_to_timespec(next_ns, &t_next);
+        rt_ns_to_timespec(next_ns, &t_next);
 
         /* Абсолютный сон до t_next: устойчив к дрейфу */
         int rc;
@@ -92,11 +86,11 @@ int main(void) {
         }
 
         // ПРАВИЛЬНЫЙ расчет дельты: время между последовательными фактическими пробуждениями
-        int64_t now_ns = timespec_to_ns(&now);
-        int64_t prev_ns = timespec_to_ns(&prev);
+        int64_t delta_ns = rt_timespec_diff_ns(&prev, &now);
         
         if (samples > 0) {
-            deltas_ns[samples] = now_ns - prev_ns;
+            rt_hist_record(&deltas, delta_ns);
+            if (samples <= FIRST_SAMPLES) first_ns[samples] = delta_ns;
         }
         
         // Сохраняем текущее время как предыдущее для следующей итерации
@@ -106,32 +100,17 @@ int main(void) {
         next_ns += period_ns;
     }
 
-    /* Статистика (исключаем sample 0, так как у него нет предыдущего значения) */
-    int64_t min_ns = INT64_MAX, max_ns = INT64_MIN, sum_ns = 0;
-    int valid_samples = NUM_SAMPLES - 1;
-    
-    for (int i = 1; i < NUM_SAMPLES; ++i) {
-        if (deltas_ns[i] < min_ns) min_ns = deltas_ns[i];
-        if (deltas_ns[i] > max_ns) max_ns = deltas_ns[i];
-        sum_ns += deltas_ns[i];
-    }
-    double avg_ns = (double)sum_ns / (double)valid_samples;
-
-    // Расчет стандартного отклонения для оценки стабильности периода
-    double sum_sq_diff = 0;
-    for (int i = 1; i < NUM_SAMPLES; ++i) {
-        sum_sq_diff += pow((double)deltas_ns[i] - avg_ns, 2);
-    }
-    double std_dev_ns = sqrt(sum_sq_diff / valid_samples);
-
-    printf("Period stats over %d samples (target: %" PRId64 " ns):\n", valid_samples, period_ns);
+    /* Статистика (sample 0 не записан, так как у него нет предыдущего значения) */
+    printf("Period stats over %" PRIu64 " samples (target: %" PRId64 " ns):\n", deltas.total, period_ns);
     printf("  min=%" PRId64 " ns, avg=%.1f ns, max=%" PRId64 " ns, std_dev=%.1f ns\n",
-           min_ns, avg_ns, max_ns, std_dev_ns);
+           deltas.min, rt_hist_mean(&deltas), deltas.max, rt_hist_stddev(&deltas));
+    printf("  p50=%" PRId64 " ns, p99=%" PRId64 " ns\n",
+           rt_hist_percentile(&deltas, 50.0), rt_hist_percentile(&deltas, 99.0));
 
     /* Вывести первые несколько измерений для наглядности */
-    printf("\nFirst 10 samples (delta from previous actual wakeup, ns):\n");
-    for (int i = 1; i < 11 && i < NUM_SAMPLES; ++i) {
-        printf("  sample %d: %" PRId64 "\n", i, deltas_ns[i]);
+    printf("\nFirst %d samples (delta from previous actual wakeup, ns):\n", FIRST_SAMPLES);
+    for (int i = 1; i <= FIRST_SAMPLES && i < NUM_SAMPLES; ++i) {
+        printf("  sample %d: %" PRId64 "\n", i, first_ns[i]);
     }
 
     return EXIT_SUCCESS;
@@ -47,14 +47,19 @@
 #define _POSIX_C_SOURCE 200809L
 #include <errno.h>
 #include <inttypes.h>
-#include <pthread.h>
 #include <sched.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
+#include "rt_clock.h"
+#include "rt_init.h"
+#include "rt_sleep.h"
+#include "rt_stats.h"
+#include "rt_time.h"
+#include "rt_watchdog.h"
 
 #ifndef __linux__
 int main(void) {
@@ -63,96 +68,166 @@ int main(void) {
 }
 #else
 
-static int compare_i64(const void *a, const void *b) {
-    int64_t va = *(const int64_t *)a;
-    int64_t vb = *(const int64_t *)b;
-    if (va < vb) return -1;
-    if (va > vb) return 1;
-    return 0;
-}
+static volatile sig_atomic_t stop_requested = 0;
 
-static inline int64_t ts_to_ns(const struct timespec *ts) {
-    return (int64_t)ts->tv_sec * 1000000000LL + (int64_t)ts->tv_nsec;
-}
-static inline void ns_to_ts(int64_t ns, struct timespec *ts) {
-    ts->tv_sec = (time_t)(ns / 1000000000LL);
-    ts->tv_nsec = (long)(ns % 1000000000LL);
+// Отметки цикла для сторожа: где поток был, когда пропал пульс
+enum { CP_SLEEP, CP_RECORD };
+static const char* const checkpoint_names[] = {"sleep", "record"};
+
+static void on_sigint(int sig) {
+    (void)sig;
+    stop_requested = 1;
 }
 
-int main(void) {
-    setvbuf(stdout, NULL, _IOLBF, 0);
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-p period_us] [-n samples] [-m plain|hybrid|spin] [-s margin_us] [-w timeout_us]\n"
+                    "  -n 0 runs until Ctrl+C (soak test, constant memory)\n"
+                    "  -m hybrid sleeps until margin before the release, then spins\n"
+                    "  -w watchdog: report cycles silent longer than timeout_us\n", prog);
+}
 
-    // 1. Переключение планировщика на SCHED_FIFO
-    struct sched_param sp = {.sched_priority = 50};
-    if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
-        perror("WARNING: sched_setscheduler failed; continuing with default scheduler");
-    } else {
-        printf("Switched to SCHED_FIFO priority %d\n", sp.sched_priority);
+int main(int argc, char *argv[]) {
+    int64_t period = 2 * RT_NSEC_PER_MSEC; /* 2ms */
+    long long samples = 5000;
+    RtSleepPolicy policy = {.mode = RT_SLEEP_PLAIN, .margin_ns = 100 * RT_NSEC_PER_USEC};
+    int64_t watchdog_timeout = 0;
+    int mode;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:m:s:w:")) != -1) {
+        switch (opt) {
+        case 'p': period = atoll(optarg) * RT_NSEC_PER_USEC; break;
+        case 'n': samples = atoll(optarg); break;
+        case 'm':
+            if ((mode = rt_sleep_parse_mode(optarg)) < 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            policy.mode = (RtSleepMode)mode;
+            break;
+        case 's': policy.margin_ns = atoll(optarg) * RT_NSEC_PER_USEC; break;
+        case 'w': watchdog_timeout = atoll(optarg) * RT_NSEC_PER_USEC; break;
+        default: usage(argv[0]); return EXIT_FAILURE;
+        }
     }
-
-    // 2. Блокировка памяти
-    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
-        perror("WARNING: mlockall failed");
+    if (period <= 0 || samples < 0 || policy.margin_ns < 0 || watchdog_timeout < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
     }
 
-    // 3. Привязка к ядру CPU
+    // Ctrl+C завершает измерение и печатает накопленную статистику
+    struct sigaction sa = {.sa_handler = on_sigint};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    // SCHED_FIFO, блокировка и прогрев памяти, привязка к последнему ядру.
+    // Что не удалось (нет прав) - предупреждение в отчете, замер идет дальше
+    RtInitConfig init;
+    rt_init_config_default(&init);
     long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
-    if (n_cpus > 0) {
-        cpu_set_t cpu_set;
-        CPU_ZERO(&cpu_set);
-        CPU_SET(n_cpus - 1, &cpu_set);
-        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
-            perror("WARNING: pthread_setaffinity_np failed");
-        } else {
-            printf("Pinned thread to CPU %ld\n", n_cpus - 1);
+    init.cpu = n_cpus > 0 ? (int)n_cpus - 1 : -1;
+    RtInitReport report;
+    if (rt_init(&init, &report) != 0) fprintf(stderr, "WARNING: not all RT settings applied\n");
+    rt_init_print_report(stdout, &report);
+
+    rt_clock_init();
+    printf("Clock source: %s\n", rt_clock_source());
+
+    // Сторож на приоритет выше цикла: он должен просыпаться, даже когда цикл
+    // занял ядро. Пульс стоит циклу одной записи в память
+    RtWatchdog* watchdog = NULL;
+    RtHeartbeat* hb = NULL;
+    if (watchdog_timeout > 0) {
+        RtWatchdogConfig wd_cfg;
+        rt_watchdog_config_default(&wd_cfg);
+        wd_cfg.priority = init.priority < 99 ? init.priority + 1 : 99;
+        wd_cfg.cpu = init.cpu;
+        RtWatchdogTarget target = {
+            .name = "jitter loop",
+            .period_ns = period,
+            .timeout_ns = watchdog_timeout,
+            .checkpoint_names = checkpoint_names,
+            .checkpoint_count = 2,
+        };
+        watchdog = rt_watchdog_create(&wd_cfg);
+        int id = watchdog ? rt_watchdog_add(watchdog, &target) : -1;
+        if (id < 0 || rt_watchdog_start(watchdog) != 0) {
+            perror("watchdog");
+            return EXIT_FAILURE;
         }
+        hb = rt_watchdog_heartbeat(watchdog, id);
     }
-    
 
-    const int64_t period = 2 * 1000000LL; /* 2ms */
-    const int samples = 5000;
-    int64_t deltas[samples]; // Store all deltas for percentile calculation
+    // Гистограмма фиксированного размера: длина прогона не ограничена памятью
+    RtHistogram jitter;
+    rt_hist_init(&jitter);
 
     struct timespec next;
-    clock_gettime(CLOCK_MONOTONIC, &next);
-    int64_t next_ns = ts_to_ns(&next) + period;
-
-    for (int i = 0; i < samples; ++i) {
-        ns_to_ts(next_ns, &next);
-        int rc;
-        // Absolute wait is crucial to prevent period drift.
-        do {
-            rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
-        } while (rc == EINTR);
-        if (rc != 0) {
-            fprintf(stderr, "clock_nanosleep: %s\n", strerror(rc));
-            return EXIT_FAILURE;
+    int64_t spin_ns = 0;
+    int64_t start_ns = rt_now_ns();
+    int64_t start_cpu_ns = rt_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    int64_t next_ns = start_ns + period;
+
+    for (long long i = 0; (samples == 0 || i < samples) && !stop_requested; ++i) {
+        if (hb) rt_heartbeat(hb, CP_SLEEP);
+        if (policy.mode != RT_SLEEP_PLAIN) {
+            // Гибрид/спин: ядро занято до момента выпуска, зато нет задержки пробуждения
+            spin_ns += rt_sleep_until(&policy, next_ns);
+        } else {
+            rt_ns_to_timespec(next_ns, &next);
+            int rc;
+            // Absolute wait is crucial to prevent period drift.
+            do {
+                rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            } while (rc == EINTR && !stop_requested);
+            if (rc != 0 && !stop_requested) {
+                fprintf(stderr, "clock_nanosleep: %s\n", strerror(rc));
+                return EXIT_FAILURE;
+            }
         }
+        if (stop_requested) break;
+        if (hb) rt_heartbeat(hb, CP_RECORD);
 
-        struct timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
         // The "error" or "jitter" for this cycle.
         // It's the difference between when we woke up and when we *should* have.
-        deltas[i] = ts_to_ns(&now) - next_ns;
+        rt_hist_record(&jitter, rt_clock_now_ns() - next_ns);
         next_ns += period;
     }
 
+    double wall_ns = (double)(rt_now_ns() - start_ns);
+    double cpu_ns = (double)(rt_clock_ns(CLOCK_THREAD_CPUTIME_ID) - start_cpu_ns);
+    if (watchdog) rt_watchdog_stop(watchdog);
+
     // --- Statistics ---
-    qsort(deltas, samples, sizeof(int64_t), compare_i64);
-    int64_t min = deltas[0];
-    int64_t max = deltas[samples - 1];
-    int64_t p99 = deltas[(samples * 99) / 100];
-    int64_t sum = 0;
-    for (int i = 0; i < samples; ++i) {
-        sum += deltas[i];
+    printf("\nJitter statistics over %" PRIu64 " samples (%" PRId64 " us period, %s wait",
+           jitter.total, (int64_t)(period / RT_NSEC_PER_USEC), rt_sleep_mode_name(policy.mode));
+    if (policy.mode == RT_SLEEP_HYBRID) {
+        printf(", margin %" PRId64 " us", (int64_t)(policy.margin_ns / RT_NSEC_PER_USEC));
+    }
+    printf("):\n");
+    printf("  min latency: %" PRId64 " ns\n", jitter.total ? jitter.min : 0);
+    printf("  avg latency: %.1f ns (stddev %.1f ns)\n", rt_hist_mean(&jitter), rt_hist_stddev(&jitter));
+    printf("  50th percentile: %" PRId64 " ns\n", rt_hist_percentile(&jitter, 50.0));
+    printf("  99th percentile: %" PRId64 " ns\n", rt_hist_percentile(&jitter, 99.0));
+    printf("  99.9th percentile: %" PRId64 " ns\n", rt_hist_percentile(&jitter, 99.9));
+    printf("  99.99th percentile: %" PRId64 " ns\n", rt_hist_percentile(&jitter, 99.99));
+    printf("  max latency: %" PRId64 " ns\n", jitter.total ? jitter.max : 0);
+    printf("  CPU busy: %.1f%% of wall time (spinning %.1f%%)\n",
+           wall_ns > 0 ? cpu_ns * 100.0 / wall_ns : 0.0, wall_ns > 0 ? spin_ns * 100.0 / wall_ns : 0.0);
+
+    // События журнала печатаются только после замера: вывод не мешает циклу
+    if (watchdog) {
+        RtWatchdogEvent ev;
+        char line[160];
+        printf("\n");
+        while (rt_watchdog_pop_event(watchdog, &ev) == 0) {
+            rt_watchdog_format_event(watchdog, &ev, line, sizeof(line));
+            printf("%s\n", line);
+        }
+        rt_watchdog_print_stats(stdout, watchdog);
+        rt_watchdog_destroy(watchdog);
     }
-    double avg = (double)sum / (double)samples;
-
-    printf("\nJitter statistics over %d samples (2ms period):\n", samples);
-    printf("  min latency: %" PRId64 " ns\n", min);
-    printf("  avg latency: %.1f ns\n", avg);
-    printf("  99th percentile: %" PRId64 " ns\n", p99);
-    printf("  max latency: %" PRId64 " ns\n", max);
 
     return 0;
 }
@@ -0,0 +1,305 @@
+/*
+ * Точность и стоимость ожидания с таймаутом на разных примитивах.
+ *
+ * Для каждого примитива из timeout_*.c три замера:
+ *   - timeout: ожидание без события до дедлайна через -t мкс; опоздание
+ *     пробуждения относительно дедлайна (раньше дедлайна - ошибка);
+ *   - wake: второй поток через -g мкс подает событие; задержка от подачи
+ *     до возврата из ожидания;
+ *   - call: вызов с уже прошедшим дедлайном - стоимость самого пути
+ *     ожидания без сна (системный вызов, перевод часов).
+ *
+ * Варианты rt_wait.h (дедлайн по CLOCK_MONOTONIC) идут рядом с обычными:
+ * condvar и mq_timedreceive по CLOCK_REALTIME и poll с таймаутом в мс.
+ * Последний показывает округление вверх до миллисекунды: при -t, не
+ * кратном 1000, p50 опоздания у него - остаток до целой мс.
+ *
+ * Запуск: timeout_bench [-n iterations] [-t timeout_us] [-g gap_us] [-f fifo_prio]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <mqueue.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_init.h"
+#include "rt_stats.h"
+#include "rt_time.h"
+#include "rt_wait.h"
+
+static const char* QNAME = "/rt_timeout_bench_mq";
+
+typedef struct {
+    pthread_mutex_t mtx;
+    pthread_cond_t cv_mono;     // rt_cond_init_monotonic
+    pthread_cond_t cv_real;     // По умолчанию, CLOCK_REALTIME
+    int flag;
+    int pipe_fd[2];
+    mqd_t mq;
+    sem_t ready;                // Ожидающий вошел в цикл - можно подавать событие
+    _Atomic int64_t signal_ns;  // Момент подачи события
+} Bench;
+
+typedef struct {
+    const char* name;
+    int (*wait)(Bench* b, int64_t deadline_ns);  // 1 - событие, 0 - дедлайн
+    void (*signal)(Bench* b);
+} Primitive;
+
+// Дедлайн по CLOCK_MONOTONIC -> тот же момент по CLOCK_REALTIME на сейчас
+static void realtime_deadline(int64_t deadline_ns, struct timespec* ts) {
+    int64_t real = deadline_ns - rt_now_ns() + rt_clock_ns(CLOCK_REALTIME);
+    rt_ns_to_timespec(real, ts);
+}
+
+static int cond_wait(Bench* b, pthread_cond_t* cv, int monotonic, int64_t deadline_ns) {
+    struct timespec ts;
+    if (!monotonic) realtime_deadline(deadline_ns, &ts);
+    pthread_mutex_lock(&b->mtx);
+    int rc = 0;
+    while (!b->flag && rc != ETIMEDOUT) {
+        rc = monotonic ? rt_cond_wait_until(cv, &b->mtx, deadline_ns) : pthread_cond_timedwait(cv, &b->mtx, &ts);
+    }
+    int got = b->flag;
+    b->flag = 0;
+    pthread_mutex_unlock(&b->mtx);
+    return got;
+}
+
+static int cond_mono_wait(Bench* b, int64_t deadline_ns) { return cond_wait(b, &b->cv_mono, 1, deadline_ns); }
+static int cond_real_wait(Bench* b, int64_t deadline_ns) { return cond_wait(b, &b->cv_real, 0, deadline_ns); }
+
+static void cond_signal(Bench* b, pthread_cond_t* cv) {
+    pthread_mutex_lock(&b->mtx);
+    b->flag = 1;
+    atomic_store(&b->signal_ns, rt_now_ns());
+    pthread_cond_signal(cv);
+    pthread_mutex_unlock(&b->mtx);
+}
+
+static void cond_mono_signal(Bench* b) { cond_signal(b, &b->cv_mono); }
+static void cond_real_signal(Bench* b) { cond_signal(b, &b->cv_real); }
+
+static int pipe_read(Bench* b) {
+    char ch;
+    return read(b->pipe_fd[0], &ch, 1) == 1;
+}
+
+static int poll_ms_wait(Bench* b, int64_t deadline_ns) {
+    struct pollfd pfd = {.fd = b->pipe_fd[0], .events = POLLIN};
+    int rc;
+    do {
+        int64_t left = deadline_ns - rt_now_ns();
+        int ms = left > 0 ? (int)((left + RT_NSEC_PER_MSEC - 1) / RT_NSEC_PER_MSEC) : 0;
+        rc = poll(&pfd, 1, ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc > 0 && pipe_read(b);
+}
+
+static int ppoll_wait(Bench* b, int64_t deadline_ns) {
+    struct pollfd pfd = {.fd = b->pipe_fd[0], .events = POLLIN};
+    int rc;
+    while ((rc = rt_poll_until(&pfd, 1, deadline_ns, NULL)) < 0 && errno == EINTR) {
+    }
+    return rc > 0 && pipe_read(b);
+}
+
+static void pipe_signal(Bench* b) {
+    const char ch = 'X';
+    atomic_store(&b->signal_ns, rt_now_ns());
+    if (write(b->pipe_fd[1], &ch, 1) != 1) perror("write");
+}
+
+static int mq_mono_wait(Bench* b, int64_t deadline_ns) {
+    char buf[8];
+    return rt_mq_receive_until(b->mq, buf, sizeof(buf), NULL, deadline_ns) >= 0;
+}
+
+static int mq_real_wait(Bench* b, int64_t deadline_ns) {
+    char buf[8];
+    struct timespec ts;
+    realtime_deadline(deadline_ns, &ts);
+    ssize_t n;
+    while ((n = mq_timedreceive(b->mq, buf, sizeof(buf), NULL, &ts)) < 0 && errno == EINTR) {
+    }
+    return n >= 0;
+}
+
+static void mq_signal(Bench* b) {
+    atomic_store(&b->signal_ns, rt_now_ns());
+    if (mq_send(b->mq, "x", 1, 0) != 0) perror("mq_send");
+}
+
+static const Primitive primitives[] = {
+    {"condvar monotonic", cond_mono_wait, cond_mono_signal},
+    {"condvar realtime", cond_real_wait, cond_real_signal},
+    {"poll (ms)", poll_ms_wait, pipe_signal},
+    {"ppoll monotonic", ppoll_wait, pipe_signal},
+    {"mq monotonic", mq_mono_wait, mq_signal},
+    {"mq realtime", mq_real_wait, mq_signal},
+};
+
+typedef struct {
+    Bench* bench;
+    const Primitive* prim;
+    long iterations;
+    int64_t gap_ns;
+} SignalerArgs;
+
+static void* signaler(void* arg) {
+    SignalerArgs* a = arg;
+    struct timespec gap;
+    rt_ns_to_timespec(a->gap_ns, &gap);
+    for (long i = 0; i < a->iterations; i++) {
+        while (sem_wait(&a->bench->ready) != 0 && errno == EINTR) {
+        }
+        nanosleep(&gap, NULL);
+        a->prim->signal(a->bench);
+    }
+    return NULL;
+}
+
+static int bench_init(Bench* b) {
+    memset(b, 0, sizeof(*b));
+    pthread_mutex_init(&b->mtx, NULL);
+    int rc = rt_cond_init_monotonic(&b->cv_mono, PTHREAD_PROCESS_PRIVATE);
+    if (rc != 0) {
+        fprintf(stderr, "rt_cond_init_monotonic: %s\n", strerror(rc));
+        return -1;
+    }
+    pthread_cond_init(&b->cv_real, NULL);
+    if (pipe(b->pipe_fd) != 0) {
+        perror("pipe");
+        return -1;
+    }
+    struct mq_attr attr = {.mq_maxmsg = 4, .mq_msgsize = 8};
+    mq_unlink(QNAME);
+    b->mq = mq_open(QNAME, O_CREAT | O_RDWR | O_CLOEXEC, 0600, &attr);
+    if (b->mq == (mqd_t)-1) {
+        perror("mq_open");
+        return -1;
+    }
+    sem_init(&b->ready, 0, 0);
+    return 0;
+}
+
+static void bench_destroy(Bench* b) {
+    sem_destroy(&b->ready);
+    mq_close(b->mq);
+    mq_unlink(QNAME);
+    close(b->pipe_fd[0]);
+    close(b->pipe_fd[1]);
+    pthread_cond_destroy(&b->cv_real);
+    pthread_cond_destroy(&b->cv_mono);
+    pthread_mutex_destroy(&b->mtx);
+}
+
+static void print_us(const RtHistogram* h) {
+    if (h->total == 0) {
+        printf(" %8s %8s %8s |", "-", "-", "-");
+        return;
+    }
+    printf(" %8.1f %8.1f %8.1f |", rt_hist_percentile(h, 50.0) / 1e3, rt_hist_percentile(h, 99.0) / 1e3,
+           h->max / 1e3);
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = 1000;
+    long timeout_us = 1000, gap_us = 200;
+    int prio = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:g:f:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = atol(optarg); break;
+            case 't': timeout_us = atol(optarg); break;
+            case 'g': gap_us = atol(optarg); break;
+            case 'f': prio = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n iterations] [-t timeout_us] [-g gap_us] [-f fifo_prio]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (iterations < 1 || timeout_us < 1 || gap_us < 0) {
+        fprintf(stderr, "iterations and timeout must be positive\n");
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (prio > 0) {
+        // Поток подачи событий наследует политику главного
+        RtInitConfig init;
+        RtInitReport report;
+        rt_init_config_default(&init);
+        init.priority = prio;
+        if (rt_init(&init, &report) != 0) fprintf(stderr, "WARNING: not all RT settings applied\n");
+        rt_init_print_report(stdout, &report);
+    }
+
+    static Bench bench;
+    if (bench_init(&bench) != 0) return 1;
+
+    int64_t timeout_ns = timeout_us * RT_NSEC_PER_USEC;
+    printf("%ld iterations, timeout %ld us, signal gap %ld us; times in us\n", iterations, timeout_us, gap_us);
+    printf("%-18s | %26s | %26s | %9s\n", "", "timeout late p50/p99/max", "wake p50/p99/max", "call ns");
+
+    static RtHistogram late, wake;
+    int failed = 0;
+    for (size_t p = 0; p < sizeof(primitives) / sizeof(primitives[0]); p++) {
+        const Primitive* prim = &primitives[p];
+        rt_hist_init(&late);
+        rt_hist_init(&wake);
+        uint64_t early = 0, missed = 0, spurious = 0;
+
+        // timeout: события нет, просыпаемся по дедлайну
+        for (long i = 0; i < iterations; i++) {
+            int64_t deadline = rt_deadline_after_ns(timeout_ns);
+            if (prim->wait(&bench, deadline)) spurious++;
+            int64_t d = rt_now_ns() - deadline;
+            if (d < 0) early++;
+            rt_hist_record(&late, d);
+        }
+
+        // wake: событие подает второй поток, дедлайн с большим запасом
+        SignalerArgs args = {&bench, prim, iterations, gap_us * RT_NSEC_PER_USEC};
+        pthread_t th;
+        if (pthread_create(&th, NULL, signaler, &args) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+        for (long i = 0; i < iterations; i++) {
+            sem_post(&bench.ready);
+            if (prim->wait(&bench, rt_deadline_after_ns(RT_NSEC_PER_SEC))) {
+                rt_hist_record(&wake, rt_now_ns() - atomic_load(&bench.signal_ns));
+            } else {
+                missed++;
+            }
+        }
+        pthread_join(th, NULL);
+
+        // call: дедлайн уже прошел
+        int64_t start = rt_now_ns();
+        for (long i = 0; i < iterations; i++) prim->wait(&bench, 0);
+        double call_ns = (double)(rt_now_ns() - start) / iterations;
+
+        printf("%-18s |", prim->name);
+        print_us(&late);
+        print_us(&wake);
+        printf(" %9.0f\n", call_ns);
+        if (early || missed || spurious) {
+            printf("  ERROR: %" PRIu64 " woke before deadline, %" PRIu64 " events missed, %" PRIu64
+                   " events without signal\n", early, missed, spurious);
+            failed = 1;
+        }
+    }
+
+    bench_destroy(&bench);
+    return failed;
+}
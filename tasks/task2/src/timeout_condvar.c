@@ -26,7 +26,9 @@
  * Особенности condvar:
  * - Требует мьютекса для защиты разделяемого состояния
  * - Подвержена ложным пробуждениям (spurious wakeups)
- * - Использует абсолютное время для таймаутов
+ * - Использует абсолютное время для таймаутов; по умолчанию это CLOCK_REALTIME,
+ *   и шаг системных часов (NTP) растягивает или обрезает ожидание. Здесь
+ *   condvar создана с CLOCK_MONOTONIC (rt_wait.h), дедлайн - по rt_now_ns()
  * 
  * Сценарии применения condvar:
  * - Производитель-потребитель между потоками
@@ -44,26 +46,13 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "rt_wait.h"
 
 static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+// Инициализируется в main: PTHREAD_COND_INITIALIZER дал бы CLOCK_REALTIME
+static pthread_cond_t cv;
 static int event_ready = 0;
 
-// Вспомогательная функция для расчета абсолютного времени в будущем.
-// pthread_cond_timedwait требует именно АБСОЛЮТНОЕ время.
-static void abs_time_after_ms(struct timespec *ts, int ms) {
-    // Важно использовать CLOCK_REALTIME, так как этого требует стандарт POSIX
-    // для pthread_cond_timedwait.
-    clock_gettime(CLOCK_REALTIME, ts);
-    ts->tv_sec += ms / 1000;
-    long add_ns = (long)(ms % 1000) * 1000000L;
-    ts->tv_nsec += add_ns;
-    if (ts->tv_nsec >= 1000000000L) {
-        ts->tv_sec++;
-        ts->tv_nsec -= 1000000000L;
-    }
-}
-
 // Поток-производитель
 static void *producer(void *arg) {
     (void)arg;
@@ -83,15 +72,21 @@ static void *producer(void *arg) {
 int main(void) {
     setvbuf(stdout, NULL, _IOLBF, 0);
 
+    int rc = rt_cond_init_monotonic(&cv, PTHREAD_PROCESS_PRIVATE);
+    if (rc != 0) {
+        fprintf(stderr, "rt_cond_init_monotonic: %s\n", strerror(rc));
+        return EXIT_FAILURE;
+    }
+
     // --- Сценарий 1: Ожидание завершается по таймауту ---
     printf("[CONSUMER] Doing a timed wait of 100ms, expecting a timeout...\n");
-    struct timespec ts;
     pthread_mutex_lock(&mtx);
-    abs_time_after_ms(&ts, 100);
+    // Дедлайн абсолютный: повтор ожидания не продлевает таймаут
+    int64_t deadline = rt_deadline_after_ms(100);
 
     // pthread_cond_timedwait атомарно разблокирует мьютекс и начинает ждать.
     // Перед возвратом мьютекс снова блокируется.
-    int rc = pthread_cond_timedwait(&cv, &mtx, &ts);
+    rc = rt_cond_wait_until(&cv, &mtx, deadline);
     if (rc == ETIMEDOUT) {
         printf("[CONSUMER] Timed out as expected.\n");
     } else {
@@ -108,11 +103,12 @@ int main(void) {
     }
 
     pthread_mutex_lock(&mtx);
-    abs_time_after_ms(&ts, 1000);
+    deadline = rt_deadline_after_ms(1000);
+    rc = 0;  // ETIMEDOUT из сценария 1 не должен прервать цикл до ожидания
     // Цикл while необходим для обработки "ложных пробуждений" (spurious wakeups),
     // когда поток просыпается без реального сигнала.
     while (!event_ready && rc != ETIMEDOUT) {
-        rc = pthread_cond_timedwait(&cv, &mtx, &ts);
+        rc = rt_cond_wait_until(&cv, &mtx, deadline);
     }
 
     if (event_ready) {
@@ -125,6 +121,7 @@ int main(void) {
     pthread_mutex_unlock(&mtx);
 
     pthread_join(th, NULL);
+    pthread_cond_destroy(&cv);
     return 0;
 }
 
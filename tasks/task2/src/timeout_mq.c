@@ -26,6 +26,9 @@
  * - Поддержка приоритетов сообщений
  * - Сообщения сохраняются при перезапуске процессов
  * - Требует управления системными ресурсами (удаление очередей)
+ * - Срок mq_timedreceive - только по CLOCK_REALTIME. rt_mq_receive_until
+ *   (rt_wait.h) ждет очередь через ppoll на ее дескрипторе до дедлайна по
+ *   CLOCK_MONOTONIC - шаг системных часов на таймаут не влияет
  * 
  * Сценарии применения mq_timedreceive:
  * - Микросервисная архитектура
@@ -44,24 +47,11 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "rt_wait.h"
 
 // Имя очереди должно начинаться со слэша.
 static const char *QNAME = "/rt_timeout_demo_mq";
 
-// Вспомогательная функция для расчета абсолютного времени в будущем.
-// mq_timedreceive, как и pthread_cond_timedwait, требует АБСОЛЮТНОЕ время.
-static void abs_time_after_ms(struct timespec *ts, int ms) {
-    // Важно использовать CLOCK_REALTIME, так как этого требует стандарт POSIX.
-    clock_gettime(CLOCK_REALTIME, ts);
-    ts->tv_sec += ms / 1000;
-    long add_ns = (long)(ms % 1000) * 1000000L;
-    ts->tv_nsec += add_ns;
-    if (ts->tv_nsec >= 1000000000L) {
-        ts->tv_sec++;
-        ts->tv_nsec -= 1000000000L;
-    }
-}
-
 // Поток-отправитель
 static void *sender(void *arg) {
     mqd_t mq = *(mqd_t *)arg;
@@ -92,16 +82,14 @@ int main(void) {
 
     // --- Сценарий 1: Таймаут ---
     printf("[RECEIVER] Waiting for 100ms on an empty queue, expecting timeout...\n");
-    struct timespec ts;
-    abs_time_after_ms(&ts, 100);
     char buf[128];
-    ssize_t n = mq_timedreceive(mq, buf, sizeof(buf), NULL, &ts);
+    ssize_t n = rt_mq_receive_until(mq, buf, sizeof(buf), NULL, rt_deadline_after_ms(100));
     if (n < 0 && errno == ETIMEDOUT) {
         printf("[RECEIVER] Timed out as expected.\n");
     } else if (n >= 0) {
         printf("[RECEIVER] Unexpectedly received message: %s\n", buf);
     } else {
-        perror("[RECEIVER] mq_timedreceive error");
+        perror("[RECEIVER] rt_mq_receive_until error");
     }
 
     // --- Сценарий 2: Успешное получение ---
@@ -114,14 +102,13 @@ int main(void) {
         return EXIT_FAILURE;
     }
 
-    abs_time_after_ms(&ts, 1000);
-    n = mq_timedreceive(mq, buf, sizeof(buf), NULL, &ts);
+    n = rt_mq_receive_until(mq, buf, sizeof(buf), NULL, rt_deadline_after_ms(1000));
     if (n >= 0) {
         printf("[RECEIVER] Successfully received '%s' within timeout.\n", buf);
     } else if (errno == ETIMEDOUT) {
         printf("[RECEIVER] Unexpected timeout.\n");
     } else {
-        perror("[RECEIVER] mq_timedreceive error");
+        perror("[RECEIVER] rt_mq_receive_until error");
     }
 
     pthread_join(th, NULL);
@@ -27,6 +27,11 @@
  * - poll: мультиплексирование множества дескрипторов
  * - mq_timedreceive: специализирован для POSIX очередей сообщений
  * 
+ * Таймаут poll - относительный и в миллисекундах: повтор после EINTR
+ * начинает отсчет заново, а срок округляется вверх до мс. Здесь ожидание
+ * идет через rt_poll_until (rt_wait.h) - ppoll до абсолютного дедлайна по
+ * CLOCK_MONOTONIC с точностью до наносекунды.
+ *
  * Сценарии применения poll:
  * - Сетевые серверы (множественные соединения)
  * - Ожидание данных от множества источников
@@ -44,6 +49,7 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "rt_wait.h"
 
 typedef struct {
     int write_fd;
@@ -85,7 +91,8 @@ int main(void) {
 
     // --- Сценарий 1: Таймаут ---
     printf("[READER] Polling for 300ms, expecting timeout...\n");
-    int rc = poll(&pfd, 1, 300); // 1 - кол-во дескрипторов, 300 - таймаут в мс
+    // 1 - кол-во дескрипторов, дедлайн - через 300 мс
+    int rc = rt_poll_until(&pfd, 1, rt_deadline_after_ms(300), NULL);
 
     if (rc == 0) {
         printf("[READER] poll() timed out as expected.\n");
@@ -106,7 +113,9 @@ int main(void) {
     }
 
     pfd.revents = 0; // Сбрасываем поле возвращенных событий
-    rc = poll(&pfd, 1, 1000);
+    int64_t deadline = rt_deadline_after_ms(1000);
+    while ((rc = rt_poll_until(&pfd, 1, deadline, NULL)) < 0 && errno == EINTR) {
+    }
 
     if (rc == 1 && (pfd.revents & POLLIN)) {
         printf("[READER] poll() detected data. Reading...\n");
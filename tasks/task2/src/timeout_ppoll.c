@@ -49,6 +49,7 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "rt_wait.h"
 
 // Флаг, который будет (безопасно) установлен в обработчике сигнала.
 // volatile - чтобы компилятор не оптимизировал доступ к переменной.
@@ -117,15 +118,15 @@ int main(void) {
     }
 
     // 5. Вызываем ppoll().
-    // Он будет ждать 5 секунд И атомарно заменит текущую маску сигналов
+    // Он будет ждать до дедлайна через 5 секунд (CLOCK_MONOTONIC, rt_wait.h) И атомарно заменит текущую маску сигналов
     // (где SIGUSR1 заблокирован) на original_mask (где он разблокирован).
     // Как только ppoll вернет управление, исходная маска будет восстановлена.
     printf("Calling ppoll() with unblocked signal mask, waiting for signal...\n");
-    struct timespec timeout = {.tv_sec = 5, .tv_nsec = 0};
+    int64_t deadline = rt_deadline_after_ms(5000);
 
     // Это ключевой вызов. Передача `&original_mask` - это то,
     // что отличает ppoll от poll и решает проблему race condition.
-    int rc = ppoll(&pfd, 1, &timeout, &original_mask);
+    int rc = rt_poll_until(&pfd, 1, deadline, &original_mask);
 
     // 6. Анализ результата
     if (rc == -1) {
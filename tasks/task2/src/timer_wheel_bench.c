@@ -0,0 +1,172 @@
+/*
+ * Много таймеров на одном timerfd: колесо таймеров rt_timer_wheel.
+ *
+ * В отличие от reptimer_timerfd.c, где один timerfd - один таймер, здесь
+ * -n таймеров (по умолчанию 100000, как тайм-ауты простоя соединений)
+ * разбросаны по интервалу -d мс и обслуживаются циклом epoll с единственным
+ * timerfd. Часть таймеров до старта отменяется (-c %) и переносится
+ * (-r %), как при продлении тайм-аута по активности клиента.
+ *
+ * По завершении выводятся стоимость постановки/отмены, число пробуждений
+ * цикла и опоздание срабатывания относительно срока. Сравните точный
+ * режим и грубый (-s slack_us): при slack 10 мс пробуждений в разы меньше,
+ * а опоздание не превышает slack + tick.
+ *
+ * Запуск: timer_wheel_bench [-n timers] [-d span_ms] [-t tick_us] [-s slack_us] [-c pct] [-r pct]
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "rt_stats.h"
+#include "rt_time.h"
+#include "rt_timer_wheel.h"
+
+typedef struct {
+    RtTimer timer;
+    int64_t deadline_ns;
+} BenchTimer;
+
+typedef struct {
+    RtHistogram lateness;
+    uint64_t early;         // Сработал раньше срока - ошибка колеса
+    int64_t now_ns;         // Время текущего пробуждения
+} BenchState;
+
+static BenchState state;
+
+static void on_expire(RtTimer* timer, void* arg) {
+    BenchTimer* t = arg;
+    (void)timer;
+    int64_t late = state.now_ns - t->deadline_ns;
+    if (late < 0) {
+        state.early++;
+    } else {
+        rt_hist_record(&state.lateness, late);
+    }
+}
+
+static uint64_t next_random(uint64_t* seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+int main(int argc, char* argv[]) {
+    long n_timers = 100000;
+    int64_t span_ns = 2000 * RT_NSEC_PER_MSEC;
+    int64_t tick_ns = RT_NSEC_PER_MSEC;
+    int64_t slack_ns = 0;
+    int cancel_pct = 10, refresh_pct = 30;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:t:s:c:r:")) != -1) {
+        switch (opt) {
+        case 'n': n_timers = atol(optarg); break;
+        case 'd': span_ns = atol(optarg) * RT_NSEC_PER_MSEC; break;
+        case 't': tick_ns = atol(optarg) * RT_NSEC_PER_USEC; break;
+        case 's': slack_ns = atol(optarg) * RT_NSEC_PER_USEC; break;
+        case 'c': cancel_pct = atoi(optarg); break;
+        case 'r': refresh_pct = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-n timers] [-d span_ms] [-t tick_us] [-s slack_us] [-c pct] [-r pct]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (n_timers <= 0 || span_ns <= 0 || tick_ns <= 0) {
+        fprintf(stderr, "timers, span and tick must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    BenchTimer* timers = calloc((size_t)n_timers, sizeof(BenchTimer));
+    RtTimerWheel* wheel = rt_wheel_create(tick_ns, rt_now_ns());
+    int tfd = rt_wheel_timerfd_create();
+    int epfd = epoll_create1(0);
+    if (!timers || !wheel || tfd == -1 || epfd == -1) {
+        perror("setup");
+        return EXIT_FAILURE;
+    }
+    rt_wheel_set_slack(wheel, slack_ns);
+    struct epoll_event event = {.events = EPOLLIN, .data.fd = tfd};
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event) == -1) {
+        perror("epoll_ctl");
+        return EXIT_FAILURE;
+    }
+    rt_hist_init(&state.lateness);
+
+    // Постановка, отмена и перенос (продление) - стоимость на операцию
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    int64_t start = rt_now_ns();
+    for (long i = 0; i < n_timers; ++i) {
+        rt_timer_init(&timers[i].timer, on_expire, &timers[i]);
+        timers[i].deadline_ns = start + (int64_t)(next_random(&seed) % (uint64_t)span_ns);
+        rt_wheel_schedule(wheel, &timers[i].timer, timers[i].deadline_ns);
+    }
+    int64_t schedule_ns = rt_now_ns() - start;
+
+    long n_cancel = n_timers * cancel_pct / 100;
+    start = rt_now_ns();
+    for (long i = 0; i < n_cancel; ++i) {
+        rt_wheel_cancel(wheel, &timers[next_random(&seed) % (uint64_t)n_timers].timer);
+    }
+    int64_t cancel_ns = rt_now_ns() - start;
+
+    long n_refresh = n_timers * refresh_pct / 100;
+    start = rt_now_ns();
+    for (long i = 0; i < n_refresh; ++i) {
+        BenchTimer* t = &timers[next_random(&seed) % (uint64_t)n_timers];
+        if (!rt_timer_pending(&t->timer)) continue;
+        t->deadline_ns = start + (int64_t)(next_random(&seed) % (uint64_t)span_ns);
+        rt_wheel_schedule(wheel, &t->timer, t->deadline_ns);
+    }
+    int64_t refresh_ns = rt_now_ns() - start;
+
+    RtTimerWheelStats stats;
+    rt_wheel_get_stats(wheel, &stats);
+    size_t expected = stats.pending;
+    printf("%ld timers over %ld ms, tick %ld us, slack %ld us\n", n_timers, (long)(span_ns / RT_NSEC_PER_MSEC),
+           (long)(tick_ns / RT_NSEC_PER_USEC), (long)(slack_ns / RT_NSEC_PER_USEC));
+    printf("schedule %.1f ns, cancel %.1f ns, reschedule %.1f ns per operation; %zu pending\n",
+           (double)schedule_ns / n_timers, n_cancel ? (double)cancel_ns / n_cancel : 0.0,
+           n_refresh ? (double)refresh_ns / n_refresh : 0.0, expected);
+
+    // Цикл событий: единственный источник - timerfd колеса
+    uint64_t wakeups = 0;
+    size_t fired = 0;
+    int64_t loop_start = rt_now_ns();
+    while (rt_wheel_next_expiry(wheel) >= 0) {
+        if (rt_wheel_timerfd_arm(wheel, tfd) == -1) {
+            perror("timerfd_settime");
+            return EXIT_FAILURE;
+        }
+        struct epoll_event ready;
+        int n = epoll_wait(epfd, &ready, 1, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return EXIT_FAILURE;
+        }
+        wakeups++;
+        state.now_ns = rt_now_ns();
+        fired += rt_wheel_timerfd_fire(wheel, tfd, state.now_ns);
+    }
+    int64_t loop_ns = rt_now_ns() - loop_start;
+
+    rt_wheel_get_stats(wheel, &stats);
+    printf("fired %zu of %zu in %.2f s: %" PRIu64 " wakeups (%.1f timers/wakeup), %" PRIu64
+           " timerfd arms, %" PRIu64 " cascades\n",
+           fired, expected, loop_ns / 1e9, wakeups, wakeups ? (double)fired / wakeups : 0.0, stats.timerfd_arms,
+           stats.cascaded);
+    rt_hist_print_summary(stdout, "lateness", &state.lateness);
+    if (state.early) printf("ERROR: %" PRIu64 " timers fired before their deadline\n", state.early);
+
+    close(epfd);
+    close(tfd);
+    rt_wheel_destroy(wheel);
+    free(timers);
+    return (state.early || fired != expected) ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Сравнение эхо-серверов epoll_server -w и uring_server: echo/s и задержка
+# (p50/p99) при 1000 и 10000 соединений. Запуск из tasks/task3 после make.
+#   ./bench_echo.sh [seconds] [msg_size]
+set -e
+SECONDS_PER_RUN=${1:-5}
+MSG_SIZE=${2:-64}
+WORKERS=$(nproc)
+
+run() {
+    name=$1; socket=$2; shift 2
+    "$@" > /dev/null 2>&1 &
+    server=$!
+    sleep 0.5
+    for conns in 1000 10000; do
+        printf '%-22s ' "$name"
+        bin/epoll_load -p "$socket" -c "$conns" -t "$WORKERS" -s "$MSG_SIZE" -d "$SECONDS_PER_RUN" | tr '\n' ' '
+        echo
+    done
+    kill -INT "$server"
+    wait "$server" || true
+}
+
+run "epoll -w $WORKERS" /tmp/epoll_server.sock bin/epoll_server -w "$WORKERS"
+run "io_uring" /tmp/uring_server.sock bin/uring_server
+run "io_uring SQPOLL" /tmp/uring_server.sock bin/uring_server -S
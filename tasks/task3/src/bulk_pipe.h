@@ -0,0 +1,194 @@
+#ifndef BULK_PIPE_H
+#define BULK_PIPE_H
+
+/*
+ * Передача больших объемов через pipe без копирования в ядро и обратно.
+ *
+ * Обычный путь (как в iov_demo.c): writev копирует данные из буферов
+ * процесса в страницы pipe, readv - обратно в буфер читателя, а запись
+ * в файл или сокет - третье копирование. Для дампов в сотни мегабайт
+ * первые два копирования - это почти все процессорное время передачи.
+ *
+ * Здесь:
+ *  - писатель отдает страницы своих буферов в pipe через vmsplice: в
+ *    кольцо pipe попадают ссылки на страницы, а не копии. С
+ *    SPLICE_F_GIFT страницы "подарены": писатель больше не трогает их
+ *    (buffer из bulk_chunk_alloc после отправки только освобождается
+ *    bulk_chunk_free - новый кусок пишется в новые страницы). Без этого
+ *    условия читатель мог бы увидеть данные, переписанные после отправки;
+ *  - читатель перекладывает страницы из pipe в файл или сокет через
+ *    splice, не читая их в свою память.
+ *
+ * Если vmsplice или splice недоступны для этих дескрипторов (stdout не
+ * pipe, файл открыт с O_APPEND, ядро без splice), сторона один раз
+ * переключается на writev/readv и дальше работает копированием;
+ * счетчик fallbacks показывает, что это произошло.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define BULK_COPY_BUF   (256u << 10)    // Буфер читателя на пути readv/write
+#define BULK_PIPE_MAX   "/proc/sys/fs/pipe-max-size"
+
+typedef enum {
+    BULK_COPY,          // writev / readv + write
+    BULK_SPLICE         // vmsplice с подарком страниц / splice
+} bulk_mode_t;
+
+typedef struct {
+    int fd;
+    bulk_mode_t mode;   // Текущий путь: после отката - BULK_COPY
+    uint64_t bytes;
+    uint64_t calls;     // Системных вызовов передачи
+    uint64_t fallbacks;
+    char* copy_buf;     // Читатель на пути копирования
+} bulk_end_t;
+
+static inline const char* bulk_mode_name(bulk_mode_t mode) {
+    return mode == BULK_SPLICE ? "splice" : "copy";
+}
+
+static inline void bulk_end_init(bulk_end_t* e, int fd, bulk_mode_t mode) {
+    e->fd = fd;
+    e->mode = mode;
+    e->bytes = e->calls = e->fallbacks = 0;
+    e->copy_buf = NULL;
+}
+
+static inline void bulk_end_release(bulk_end_t* e) {
+    free(e->copy_buf);
+    e->copy_buf = NULL;
+}
+
+/**
+ * @brief Увеличивает емкость pipe до want (не больше pipe-max-size).
+ *
+ * Кольцо по умолчанию - 16 страниц: при кусках больше 64 КБ каждый
+ * vmsplice ждал бы читателя на середине.
+ *
+ * @return Новая емкость или -1.
+ */
+static inline int bulk_pipe_size(int fd, size_t want) {
+    long max = 0;
+    FILE* f = fopen(BULK_PIPE_MAX, "r");
+    if (f) {
+        if (fscanf(f, "%ld", &max) != 1) max = 0;
+        fclose(f);
+    }
+    if (max > 0 && want > (size_t)max) want = (size_t)max;
+    if (want > INT_MAX) want = INT_MAX;
+    int cur = fcntl(fd, F_GETPIPE_SZ);
+    if (cur < 0 || (size_t)cur >= want) return cur;
+    int rc = fcntl(fd, F_SETPIPE_SZ, (int)want);
+    return rc < 0 ? cur : rc;
+}
+
+// Свежие выровненные страницы под один кусок; MAP_POPULATE - все отказы
+// страниц одним вызовом, а не по одному при заполнении
+static inline void* bulk_chunk_alloc(size_t size) {
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// Страницы, уже отданные в pipe, остаются в нем до прочтения: munmap только снимает отображение
+static inline void bulk_chunk_free(void* p, size_t size) {
+    if (p) munmap(p, size);
+}
+
+// Вызовы, которые говорят "этот дескриптор такой путь не поддерживает"
+static inline int bulk_unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == EBADF;
+}
+
+/**
+ * @brief Отправляет iov целиком. На пути BULK_SPLICE буферы после возврата
+ *        писателю больше не принадлежат (SPLICE_F_GIFT).
+ * @return 0 или -1 с errno.
+ */
+static inline int bulk_sendv(bulk_end_t* e, struct iovec* iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n;
+        if (e->mode == BULK_SPLICE) {
+            n = vmsplice(e->fd, iov, (unsigned long)cnt, SPLICE_F_GIFT);
+            if (n < 0 && bulk_unsupported(errno)) {
+                // Дескриптор не pipe: дальше - обычный writev
+                e->mode = BULK_COPY;
+                e->fallbacks++;
+                continue;
+            }
+        } else {
+            n = writev(e->fd, iov, cnt);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        e->calls++;
+        e->bytes += (uint64_t)n;
+        // Частичная передача: сдвигаем iov на переданное
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+static inline int bulk_write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Перекладывает до max байт из pipe e->fd в out.
+ * @return Передано байт, 0 - конец данных (писатель закрыл pipe), -1 - ошибка.
+ */
+static inline ssize_t bulk_drain(bulk_end_t* e, int out, size_t max) {
+    for (;;) {
+        if (e->mode == BULK_SPLICE) {
+            ssize_t n = splice(e->fd, NULL, out, NULL, max, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n >= 0) {
+                e->calls++;
+                e->bytes += (uint64_t)n;
+                return n;
+            }
+            if (errno == EINTR) continue;
+            if (!bulk_unsupported(errno)) return -1;
+            e->mode = BULK_COPY;
+            e->fallbacks++;
+        }
+        if (!e->copy_buf && !(e->copy_buf = malloc(BULK_COPY_BUF))) return -1;
+        struct iovec iov = {e->copy_buf, max < BULK_COPY_BUF ? max : BULK_COPY_BUF};
+        ssize_t n = readv(e->fd, &iov, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return n;
+        if (bulk_write_all(out, e->copy_buf, (size_t)n) < 0) return -1;
+        e->calls += 2;
+        e->bytes += (uint64_t)n;
+        return n;
+    }
+}
+
+#endif // BULK_PIPE_H
@@ -0,0 +1,342 @@
+/*
+ * Передача дампов через pipe: vmsplice/splice против writev/readv
+ *
+ * Продолжение iov_demo.c для больших объемов (bulk_pipe.h). Три режима:
+ *  - -B (по умолчанию) - сравнение: дочерний процесс пишет -s МБ кусками
+ *    каждого размера из -c в pipe, родитель перекладывает их в приемник
+ *    (-o: null - /dev/null, file - файл во временном каталоге, socket -
+ *    socketpair, который вычитывает третий процесс). Для каждого куска -
+ *    МБ/с и процессорное время писателя и читателя на гигабайт для пути
+ *    копирования и для vmsplice + splice. Содержимое файла проверяется;
+ *  - -S - писатель: синтетический дамп (-s МБ) в stdout, например
+ *    bin/bulk_xfer -S -s 512 | gzip -1 > dump.gz;
+ *  - -R path - читатель: stdin (pipe) в файл path, "-" - в stdout.
+ * -m copy отключает vmsplice/splice; без него они используются, где
+ * дескрипторы это позволяют, иначе - откат на writev/readv.
+ *
+ * Запуск: ./bin/bulk_xfer [-B | -S | -R path] [-c 4K,64K,1M] [-s MB] [-o null,file,socket] [-m splice|copy]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "bulk_pipe.h"
+
+#define MAX_SIZES       16
+#define DEFAULT_CHUNKS  "4K,16K,64K,256K,1M"
+#define DEFAULT_SINKS   "null,file,socket"
+#define DEFAULT_MB      128
+#define PIPE_WANT       (1u << 20)
+#define ARENA_BYTES     (4u << 20)  // Свежие страницы писателя на пути splice
+
+static size_t page_size;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(const struct rusage* ru) {
+    return (uint64_t)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000000ull +
+           (uint64_t)(ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1000ull;
+}
+
+static int parse_size(const char* s, size_t* out) {
+    char* end;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s) return -1;
+    if (*end == 'K' || *end == 'k') v <<= 10, end++;
+    else if (*end == 'M' || *end == 'm') v <<= 20, end++;
+    if (*end != '\0' || v == 0) return -1;
+    *out = (size_t)v;
+    return 0;
+}
+
+// Куски - целые страницы: подарить можно только страницу целиком
+static int parse_chunks(const char* list, size_t* sizes) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", list);
+    int n = 0;
+    for (char* tok = strtok(buf, ","); tok && n < MAX_SIZES; tok = strtok(NULL, ",")) {
+        size_t v;
+        if (parse_size(tok, &v) < 0) return -1;
+        sizes[n++] = (v + page_size - 1) / page_size * page_size;
+    }
+    return n;
+}
+
+/* --- данные: 64-битный счетчик подряд, по нему проверяется порядок --- */
+
+static void fill_chunk(void* buf, size_t len, uint64_t* seq) {
+    uint64_t* w = buf;
+    for (size_t i = 0; i < len / sizeof(uint64_t); ++i) w[i] = (*seq)++;
+}
+
+/**
+ * Пишет total байт в fd кусками chunk. На пути splice куски нарезаются из
+ * свежих страниц арены (mmap на ARENA_BYTES, чтобы не платить mmap/munmap
+ * за каждый кусок); отданные страницы не переписываются - исчерпанная
+ * арена только снимается munmap. На пути копирования - один и тот же
+ * буфер, как в обычном writev.
+ */
+static int produce(int fd, size_t chunk, uint64_t total, bulk_mode_t mode, bulk_end_t* e) {
+    bulk_end_init(e, fd, mode);
+    size_t arena_size = chunk < ARENA_BYTES ? ARENA_BYTES / chunk * chunk : chunk;
+    char* arena = NULL;
+    size_t used = 0;
+    void* reused = NULL;
+    uint64_t seq = 0;
+    for (uint64_t sent = 0; sent < total;) {
+        size_t len = total - sent < chunk ? (size_t)(total - sent) : chunk;
+        void* buf;
+        if (e->mode == BULK_SPLICE) {
+            if (!arena || used == arena_size) {
+                bulk_chunk_free(arena, arena_size);
+                if (!(arena = bulk_chunk_alloc(arena_size))) return -1;
+                used = 0;
+            }
+            buf = arena + used;
+            used += chunk;
+        } else {
+            if (!reused && !(reused = bulk_chunk_alloc(chunk))) return -1;
+            buf = reused;
+        }
+        fill_chunk(buf, len, &seq);
+        struct iovec iov = {buf, len};
+        if (bulk_sendv(e, &iov, 1) < 0) return -1;
+        sent += len;
+    }
+    bulk_chunk_free(arena, arena_size);
+    bulk_chunk_free(reused, chunk);
+    return 0;
+}
+
+static int consume(int in, int out, bulk_mode_t mode, bulk_end_t* e) {
+    bulk_end_init(e, in, mode);
+    ssize_t n;
+    while ((n = bulk_drain(e, out, PIPE_WANT)) > 0) {
+    }
+    bulk_end_release(e);
+    return n < 0 ? -1 : 0;
+}
+
+/* --- одиночные режимы -S и -R --- */
+
+static int run_send(size_t chunk, uint64_t total, bulk_mode_t mode) {
+    bulk_end_t e;
+    bulk_pipe_size(STDOUT_FILENO, PIPE_WANT);
+    if (produce(STDOUT_FILENO, chunk, total, mode, &e) < 0) {
+        perror("bulk_xfer: send");
+        return 1;
+    }
+    fprintf(stderr, "sent %llu bytes via %s in %llu calls%s\n", (unsigned long long)e.bytes,
+            bulk_mode_name(e.mode), (unsigned long long)e.calls, e.fallbacks ? " (fallback to writev)" : "");
+    return 0;
+}
+
+static int run_receive(const char* path, bulk_mode_t mode) {
+    int out = strcmp(path, "-") == 0 ? STDOUT_FILENO : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        perror(path);
+        return 1;
+    }
+    bulk_end_t e;
+    uint64_t t0 = now_ns();
+    if (consume(STDIN_FILENO, out, mode, &e) < 0) {
+        perror("bulk_xfer: receive");
+        return 1;
+    }
+    double s = (now_ns() - t0) / 1e9;
+    fprintf(stderr, "received %llu bytes via %s in %.2f s (%.0f MB/s)%s\n", (unsigned long long)e.bytes,
+            bulk_mode_name(e.mode), s, s > 0 ? e.bytes / 1e6 / s : 0.0, e.fallbacks ? " (fallback to readv)" : "");
+    if (out != STDOUT_FILENO) close(out);
+    return 0;
+}
+
+/* --- сравнение -B --- */
+
+typedef enum { SINK_NULL, SINK_FILE, SINK_SOCKET } sink_kind_t;
+
+static const char* const sink_names[] = {"null", "file", "socket"};
+
+typedef struct {
+    double mb_s;
+    double writer_cpu;      // Секунд процессора на ГБ
+    double reader_cpu;
+    int fallback;
+    int verified;           // 1 - совпало, 0 - нет, -1 - не проверялось
+} run_result_t;
+
+static int open_sink_file(void) {
+    const char* dir = getenv("TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/bulk_xfer_XXXXXX", dir && *dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd >= 0) unlink(path);
+    return fd;
+}
+
+// Файл должен содержать счетчик 0, 1, 2, ... без пропусков
+static int verify_file(int fd, uint64_t total) {
+    static uint64_t buf[8192];
+    uint64_t expect = 0;
+    for (uint64_t off = 0; off < total;) {
+        ssize_t n = pread(fd, buf, sizeof(buf), (off_t)off);
+        if (n <= 0) return 0;
+        for (size_t i = 0; i < (size_t)n / sizeof(uint64_t); ++i) {
+            if (buf[i] != expect++) return 0;
+        }
+        off += (uint64_t)n;
+    }
+    return 1;
+}
+
+// Третий процесс для socket: просто вычитывает и выбрасывает, в обоих режимах одинаково
+static pid_t start_socket_drain(int fds[2]) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        static char buf[1 << 18];
+        while (read(fds[1], buf, sizeof(buf)) > 0) {
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    return pid;
+}
+
+static int run_once(size_t chunk, uint64_t total, sink_kind_t sink, bulk_mode_t mode, run_result_t* r) {
+    int sink_fd = -1, sock[2] = {-1, -1};
+    pid_t drain = -1;
+    if (sink == SINK_NULL) sink_fd = open("/dev/null", O_WRONLY);
+    if (sink == SINK_FILE) sink_fd = open_sink_file();
+    if (sink == SINK_SOCKET && (drain = start_socket_drain(sock)) > 0) sink_fd = sock[0];
+    int p[2];
+    if (sink_fd < 0 || pipe(p) < 0) return -1;
+    // Одинаковая емкость pipe для обоих путей
+    bulk_pipe_size(p[1], PIPE_WANT);
+
+    struct timespec c0, c1;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c0);
+    uint64_t t0 = now_ns();
+    pid_t writer = fork();
+    if (writer == 0) {
+        close(p[0]);
+        bulk_end_t e;
+        int rc = produce(p[1], chunk, total, mode, &e);
+        _exit(rc < 0 ? 1 : e.fallbacks ? 2 : 0);
+    }
+    close(p[1]);
+    bulk_end_t e;
+    int rc = consume(p[0], sink_fd, mode, &e);
+    close(p[0]);
+    int status;
+    struct rusage ru;
+    wait4(writer, &status, 0, &ru);
+    uint64_t elapsed = now_ns() - t0;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c1);
+
+    double gb = total / 1e9;
+    r->mb_s = total / 1e6 / (elapsed / 1e9);
+    r->writer_cpu = cpu_ns(&ru) / 1e9 / gb;
+    r->reader_cpu = ((c1.tv_sec - c0.tv_sec) + (c1.tv_nsec - c0.tv_nsec) / 1e9) / gb;
+    r->fallback = e.fallbacks > 0 || (WIFEXITED(status) && WEXITSTATUS(status) == 2);
+    r->verified = sink == SINK_FILE ? verify_file(sink_fd, total) : -1;
+    if (e.bytes != total || !WIFEXITED(status) || WEXITSTATUS(status) == 1) rc = -1;
+
+    close(sink_fd);
+    if (drain > 0) waitpid(drain, NULL, 0);
+    return rc;
+}
+
+static int run_bench(const size_t* chunks, int nchunks, const char* sinks, uint64_t total, int splice_on) {
+    int pipe_fds[2], pipe_sz = -1;
+    if (pipe(pipe_fds) == 0) {
+        pipe_sz = bulk_pipe_size(pipe_fds[1], PIPE_WANT);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+    }
+    printf("%llu MB per run, pipe %d KB\n", (unsigned long long)(total >> 20), pipe_sz / 1024);
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", sinks);
+    for (char* tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        int sink = -1;
+        for (int k = 0; k < 3; ++k) {
+            if (strcmp(tok, sink_names[k]) == 0) sink = k;
+        }
+        if (sink < 0) {
+            fprintf(stderr, "unknown sink '%s' (null, file, socket)\n", tok);
+            return 1;
+        }
+        printf("\nsink %s\n", sink_names[sink]);
+        printf("%8s | %9s %8s %8s | %9s %8s %8s | %7s\n", "chunk", "copy MB/s", "wr s/GB", "rd s/GB",
+               "splice", "wr s/GB", "rd s/GB", "speedup");
+        for (int i = 0; i < nchunks; ++i) {
+            run_result_t copy, spl = {0};
+            if (run_once(chunks[i], total, (sink_kind_t)sink, BULK_COPY, &copy) < 0 ||
+                (splice_on && run_once(chunks[i], total, (sink_kind_t)sink, BULK_SPLICE, &spl) < 0)) {
+                perror("bulk_xfer: run");
+                return 1;
+            }
+            printf("%7zuK | %9.0f %8.3f %8.3f | ", chunks[i] >> 10, copy.mb_s, copy.writer_cpu, copy.reader_cpu);
+            if (splice_on) {
+                printf("%9.0f %8.3f %8.3f | %6.2fx", spl.mb_s, spl.writer_cpu, spl.reader_cpu, spl.mb_s / copy.mb_s);
+            } else {
+                printf("%9s %8s %8s | %7s", "-", "-", "-", "-");
+            }
+            if (spl.fallback) printf("  (fallback to copy)");
+            if (copy.verified == 0 || spl.verified == 0) printf("  VERIFY FAILED");
+            printf("\n");
+            if (copy.verified == 0 || spl.verified == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const char* chunk_list = DEFAULT_CHUNKS;
+    const char* sinks = DEFAULT_SINKS;
+    const char* receive_path = NULL;
+    uint64_t total = (uint64_t)DEFAULT_MB << 20;
+    bulk_mode_t mode = BULK_SPLICE;
+    int send = 0, chunk_given = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "BSR:c:s:o:m:")) != -1) {
+        switch (opt) {
+            case 'B': send = 0; receive_path = NULL; break;
+            case 'S': send = 1; break;
+            case 'R': receive_path = optarg; break;
+            case 'c': chunk_list = optarg; chunk_given = 1; break;
+            case 's': total = (uint64_t)strtoull(optarg, NULL, 10) << 20; break;
+            case 'o': sinks = optarg; break;
+            case 'm': mode = strcmp(optarg, "copy") == 0 ? BULK_COPY : BULK_SPLICE; break;
+            default:
+                fprintf(stderr,
+                        "Usage: %s [-B | -S | -R path] [-c 4K,64K,1M] [-s MB] [-o null,file,socket] [-m splice|copy]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    size_t chunks[MAX_SIZES];
+    int nchunks = parse_chunks(chunk_list, chunks);
+    if (nchunks <= 0 || total == 0) {
+        fprintf(stderr, "bad chunk list or size\n");
+        return 1;
+    }
+    if (receive_path) return run_receive(receive_path, mode);
+    // Без -c писатель шлет кусками по мегабайту
+    if (send) return run_send(chunk_given ? chunks[0] : PIPE_WANT, total, mode);
+    return run_bench(chunks, nchunks, sinks, total, mode == BULK_SPLICE);
+}
@@ -8,4 +8,29 @@
 #define MSG_PRIO_NORMAL     1
 #define MSG_PRIO_HIGH       10
 
+/*
+ * Пакетный режим (posix_mq_server -b, mq_bench): каждый запрос начинается
+ * с заголовка, в котором клиент называет свою очередь ответов. Сервер
+ * держит открытые дескрипторы очередей клиентов и отвечает в нужную.
+ */
+#include <stdint.h>
+
+#define CLIENT_QUEUE_PREFIX "/mq_client_ex_"
+#define REPLY_NAME_MAX      32
+#define MQ_FLAG_BYE         1u  // Клиент уходит: закрыть его дескриптор, не отвечать
+#define MQ_FLAG_REJECTED    2u  // В ответе: очередь класса переполнена, запрос не выполнен
+
+typedef struct {
+    char reply_to[REPLY_NAME_MAX];  // Имя очереди ответов, начинается с CLIENT_QUEUE_PREFIX
+    uint32_t flags;
+    uint32_t len;                   // Байт данных после заголовка
+    uint32_t work_us;               // Имитация обработки: столько сервер занят запросом
+    uint32_t reserved;
+    uint64_t seq;
+    int64_t sent_ns;                // Для замера задержки клиентом, сервер не трогает
+    char data[];
+} mq_request_t;
+
+#define MQ_DATA_MAX (MAX_MSG_SIZE - sizeof(mq_request_t))
+
 #endif // COMMON_H
@@ -0,0 +1,230 @@
+/*
+ * Нагрузочный клиент для epoll_server -w N
+ *
+ * -t потоков держат в сумме -c соединений. Каждый поток по кругу пишет
+ * в каждое свое соединение сообщение размером -s байт и дочитывает эхо
+ * (одно сообщение "в полете" на соединение). Через -d секунд печатаются
+ * пропускная способность, число эхо-ответов в секунду и задержка от
+ * записи сообщения до прихода эха целиком (p50/p99/max).
+ *
+ * -p - путь сокета: так же нагружается uring_server (/tmp/uring_server.sock).
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_stats.h"
+
+#define SOCKET_PATH "/tmp/epoll_server.sock"
+#define MAX_THREADS 64
+#define MAX_SAMPLES (1u << 20)  // Замеров задержки на поток; дальше - случайная замена
+
+typedef struct {
+    pthread_t thread;
+    int n_conns;
+    size_t msg_size;
+    uint64_t bytes;
+    uint64_t messages;
+    uint64_t* samples;  // Задержки, нс
+    size_t n_samples;
+    int failed;
+} load_thread_t;
+
+static atomic_int stop = 0;
+static const char* socket_path = SOCKET_PATH;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void record_sample(load_thread_t* t, uint64_t ns, unsigned* seed) {
+    if (t->n_samples < MAX_SAMPLES) {
+        t->samples[t->n_samples++] = ns;
+        return;
+    }
+    // Reservoir sampling: выборка остается равномерной по всему прогону
+    *seed = *seed * 1103515245u + 12345u;
+    uint64_t slot = ((uint64_t)*seed << 16 | (*seed >> 16)) % t->messages;
+    if (slot < MAX_SAMPLES) t->samples[slot] = ns;
+}
+
+static void raise_nofile_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static int connect_server(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n == 0) return -1;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void* load_main(void* arg) {
+    load_thread_t* t = arg;
+    int* fds = calloc((size_t)t->n_conns, sizeof(int));
+    uint64_t* sent_at = calloc((size_t)t->n_conns, sizeof(uint64_t));
+    char* out = malloc(t->msg_size);
+    char* in = malloc(t->msg_size);
+    unsigned seed = (unsigned)(uintptr_t)t;
+    t->samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+    if (!fds || !sent_at || !out || !in || !t->samples) {
+        t->failed = 1;
+        goto out;
+    }
+    memset(out, 'x', t->msg_size);
+    for (int i = 0; i < t->n_conns; ++i) {
+        if ((fds[i] = connect_server()) == -1) {
+            perror("connect");
+            t->n_conns = i;
+            t->failed = 1;
+            goto out;
+        }
+    }
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        for (int i = 0; i < t->n_conns; ++i) {
+            sent_at[i] = now_ns();
+            if (write_all(fds[i], out, t->msg_size) == -1) {
+                t->failed = 1;
+                goto out;
+            }
+        }
+        for (int i = 0; i < t->n_conns; ++i) {
+            if (read_all(fds[i], in, t->msg_size) == -1) {
+                t->failed = 1;
+                goto out;
+            }
+            t->messages++;
+            record_sample(t, now_ns() - sent_at[i], &seed);
+        }
+        t->bytes += (uint64_t)t->n_conns * t->msg_size;
+    }
+
+out:
+    for (int i = 0; fds && i < t->n_conns; ++i) close(fds[i]);
+    free(fds);
+    free(sent_at);
+    free(out);
+    free(in);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int n_conns = 64, n_threads = 1, seconds = 5;
+    size_t msg_size = 1024;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:s:d:p:")) != -1) {
+        switch (opt) {
+        case 'c': n_conns = atoi(optarg); break;
+        case 't': n_threads = atoi(optarg); break;
+        case 's': msg_size = (size_t)atol(optarg); break;
+        case 'd': seconds = atoi(optarg); break;
+        case 'p': socket_path = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-c connections] [-t threads] [-s msg_size] [-d seconds] [-p socket]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (n_threads < 1 || n_threads > MAX_THREADS || n_conns < n_threads || msg_size == 0) {
+        fprintf(stderr, "threads must be 1..%d, connections >= threads, msg_size > 0\n", MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    raise_nofile_limit();
+
+    static load_thread_t threads[MAX_THREADS];
+    for (int i = 0; i < n_threads; ++i) {
+        threads[i].n_conns = n_conns / n_threads + (i < n_conns % n_threads);
+        threads[i].msg_size = msg_size;
+        if (pthread_create(&threads[i].thread, NULL, load_main, &threads[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sleep((unsigned)seconds);
+    atomic_store(&stop, 1);
+
+    uint64_t bytes = 0, messages = 0;
+    size_t n_samples = 0;
+    int failed = 0;
+    for (int i = 0; i < n_threads; ++i) {
+        pthread_join(threads[i].thread, NULL);
+        bytes += threads[i].bytes;
+        messages += threads[i].messages;
+        n_samples += threads[i].n_samples;
+        failed |= threads[i].failed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    uint64_t* all = malloc((n_samples ? n_samples : 1) * sizeof(uint64_t));
+    size_t pos = 0;
+    for (int i = 0; i < n_threads; ++i) {
+        if (all && threads[i].samples) memcpy(all + pos, threads[i].samples, threads[i].n_samples * sizeof(uint64_t));
+        pos += threads[i].n_samples;
+        free(threads[i].samples);
+    }
+    printf("%d connections, %d threads, %zu-byte messages: %.0f echo/s, %.1f MB/s%s\n", n_conns, n_threads,
+           msg_size, messages / elapsed, bytes / elapsed / 1e6, failed ? " (errors)" : "");
+    if (all && n_samples > 0) {
+        static const double pct[] = {50.0, 99.0, 100.0};
+        int64_t q[3];
+        rt_stats_percentiles((int64_t*)all, n_samples, pct, 3, q);
+        printf("latency, us: p50 %.1f, p99 %.1f, max %.1f\n", q[0] / 1e3, q[1] / 1e3, q[2] / 1e3);
+    }
+    free(all);
+    return failed ? EXIT_FAILURE : 0;
+}
@@ -6,6 +6,27 @@
  *  - Сокеты подключенных клиентов для чтения данных.
  *  - eventfd для внутренних уведомлений (например, от других потоков).
  *  - Корректная обработка отключения клиента.
+ *
+ * Режим -w N: эхо-сервер из N рабочих потоков, у каждого свой epoll,
+ * поток закреплен за ядром. Слушающий сокет добавлен во все epoll с
+ * EPOLLEXCLUSIVE: о новом подключении ядро будит один поток, а не все
+ * (SO_REUSEPORT для UNIX-сокетов не работает). Соединение живет в потоке,
+ * который его принял. На горячем пути нет вывода: статистику раз в
+ * секунду печатает главный поток.
+ *
+ * Эхо в обоих режимах идет через очередь вывода соединения: данные
+ * читаются прямо в блоки из MemoryPool потока (task5), очередь
+ * отправляется одним writev по цепочке iovec (как в iov_demo.c).
+ * EPOLLOUT зарегистрирован, только пока очередь не пуста. Когда в очереди
+ * больше CONN_HIGH_WATER байт, соединение перестает читать, пока клиент
+ * не заберет ответ: память ограничена, медленный клиент данных не теряет.
+ * После EOF от клиента чтение прекращается, а соединение закрывается,
+ * когда очередь отправлена (или запись не удалась).
+ *
+ * -i idle_ms: соединение, от которого столько времени не пришло данных,
+ * закрывается. Тайм-ауты всех соединений потока живут в одном колесе
+ * таймеров (common/rt_timer_wheel) на одном timerfd в том же epoll:
+ * продление при чтении - O(1) перестановка в списке, без системных вызовов.
  */
 #define _GNU_SOURCE
 #include <stdio.h>
@@ -14,17 +35,101 @@
 #include <unistd.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/eventfd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include "mempool.h"
+#include "rt_time.h"
+#include "rt_timer_wheel.h"
 
 #define MAX_EVENTS 10
 #define SOCKET_PATH "/tmp/epoll_server.sock"
-#define READ_BUFFER_SIZE 256
 
-void add_to_epoll(int epoll_fd, int fd, uint32_t events) {
+#define MAX_WORKERS       64
+#define DEFAULT_BATCH     64        // Событий за один epoll_wait
+#define ACCEPT_BURST      16        // Подключений за одно пробуждение: остальные достанутся другим потокам
+
+#define OUT_BLOCK_SIZE    4096      // Блок очереди вывода вместе с заголовком
+#define OUT_POOL_BLOCKS   8192      // Блоков в пуле потока (32 МБ)
+#define CONN_HIGH_WATER   (64 * 1024) // Байт в очереди, после которых чтение приостанавливается
+#define WRITEV_MAX_IOV    64        // Блоков за один writev
+
+#define IDLE_TICK_NS      RT_NSEC_PER_MSEC // Разрешение колеса тайм-аутов
+#define IDLE_SLACK_DIV    16        // Пробуждения объединяются в окна idle/16: точность тайм-ауту простоя не нужна
+
+// Блок очереди вывода: данные читаются сюда и отсюда же отправляются
+typedef struct out_block {
+    struct out_block* next;
+    uint32_t len;   // Занято байт в data
+    uint32_t off;   // Из них уже отправлено
+    char data[];
+} out_block_t;
+
+#define OUT_BLOCK_DATA (OUT_BLOCK_SIZE - sizeof(out_block_t))
+
+typedef struct conn {
+    int fd;
+    int want_out;           // В epoll зарегистрирован EPOLLOUT
+    int starved;            // Ждет освобождения блоков пула
+    int eof;                // Клиент закрыл запись: дослать очередь и закрыть
+    out_block_t* head;      // Очередь вывода
+    out_block_t* tail;
+    size_t queued;          // Неотправленных байт в очереди
+    struct conn* next_starved;
+    struct conn* prev;      // Список открытых соединений потока
+    struct conn* next;
+    struct worker* owner;
+    RtTimer idle;           // Тайм-аут простоя (-i)
+} conn_t;
+
+// Счетчики пишет только свой поток, главный поток их читает
+typedef struct worker {
+    alignas(64) _Atomic uint64_t accepted;
+    _Atomic uint64_t closed;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t wakeups;
+    _Atomic uint64_t events;
+    _Atomic uint64_t writevs;
+    _Atomic uint64_t paused;    // Сколько раз соединение уперлось в CONN_HIGH_WATER
+    _Atomic uint64_t idle_closed;
+    pthread_t thread;
+    int id;
+    int cpu;
+    int epoll_fd;
+    int verbose;                // Демонстрационный режим: печатать события
+    MemoryPool* pool;
+    conn_t* starved;            // Соединения, которым не хватило блоков
+    conn_t* conns;              // Открытые соединения: закрываются при остановке
+    RtTimerWheel* wheel;        // Тайм-ауты простоя, NULL без -i
+    int timer_fd;
+    int64_t now_ns;             // Время текущего пробуждения: одно clock_gettime на пачку событий
+} worker_t;
+
+static int listen_fd = -1;
+static int stop_fd = -1;
+static int event_fd = -1;
+static int batch_size = DEFAULT_BATCH;
+static int64_t idle_ns = 0;
+// Метки для data.ptr служебных дескрипторов
+static char listen_tag, stop_tag, event_tag, timer_tag;
+static volatile sig_atomic_t done = 0;
+
+static void term(int signum) {
+    (void)signum;
+    done = 1;
+}
+
+void add_to_epoll(int epoll_fd, int fd, uint32_t events, void* ptr) {
     struct epoll_event event;
-    event.data.fd = fd;
+    event.data.ptr = ptr;
     event.events = events;
     if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
         perror("epoll_ctl ADD");
@@ -32,12 +137,11 @@ void add_to_epoll(int epoll_fd, int fd, uint32_t events) {
     }
 }
 
-int main() {
-    int server_fd, epoll_fd, event_fd;
+static int create_listener(void) {
+    int server_fd;
     struct sockaddr_un addr;
-    struct epoll_event events[MAX_EVENTS];
 
-    unlink(SOCKET_PATH); 
+    unlink(SOCKET_PATH);
     if ((server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
         perror("socket");
         exit(EXIT_FAILURE);
@@ -57,83 +161,451 @@ int main() {
         exit(EXIT_FAILURE);
     }
     printf("Server is listening on socket: %s\n", SOCKET_PATH);
+    return server_fd;
+}
 
-    if ((epoll_fd = epoll_create1(0)) == -1) {
+static void worker_init(worker_t* w, int id, int cpu, int verbose) {
+    w->id = id;
+    w->cpu = cpu;
+    w->verbose = verbose;
+    if ((w->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
         perror("epoll_create1");
         exit(EXIT_FAILURE);
     }
-
-    if ((event_fd = eventfd(0, EFD_NONBLOCK)) == -1) {
-        perror("eventfd");
+    // Пул без блокировок: блоками соединения пользуется только его поток
+    if ((w->pool = pool_create(OUT_BLOCK_SIZE, OUT_POOL_BLOCKS)) == NULL) {
+        perror("pool_create");
         exit(EXIT_FAILURE);
     }
-    printf("Created eventfd, to emulate internal event execute:\n");
-    printf("echo 1 > /proc/%d/fd/%d\n\n", getpid(), event_fd);
+    w->timer_fd = -1;
+    if (idle_ns > 0) {
+        w->now_ns = rt_now_ns();
+        if ((w->wheel = rt_wheel_create(IDLE_TICK_NS, w->now_ns)) == NULL ||
+            (w->timer_fd = rt_wheel_timerfd_create()) == -1) {
+            perror("timer wheel");
+            exit(EXIT_FAILURE);
+        }
+        rt_wheel_set_slack(w->wheel, idle_ns / IDLE_SLACK_DIV);
+        add_to_epoll(w->epoll_fd, w->timer_fd, EPOLLIN, &timer_tag);
+    }
+}
 
+static void counter_add(_Atomic uint64_t* counter, uint64_t value) {
+    // Писатель один: load + store дешевле атомарного сложения
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
 
-    add_to_epoll(epoll_fd, server_fd, EPOLLIN);
-    add_to_epoll(epoll_fd, event_fd, EPOLLIN);
+// ---------------------------------------------------------------------------
+// Соединение и его очередь вывода
+// ---------------------------------------------------------------------------
 
-    while (1) {
-        int n_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-        if (n_events == -1) {
-            perror("epoll_wait");
-            exit(EXIT_FAILURE);
+static void conn_close(worker_t* w, conn_t* c) {
+    if (w->verbose) printf("Client (fd=%d) disconnected.\n", c->fd);
+    close(c->fd); // Закрытие удаляет fd из epoll
+    if (w->wheel) rt_wheel_cancel(w->wheel, &c->idle);
+    while (c->head) {
+        out_block_t* next = c->head->next;
+        pool_free(w->pool, c->head);
+        c->head = next;
+    }
+    if (c->starved) {
+        conn_t** link = &w->starved;
+        while (*link != c) link = &(*link)->next_starved;
+        *link = c->next_starved;
+    }
+    if (c->prev) c->prev->next = c->next;
+    else w->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    free(c);
+    counter_add(&w->closed, 1);
+}
+
+static int conn_set_out(worker_t* w, conn_t* c, int want_out) {
+    if (c->want_out == want_out) return 0;
+    struct epoll_event event;
+    event.data.ptr = c;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want_out ? EPOLLOUT : 0);
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, c->fd, &event) == -1) return -1;
+    c->want_out = want_out;
+    return 0;
+}
+
+/*
+ * Отправляет очередь одним writev (до WRITEV_MAX_IOV блоков за вызов) и
+ * возвращает отправленные блоки в пул.
+ * @return 0 - очередь пуста или сокет полон (EAGAIN); -1 - ошибка.
+ */
+static int conn_flush(worker_t* w, conn_t* c) {
+    while (c->queued > 0) {
+        struct iovec iov[WRITEV_MAX_IOV];
+        int n_iov = 0;
+        size_t total = 0;
+        for (out_block_t* b = c->head; b && n_iov < WRITEV_MAX_IOV; b = b->next) {
+            if (b->off == b->len) continue;
+            iov[n_iov].iov_base = b->data + b->off;
+            iov[n_iov].iov_len = b->len - b->off;
+            total += iov[n_iov].iov_len;
+            n_iov++;
+        }
+        ssize_t n = writev(c->fd, iov, n_iov);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
         }
+        counter_add(&w->writevs, 1);
+        c->queued -= (size_t)n;
 
-        for (int i = 0; i < n_events; i++) {
-            if (events[i].data.fd == server_fd) {
-                // --- Новое подключение ---
-                int client_fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK);
-                if (client_fd == -1) {
-                    perror("accept4");
-                    continue;
+        size_t left = (size_t)n;
+        while (c->head) {
+            out_block_t* b = c->head;
+            size_t chunk = b->len - b->off;
+            if (left < chunk) {
+                b->off += (uint32_t)left;
+                break;
+            }
+            left -= chunk;
+            if (b == c->tail) {
+                // Хвост оставляем: в него продолжится чтение
+                b->len = b->off = 0;
+                break;
+            }
+            c->head = b->next;
+            pool_free(w->pool, b);
+        }
+        if ((size_t)n < total) return 0; // Короткая запись: сокет полон, ждать EPOLLOUT
+    }
+    return 0;
+}
+
+// Место для чтения в хвосте очереди; NULL - пул исчерпан
+static out_block_t* conn_tail_space(worker_t* w, conn_t* c) {
+    if (c->tail && c->tail->len < OUT_BLOCK_DATA) return c->tail;
+    out_block_t* b = pool_alloc(w->pool);
+    if (!b) return NULL;
+    b->next = NULL;
+    b->len = b->off = 0;
+    if (c->tail) {
+        c->tail->next = b;
+    } else {
+        c->head = b;
+    }
+    c->tail = b;
+    return b;
+}
+
+/*
+ * Обслуживает соединение. В режиме ET следующего уведомления о данных,
+ * оставленных в сокете, не будет, поэтому читаем до EAGAIN - или до
+ * CONN_HIGH_WATER: тогда чтение продолжится по EPOLLOUT, когда очередь
+ * уйдет клиенту (это и есть обратное давление). Все, что прочитано за
+ * один проход, уходит одним writev.
+ */
+static void conn_service(worker_t* w, conn_t* c) {
+    int active = 0;
+    for (;;) {
+        int drained = 0;
+        while (!c->eof && c->queued < CONN_HIGH_WATER) {
+            out_block_t* b = conn_tail_space(w, c);
+            if (!b) {
+                // Нет блоков: подождать, пока их вернут другие соединения потока
+                if (!c->starved) {
+                    c->starved = 1;
+                    c->next_starved = w->starved;
+                    w->starved = c;
                 }
-                add_to_epoll(epoll_fd, client_fd, EPOLLIN | EPOLLET); // ET для примера
-                printf("New client (fd=%d) connected.\n", client_fd);
+                break;
+            }
+            ssize_t n = read(c->fd, b->data + b->len, OUT_BLOCK_DATA - b->len);
+            if (n > 0) {
+                if (w->verbose) printf("Received from client (fd=%d): %.*s", c->fd, (int)n, b->data + b->len);
+                b->len += (uint32_t)n;
+                c->queued += (size_t)n;
+                active = 1;
+                counter_add(&w->bytes, (uint64_t)n);
+            } else if (n == 0) {
+                c->eof = 1; // Клиент закрыл запись; прочитанное еще надо отправить
+                break;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                drained = 1;
+                break;
+            } else if (errno != EINTR) {
+                if (w->verbose) perror("read");
+                conn_close(w, c);
+                return;
+            }
+        }
+        if (c->queued >= CONN_HIGH_WATER) counter_add(&w->paused, 1);
+
+        size_t before = c->queued;
+        if (conn_flush(w, c) == -1 || (c->eof && c->queued == 0)) {
+            conn_close(w, c);
+            return;
+        }
+        // Продолжать чтение, если сокет не вычитан и запись продвинулась
+        if (drained || c->eof || c->starved || c->queued >= CONN_HIGH_WATER || c->queued == before) break;
+    }
+    if (active && w->wheel) rt_wheel_schedule(w->wheel, &c->idle, w->now_ns + idle_ns);
+    if (conn_set_out(w, c, c->queued > 0) == -1) conn_close(w, c);
+}
+
+// Срабатывает из rt_wheel_advance: таймер уже снят с колеса
+static void conn_idle_expired(RtTimer* timer, void* arg) {
+    conn_t* c = arg;
+    (void)timer;
+    if (c->owner->verbose) printf("Client (fd=%d) idle, closing.\n", c->fd);
+    counter_add(&c->owner->idle_closed, 1);
+    conn_close(c->owner, c);
+}
+
+// После возврата блоков в пул - дать шанс соединениям, которым их не хватило
+static void worker_wake_starved(worker_t* w) {
+    conn_t* list = w->starved;
+    w->starved = NULL;
+    while (list) {
+        conn_t* c = list;
+        list = c->next_starved;
+        c->starved = 0;
+        conn_service(w, c);
+    }
+}
+
+// Остановка: соединения, которые клиенты не закрыли, освобождаются здесь
+static void worker_close_all(worker_t* w) {
+    while (w->conns) conn_close(w, w->conns);
+}
+
+static void accept_clients(worker_t* w) {
+    for (int i = 0; i < ACCEPT_BURST; ++i) {
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            // EAGAIN: подключение забрал другой поток или очередь пуста
+            if (w->verbose && errno != EAGAIN && errno != EWOULDBLOCK) perror("accept4");
+            return;
+        }
+        conn_t* c = calloc(1, sizeof(*c));
+        if (!c) {
+            close(client_fd);
+            continue;
+        }
+        c->fd = client_fd;
+        c->owner = w;
+        rt_timer_init(&c->idle, conn_idle_expired, c);
+        struct epoll_event event;
+        event.data.ptr = c;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) == -1) {
+            close(client_fd);
+            free(c);
+            continue;
+        }
+        // Таймер ставится только зарегистрированному соединению: иначе free выше оставил бы его в колесе
+        if (w->wheel) rt_wheel_schedule(w->wheel, &c->idle, w->now_ns + idle_ns);
+        c->next = w->conns;
+        if (w->conns) w->conns->prev = c;
+        w->conns = c;
+        counter_add(&w->accepted, 1);
+        if (w->verbose) printf("New client (fd=%d) connected.\n", client_fd);
+        // Клиент мог успеть что-то прислать до регистрации: ET об этом не сообщит
+        conn_service(w, c);
+    }
+}
+
+static void* worker_main(void* arg) {
+    worker_t* w = arg;
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
 
-            } else if (events[i].data.fd == event_fd) {
+    struct epoll_event* events = calloc((size_t)batch_size, sizeof(*events));
+    if (!events) return NULL;
+    for (;;) {
+        if (w->wheel && rt_wheel_timerfd_arm(w->wheel, w->timer_fd) == -1) perror("timerfd_settime");
+        int n_events = epoll_wait(w->epoll_fd, events, batch_size, -1);
+        if (n_events == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        counter_add(&w->wakeups, 1);
+        counter_add(&w->events, (uint64_t)n_events);
+        if (w->wheel) w->now_ns = rt_now_ns();
+        int timers_due = 0;
+        for (int i = 0; i < n_events; i++) {
+            void* ptr = events[i].data.ptr;
+            if (ptr == &timer_tag) {
+                timers_due = 1;
+            } else if (ptr == &listen_tag) {
+                accept_clients(w);
+            } else if (ptr == &stop_tag) {
+                free(events);
+                worker_close_all(w);
+                return NULL;
+            } else if (ptr == &event_tag) {
                 // --- Внутреннее событие ---
                 uint64_t counter;
-                read(event_fd, &counter, sizeof(counter)); // Сбрасываем счетчик
-                printf("!!! Received internal event (counter=%llu) !!!\n", (unsigned long long)counter);
-
-            } else {
-                int client_fd = events[i].data.fd;
-                char buffer[READ_BUFFER_SIZE];
-
-                ssize_t bytes_read = read(client_fd, buffer, READ_BUFFER_SIZE);
-
-                if (bytes_read == -1) {
-                    // EWOULDBLOCK означает, что мы прочитали все данные (в режиме ET)
-                    if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                        perror("read");
-                        close(client_fd);
-                    }
-                } else if (bytes_read == 0) {
-                    // --- Обрыв соединения ---
-                    // Клиент закрыл сокет. epoll автоматически удаляет fd,
-                    // но мы должны его закрыть сами.
-                    printf("Client (fd=%d) disconnected.\n", client_fd);
-                    close(client_fd); // epoll_ctl(EPOLL_CTL_DEL) не нужен для close
-                } else {
-                    buffer[bytes_read] = '\0';
-                    printf("Received from client (fd=%d): %s", client_fd, buffer);
-                    // Эхо-ответ
-                    write(client_fd, buffer, bytes_read);
+                if (read(event_fd, &counter, sizeof(counter)) == sizeof(counter)) { // Сбрасываем счетчик
+                    printf("!!! Received internal event (counter=%llu) !!!\n", (unsigned long long)counter);
                 }
+            } else {
+                conn_service(w, ptr);
             }
         }
+        if (w->starved) worker_wake_starved(w);
+        // Тайм-ауты - после событий пачки: закрытое по ним соединение может
+        // стоять в events дальше, а чтение в этой же пачке продлевает тайм-аут
+        if (timers_due) rt_wheel_timerfd_fire(w->wheel, w->timer_fd, w->now_ns);
+        if (w->verbose) fflush(stdout);
+    }
+    free(events);
+    worker_close_all(w);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Многопоточный режим
+// ---------------------------------------------------------------------------
+
+static int run_workers(int n_workers, int pin) {
+    static worker_t workers[MAX_WORKERS];
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = term;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN); // Клиент может закрыть сокет, пока мы пишем
+
+    listen_fd = create_listener();
+    // eventfd остановки: не вычитывается, поэтому (LT) будит все потоки
+    if ((stop_fd = eventfd(0, EFD_NONBLOCK)) == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < n_workers; ++i) {
+        worker_t* w = &workers[i];
+        worker_init(w, i, pin ? (int)(i % n_cpus) : -1, 0);
+        add_to_epoll(w->epoll_fd, listen_fd, EPOLLIN | EPOLLEXCLUSIVE, &listen_tag);
+        add_to_epoll(w->epoll_fd, stop_fd, EPOLLIN, &stop_tag);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    printf("%d worker(s), batch %d events, %s", n_workers, batch_size, pin ? "pinned to cores" : "not pinned");
+    if (idle_ns > 0) printf(", idle timeout %lld ms", (long long)(idle_ns / RT_NSEC_PER_MSEC));
+    printf("\n");
+
+    uint64_t prev_bytes = 0;
+    while (!done) {
+        sleep(1);
+        uint64_t bytes = 0, active = 0;
+        for (int i = 0; i < n_workers; ++i) {
+            bytes += atomic_load_explicit(&workers[i].bytes, memory_order_relaxed);
+            active += atomic_load_explicit(&workers[i].accepted, memory_order_relaxed) -
+                      atomic_load_explicit(&workers[i].closed, memory_order_relaxed);
+        }
+        printf("connections: %llu, echo: %.1f MB/s\n", (unsigned long long)active,
+               (bytes - prev_bytes) / 1e6);
+        fflush(stdout);
+        prev_bytes = bytes;
+    }
+
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)) perror("write eventfd");
+    printf("\n%-6s %-4s %10s %10s %12s %10s %12s %10s %8s %10s %10s\n", "worker", "cpu", "accepted", "closed",
+           "bytes", "wakeups", "events/wake", "writev", "paused", "pool peak", "idle kick");
+    for (int i = 0; i < n_workers; ++i) {
+        worker_t* w = &workers[i];
+        pthread_join(w->thread, NULL);
+        uint64_t wakeups = atomic_load(&w->wakeups);
+        PoolStats stats;
+        pool_get_stats(w->pool, &stats);
+        printf("%-6d %-4d %10llu %10llu %12llu %10llu %12.2f %10llu %8llu %10zu %10llu\n", w->id, w->cpu,
+               (unsigned long long)atomic_load(&w->accepted), (unsigned long long)atomic_load(&w->closed),
+               (unsigned long long)atomic_load(&w->bytes), (unsigned long long)wakeups,
+               wakeups ? (double)atomic_load(&w->events) / wakeups : 0.0,
+               (unsigned long long)atomic_load(&w->writevs), (unsigned long long)atomic_load(&w->paused),
+               stats.peak_in_use, (unsigned long long)atomic_load(&w->idle_closed));
+        close(w->epoll_fd);
+        if (w->wheel) {
+            close(w->timer_fd);
+            rt_wheel_destroy(w->wheel);
+        }
+        pool_destroy(w->pool);
     }
+    close(stop_fd);
+    close(listen_fd);
+    unlink(SOCKET_PATH);
+    return 0;
+}
 
-    close(server_fd);
-    close(epoll_fd);
+// ---------------------------------------------------------------------------
+// Демонстрационный однопоточный режим
+// ---------------------------------------------------------------------------
+
+static int run_demo(void) {
+    static worker_t demo;
+    signal(SIGPIPE, SIG_IGN);
+
+    listen_fd = create_listener();
+    worker_init(&demo, 0, -1, 1);
+    batch_size = MAX_EVENTS;
+
+    if ((event_fd = eventfd(0, EFD_NONBLOCK)) == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+    printf("Created eventfd, to emulate internal event execute:\n");
+    printf("echo 1 > /proc/%d/fd/%d\n\n", getpid(), event_fd);
+
+
+    add_to_epoll(demo.epoll_fd, listen_fd, EPOLLIN, &listen_tag);
+    add_to_epoll(demo.epoll_fd, event_fd, EPOLLIN, &event_tag);
+
+    // Клиентские сокеты регистрируются с EPOLLET (см. accept_clients)
+    worker_main(&demo);
+
+    close(listen_fd);
+    close(demo.epoll_fd);
     close(event_fd);
+    if (demo.wheel) {
+        close(demo.timer_fd);
+        rt_wheel_destroy(demo.wheel);
+    }
+    pool_destroy(demo.pool);
     unlink(SOCKET_PATH);
 
     return 0;
 }
 
+int main(int argc, char* argv[]) {
+    int n_workers = 0;
+    int pin = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:b:ui:")) != -1) {
+        switch (opt) {
+        case 'w': n_workers = atoi(optarg); break;
+        case 'b': batch_size = atoi(optarg); break;
+        case 'u': pin = 0; break;
+        case 'i': idle_ns = atol(optarg) * RT_NSEC_PER_MSEC; break;
+        default:
+            fprintf(stderr, "Usage: %s [-i idle_ms] [-w workers [-b batch] [-u]]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (n_workers == 0) return run_demo();
+    if (n_workers < 0 || n_workers > MAX_WORKERS || batch_size < 1) {
+        fprintf(stderr, "workers must be 1..%d, batch >= 1\n", MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+    return run_workers(n_workers, pin);
+}
+
 /*
  * Как протестировать:
  * 1. Запустите сервер: ./bin/epoll_server
@@ -143,4 +615,12 @@ int main() {
  * 3. В третьем терминале, чтобы проверить eventfd, выполните команду,
  *    которую сервер вывел при старте (echo 1 > /proc/...).
  *    Сервер должен сообщить о внутреннем событии.
+ *
+ * Многопоточный режим: ./bin/epoll_server -w 4 [-b 64] [-u - без привязки],
+ * нагрузка: ./bin/epoll_load -c 256 -t 4 -s 1024 -d 10.
+ * Сравните MB/s и распределение accepted по потокам при -w 1, 2, 4...
+ *
+ * Тайм-ауты: ./bin/epoll_server -w 1 -i 2000 и подключитесь socat: через
+ * 2 с молчания сервер закроет соединение (столбец idle kick), а нагрузка
+ * epoll_load, которая пишет непрерывно, закрыта не будет.
  */
@@ -0,0 +1,544 @@
+/*
+ * Сравнение транспортов IPC на одной и той же нагрузке
+ *
+ * Демонстрации задания (iov_demo, posix_mq_*, epoll_server, shm_*) печатают
+ * каждое сообщение и спят между ними, поэтому по ним нельзя выбрать
+ * транспорт. Здесь родитель и дочерний процесс (fork) обмениваются
+ * сообщениями через:
+ *  - pipe   - два канала, по одному в каждую сторону;
+ *  - mq     - две очереди POSIX MQ (размер сообщения не больше msgsize_max);
+ *  - unix   - socketpair(AF_UNIX, SOCK_STREAM);
+ *  - shm    - два кольца shm_varring.h (futex только при пустом кольце).
+ *
+ * Нагрузки:
+ *  - ping-pong: сообщение туда и обратно, задержка круга (p50/p99/p99.9/max);
+ *  - поток: -m сообщений в одну сторону без ожидания ответа, в конце одно
+ *    подтверждение; пропускная способность в сообщениях и МБ/с.
+ *
+ * Перебираются размеры сообщения (-s) и привязка процессов (-p):
+ * none - без привязки, same - оба на одном ядре, sibling - соседние
+ * гиперпотоки одного ядра, core - разные ядра одного сокета, socket -
+ * разные сокеты. Недоступные на этой машине варианты пропускаются.
+ *
+ * Запуск: ./bin/ipc_bench [-t pipe,mq,unix,shm] [-s 64,1024,...] [-p none,same,...] [-n roundtrips] [-m messages]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_stats.h"
+#include "shm_varring.h"
+
+#define MAX_SIZES        16
+#define WARMUP_ROUNDS    1000
+#define SHM_MIN_RING     (1u << 20)
+#define MQ_DEPTH         10     // msg_max по умолчанию для непривилегированных
+#define DEFAULT_SIZES    "64,256,1024,4096,16384,65536"
+
+// Канал в обе стороны: сторона 0 - родитель, сторона 1 - дочерний процесс
+typedef struct {
+    size_t size;
+    int fds[2][2];              // pipe: [направление][конец]; unix: fds[0] - socketpair
+    mqd_t mq[2];                // Направление 0: родитель -> потомок, 1: обратно
+    shm_varring_t* ring[2];
+    shm_varring_end_t end[2];   // Свой конец каждого кольца (producer или consumer)
+    unsigned spin_limit;        // shm: опросов перед сном, 0 - процессы делят одно ядро
+} ipc_link_t;
+
+typedef struct {
+    const char* name;
+    int (*setup)(ipc_link_t* l);
+    void (*teardown)(ipc_link_t* l);
+    int (*send)(ipc_link_t* l, int side, const void* buf);
+    int (*recv)(ipc_link_t* l, int side, void* buf);
+    size_t (*max_size)(void);
+    void (*attach)(ipc_link_t* l, int side);   // После fork, может быть NULL
+    void (*detach)(ipc_link_t* l, int side);   // Перед выходом стороны, может быть NULL
+} transport_t;
+
+typedef struct {
+    const char* name;
+    int cpu[2];                 // -1 - без привязки
+} pin_mode_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n == 0) {
+            errno = EPIPE;
+            return -1;
+        }
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static size_t no_limit(void) {
+    return SIZE_MAX;
+}
+
+// ---------------------------------------------------------------------------
+// pipe
+// ---------------------------------------------------------------------------
+
+static int pipe_setup(ipc_link_t* l) {
+    if (pipe(l->fds[0]) == -1) return -1;
+    if (pipe(l->fds[1]) == -1) {
+        close(l->fds[0][0]);
+        close(l->fds[0][1]);
+        return -1;
+    }
+    return 0;
+}
+
+static void pipe_teardown(ipc_link_t* l) {
+    for (int d = 0; d < 2; ++d) {
+        close(l->fds[d][0]);
+        close(l->fds[d][1]);
+    }
+}
+
+static int pipe_send(ipc_link_t* l, int side, const void* buf) {
+    return write_all(l->fds[side][1], buf, l->size);
+}
+
+static int pipe_recv(ipc_link_t* l, int side, void* buf) {
+    return read_all(l->fds[!side][0], buf, l->size);
+}
+
+// ---------------------------------------------------------------------------
+// UNIX-сокет
+// ---------------------------------------------------------------------------
+
+static int unix_setup(ipc_link_t* l) {
+    return socketpair(AF_UNIX, SOCK_STREAM, 0, l->fds[0]);
+}
+
+static void unix_teardown(ipc_link_t* l) {
+    close(l->fds[0][0]);
+    close(l->fds[0][1]);
+}
+
+static int unix_send(ipc_link_t* l, int side, const void* buf) {
+    return write_all(l->fds[0][side], buf, l->size);
+}
+
+static int unix_recv(ipc_link_t* l, int side, void* buf) {
+    return read_all(l->fds[0][side], buf, l->size);
+}
+
+// ---------------------------------------------------------------------------
+// POSIX MQ
+// ---------------------------------------------------------------------------
+
+static void mq_link_name(char* name, size_t len, int dir) {
+    snprintf(name, len, "/ipc_bench_%d_%d", (int)getpid(), dir);
+}
+
+static int mq_link_setup(ipc_link_t* l) {
+    struct mq_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.mq_maxmsg = MQ_DEPTH;
+    attr.mq_msgsize = (long)l->size;
+    for (int d = 0; d < 2; ++d) {
+        char name[64];
+        mq_link_name(name, sizeof(name), d);
+        mq_unlink(name);
+        // Дескрипторы наследуются через fork, имя больше не нужно
+        l->mq[d] = mq_open(name, O_CREAT | O_RDWR, 0600, &attr);
+        mq_unlink(name);
+        if (l->mq[d] == (mqd_t)-1) {
+            if (d == 1) mq_close(l->mq[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void mq_link_teardown(ipc_link_t* l) {
+    mq_close(l->mq[0]);
+    mq_close(l->mq[1]);
+}
+
+static int mq_link_send(ipc_link_t* l, int side, const void* buf) {
+    while (mq_send(l->mq[side], buf, l->size, 0) == -1) {
+        if (errno != EINTR) return -1;
+    }
+    return 0;
+}
+
+static int mq_link_recv(ipc_link_t* l, int side, void* buf) {
+    for (;;) {
+        ssize_t n = mq_receive(l->mq[!side], buf, l->size, NULL);
+        if (n >= 0) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+static size_t mq_max_size(void) {
+    long max = 8192;
+    FILE* f = fopen("/proc/sys/fs/mqueue/msgsize_max", "r");
+    if (f) {
+        if (fscanf(f, "%ld", &max) != 1) max = 8192;
+        fclose(f);
+    }
+    return (size_t)max;
+}
+
+// ---------------------------------------------------------------------------
+// Разделяемая память (shm_varring.h)
+// ---------------------------------------------------------------------------
+
+static int shm_link_setup(ipc_link_t* l) {
+    uint64_t capacity = SHM_MIN_RING;
+    while (capacity / 4 < shm_var_record_size(l->size)) capacity *= 2;
+    for (int d = 0; d < 2; ++d) {
+        char name[64];
+        mq_link_name(name, sizeof(name), d);
+        // Отображение MAP_SHARED переживает fork, имя больше не нужно
+        l->ring[d] = shm_varring_create(name, capacity);
+        shm_unlink(name);
+        if (!l->ring[d]) {
+            if (d == 1) shm_varring_close(l->ring[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void shm_link_teardown(ipc_link_t* l) {
+    shm_varring_close(l->ring[0]);
+    shm_varring_close(l->ring[1]);
+}
+
+// Концы колец выбираются после fork, когда известна сторона
+static void shm_link_attach(ipc_link_t* l, int side) {
+    shm_varring_producer_init(&l->end[side], l->ring[side]);
+    shm_varring_consumer_init(&l->end[!side], l->ring[!side]);
+}
+
+// Сторона уходит: собеседник получит EPIPE и в send, и в recv, а не будет ждать
+static void shm_link_detach(ipc_link_t* l, int side) {
+    shm_varring_close_reader(l->ring[!side]);
+    shm_varring_close_writer(l->ring[side]);
+}
+
+static int shm_link_send(ipc_link_t* l, int side, const void* buf) {
+    void* data;
+    // Ожидания места на futex у кольца нет: опрос, затем уступаем ядро
+    for (unsigned spins = 0; (data = shm_varring_reserve(&l->end[side], l->size)) == NULL; ++spins) {
+        if (errno != EAGAIN) return -1;
+        if (spins < l->spin_limit) {
+            shm_cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+    memcpy(data, buf, l->size);
+    shm_varring_commit(&l->end[side], l->size);
+    return 0;
+}
+
+static int shm_link_recv(ipc_link_t* l, int side, void* buf) {
+    uint64_t len;
+    const void* data;
+    while ((data = shm_varring_peek_spin(&l->end[!side], &len, l->spin_limit)) == NULL) {
+        if (errno != EINTR) return -1;
+    }
+    memcpy(buf, data, len < l->size ? len : l->size);
+    shm_varring_release(&l->end[!side]);
+    return 0;
+}
+
+static const transport_t transports[] = {
+    {"pipe", pipe_setup, pipe_teardown, pipe_send, pipe_recv, no_limit, NULL, NULL},
+    {"mq", mq_link_setup, mq_link_teardown, mq_link_send, mq_link_recv, mq_max_size, NULL, NULL},
+    {"unix", unix_setup, unix_teardown, unix_send, unix_recv, no_limit, NULL, NULL},
+    {"shm", shm_link_setup, shm_link_teardown, shm_link_send, shm_link_recv, no_limit, shm_link_attach,
+     shm_link_detach},
+};
+#define N_TRANSPORTS (sizeof(transports) / sizeof(transports[0]))
+
+// ---------------------------------------------------------------------------
+// Привязка к ядрам
+// ---------------------------------------------------------------------------
+
+static int read_topology(int cpu, const char* what) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, what);
+    FILE* f = fopen(path, "r");
+    int value = -1;
+    if (f) {
+        if (fscanf(f, "%d", &value) != 1) value = -1;
+        fclose(f);
+    }
+    return value;
+}
+
+/*
+ * Подбирает пару ядер для режима из разрешенных процессу.
+ * @return 0 - пара найдена; -1 - на этой машине режим недоступен.
+ */
+static int resolve_pin(const char* mode, int cpu[2]) {
+    cpu_set_t allowed;
+    cpu[0] = cpu[1] = -1;
+    if (strcmp(mode, "none") == 0) return 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) return -1;
+    int first = -1;
+    for (int i = 0; i < CPU_SETSIZE && first < 0; ++i) {
+        if (CPU_ISSET(i, &allowed)) first = i;
+    }
+    if (first < 0) return -1;
+    cpu[0] = first;
+    if (strcmp(mode, "same") == 0) {
+        cpu[1] = first;
+        return 0;
+    }
+    int pkg = read_topology(first, "physical_package_id");
+    int core = read_topology(first, "core_id");
+    for (int i = first + 1; i < CPU_SETSIZE; ++i) {
+        if (!CPU_ISSET(i, &allowed)) continue;
+        int same_pkg = read_topology(i, "physical_package_id") == pkg;
+        int same_core = same_pkg && read_topology(i, "core_id") == core;
+        if ((strcmp(mode, "sibling") == 0 && same_core) || (strcmp(mode, "core") == 0 && same_pkg && !same_core) ||
+            (strcmp(mode, "socket") == 0 && !same_pkg)) {
+            cpu[1] = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void pin_to(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) perror("sched_setaffinity");
+}
+
+// ---------------------------------------------------------------------------
+// Нагрузки
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t p50, p99, p999, max;   // Задержка круга, нс
+    double msgs_per_sec;            // Поток
+    int failed;
+} run_result_t;
+
+// Дочерний процесс: эхо на rounds сообщений, затем прием потока и подтверждение
+static void child_exit(const transport_t* t, ipc_link_t* l, int code) {
+    if (t->detach) t->detach(l, 1);
+    _exit(code);
+}
+
+static void child_main(const transport_t* t, ipc_link_t* l, long rounds, long stream, char* buf) {
+    for (long i = 0; i < rounds; ++i) {
+        if (t->recv(l, 1, buf) == -1 || t->send(l, 1, buf) == -1) child_exit(t, l, 1);
+    }
+    for (long i = 0; i < stream; ++i) {
+        if (t->recv(l, 1, buf) == -1) child_exit(t, l, 1);
+    }
+    if (t->send(l, 1, buf) == -1) child_exit(t, l, 1);
+    child_exit(t, l, 0);
+}
+
+static run_result_t run_one(const transport_t* t, size_t size, const int cpu[2], long rounds, long stream) {
+    run_result_t res;
+    memset(&res, 0, sizeof(res));
+    ipc_link_t link;
+    memset(&link, 0, sizeof(link));
+    link.size = size;
+    // На одном ядре собеседник не работает, пока мы крутимся: сразу спать
+    link.spin_limit = (cpu[0] >= 0 && cpu[0] == cpu[1]) || sysconf(_SC_NPROCESSORS_ONLN) == 1 ? 0 : SHM_SPSC_SPIN_LIMIT;
+    char* buf = malloc(size);
+    uint64_t* samples = malloc((size_t)rounds * sizeof(uint64_t));
+    if (!buf || !samples || t->setup(&link) == -1) {
+        perror(t->name);
+        free(buf);
+        free(samples);
+        res.failed = 1;
+        return res;
+    }
+    memset(buf, 'x', size);
+
+    cpu_set_t saved;
+    sched_getaffinity(0, sizeof(saved), &saved);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        t->teardown(&link);
+        free(buf);
+        free(samples);
+        res.failed = 1;
+        return res;
+    }
+    if (pid == 0) {
+        pin_to(cpu[1]);
+        if (t->attach) t->attach(&link, 1);
+        child_main(t, &link, WARMUP_ROUNDS + rounds, stream, buf);
+    }
+    pin_to(cpu[0]);
+    if (t->attach) t->attach(&link, 0);
+
+    for (long i = 0; i < WARMUP_ROUNDS + rounds && !res.failed; ++i) {
+        uint64_t start = now_ns();
+        if (t->send(&link, 0, buf) == -1 || t->recv(&link, 0, buf) == -1) {
+            res.failed = 1;
+            break;
+        }
+        if (i >= WARMUP_ROUNDS) samples[i - WARMUP_ROUNDS] = now_ns() - start;
+    }
+    uint64_t start = now_ns();
+    for (long i = 0; i < stream && !res.failed; ++i) {
+        if (t->send(&link, 0, buf) == -1) res.failed = 1;
+    }
+    if (!res.failed && t->recv(&link, 0, buf) == -1) res.failed = 1;
+    uint64_t elapsed = now_ns() - start;
+
+    if (res.failed) kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) res.failed = 1;
+    sched_setaffinity(0, sizeof(saved), &saved);
+    t->teardown(&link);
+
+    if (!res.failed) {
+        static const double pct[] = {50.0, 99.0, 99.9, 100.0};
+        int64_t q[4];
+        rt_stats_percentiles((int64_t*)samples, (size_t)rounds, pct, 4, q);
+        res.p50 = (uint64_t)q[0];
+        res.p99 = (uint64_t)q[1];
+        res.p999 = (uint64_t)q[2];
+        res.max = (uint64_t)q[3];
+        res.msgs_per_sec = stream / (elapsed / 1e9);
+    }
+    free(samples);
+    free(buf);
+    return res;
+}
+
+static int in_list(const char* list, const char* name) {
+    size_t len = strlen(name);
+    for (const char* p = list; *p;) {
+        const char* comma = strchr(p, ',');
+        size_t item = comma ? (size_t)(comma - p) : strlen(p);
+        if (item == len && strncmp(p, name, len) == 0) return 1;
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* transport_list = "pipe,mq,unix,shm";
+    const char* size_list = DEFAULT_SIZES;
+    const char* pin_list = "none,same,sibling,core,socket";
+    long rounds = 20000, stream = 100000;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:p:n:m:")) != -1) {
+        switch (opt) {
+        case 't': transport_list = optarg; break;
+        case 's': size_list = optarg; break;
+        case 'p': pin_list = optarg; break;
+        case 'n': rounds = atol(optarg); break;
+        case 'm': stream = atol(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-t pipe,mq,unix,shm] [-s sizes] [-p none,same,sibling,core,socket] "
+                            "[-n roundtrips] [-m stream_msgs]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t sizes[MAX_SIZES];
+    int n_sizes = 0;
+    char* copy = strdup(size_list);
+    for (char* tok = copy ? strtok(copy, ",") : NULL; tok && n_sizes < MAX_SIZES; tok = strtok(NULL, ",")) {
+        long v = atol(tok);
+        if (v > 0) sizes[n_sizes++] = (size_t)v;
+    }
+    free(copy);
+    if (n_sizes == 0 || rounds < 1 || stream < 1) {
+        fprintf(stderr, "need at least one size > 0, roundtrips >= 1, stream_msgs >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+    static const char* pin_names[] = {"none", "same", "sibling", "core", "socket"};
+    pin_mode_t pins[5];
+    int n_pins = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (!in_list(pin_list, pin_names[i])) continue;
+        pins[n_pins].name = pin_names[i];
+        if (resolve_pin(pin_names[i], pins[n_pins].cpu) == -1) {
+            printf("pinning '%s' is not available on this machine, skipped\n", pin_names[i]);
+            continue;
+        }
+        n_pins++;
+    }
+
+    printf("%d round trips (+%d warm-up) and %ld streamed messages per run\n", (int)rounds, WARMUP_ROUNDS, stream);
+    printf("%-5s %-8s %7s %10s %10s %10s %10s %12s %10s\n", "ipc", "pin", "size", "rtt p50", "p99", "p99.9",
+           "max us", "stream msg/s", "MB/s");
+    int failed = 0;
+    for (size_t t = 0; t < N_TRANSPORTS; ++t) {
+        if (!in_list(transport_list, transports[t].name)) continue;
+        for (int p = 0; p < n_pins; ++p) {
+            char pin_label[32];
+            if (pins[p].cpu[0] < 0) {
+                snprintf(pin_label, sizeof(pin_label), "%s", pins[p].name);
+            } else {
+                snprintf(pin_label, sizeof(pin_label), "%.4s %d/%d", pins[p].name, pins[p].cpu[0], pins[p].cpu[1]);
+            }
+            for (int s = 0; s < n_sizes; ++s) {
+                if (sizes[s] > transports[t].max_size()) {
+                    printf("%-5s %-8s %7zu %10s\n", transports[t].name, pin_label, sizes[s], "- (too big)");
+                    continue;
+                }
+                run_result_t r = run_one(&transports[t], sizes[s], pins[p].cpu, rounds, stream);
+                if (r.failed) {
+                    printf("%-5s %-8s %7zu %10s\n", transports[t].name, pin_label, sizes[s], "failed");
+                    failed = 1;
+                    continue;
+                }
+                printf("%-5s %-8s %7zu %10.1f %10.1f %10.1f %10.1f %12.0f %10.1f\n", transports[t].name, pin_label,
+                       sizes[s], r.p50 / 1e3, r.p99 / 1e3, r.p999 / 1e3, r.max / 1e3, r.msgs_per_sec,
+                       r.msgs_per_sec * (double)sizes[s] / 1e6);
+                fflush(stdout);
+            }
+        }
+    }
+    return failed ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Нагрузочный клиент для posix_mq_server -b
+ *
+ * Каждый клиент - поток со своей очередью ответов
+ * (/mq_client_ex_<pid>_<n>), имя которой он передает в заголовке запроса.
+ * Клиент держит -w запросов "в полете": на каждый ответ отправляет
+ * следующий, пока не наберет -n. Задержка - от mq_send запроса до
+ * mq_receive ответа.
+ *
+ * Прогоны идут для 1, 2, 4, ... и -c клиентов: видно, как растет
+ * пропускная способность, пока сервер успевает осушать пачки, и как
+ * растет задержка, когда общая очередь сервера (10 сообщений) заполнена.
+ *
+ * Смешанная нагрузка для posix_mq_server -p: -H процентов запросов идут с
+ * MSG_PRIO_HIGH, обычные просят -W мкс обработки. Задержка выводится
+ * отдельно по приоритетам: срочные не должны ждать долгих обычных.
+ *
+ * Запуск: ./bin/posix_mq_server -b & ./bin/mq_bench [-c clients] [-n msgs] [-w window] [-s size]
+ *         ./bin/posix_mq_server -p & ./bin/mq_bench -c 4 -H 10 -W 1000
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "rt_stats.h"
+
+#define MAX_BENCH_CLIENTS 64
+#define MAX_WINDOW        10    // Не больше емкости очереди ответов
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    long n_msgs;
+    int window;
+    size_t size;
+    int high_pct;
+    uint32_t work_us;
+    uint64_t* samples[2];   // Задержки, нс: обычные и срочные
+    long n_samples[2];
+    long rejected;
+    int failed;
+} bench_client_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int send_request(bench_client_t* c, mqd_t mq, mq_request_t* req, uint64_t seq, unsigned* seed) {
+    unsigned int prio = MSG_PRIO_NORMAL;
+    *seed = *seed * 1103515245u + 12345u;
+    if ((int)((*seed >> 16) % 100) < c->high_pct) prio = MSG_PRIO_HIGH;
+    req->work_us = prio == MSG_PRIO_HIGH ? 0 : c->work_us;
+    req->seq = seq;
+    req->sent_ns = (int64_t)now_ns();
+    while (mq_send(mq, (const char*)req, sizeof(*req) + req->len, prio) == -1) {
+        if (errno != EINTR) return -1;
+    }
+    return 0;
+}
+
+static void* client_main(void* arg) {
+    bench_client_t* c = arg;
+    _Alignas(mq_request_t) char out[MAX_MSG_SIZE];
+    _Alignas(mq_request_t) char in[MAX_MSG_SIZE];
+    mq_request_t* req = (mq_request_t*)out;
+    mq_request_t* reply = (mq_request_t*)in;
+    unsigned seed = (unsigned)c->id * 2654435761u + 1;
+
+    struct mq_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.mq_maxmsg = MAX_WINDOW;
+    attr.mq_msgsize = MAX_MSG_SIZE;
+    memset(out, 0, sizeof(out));
+    snprintf(req->reply_to, REPLY_NAME_MAX, CLIENT_QUEUE_PREFIX "%d_%d", (int)getpid(), c->id);
+    req->len = (uint32_t)c->size;
+    memset(req->data, 'x', c->size);
+
+    mq_unlink(req->reply_to);
+    mqd_t mq_reply = mq_open(req->reply_to, O_CREAT | O_RDONLY | O_CLOEXEC, 0600, &attr);
+    mqd_t mq_server = mq_open(SERVER_QUEUE_NAME, O_WRONLY | O_CLOEXEC);
+    c->samples[0] = malloc((size_t)c->n_msgs * sizeof(uint64_t));
+    c->samples[1] = malloc((size_t)c->n_msgs * sizeof(uint64_t));
+    if (mq_reply == (mqd_t)-1 || mq_server == (mqd_t)-1 || !c->samples[0] || !c->samples[1]) {
+        perror(mq_server == (mqd_t)-1 ? "mq_open (server, is posix_mq_server -b running?)" : "mq_open (reply)");
+        c->failed = 1;
+        goto out;
+    }
+
+    uint64_t sent = 0;
+    for (; sent < (uint64_t)c->window && sent < (uint64_t)c->n_msgs; ++sent) {
+        if (send_request(c, mq_server, req, sent, &seed) == -1) {
+            c->failed = 1;
+            goto out;
+        }
+    }
+    for (long received = 0; received < c->n_msgs; ++received) {
+        unsigned int prio;
+        ssize_t n = mq_receive(mq_reply, in, sizeof(in), &prio);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("mq_receive");
+            c->failed = 1;
+            break;
+        }
+        if (reply->flags & MQ_FLAG_REJECTED) {
+            c->rejected++;
+        } else if ((size_t)n != sizeof(*reply) + c->size || reply->data[0] != 'X') {
+            c->failed = 1; // Сервер не тот или ответ испорчен
+        } else {
+            int high = prio >= MSG_PRIO_HIGH;
+            c->samples[high][c->n_samples[high]++] = now_ns() - (uint64_t)reply->sent_ns;
+        }
+        if (sent < (uint64_t)c->n_msgs) {
+            if (send_request(c, mq_server, req, sent++, &seed) == -1) {
+                c->failed = 1;
+                break;
+            }
+        }
+    }
+    // Сервер закроет наш дескриптор и не будет держать очередь после unlink
+    req->flags = MQ_FLAG_BYE;
+    req->len = 0;
+    send_request(c, mq_server, req, sent, &seed);
+
+out:
+    if (mq_server != (mqd_t)-1) mq_close(mq_server);
+    if (mq_reply != (mqd_t)-1) {
+        mq_close(mq_reply);
+        mq_unlink(req->reply_to);
+    }
+    return NULL;
+}
+
+static void print_class(int n_clients, double rate, const char* name, bench_client_t* clients, int high,
+                        long rejected, int failed) {
+    long total = 0;
+    for (int i = 0; i < n_clients; ++i) total += clients[i].n_samples[high];
+    if (total == 0) return;
+    uint64_t* all = malloc((size_t)total * sizeof(uint64_t));
+    if (!all) return;
+    long pos = 0;
+    for (int i = 0; i < n_clients; ++i) {
+        memcpy(all + pos, clients[i].samples[high], (size_t)clients[i].n_samples[high] * sizeof(uint64_t));
+        pos += clients[i].n_samples[high];
+    }
+    static const double pct[] = {50.0, 99.0, 100.0};
+    int64_t q[3];
+    rt_stats_percentiles((int64_t*)all, (size_t)total, pct, 3, q);
+    printf("%7d %12.0f %-7s %10.1f %10.1f %10.1f %9ld%s\n", n_clients, rate, name, q[0] / 1e3, q[1] / 1e3,
+           q[2] / 1e3, rejected, failed ? "  (errors)" : "");
+    free(all);
+}
+
+static int run(int n_clients, long n_msgs, int window, size_t size, int high_pct, uint32_t work_us) {
+    static bench_client_t clients[MAX_BENCH_CLIENTS];
+    memset(clients, 0, sizeof(clients));
+    uint64_t start = now_ns();
+    for (int i = 0; i < n_clients; ++i) {
+        clients[i].id = i;
+        clients[i].n_msgs = n_msgs;
+        clients[i].window = window;
+        clients[i].size = size;
+        clients[i].high_pct = high_pct;
+        clients[i].work_us = work_us;
+        if (pthread_create(&clients[i].thread, NULL, client_main, &clients[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    long total = 0, rejected = 0;
+    int failed = 0;
+    for (int i = 0; i < n_clients; ++i) {
+        pthread_join(clients[i].thread, NULL);
+        total += clients[i].n_samples[0] + clients[i].n_samples[1] + clients[i].rejected;
+        rejected += clients[i].rejected;
+        failed |= clients[i].failed;
+    }
+    double rate = total / ((now_ns() - start) / 1e9);
+
+    if (total == rejected) printf("%7d %12s\n", n_clients, "failed");
+    print_class(n_clients, rate, "normal", clients, 0, rejected, failed);
+    print_class(n_clients, rate, "high", clients, 1, rejected, failed);
+    for (int i = 0; i < n_clients; ++i) {
+        free(clients[i].samples[0]);
+        free(clients[i].samples[1]);
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    int max_clients = 8, window = 1, high_pct = 0;
+    uint32_t work_us = 0;
+    long n_msgs = 100000;
+    size_t size = 64;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:w:s:H:W:")) != -1) {
+        switch (opt) {
+        case 'c': max_clients = atoi(optarg); break;
+        case 'n': n_msgs = atol(optarg); break;
+        case 'w': window = atoi(optarg); break;
+        case 's': size = (size_t)atol(optarg); break;
+        case 'H': high_pct = atoi(optarg); break;
+        case 'W': work_us = (uint32_t)atol(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-c clients] [-n msgs_per_client] [-w window] [-s size] [-H high_pct] [-W work_us]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (max_clients < 1 || max_clients > MAX_BENCH_CLIENTS || n_msgs < 1 || window < 1 || window > MAX_WINDOW ||
+        size < 1 || size > MQ_DATA_MAX || high_pct < 0 || high_pct > 100) {
+        fprintf(stderr, "clients 1..%d, msgs >= 1, window 1..%d, size 1..%zu, high_pct 0..100\n", MAX_BENCH_CLIENTS,
+                MAX_WINDOW, (size_t)MQ_DATA_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%ld messages per client, window %d, %zu-byte payload, %d%% high priority, normal work %u us\n", n_msgs,
+           window, size, high_pct, (unsigned)work_us);
+    printf("%7s %12s %-7s %10s %10s %10s %9s\n", "clients", "msgs/s", "prio", "p50 us", "p99 us", "max us",
+           "rejected");
+    int failed = 0;
+    for (int n = 1;; n *= 2) {
+        if (n > max_clients) n = max_clients;
+        failed |= run(n, n_msgs, window, size, high_pct, work_us);
+        if (n == max_clients) break;
+    }
+    return failed ? EXIT_FAILURE : 0;
+}
@@ -3,15 +3,108 @@
  *
  * Ожидает сообщения от клиентов, преобразует их в верхний регистр
  * и отправляет обратно. Демонстрирует работу с приоритетами.
+ *
+ * Режим -b (пакетный): очередь ответа называется в заголовке каждого
+ * запроса (mq_request_t), и дескрипторы очередей клиентов кешируются -
+ * mq_open/mq_close на каждый ответ стоят больше самой пересылки. После
+ * первого блокирующего mq_receive очередь вычитывается неблокирующе до
+ * EAGAIN, как в task2/mq_clean_burst.c, и ничего не печатается на каждое
+ * сообщение: сводка выводится по Ctrl+C. Нагрузка - mq_bench.
+ *
+ * Режим -p (диспетчер): запросы обоих режимов выполняет не поток приема.
+ * Диспетчер (SCHED_FIFO 60) раскладывает их по классам приоритета
+ * сообщения - MSG_PRIO_HIGH и выше в срочный, остальное в обычный, - а
+ * каждый класс обслуживает свой пул потоков с SCHED_FIFO 50 и 20
+ * соответственно. Долгий обычный запрос вытесняется срочным, и время
+ * ответа на срочный не зависит от обычной нагрузки. Для каждого класса
+ * выводятся максимальная глубина очереди и задержка от приема до ответа.
  */
+#define _GNU_SOURCE
+#include <errno.h>
 #include <mqueue.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include "common.h"
+#include "rt_stats.h"
+#include "rt_time.h"
+
+#define MAX_CLIENTS 64  // Кешируемых дескрипторов очередей ответов
+
+#define CLASS_QUEUE_CAP   1024  // Запросов в очереди класса; дальше - MQ_FLAG_REJECTED
+#define MAX_CLASS_WORKERS 16
+#define DISPATCH_RT_PRIO  60    // Диспетчер выше всех рабочих: срочный запрос не ждет приема
+#define HIGH_RT_PRIO      50
+#define NORMAL_RT_PRIO    20
+
+typedef struct {
+    char name[REPLY_NAME_MAX];  // Пустое имя - ячейка не привязана к клиенту
+    mqd_t mq;                   // -1 - закрыт
+    atomic_int inflight;        // Ответов в работе у рабочих (-p): ячейку нельзя вытеснять
+} reply_handle_t;
+
+typedef struct {
+    unsigned long long messages;
+    unsigned long long bursts;
+    unsigned long long max_burst;
+    unsigned long long opens;       // mq_open очередей ответов
+    unsigned long long evictions;   // Вытеснений из полного кеша
+    unsigned long long dropped;     // Ответ не влез в очередь клиента
+    unsigned long long invalid;
+} batch_stats_t;
+
+// Запрос, переданный диспетчером в очередь класса
+typedef struct {
+    reply_handle_t *reply;
+    unsigned int priority;
+    int64_t recv_ns;
+    _Alignas(mq_request_t) char buffer[MAX_MSG_SIZE];
+} dispatch_item_t;
+
+struct prio_class;
+
+typedef struct {
+    pthread_t thread;
+    struct prio_class *cls;
+    unsigned long long handled;
+    unsigned long long dropped;
+    RtHistogram latency;        // От приема диспетчером до отправки ответа, нс
+} class_worker_t;
+
+typedef struct prio_class {
+    const char *name;
+    int rt_prio;                // 0 - SCHED_OTHER
+    int n_workers;
+    class_worker_t workers[MAX_CLASS_WORKERS];
+    pthread_mutex_t lock;
+    pthread_cond_t nonempty;
+    dispatch_item_t ring[CLASS_QUEUE_CAP];
+    unsigned head;              // Поля ниже - под lock
+    unsigned tail;
+    int stop;
+    unsigned long long queued;
+    unsigned long long rejected;
+    unsigned max_depth;
+} prio_class_t;
+
+static reply_handle_t replies[MAX_CLIENTS];
+static unsigned evict_cursor = 0;
+static batch_stats_t stats;
+static prio_class_t classes[2]; // 0 - обычный, 1 - срочный
+static volatile sig_atomic_t done = 0;
+
+static void term(int signum) {
+    (void)signum;
+    done = 1;
+}
 
 void to_upper(char *str) {
     for (int i = 0; str[i]; i++) {
@@ -19,7 +112,366 @@ void to_upper(char *str) {
     }
 }
 
-int main() {
+static void to_upper_n(char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (char)toupper((unsigned char)data[i]);
+    }
+}
+
+/*
+ * Дескриптор очереди ответов по имени. Клиентов немного (MAX_CLIENTS),
+ * и линейный поиск по кешу дешевле любого системного вызова. Очередь
+ * открывается неблокирующей: ушедший без MQ_FLAG_BYE клиент не должен
+ * останавливать сервер, его ответы просто теряются.
+ * @return NULL, если очередь не открылась или весь кеш занят ответами в работе.
+ */
+static reply_handle_t *reply_lookup(const char *name) {
+    int free_slot = -1;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (strcmp(replies[i].name, name) == 0) return &replies[i];
+        if (free_slot < 0 && replies[i].name[0] == '\0' &&
+            atomic_load_explicit(&replies[i].inflight, memory_order_acquire) == 0) {
+            free_slot = i;
+        }
+    }
+    int slot = free_slot;
+    for (int k = 0; slot < 0 && k < MAX_CLIENTS; ++k) {
+        int i = (int)((evict_cursor + (unsigned)k) % MAX_CLIENTS);
+        if (atomic_load_explicit(&replies[i].inflight, memory_order_acquire) == 0) slot = i;
+    }
+    if (slot < 0) return NULL;
+
+    mqd_t mq = mq_open(name, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (mq == (mqd_t)-1) return NULL;
+    stats.opens++;
+    if (replies[slot].name[0] != '\0') {
+        stats.evictions++;
+        evict_cursor = (unsigned)slot + 1;
+    }
+    if (replies[slot].mq != (mqd_t)-1) mq_close(replies[slot].mq);
+    strcpy(replies[slot].name, name);
+    replies[slot].mq = mq;
+    return &replies[slot];
+}
+
+static void reply_forget(const char *name) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (strcmp(replies[i].name, name) == 0) {
+            // Имя отвязывается сразу: клиент с тем же именем получит новую
+            // очередь. Рабочий (-p) мог еще не отметить отправленный ответ -
+            // тогда дескриптор закроется при повторном использовании ячейки
+            replies[i].name[0] = '\0';
+            if (atomic_load_explicit(&replies[i].inflight, memory_order_acquire) == 0) {
+                mq_close(replies[i].mq);
+                replies[i].mq = (mqd_t)-1;
+            }
+            return;
+        }
+    }
+}
+
+static void reply_init(void) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) replies[i].mq = (mqd_t)-1;
+}
+
+static void reply_close_all(void) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (replies[i].mq != (mqd_t)-1) mq_close(replies[i].mq);
+        replies[i].mq = (mqd_t)-1;
+        replies[i].name[0] = '\0';
+    }
+}
+
+static mq_request_t *parse_request(char *buffer, ssize_t bytes) {
+    mq_request_t *req = (mq_request_t *)buffer;
+    if ((size_t)bytes < sizeof(*req) || req->len > (size_t)bytes - sizeof(*req) ||
+        memchr(req->reply_to, '\0', REPLY_NAME_MAX) == NULL ||
+        strncmp(req->reply_to, CLIENT_QUEUE_PREFIX, strlen(CLIENT_QUEUE_PREFIX)) != 0) {
+        stats.invalid++;
+        return NULL;
+    }
+    stats.messages++;
+    return req;
+}
+
+// Выполняет запрос: work_us активного ожидания (имитация вычислений) и верхний регистр
+static void serve_request(mq_request_t *req) {
+    if (req->work_us > 0) {
+        int64_t end = rt_now_ns() + (int64_t)req->work_us * RT_NSEC_PER_USEC;
+        while (rt_now_ns() < end) {
+        }
+    }
+    to_upper_n(req->data, req->len);
+}
+
+static void handle_request(char *buffer, ssize_t bytes, unsigned int priority) {
+    mq_request_t *req = parse_request(buffer, bytes);
+    if (!req) return;
+    if (req->flags & MQ_FLAG_BYE) {
+        reply_forget(req->reply_to);
+        return;
+    }
+    reply_handle_t *reply = reply_lookup(req->reply_to);
+    if (!reply) {
+        stats.dropped++;
+        return;
+    }
+    serve_request(req);
+    if (mq_send(reply->mq, buffer, sizeof(*req) + req->len, priority) == -1) {
+        if (errno != EAGAIN) perror("mq_send");
+        stats.dropped++;
+    }
+}
+
+static mqd_t open_server_queue(int flags) {
+    struct mq_attr attr;
+    attr.mq_flags = 0;
+    attr.mq_maxmsg = 10;
+    attr.mq_msgsize = MAX_MSG_SIZE;
+    attr.mq_curmsgs = 0;
+    mqd_t mq = mq_open(SERVER_QUEUE_NAME, flags | O_CLOEXEC, 0644, &attr);
+    if (mq == (mqd_t)-1) {
+        perror("mq_open (server)");
+        exit(1);
+    }
+    return mq;
+}
+
+/*
+ * Цикл приема обоих режимов: блокирующий mq_receive первого сообщения
+ * пачки, затем неблокирующее осушение очереди. Второй, неблокирующий
+ * дескриптор той же очереди заменяет два mq_setattr на каждую пачку,
+ * как в mq_clean_burst.c.
+ */
+static void receive_loop(void (*handle)(char *, ssize_t, unsigned int)) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = term; // Без SA_RESTART: mq_receive прервется с EINTR
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    reply_init();
+    mq_unlink(SERVER_QUEUE_NAME);
+    mqd_t mq_server = open_server_queue(O_CREAT | O_RDONLY);
+    mqd_t mq_drain = open_server_queue(O_RDONLY | O_NONBLOCK);
+    printf("Server is running on %s (Ctrl+C for stats)...\n", SERVER_QUEUE_NAME);
+    fflush(stdout);
+
+    _Alignas(mq_request_t) char buffer[MAX_MSG_SIZE];
+    unsigned int priority;
+    while (!done) {
+        // 1. Блокирующе ждем первое сообщение пачки
+        ssize_t bytes = mq_receive(mq_server, buffer, sizeof(buffer), &priority);
+        if (bytes == -1) {
+            if (errno == EINTR) continue;
+            perror("mq_receive");
+            break;
+        }
+        unsigned long long burst = 1;
+        handle(buffer, bytes, priority);
+        // 2. Забираем все, что накопилось, без блокировки (старшие приоритеты первыми)
+        while ((bytes = mq_receive(mq_drain, buffer, sizeof(buffer), &priority)) >= 0) {
+            handle(buffer, bytes, priority);
+            burst++;
+        }
+        if (errno != EAGAIN && errno != EINTR) perror("mq_receive (drain)");
+        stats.bursts++;
+        if (burst > stats.max_burst) stats.max_burst = burst;
+    }
+
+    printf("\nmessages: %llu, bursts: %llu (avg %.2f, max %llu), reply queue opens: %llu, evictions: %llu, "
+           "dropped replies: %llu, invalid: %llu\n",
+           stats.messages, stats.bursts, stats.bursts ? (double)stats.messages / stats.bursts : 0.0,
+           stats.max_burst, stats.opens, stats.evictions, stats.dropped, stats.invalid);
+    mq_close(mq_drain);
+    mq_close(mq_server);
+    mq_unlink(SERVER_QUEUE_NAME);
+}
+
+static int run_batched(void) {
+    receive_loop(handle_request);
+    reply_close_all();
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Диспетчер по приоритетам (-p)
+// ---------------------------------------------------------------------------
+
+static void *class_worker_main(void *arg) {
+    class_worker_t *w = arg;
+    prio_class_t *cls = w->cls;
+    dispatch_item_t item;
+    for (;;) {
+        pthread_mutex_lock(&cls->lock);
+        while (cls->head == cls->tail && !cls->stop) pthread_cond_wait(&cls->nonempty, &cls->lock);
+        if (cls->stop) {
+            pthread_mutex_unlock(&cls->lock);
+            break;
+        }
+        item = cls->ring[cls->head % CLASS_QUEUE_CAP];
+        cls->head++;
+        pthread_mutex_unlock(&cls->lock);
+
+        mq_request_t *req = (mq_request_t *)item.buffer;
+        serve_request(req);
+        if (mq_send(item.reply->mq, item.buffer, sizeof(*req) + req->len, item.priority) == -1) {
+            w->dropped++;
+        } else {
+            w->handled++;
+        }
+        atomic_fetch_sub_explicit(&item.reply->inflight, 1, memory_order_release);
+        rt_hist_record(&w->latency, rt_now_ns() - item.recv_ns);
+    }
+    return NULL;
+}
+
+static void dispatch_request(char *buffer, ssize_t bytes, unsigned int priority) {
+    int64_t now = rt_now_ns();
+    mq_request_t *req = parse_request(buffer, bytes);
+    if (!req) return;
+    if (req->flags & MQ_FLAG_BYE) {
+        reply_forget(req->reply_to);
+        return;
+    }
+    reply_handle_t *reply = reply_lookup(req->reply_to);
+    if (!reply) {
+        stats.dropped++;
+        return;
+    }
+    prio_class_t *cls = &classes[priority >= MSG_PRIO_HIGH];
+    pthread_mutex_lock(&cls->lock);
+    unsigned depth = cls->tail - cls->head;
+    if (depth == CLASS_QUEUE_CAP) {
+        cls->rejected++;
+        pthread_mutex_unlock(&cls->lock);
+        // Клиент ждет ответа: сообщить об отказе, а не молчать
+        req->flags |= MQ_FLAG_REJECTED;
+        req->len = 0;
+        if (mq_send(reply->mq, buffer, sizeof(*req), priority) == -1) stats.dropped++;
+        return;
+    }
+    dispatch_item_t *item = &cls->ring[cls->tail % CLASS_QUEUE_CAP];
+    item->reply = reply;
+    item->priority = priority;
+    item->recv_ns = now;
+    memcpy(item->buffer, buffer, (size_t)bytes);
+    atomic_fetch_add_explicit(&reply->inflight, 1, memory_order_relaxed);
+    cls->tail++;
+    cls->queued++;
+    if (depth + 1 > cls->max_depth) cls->max_depth = depth + 1;
+    pthread_cond_signal(&cls->nonempty);
+    pthread_mutex_unlock(&cls->lock);
+}
+
+// Поток с SCHED_FIFO rt_prio. Политика задается явно, а не наследуется от
+// диспетчера; 0 или нет прав (EPERM) - SCHED_OTHER
+static int start_rt_thread(pthread_t *thread, int rt_prio, void *(*fn)(void *), void *arg) {
+    for (;;) {
+        pthread_attr_t attr;
+        struct sched_param param = {.sched_priority = rt_prio};
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, rt_prio > 0 ? SCHED_FIFO : SCHED_OTHER);
+        pthread_attr_setschedparam(&attr, &param);
+        int rc = pthread_create(thread, &attr, fn, arg);
+        pthread_attr_destroy(&attr);
+        if (rc != EPERM || rt_prio == 0) return rc;
+        fprintf(stderr, "SCHED_FIFO %d not permitted, worker runs as SCHED_OTHER\n", rt_prio);
+        rt_prio = 0;
+    }
+}
+
+static int run_dispatch(int normal_workers, int high_workers, int normal_prio) {
+    const char *names[2] = {"normal", "high"};
+    int prios[2] = {normal_prio, HIGH_RT_PRIO};
+    int counts[2] = {normal_workers, high_workers};
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) perror("mlockall (continuing)");
+    struct sched_param param = {.sched_priority = DISPATCH_RT_PRIO};
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        fprintf(stderr, "SCHED_FIFO %d not permitted for the dispatcher\n", DISPATCH_RT_PRIO);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int c = 0; c < 2; ++c) {
+        prio_class_t *cls = &classes[c];
+        cls->name = names[c];
+        cls->rt_prio = prios[c];
+        cls->n_workers = counts[c];
+        pthread_mutex_init(&cls->lock, NULL);
+        pthread_cond_init(&cls->nonempty, NULL);
+        for (int i = 0; i < cls->n_workers; ++i) {
+            class_worker_t *w = &cls->workers[i];
+            w->cls = cls;
+            rt_hist_init(&w->latency);
+            if (start_rt_thread(&w->thread, cls->rt_prio, class_worker_main, w) != 0) {
+                perror("pthread_create");
+                exit(1);
+            }
+        }
+    }
+    printf("Dispatcher: SCHED_FIFO %d; normal: %d worker(s), prio %d; high (priority >= %d): %d worker(s), prio %d\n",
+           DISPATCH_RT_PRIO, normal_workers, normal_prio, MSG_PRIO_HIGH, high_workers, HIGH_RT_PRIO);
+
+    receive_loop(dispatch_request);
+
+    printf("%-7s %5s %8s %10s %9s %8s %10s\n", "class", "prio", "workers", "handled", "rejected", "dropped",
+           "max depth");
+    for (int c = 0; c < 2; ++c) {
+        prio_class_t *cls = &classes[c];
+        pthread_mutex_lock(&cls->lock);
+        cls->stop = 1;
+        pthread_cond_broadcast(&cls->nonempty);
+        pthread_mutex_unlock(&cls->lock);
+    }
+    static RtHistogram latency[2];
+    for (int c = 0; c < 2; ++c) {
+        prio_class_t *cls = &classes[c];
+        unsigned long long handled = 0, dropped = 0;
+        rt_hist_init(&latency[c]);
+        for (int i = 0; i < cls->n_workers; ++i) {
+            pthread_join(cls->workers[i].thread, NULL);
+            handled += cls->workers[i].handled;
+            dropped += cls->workers[i].dropped;
+            rt_hist_merge(&latency[c], &cls->workers[i].latency);
+        }
+        printf("%-7s %5d %8d %10llu %9llu %8llu %10u\n", cls->name, cls->rt_prio, cls->n_workers, handled,
+               cls->rejected, dropped, cls->max_depth);
+    }
+    for (int c = 0; c < 2; ++c) rt_hist_print_summary(stdout, classes[c].name, &latency[c]);
+    reply_close_all();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int batched = 0, dispatch = 0;
+    int normal_workers = 2, high_workers = 1, normal_prio = NORMAL_RT_PRIO;
+    int opt;
+    while ((opt = getopt(argc, argv, "bpt:T:P:")) != -1) {
+        switch (opt) {
+        case 'b': batched = 1; break;
+        case 'p': dispatch = 1; break;
+        case 't': normal_workers = atoi(optarg); break;
+        case 'T': high_workers = atoi(optarg); break;
+        case 'P': normal_prio = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-b | -p [-t normal_workers] [-T high_workers] [-P normal_rt_prio]]\n",
+                    argv[0]);
+            exit(1);
+        }
+    }
+    if (dispatch) {
+        if (normal_workers < 1 || normal_workers > MAX_CLASS_WORKERS || high_workers < 1 ||
+            high_workers > MAX_CLASS_WORKERS || normal_prio < 0 || normal_prio >= HIGH_RT_PRIO) {
+            fprintf(stderr, "workers 1..%d per class, normal_rt_prio 0..%d (0 - SCHED_OTHER)\n", MAX_CLASS_WORKERS,
+                    HIGH_RT_PRIO - 1);
+            exit(1);
+        }
+        return run_dispatch(normal_workers, high_workers, normal_prio);
+    }
+    if (batched) return run_batched();
+
     mqd_t mq_server, mq_client;
     struct mq_attr attr;
 
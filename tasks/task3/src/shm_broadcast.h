@@ -0,0 +1,275 @@
+#ifndef SHM_BROADCAST_H
+#define SHM_BROADCAST_H
+
+/*
+ * Широковещательное кольцо в разделяемой памяти (в стиле disruptor):
+ * один писатель, до SHM_BCAST_MAX_READERS читателей, каждый со своим
+ * курсором. Сообщение прочитают все подключенные читатели.
+ *
+ * Читатели двух видов:
+ * - critical: писатель не перезапишет ячейку, пока ее не прочитал самый
+ *   медленный critical-читатель (сообщения не теряются, но такой читатель
+ *   тормозит писателя);
+ * - lossy: писатель их не ждет. Отставший больше чем на емкость кольца
+ *   читатель перескакивает вперед и видит, сколько сообщений пропустил.
+ *
+ * В каждой ячейке рядом со значением хранится номер сообщения + 1.
+ * Писатель сначала помечает ячейку SHM_BCAST_WRITING, затем пишет значение
+ * и номер, поэтому lossy-читатель, чью ячейку перезаписали во время
+ * чтения, это обнаружит (как у seqlock).
+ */
+
+#include "shm_spsc.h"
+
+#define SHM_BCAST_NAME        "/shm_bcast_ex"
+#define SHM_BCAST_MAGIC       0x42434153u // "BCAS"
+#define SHM_BCAST_MAX_READERS 8
+#define SHM_BCAST_WRITING     UINT64_MAX
+
+enum { SHM_BCAST_FREE, SHM_BCAST_JOINING, SHM_BCAST_ACTIVE };
+
+typedef struct {
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t cursor; // Следующее сообщение для чтения
+    _Atomic uint64_t skipped;                        // Потеряно из-за отставания (lossy)
+    _Atomic uint32_t state;                          // SHM_BCAST_FREE / JOINING / ACTIVE
+    uint32_t critical;
+} shm_bcast_reader_t;
+
+typedef struct {
+    _Atomic uint64_t seq;   // Номер сообщения + 1; 0 - пусто; SHM_BCAST_WRITING
+    _Atomic uint64_t value;
+} shm_bcast_slot_t;
+
+typedef struct {
+    alignas(SHM_CACHE_LINE) uint32_t magic;
+    uint64_t capacity;
+    uint64_t mask;
+
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t published; // Сколько сообщений опубликовано
+
+    alignas(SHM_CACHE_LINE) _Atomic uint32_t wake_seq;
+    _Atomic uint32_t sleepers;  // Читатели, уснувшие на futex
+    _Atomic uint32_t closed;
+
+    shm_bcast_reader_t readers[SHM_BCAST_MAX_READERS];
+
+    alignas(SHM_CACHE_LINE) shm_bcast_slot_t slots[];
+} shm_bcast_t;
+
+typedef struct {
+    shm_bcast_t* ring;
+    uint64_t next;      // Номер следующего сообщения
+    uint64_t gate;      // Нижняя граница курсоров critical-читателей (кэш)
+} shm_bcast_writer_t;
+
+typedef struct {
+    shm_bcast_t* ring;
+    shm_bcast_reader_t* self;
+    uint64_t cursor;
+    uint64_t skipped;
+} shm_bcast_reader_end_t;
+
+static inline size_t shm_bcast_bytes(uint64_t capacity) {
+    return sizeof(shm_bcast_t) + capacity * sizeof(shm_bcast_slot_t);
+}
+
+static inline shm_bcast_t* shm_bcast_create(const char* name, uint64_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    size_t bytes = shm_bcast_bytes(capacity);
+    if (ftruncate(fd, (off_t)bytes) == -1) {
+        close(fd);
+        return NULL;
+    }
+    shm_bcast_t* ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+
+    // Свежий сегмент после ftruncate заполнен нулями: ячейки пусты, читатели свободны
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SHM_BCAST_MAGIC;
+    return ring;
+}
+
+static inline shm_bcast_t* shm_bcast_open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(shm_bcast_t)) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+    shm_bcast_t* ring = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+    if (ring->magic != SHM_BCAST_MAGIC || shm_bcast_bytes(ring->capacity) != (size_t)st.st_size) {
+        munmap(ring, (size_t)st.st_size);
+        errno = EAGAIN;
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return ring;
+}
+
+static inline void shm_bcast_close(shm_bcast_t* ring) {
+    munmap(ring, shm_bcast_bytes(ring->capacity));
+}
+
+static inline int shm_bcast_reader_count(shm_bcast_t* ring) {
+    int count = 0;
+    for (int i = 0; i < SHM_BCAST_MAX_READERS; ++i) {
+        count += atomic_load_explicit(&ring->readers[i].state, memory_order_acquire) == SHM_BCAST_ACTIVE;
+    }
+    return count;
+}
+
+static inline void shm_bcast_writer_init(shm_bcast_writer_t* w, shm_bcast_t* ring) {
+    w->ring = ring;
+    w->next = atomic_load_explicit(&ring->published, memory_order_relaxed);
+    w->gate = w->next;
+}
+
+// Наименьший курсор среди активных critical-читателей (или next, если их нет)
+static inline uint64_t shm_bcast_min_gate(shm_bcast_writer_t* w) {
+    uint64_t gate = w->next;
+    for (int i = 0; i < SHM_BCAST_MAX_READERS; ++i) {
+        shm_bcast_reader_t* r = &w->ring->readers[i];
+        if (atomic_load_explicit(&r->state, memory_order_acquire) != SHM_BCAST_ACTIVE || !r->critical) continue;
+        uint64_t cursor = atomic_load_explicit(&r->cursor, memory_order_acquire);
+        if (cursor < gate) gate = cursor;
+    }
+    return gate;
+}
+
+// 0 - опубликовано; -1 - critical-читатель еще не освободил ячейку
+static inline int shm_bcast_try_publish(shm_bcast_writer_t* w, uint64_t value) {
+    shm_bcast_t* ring = w->ring;
+    if (w->next - w->gate >= ring->capacity) {
+        w->gate = shm_bcast_min_gate(w);
+        if (w->next - w->gate >= ring->capacity) return -1;
+    }
+    shm_bcast_slot_t* slot = &ring->slots[w->next & ring->mask];
+    atomic_store_explicit(&slot->seq, SHM_BCAST_WRITING, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, w->next + 1, memory_order_release);
+    atomic_store_explicit(&ring->published, ++w->next, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleepers, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&ring->wake_seq, 1, memory_order_release);
+        shm_futex(&ring->wake_seq, FUTEX_WAKE, INT_MAX);
+    }
+    return 0;
+}
+
+static inline void shm_bcast_close_writer(shm_bcast_t* ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->wake_seq, 1, memory_order_seq_cst);
+    shm_futex(&ring->wake_seq, FUTEX_WAKE, INT_MAX);
+}
+
+/**
+ * @brief Подключает читателя; он получит сообщения, опубликованные после этого.
+ *
+ * Critical-читатель обязан вызвать shm_bcast_leave() перед выходом, иначе
+ * писатель остановится, когда догонит его курсор.
+ *
+ * @return 0 или -1 (errno = EBUSY - все места заняты).
+ */
+static inline int shm_bcast_join(shm_bcast_reader_end_t* r, shm_bcast_t* ring, int critical) {
+    for (int i = 0; i < SHM_BCAST_MAX_READERS; ++i) {
+        shm_bcast_reader_t* slot = &ring->readers[i];
+        uint32_t expected = SHM_BCAST_FREE;
+        if (!atomic_compare_exchange_strong(&slot->state, &expected, SHM_BCAST_JOINING)) continue;
+        r->ring = ring;
+        r->self = slot;
+        r->cursor = atomic_load_explicit(&ring->published, memory_order_acquire);
+        r->skipped = 0;
+        slot->critical = (uint32_t)critical;
+        atomic_store_explicit(&slot->skipped, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->cursor, r->cursor, memory_order_relaxed);
+        atomic_store_explicit(&slot->state, SHM_BCAST_ACTIVE, memory_order_release);
+        return 0;
+    }
+    errno = EBUSY;
+    return -1;
+}
+
+static inline void shm_bcast_leave(shm_bcast_reader_end_t* r) {
+    atomic_store_explicit(&r->self->state, SHM_BCAST_FREE, memory_order_release);
+}
+
+// 0 - прочитано; -1 - новых сообщений нет. Потери копятся в r->skipped.
+static inline int shm_bcast_try_read(shm_bcast_reader_end_t* r, uint64_t* value) {
+    shm_bcast_t* ring = r->ring;
+    for (;;) {
+        uint64_t published = atomic_load_explicit(&ring->published, memory_order_acquire);
+        if (r->cursor == published) return -1;
+        if (published - r->cursor > ring->capacity) {
+            // Писатель ушел больше чем на круг: перескочить к самому старому доступному
+            r->skipped += published - ring->capacity - r->cursor;
+            r->cursor = published - ring->capacity;
+        }
+
+        shm_bcast_slot_t* slot = &ring->slots[r->cursor & ring->mask];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        uint64_t v = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != r->cursor + 1 || atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+            // Ячейку перезаписали до или во время чтения - сообщение потеряно
+            r->skipped++;
+            r->cursor++;
+            continue;
+        }
+        *value = v;
+        r->cursor++;
+        atomic_store_explicit(&r->self->cursor, r->cursor, memory_order_release);
+        if (r->skipped) atomic_store_explicit(&r->self->skipped, r->skipped, memory_order_relaxed);
+        return 0;
+    }
+}
+
+/**
+ * @brief Ждет следующее сообщение (см. shm_spsc_pop о параметре block).
+ * @return 0 или -1: errno = EPIPE (писатель закрыл кольцо, все прочитано) / EINTR.
+ */
+static inline int shm_bcast_read(shm_bcast_reader_end_t* r, uint64_t* value, int block) {
+    shm_bcast_t* ring = r->ring;
+    for (unsigned spins = 0;; ++spins) {
+        if (shm_bcast_try_read(r, value) == 0) return 0;
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            if (shm_bcast_try_read(r, value) == 0) return 0;
+            errno = EPIPE;
+            return -1;
+        }
+        if (!block || spins < SHM_SPSC_SPIN_LIMIT) {
+            shm_cpu_relax();
+            continue;
+        }
+
+        uint32_t seq = atomic_load_explicit(&ring->wake_seq, memory_order_acquire);
+        atomic_fetch_add_explicit(&ring->sleepers, 1, memory_order_seq_cst);
+        int rc = 0;
+        if (atomic_load_explicit(&ring->published, memory_order_seq_cst) == r->cursor &&
+            !atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            rc = (int)shm_futex(&ring->wake_seq, FUTEX_WAIT, seq);
+        }
+        int saved = errno;
+        atomic_fetch_sub_explicit(&ring->sleepers, 1, memory_order_relaxed);
+        if (rc == -1 && saved == EINTR) {
+            errno = EINTR;
+            return -1;
+        }
+        spins = 0;
+    }
+}
+
+#endif // SHM_BROADCAST_H
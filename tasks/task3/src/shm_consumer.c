@@ -4,7 +4,18 @@
  * 1. Открывает существующий сегмент разделяемой памяти.
  * 2. Открывает существующие семафоры.
  * 3. В цикле читает данные из кольцевого буфера, когда они доступны.
+ *
+ * Режим -m spsc: чтение из lock-free кольца shm_spsc.h; -s - только
+ * активный опрос, без сна на futex.
+ *
+ * Режим -m var: кадры переменной длины (shm_varring.h) читаются прямо
+ * из общей памяти и освобождаются после проверки, без копирования.
+ *
+ * Режим -m bcast: один из читателей широковещательного кольца
+ * shm_broadcast.h; -C - critical (producer его ждет), иначе lossy
+ * (пропускает сообщения при отставании). -d - имитация обработки, мкс.
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -13,19 +24,180 @@
 #include <fcntl.h>
 #include <semaphore.h>
 #include <signal.h>
+#include <string.h>
+#include <time.h>
 #include "shm_common.h"
+#include "shm_spsc.h"
+#include "shm_varring.h"
+#include "shm_broadcast.h"
 
 volatile sig_atomic_t done = 0;
 void term(int signum) {
+    (void)signum;
     done = 1;
 }
 
-int main() {
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run_spsc(int block) {
+    shm_spsc_t *ring;
+    // Ждать, пока producer создаст и инициализирует кольцо
+    while ((ring = shm_spsc_open(SHM_SPSC_NAME)) == NULL) {
+        if (done || (errno != ENOENT && errno != EAGAIN)) {
+            perror("shm_spsc_open");
+            return EXIT_FAILURE;
+        }
+        usleep(10000);
+    }
+    printf("Consumer: SPSC ring of %llu slots opened (%s)\n",
+           (unsigned long long)ring->capacity, block ? "spin, then futex" : "busy-poll");
+
+    shm_spsc_end_t consumer;
+    shm_spsc_consumer_init(&consumer, ring);
+    uint64_t expected = 0, errors = 0, value;
+    double start = 0.0;
+    while (!done) {
+        if (shm_spsc_pop(&consumer, &value, block) != 0) {
+            if (errno == EINTR) continue;
+            break; // EPIPE: producer закончил, кольцо пусто
+        }
+        if (expected == 0) start = now_sec();
+        if (value != expected) errors++;
+        expected = value + 1;
+    }
+    double elapsed = now_sec() - start;
+    shm_spsc_close_reader(ring); // Остановка по сигналу: producer не должен ждать места вечно
+
+    printf("Consumer: %llu values in %.3f s (%.1f M msg/s), order errors: %llu\n",
+           (unsigned long long)expected, elapsed, elapsed > 0 ? expected / elapsed / 1e6 : 0.0,
+           (unsigned long long)errors);
+    shm_spsc_close(ring);
+    shm_unlink(SHM_SPSC_NAME);
+    return errors ? EXIT_FAILURE : 0;
+}
+
+static int run_var(int block) {
+    shm_varring_t *ring;
+    while ((ring = shm_varring_open(SHM_VARRING_NAME)) == NULL) {
+        if (done || (errno != ENOENT && errno != EAGAIN)) {
+            perror("shm_varring_open");
+            return EXIT_FAILURE;
+        }
+        usleep(10000);
+    }
+    printf("Consumer: variable-length ring of %llu bytes opened (%s)\n",
+           (unsigned long long)ring->capacity, block ? "spin, then futex" : "busy-poll");
+
+    shm_varring_end_t consumer;
+    shm_varring_consumer_init(&consumer, ring);
+    uint64_t frames = 0, bytes = 0, errors = 0, len;
+    double start = 0.0;
+    while (!done) {
+        const unsigned char *frame = shm_varring_peek(&consumer, &len, block);
+        if (!frame) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (frames == 0) start = now_sec();
+        // Обработка на месте: номер кадра и последний байт заполнения
+        uint64_t seq;
+        memcpy(&seq, frame, sizeof(seq));
+        if (seq != frames || frame[len - 1] != (unsigned char)(seq & 0xff)) errors++;
+        frames++;
+        bytes += len;
+        shm_varring_release(&consumer);
+    }
+    double elapsed = now_sec() - start;
+    shm_varring_close_reader(ring); // Остановка по сигналу: producer не должен ждать места вечно
+
+    printf("Consumer: %llu frames, %.1f MB in %.3f s (%.0f MB/s), errors: %llu\n",
+           (unsigned long long)frames, bytes / 1e6, elapsed, elapsed > 0 ? bytes / elapsed / 1e6 : 0.0,
+           (unsigned long long)errors);
+    shm_varring_close(ring);
+    shm_unlink(SHM_VARRING_NAME);
+    return errors ? EXIT_FAILURE : 0;
+}
+
+static int run_bcast(int block, int critical, double delay_us) {
+    shm_bcast_t *ring;
+    while ((ring = shm_bcast_open(SHM_BCAST_NAME)) == NULL) {
+        if (done || (errno != ENOENT && errno != EAGAIN)) {
+            perror("shm_bcast_open");
+            return EXIT_FAILURE;
+        }
+        usleep(10000);
+    }
+    shm_bcast_reader_end_t reader;
+    if (shm_bcast_join(&reader, ring, critical) != 0) {
+        perror("shm_bcast_join");
+        shm_bcast_close(ring);
+        return EXIT_FAILURE;
+    }
+    const char *kind = critical ? "critical" : "lossy";
+    printf("Consumer: joined broadcast ring of %llu slots as %s reader (%s)\n",
+           (unsigned long long)ring->capacity, kind, block ? "spin, then futex" : "busy-poll");
+
+    uint64_t received = 0, errors = 0, expected = 0, value;
+    double start = 0.0;
+    while (!done) {
+        if (shm_bcast_read(&reader, &value, block) != 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (received == 0) {
+            start = now_sec();
+            expected = value;
+        }
+        // Пропуски допустимы только вперед и только у lossy-читателя
+        if (value < expected || (critical && value != expected)) errors++;
+        expected = value + 1;
+        received++;
+        if (delay_us > 0) {
+            double until = now_sec() + delay_us / 1e6;
+            while (now_sec() < until) shm_cpu_relax();
+        }
+    }
+    double elapsed = now_sec() - start;
+    shm_bcast_leave(&reader);
+
+    printf("Consumer[%s]: %llu messages in %.3f s, skipped %llu, order errors: %llu\n", kind,
+           (unsigned long long)received, elapsed, (unsigned long long)reader.skipped,
+           (unsigned long long)errors);
+    shm_bcast_close(ring);
+    return errors ? EXIT_FAILURE : 0;
+}
+
+int main(int argc, char *argv[]) {
     struct sigaction action;
+    memset(&action, 0, sizeof(action));
     action.sa_handler = term;
     sigaction(SIGINT, &action, NULL);
     sigaction(SIGTERM, &action, NULL);
 
+    const char *mode = "sem";
+    int block = 1;
+    int critical = 0;
+    double delay_us = 0.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:sCd:")) != -1) {
+        switch (opt) {
+        case 'm': mode = optarg; break;
+        case 's': block = 0; break;
+        case 'C': critical = 1; break;
+        case 'd': delay_us = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-m sem|spsc|var|bcast] [-s] [-C] [-d delay_us]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (strcmp(mode, "spsc") == 0) return run_spsc(block);
+    if (strcmp(mode, "var") == 0) return run_var(block);
+    if (strcmp(mode, "bcast") == 0) return run_bcast(block, critical, delay_us);
+
     // === 2. Открытие сегмента Shared Memory ===
     // Задержка, чтобы дать производителю время создать объекты
     sleep(1);
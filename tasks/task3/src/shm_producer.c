@@ -6,7 +6,19 @@
  *    - один показывает, сколько свободного места есть в буфере (для producer'а).
  *    - другой показывает, сколько элементов готовы для чтения (для consumer'а).
  * 3. В цикле записывает данные в кольцевой буфер.
+ *
+ * Режим -m spsc: вместо семафоров - lock-free кольцо из shm_spsc.h.
+ * Producer пишет -n чисел подряд без пауз и вывода, consumer проверяет
+ * порядок и считает пропускную способность.
+ *
+ * Режим -m var: кадры случайной длины 64 Б - 64 КБ (shm_varring.h)
+ * пишутся прямо в зарезервированное место общей памяти, без копирования.
+ *
+ * Режим -m bcast: широковещательное кольцо shm_broadcast.h. Producer ждет
+ * -k читателей и публикует -n номеров (с темпом -r сообщений/с, если задан);
+ * его тормозят только critical-читатели.
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -15,19 +27,196 @@
 #include <fcntl.h>
 #include <semaphore.h>
 #include <signal.h>
+#include <string.h>
+#include <time.h>
 #include "shm_common.h"
+#include "shm_spsc.h"
+#include "shm_varring.h"
+#include "shm_broadcast.h"
 
 volatile sig_atomic_t done = 0;
 void term(int signum) {
+    (void)signum;
     done = 1;
 }
 
-int main() {
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run_spsc(uint64_t count, uint64_t capacity) {
+    shm_unlink(SHM_SPSC_NAME);
+    shm_spsc_t *ring = shm_spsc_create(SHM_SPSC_NAME, capacity);
+    if (!ring) {
+        perror("shm_spsc_create");
+        return EXIT_FAILURE;
+    }
+    printf("Producer: SPSC ring of %llu slots created, writing %llu values...\n",
+           (unsigned long long)capacity, (unsigned long long)count);
+
+    shm_spsc_end_t producer;
+    shm_spsc_producer_init(&producer, ring);
+    double start = now_sec();
+    uint64_t i;
+    for (i = 0; i < count && !done; ++i) {
+        if (shm_spsc_push(&producer, i) != 0) {
+            fprintf(stderr, "Producer: consumer is gone, stopping\n");
+            break;
+        }
+    }
+    shm_spsc_close_writer(ring);
+    double elapsed = now_sec() - start;
+
+    printf("Producer: %llu values in %.3f s (%.1f M msg/s)\n",
+           (unsigned long long)i, elapsed, i / elapsed / 1e6);
+    // Сегмент удаляет consumer, дочитав кольцо
+    shm_spsc_close(ring);
+    return 0;
+}
+
+#define FRAME_MIN 64
+#define FRAME_MAX (64 * 1024)
+
+static int run_var(uint64_t count, uint64_t capacity) {
+    shm_unlink(SHM_VARRING_NAME);
+    shm_varring_t *ring = shm_varring_create(SHM_VARRING_NAME, capacity);
+    if (!ring) {
+        perror("shm_varring_create");
+        return EXIT_FAILURE;
+    }
+    if (shm_varring_max_record(ring) < FRAME_MAX) {
+        fprintf(stderr, "Ring of %llu bytes is too small for %d-byte frames\n",
+                (unsigned long long)capacity, FRAME_MAX);
+        shm_varring_close(ring);
+        shm_unlink(SHM_VARRING_NAME);
+        return EXIT_FAILURE;
+    }
+    printf("Producer: variable-length ring of %llu bytes created, writing %llu frames...\n",
+           (unsigned long long)capacity, (unsigned long long)count);
+
+    shm_varring_end_t producer;
+    shm_varring_producer_init(&producer, ring);
+    unsigned seed = 1;
+    uint64_t bytes = 0, i;
+    double start = now_sec();
+    for (i = 0; i < count && !done; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        uint64_t len = FRAME_MIN + (seed >> 8) % (FRAME_MAX - FRAME_MIN + 1);
+        unsigned char *frame;
+        for (unsigned spins = 0; (frame = shm_varring_reserve(&producer, len)) == NULL && !done; ++spins) {
+            if (errno == EPIPE) {
+                fprintf(stderr, "Producer: consumer is gone, stopping\n");
+                break;
+            }
+            if (spins < SHM_SPSC_SPIN_LIMIT) {
+                shm_cpu_relax();
+            } else {
+                sched_yield();
+            }
+        }
+        if (!frame) break;
+        // "Датчик" пишет кадр прямо в общую память: номер и заполнение
+        memcpy(frame, &i, sizeof(i));
+        memset(frame + sizeof(i), (int)(i & 0xff), len - sizeof(i));
+        shm_varring_commit(&producer, len);
+        bytes += len;
+    }
+    shm_varring_close_writer(ring);
+    double elapsed = now_sec() - start;
+
+    printf("Producer: %llu frames, %.1f MB in %.3f s (%.2f M frames/s, %.0f MB/s)\n",
+           (unsigned long long)i, bytes / 1e6, elapsed, i / elapsed / 1e6, bytes / elapsed / 1e6);
+    shm_varring_close(ring);
+    return 0;
+}
+
+static int run_bcast(uint64_t count, uint64_t capacity, double rate, int readers) {
+    shm_unlink(SHM_BCAST_NAME);
+    shm_bcast_t *ring = shm_bcast_create(SHM_BCAST_NAME, capacity);
+    if (!ring) {
+        perror("shm_bcast_create");
+        return EXIT_FAILURE;
+    }
+    printf("Producer: broadcast ring of %llu slots created, waiting for %d reader(s)...\n",
+           (unsigned long long)capacity, readers);
+    while (!done && shm_bcast_reader_count(ring) < readers) {
+        usleep(10000);
+    }
+
+    shm_bcast_writer_t writer;
+    shm_bcast_writer_init(&writer, ring);
+    uint64_t gated = 0, i;
+    double start = now_sec();
+    for (i = 0; i < count && !done; ++i) {
+        if (rate > 0) {
+            // Темп датчика: далеко до срока - спать, близко - крутиться
+            double wait;
+            while ((wait = start + i / rate - now_sec()) > 0) {
+                if (wait > 1e-3) {
+                    usleep((useconds_t)(wait * 1e6) - 500);
+                } else {
+                    shm_cpu_relax();
+                }
+            }
+        }
+        for (unsigned spins = 0; shm_bcast_try_publish(&writer, i) != 0 && !done; ++spins) {
+            if (spins == 0) gated++;
+            if (spins < SHM_SPSC_SPIN_LIMIT) {
+                shm_cpu_relax();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+    shm_bcast_close_writer(ring);
+    double elapsed = now_sec() - start;
+
+    printf("Producer: %llu messages in %.3f s (%.2f M msg/s), waited for critical readers %llu times\n",
+           (unsigned long long)i, elapsed, i / elapsed / 1e6, (unsigned long long)gated);
+    // Читатели уже отобразили сегмент и дочитают его после удаления имени
+    shm_bcast_close(ring);
+    shm_unlink(SHM_BCAST_NAME);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
     struct sigaction action;
+    memset(&action, 0, sizeof(action));
     action.sa_handler = term;
     sigaction(SIGINT, &action, NULL);
     sigaction(SIGTERM, &action, NULL);
 
+    const char *mode = "sem";
+    uint64_t count = 0;
+    uint64_t capacity = 0;
+    double rate = 0.0;
+    int readers = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:c:r:k:")) != -1) {
+        switch (opt) {
+        case 'm': mode = optarg; break;
+        case 'n': count = strtoull(optarg, NULL, 10); break;
+        case 'c': capacity = strtoull(optarg, NULL, 10); break;
+        case 'r': rate = atof(optarg); break;
+        case 'k': readers = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-m sem|spsc|var|bcast] [-n count] [-c capacity] [-r msg_per_sec] [-k readers]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (strcmp(mode, "spsc") == 0) {
+        return run_spsc(count ? count : 10000000, capacity ? capacity : 4096);
+    }
+    if (strcmp(mode, "var") == 0) {
+        return run_var(count ? count : 200000, capacity ? capacity : 4 * 1024 * 1024);
+    }
+    if (strcmp(mode, "bcast") == 0) {
+        return run_bcast(count ? count : 1000000, capacity ? capacity : 1024, rate, readers);
+    }
+
     int shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (shm_fd == -1) {
         perror("shm_open");
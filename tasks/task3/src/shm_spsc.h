@@ -0,0 +1,273 @@
+#ifndef SHM_SPSC_H
+#define SHM_SPSC_H
+
+/*
+ * Lock-free кольцо "один писатель - один читатель" в разделяемой памяти.
+ *
+ * Индексы head (пишет только producer) и tail (пишет только consumer) -
+ * монотонные 64-битные счетчики, каждый в своей кэш-линии; ячейка
+ * вычисляется как index & mask, поэтому емкость - степень двойки.
+ * Публикация - store-release индекса, чтение - load-acquire, без
+ * системных вызовов на сообщение. Каждая сторона кэширует последний
+ * увиденный индекс другой стороны и перечитывает его, только когда
+ * кольцо кажется полным (пустым).
+ *
+ * Consumer в пустом кольце сначала крутится, а затем засыпает на futex;
+ * producer делает FUTEX_WAKE, только если consumer объявил, что спит.
+ * Producer на полном кольце крутится и уступает процессор, пока consumer
+ * не освободит место или не уйдет (reader_closed или процесс завершен).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_SPSC_NAME       "/shm_spsc_ex"
+#define SHM_SPSC_MAGIC      0x53505343u // "SPSC"
+#define SHM_CACHE_LINE      64
+#define SHM_SPSC_SPIN_LIMIT 4096        // Итераций опроса перед сном на futex
+
+typedef struct {
+    // Неизменяемая после создания часть
+    alignas(SHM_CACHE_LINE) uint32_t magic;
+    uint64_t capacity;
+    uint64_t mask;
+
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t head;  // Следующая ячейка для записи
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t tail;  // Следующая ячейка для чтения
+
+    // Пробуждение consumer'а: счетчик futex и флаг "сплю"
+    alignas(SHM_CACHE_LINE) _Atomic uint32_t wake_seq;
+    _Atomic uint32_t consumer_sleeping;
+    _Atomic uint32_t closed;                        // Producer завершил запись
+    _Atomic uint32_t reader_closed;                 // Consumer больше не читает
+    _Atomic int32_t consumer_pid;                   // 0 - consumer еще не подключился
+
+    alignas(SHM_CACHE_LINE) uint64_t slots[];
+} shm_spsc_t;
+
+// Локальное (не разделяемое) состояние каждой стороны
+typedef struct {
+    shm_spsc_t* ring;
+    uint64_t index;         // Свой индекс: head для producer, tail для consumer
+    uint64_t cached_other;  // Последнее прочитанное значение чужого индекса
+} shm_spsc_end_t;
+
+static inline void shm_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline long shm_futex(_Atomic uint32_t* addr, int op, uint32_t value) {
+    // Без FUTEX_PRIVATE_FLAG: слово лежит в памяти, общей для процессов
+    return syscall(SYS_futex, (uint32_t*)addr, op, value, NULL, NULL, 0);
+}
+
+static inline size_t shm_spsc_bytes(uint64_t capacity) {
+    return sizeof(shm_spsc_t) + capacity * sizeof(uint64_t);
+}
+
+/**
+ * @brief Создает сегмент с кольцом емкостью capacity (степень двойки).
+ * @return Отображенное кольцо или NULL (errno).
+ */
+static inline shm_spsc_t* shm_spsc_create(const char* name, uint64_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    size_t bytes = shm_spsc_bytes(capacity);
+    if (ftruncate(fd, (off_t)bytes) == -1) {
+        close(fd);
+        return NULL;
+    }
+    shm_spsc_t* ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->wake_seq, 0);
+    atomic_store(&ring->consumer_sleeping, 0);
+    atomic_store(&ring->closed, 0);
+    atomic_store(&ring->reader_closed, 0);
+    atomic_store(&ring->consumer_pid, 0);
+    // magic последним: открывающая сторона ждет его как признак готовности
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SHM_SPSC_MAGIC;
+    return ring;
+}
+
+/**
+ * @brief Открывает кольцо, созданное другим процессом.
+ * @return Отображенное кольцо или NULL (errno; EAGAIN - еще не инициализировано).
+ */
+static inline shm_spsc_t* shm_spsc_open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(shm_spsc_t)) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+    shm_spsc_t* ring = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+    if (ring->magic != SHM_SPSC_MAGIC || shm_spsc_bytes(ring->capacity) != (size_t)st.st_size) {
+        munmap(ring, (size_t)st.st_size);
+        errno = EAGAIN;
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return ring;
+}
+
+static inline void shm_spsc_close(shm_spsc_t* ring) {
+    munmap(ring, shm_spsc_bytes(ring->capacity));
+}
+
+static inline void shm_spsc_producer_init(shm_spsc_end_t* end, shm_spsc_t* ring) {
+    end->ring = ring;
+    end->index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    end->cached_other = atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+static inline void shm_spsc_consumer_init(shm_spsc_end_t* end, shm_spsc_t* ring) {
+    end->ring = ring;
+    atomic_store_explicit(&ring->consumer_pid, (int32_t)getpid(), memory_order_release);
+    end->index = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    end->cached_other = atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+// Разбудить consumer'а, если он уснул (или собирается уснуть) на пустом кольце
+static inline void shm_spsc_notify(shm_spsc_t* ring) {
+    // seq_cst-барьер в паре с барьером в shm_spsc_pop: либо consumer увидит
+    // новый head, либо мы увидим consumer_sleeping = 1
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->consumer_sleeping, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->consumer_sleeping, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->wake_seq, 1, memory_order_release);
+        shm_futex(&ring->wake_seq, FUTEX_WAKE, INT_MAX);
+    }
+}
+
+// 0 - записано, -1 - кольцо полно
+static inline int shm_spsc_try_push(shm_spsc_end_t* p, uint64_t value) {
+    shm_spsc_t* ring = p->ring;
+    if (p->index - p->cached_other == ring->capacity) {
+        p->cached_other = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (p->index - p->cached_other == ring->capacity) return -1;
+    }
+    ring->slots[p->index & ring->mask] = value;
+    atomic_store_explicit(&ring->head, ++p->index, memory_order_release);
+    shm_spsc_notify(ring);
+    return 0;
+}
+
+// Consumer закрыл чтение или его процесс завершился (аварийно тоже)
+static inline int shm_spsc_reader_gone(shm_spsc_t* ring) {
+    if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire)) return 1;
+    pid_t pid = atomic_load_explicit(&ring->consumer_pid, memory_order_acquire);
+    return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+/**
+ * @brief Записывает, дожидаясь места; producer не спит, а уступает процессор.
+ * @return 0 - записано; -1 - consumer ушел и место не освободится (errno = EPIPE).
+ */
+static inline int shm_spsc_push(shm_spsc_end_t* p, uint64_t value) {
+    for (unsigned spins = 0; shm_spsc_try_push(p, value) != 0; ++spins) {
+        if (spins < SHM_SPSC_SPIN_LIMIT) {
+            shm_cpu_relax();
+            continue;
+        }
+        // Проверка - только на медленном пути: kill - системный вызов
+        if (shm_spsc_reader_gone(p->ring)) {
+            errno = EPIPE;
+            return -1;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
+// 0 - прочитано, -1 - кольцо пусто
+static inline int shm_spsc_try_pop(shm_spsc_end_t* c, uint64_t* value) {
+    shm_spsc_t* ring = c->ring;
+    if (c->index == c->cached_other) {
+        c->cached_other = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (c->index == c->cached_other) return -1;
+    }
+    *value = ring->slots[c->index & ring->mask];
+    atomic_store_explicit(&ring->tail, ++c->index, memory_order_release);
+    return 0;
+}
+
+// Пометить кольцо закрытым: consumer дочитает остаток и получит -1 из shm_spsc_pop
+static inline void shm_spsc_close_writer(shm_spsc_t* ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    atomic_store_explicit(&ring->consumer_sleeping, 1, memory_order_relaxed);
+    shm_spsc_notify(ring);
+}
+
+// Consumer больше не читает: блокирующий shm_spsc_push вернет -1 вместо ожидания
+static inline void shm_spsc_close_reader(shm_spsc_t* ring) {
+    atomic_store_explicit(&ring->reader_closed, 1, memory_order_release);
+}
+
+/**
+ * @brief Читает элемент, ожидая его при пустом кольце.
+ *
+ * @param block 0 - только активный опрос; 1 - после SHM_SPSC_SPIN_LIMIT
+ *              пустых опросов сон на futex до записи producer'а.
+ * @return 0 - прочитано; -1 - кольцо закрыто и пусто (errno = EPIPE) или
+ *         сон прерван сигналом (errno = EINTR).
+ */
+static inline int shm_spsc_pop(shm_spsc_end_t* c, uint64_t* value, int block) {
+    shm_spsc_t* ring = c->ring;
+    for (unsigned spins = 0;; ++spins) {
+        if (shm_spsc_try_pop(c, value) == 0) return 0;
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            if (shm_spsc_try_pop(c, value) == 0) return 0;
+            errno = EPIPE;
+            return -1;
+        }
+        if (!block || spins < SHM_SPSC_SPIN_LIMIT) {
+            shm_cpu_relax();
+            continue;
+        }
+
+        uint32_t seq = atomic_load_explicit(&ring->wake_seq, memory_order_acquire);
+        atomic_store_explicit(&ring->consumer_sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != c->index ||
+            atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            atomic_store_explicit(&ring->consumer_sleeping, 0, memory_order_relaxed);
+            continue;
+        }
+        if (shm_futex(&ring->wake_seq, FUTEX_WAIT, seq) == -1 && errno == EINTR) return -1;
+        spins = 0;
+    }
+}
+
+#endif // SHM_SPSC_H
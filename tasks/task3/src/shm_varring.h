@@ -0,0 +1,303 @@
+#ifndef SHM_VARRING_H
+#define SHM_VARRING_H
+
+/*
+ * Кольцо записей переменной длины в разделяемой памяти без копирования.
+ *
+ * Producer резервирует место (shm_varring_reserve), пишет данные прямо в
+ * отображенную память и публикует запись (shm_varring_commit). Consumer
+ * получает указатель на данные внутри кольца (shm_varring_peek) и
+ * освобождает место после обработки (shm_varring_release).
+ *
+ * Каждая запись - заголовок shm_var_hdr_t и данные, выровненные на
+ * SHM_VAR_ALIGN. Запись всегда непрерывна: если до конца буфера места не
+ * хватает, producer закрывает хвост записью-заполнителем (PAD) и пишет с
+ * начала буфера. Индексы head/tail - монотонные смещения в байтах,
+ * синхронизация такая же, как в shm_spsc.h. Как и там, ушедший consumer
+ * (reader_closed или завершенный процесс) не оставляет producer'а ждать
+ * места вечно: reserve вернет EPIPE.
+ */
+
+#include <string.h>
+#include "shm_spsc.h"
+
+#define SHM_VARRING_NAME  "/shm_varring_ex"
+#define SHM_VARRING_MAGIC 0x56415252u // "VARR"
+#define SHM_VAR_ALIGN     8
+#define SHM_VAR_DATA      1u
+#define SHM_VAR_PAD       2u
+
+typedef struct {
+    uint32_t len;   // Длина данных без заголовка
+    uint32_t type;  // SHM_VAR_DATA или SHM_VAR_PAD
+} shm_var_hdr_t;
+
+typedef struct {
+    alignas(SHM_CACHE_LINE) uint32_t magic;
+    uint64_t capacity;      // Байт в data[], степень двойки
+    uint64_t mask;
+
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t head;
+    alignas(SHM_CACHE_LINE) _Atomic uint64_t tail;
+
+    alignas(SHM_CACHE_LINE) _Atomic uint32_t wake_seq;
+    _Atomic uint32_t consumer_sleeping;
+    _Atomic uint32_t closed;
+    _Atomic uint32_t reader_closed;                 // Consumer больше не читает
+    _Atomic int32_t consumer_pid;                   // 0 - consumer еще не подключился
+
+    alignas(SHM_CACHE_LINE) unsigned char data[];
+} shm_varring_t;
+
+typedef struct {
+    shm_varring_t* ring;
+    uint64_t index;         // head для producer, tail для consumer (еще не опубликованный)
+    uint64_t cached_other;
+    uint64_t pending;       // Размер зарезервированной / прочитанной записи
+    unsigned full_polls;    // Producer: неудачных reserve подряд (проверка consumer'а)
+} shm_varring_end_t;
+
+static inline uint64_t shm_var_record_size(uint64_t len) {
+    return sizeof(shm_var_hdr_t) + ((len + SHM_VAR_ALIGN - 1) & ~(uint64_t)(SHM_VAR_ALIGN - 1));
+}
+
+// Наибольшая запись: с учетом заполнителя она всегда помещается в пустое кольцо
+static inline uint64_t shm_varring_max_record(const shm_varring_t* ring) {
+    return ring->capacity / 2 - sizeof(shm_var_hdr_t);
+}
+
+static inline size_t shm_varring_bytes(uint64_t capacity) {
+    return sizeof(shm_varring_t) + capacity;
+}
+
+static inline shm_varring_t* shm_varring_create(const char* name, uint64_t capacity) {
+    if (capacity < 4 * sizeof(shm_var_hdr_t) || (capacity & (capacity - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    size_t bytes = shm_varring_bytes(capacity);
+    if (ftruncate(fd, (off_t)bytes) == -1) {
+        close(fd);
+        return NULL;
+    }
+    shm_varring_t* ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->wake_seq, 0);
+    atomic_store(&ring->consumer_sleeping, 0);
+    atomic_store(&ring->closed, 0);
+    atomic_store(&ring->reader_closed, 0);
+    atomic_store(&ring->consumer_pid, 0);
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SHM_VARRING_MAGIC;
+    return ring;
+}
+
+static inline shm_varring_t* shm_varring_open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0666);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(shm_varring_t)) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+    shm_varring_t* ring = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+    if (ring->magic != SHM_VARRING_MAGIC || shm_varring_bytes(ring->capacity) != (size_t)st.st_size) {
+        munmap(ring, (size_t)st.st_size);
+        errno = EAGAIN;
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return ring;
+}
+
+static inline void shm_varring_close(shm_varring_t* ring) {
+    munmap(ring, shm_varring_bytes(ring->capacity));
+}
+
+static inline void shm_varring_producer_init(shm_varring_end_t* end, shm_varring_t* ring) {
+    end->ring = ring;
+    end->index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    end->cached_other = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    end->pending = 0;
+    end->full_polls = 0;
+}
+
+static inline void shm_varring_consumer_init(shm_varring_end_t* end, shm_varring_t* ring) {
+    end->ring = ring;
+    atomic_store_explicit(&ring->consumer_pid, (int32_t)getpid(), memory_order_release);
+    end->index = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    end->cached_other = atomic_load_explicit(&ring->head, memory_order_acquire);
+    end->pending = 0;
+}
+
+// Consumer закрыл чтение или его процесс завершился
+static inline int shm_varring_reader_gone(shm_varring_t* ring) {
+    if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire)) return 1;
+    pid_t pid = atomic_load_explicit(&ring->consumer_pid, memory_order_acquire);
+    return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+static inline shm_var_hdr_t* shm_varring_hdr(shm_varring_t* ring, uint64_t index) {
+    return (shm_var_hdr_t*)(ring->data + (index & ring->mask));
+}
+
+/**
+ * @brief Резервирует непрерывное место под запись длиной до len байт.
+ *
+ * @return Указатель на область данных в общей памяти или NULL:
+ *         errno = EAGAIN - сейчас нет места, EMSGSIZE - len больше
+ *         shm_varring_max_record(), EPIPE - consumer ушел, места не будет.
+ */
+static inline void* shm_varring_reserve(shm_varring_end_t* p, uint64_t len) {
+    shm_varring_t* ring = p->ring;
+    if (len > shm_varring_max_record(ring)) {
+        errno = EMSGSIZE;
+        return NULL;
+    }
+    uint64_t need = shm_var_record_size(len);
+    uint64_t to_end = ring->capacity - (p->index & ring->mask);
+    uint64_t total = need + (to_end < need ? to_end : 0);
+    if (ring->capacity - (p->index - p->cached_other) < total) {
+        p->cached_other = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (ring->capacity - (p->index - p->cached_other) < total) {
+            // Флаг - при каждом промахе, процесс (kill - системный вызов) - раз в SHM_SPSC_SPIN_LIMIT
+            if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire) ||
+                (++p->full_polls % SHM_SPSC_SPIN_LIMIT == 0 && shm_varring_reader_gone(ring))) {
+                errno = EPIPE;
+                return NULL;
+            }
+            errno = EAGAIN;
+            return NULL;
+        }
+    }
+    p->full_polls = 0;
+    if (to_end < need) {
+        // Хвост буфера - заполнитель; он станет виден вместе с записью
+        shm_var_hdr_t* pad = shm_varring_hdr(ring, p->index);
+        pad->len = (uint32_t)(to_end - sizeof(shm_var_hdr_t));
+        pad->type = SHM_VAR_PAD;
+        p->index += to_end;
+    }
+    p->pending = len;
+    return shm_varring_hdr(ring, p->index) + 1;
+}
+
+static inline void shm_varring_notify(shm_varring_t* ring) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->consumer_sleeping, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->consumer_sleeping, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->wake_seq, 1, memory_order_release);
+        shm_futex(&ring->wake_seq, FUTEX_WAKE, INT_MAX);
+    }
+}
+
+/**
+ * @brief Публикует зарезервированную запись.
+ * @param len Фактическая длина данных, не больше зарезервированной.
+ */
+static inline void shm_varring_commit(shm_varring_end_t* p, uint64_t len) {
+    shm_varring_t* ring = p->ring;
+    if (len > p->pending) len = p->pending;
+    shm_var_hdr_t* hdr = shm_varring_hdr(ring, p->index);
+    hdr->len = (uint32_t)len;
+    hdr->type = SHM_VAR_DATA;
+    p->index += shm_var_record_size(len);
+    p->pending = 0;
+    atomic_store_explicit(&ring->head, p->index, memory_order_release);
+    shm_varring_notify(ring);
+}
+
+/**
+ * @brief Возвращает следующую запись, не копируя ее.
+ *
+ * Данные остаются действительными до shm_varring_release().
+ *
+ * @return Указатель на данные или NULL, если кольцо пусто.
+ */
+static inline const void* shm_varring_try_peek(shm_varring_end_t* c, uint64_t* len) {
+    shm_varring_t* ring = c->ring;
+    for (;;) {
+        if (c->index == c->cached_other) {
+            c->cached_other = atomic_load_explicit(&ring->head, memory_order_acquire);
+            if (c->index == c->cached_other) return NULL;
+        }
+        const shm_var_hdr_t* hdr = shm_varring_hdr(ring, c->index);
+        if (hdr->type == SHM_VAR_PAD) {
+            c->index += sizeof(shm_var_hdr_t) + hdr->len;
+            continue;
+        }
+        *len = hdr->len;
+        c->pending = shm_var_record_size(hdr->len);
+        return hdr + 1;
+    }
+}
+
+// Освобождает запись, полученную из peek, и отдает место producer'у
+static inline void shm_varring_release(shm_varring_end_t* c) {
+    c->index += c->pending;
+    c->pending = 0;
+    atomic_store_explicit(&c->ring->tail, c->index, memory_order_release);
+}
+
+static inline void shm_varring_close_writer(shm_varring_t* ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    atomic_store_explicit(&ring->consumer_sleeping, 1, memory_order_relaxed);
+    shm_varring_notify(ring);
+}
+
+// Consumer больше не читает: reserve вернет EPIPE вместо EAGAIN
+static inline void shm_varring_close_reader(shm_varring_t* ring) {
+    atomic_store_explicit(&ring->reader_closed, 1, memory_order_release);
+}
+
+/**
+ * @brief Ждет следующую запись: spin_limit пустых опросов, затем сон на
+ *        futex; UINT_MAX - только опрос. Когда писатель на том же ядре,
+ *        опрос лишь отнимает у него время, и spin_limit = 0 выгоднее.
+ * @return Указатель на данные или NULL: errno = EPIPE (закрыто и пусто) / EINTR.
+ */
+static inline const void* shm_varring_peek_spin(shm_varring_end_t* c, uint64_t* len, unsigned spin_limit) {
+    shm_varring_t* ring = c->ring;
+    for (unsigned spins = 0;; ++spins) {
+        const void* data = shm_varring_try_peek(c, len);
+        if (data) return data;
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            if ((data = shm_varring_try_peek(c, len)) != NULL) return data;
+            errno = EPIPE;
+            return NULL;
+        }
+        if (spin_limit == UINT_MAX || spins < spin_limit) {
+            shm_cpu_relax();
+            continue;
+        }
+
+        uint32_t seq = atomic_load_explicit(&ring->wake_seq, memory_order_acquire);
+        atomic_store_explicit(&ring->consumer_sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != c->index ||
+            atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            atomic_store_explicit(&ring->consumer_sleeping, 0, memory_order_relaxed);
+            continue;
+        }
+        if (shm_futex(&ring->wake_seq, FUTEX_WAIT, seq) == -1 && errno == EINTR) return NULL;
+        spins = 0;
+    }
+}
+
+// Ждет следующую запись (см. shm_spsc_pop о параметре block)
+static inline const void* shm_varring_peek(shm_varring_end_t* c, uint64_t* len, int block) {
+    return shm_varring_peek_spin(c, len, block ? SHM_SPSC_SPIN_LIMIT : UINT_MAX);
+}
+
+#endif // SHM_VARRING_H
@@ -0,0 +1,256 @@
+#ifndef URING_H
+#define URING_H
+
+/*
+ * Минимальная обертка над io_uring на системных вызовах, без liburing.
+ *
+ * SQ и CQ - кольца в памяти, общей с ядром: приложение заполняет sqe и
+ * сдвигает sq tail (store-release), ядро публикует cqe и сдвигает cq tail.
+ * io_uring_enter нужен, только чтобы сообщить ядру о новых sqe и/или
+ * дождаться cqe. В режиме SQPOLL отправку выбирает поток ядра, и
+ * системный вызов нужен лишь для его пробуждения (IORING_SQ_NEED_WAKEUP).
+ */
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;
+    unsigned flags;         // IORING_SETUP_*
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_flags;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail; // Подготовленные, но еще не опубликованные sqe
+    struct io_uring_sqe* sqes;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ptr;
+    void* cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+
+    uint64_t enters;        // Число вызовов io_uring_enter (для статистики)
+} uring_t;
+
+static inline void uring_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline int uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, (size_t)_NSIG / 8);
+}
+
+static inline int uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * @brief Создает кольцо и отображает SQ/CQ.
+ * @param cq_entries Размер CQ (0 - по умолчанию, 2 * entries).
+ * @param flags IORING_SETUP_*; для SQPOLL поток ядра засыпает через 1 с простоя.
+ * @return 0 или -1 (errno).
+ */
+static inline int uring_init(uring_t* u, unsigned entries, unsigned cq_entries, unsigned flags) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    p.flags = flags;
+    if (cq_entries) {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+    }
+    if (flags & IORING_SETUP_SQPOLL) p.sq_thread_idle = 1000;
+    u->fd = uring_setup(entries, &p);
+    if (u->fd < 0) return -1;
+    u->flags = p.flags;
+
+    u->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_len > u->sq_len) u->sq_len = u->cq_len;
+        u->cq_len = u->sq_len;
+    }
+    int err;
+    u->sq_ptr = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                     IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        err = errno;
+        goto fail_fd;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                         IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) {
+            err = errno;
+            goto fail_sq;
+        }
+    }
+    u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                   IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        err = errno;
+        goto fail_cq;
+    }
+
+    char* sq = u->sq_ptr;
+    u->sq_head = (unsigned*)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    u->sq_flags = (unsigned*)(sq + p.sq_off.flags);
+    u->sq_array = (unsigned*)(sq + p.sq_off.array);
+    u->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    u->sq_local_tail = *u->sq_tail;
+    // Порядок sqe в массиве совпадает с порядком в кольце
+    for (unsigned i = 0; i < p.sq_entries; ++i) u->sq_array[i] = i;
+
+    char* cq = u->cq_ptr;
+    u->cq_head = (unsigned*)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    u->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+
+    // Откат - в обратном порядке, как в uring_exit
+fail_cq:
+    if (u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+fail_sq:
+    munmap(u->sq_ptr, u->sq_len);
+fail_fd:
+    close(u->fd);
+    errno = err;
+    return -1;
+}
+
+static inline void uring_exit(uring_t* u) {
+    munmap(u->sqes, u->sqes_len);
+    if (u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+    munmap(u->sq_ptr, u->sq_len);
+    close(u->fd);
+}
+
+/**
+ * @brief Отправляет подготовленные sqe и, если wait, ждет хотя бы одно cqe.
+ * @return Результат io_uring_enter, 0 если вызов не понадобился, -1 (errno).
+ */
+static inline int uring_submit(uring_t* u, int wait) {
+    unsigned tail = *u->sq_tail;
+    unsigned to_submit = u->sq_local_tail - tail;
+    if (to_submit) __atomic_store_n(u->sq_tail, u->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    if (u->flags & IORING_SETUP_SQPOLL) {
+        // Полный барьер: запись tail должна быть видна до чтения флага
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(u->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        to_submit = 0;
+    }
+    if (wait && __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE) == *u->cq_head) flags |= IORING_ENTER_GETEVENTS;
+    if (!to_submit && !flags) return 0;
+    u->enters++;
+    return uring_enter(u->fd, to_submit, (flags & IORING_ENTER_GETEVENTS) ? 1 : 0, flags);
+}
+
+// Свободный sqe (обнуленный); при полной SQ сначала отправляет накопленное
+static inline struct io_uring_sqe* uring_get_sqe(uring_t* u) {
+    while (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+        if (uring_submit(u, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return NULL;
+    }
+    struct io_uring_sqe* sqe = &u->sqes[u->sq_local_tail & u->sq_mask];
+    u->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// Следующее cqe или NULL; после обработки - uring_cqe_seen()
+static inline struct io_uring_cqe* uring_peek_cqe(uring_t* u) {
+    unsigned head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &u->cqes[head & u->cq_mask];
+}
+
+static inline void uring_cqe_seen(uring_t* u) {
+    __atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// ---------------------------------------------------------------------------
+// Кольцо предоставленных буферов (IORING_REGISTER_PBUF_RING)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    struct io_uring_buf_ring* br;
+    size_t br_len;
+    unsigned entries;
+    unsigned mask;
+    unsigned short local_tail;
+    unsigned short bgid;
+} uring_bufring_t;
+
+/**
+ * @brief Регистрирует кольцо буферов группы bgid на entries (степень двойки) мест.
+ * @return 0 или -1 (errno).
+ */
+static inline int uring_bufring_init(uring_t* u, uring_bufring_t* b, unsigned entries, unsigned short bgid) {
+    b->br_len = entries * sizeof(struct io_uring_buf);
+    b->br = mmap(NULL, b->br_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (b->br == MAP_FAILED) return -1;
+    b->entries = entries;
+    b->mask = entries - 1;
+    b->local_tail = 0;
+    b->bgid = bgid;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)b->br;
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+    if (uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int saved = errno;
+        munmap(b->br, b->br_len);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+// Кладет буфер в кольцо; ядро увидит его после uring_bufring_publish()
+static inline void uring_bufring_add(uring_bufring_t* b, void* addr, unsigned len, unsigned short bid) {
+    struct io_uring_buf* buf = &b->br->bufs[b->local_tail & b->mask];
+    buf->addr = (uint64_t)(uintptr_t)addr;
+    buf->len = len;
+    buf->bid = bid;
+    b->local_tail++;
+}
+
+static inline void uring_bufring_publish(uring_bufring_t* b) {
+    __atomic_store_n(&b->br->tail, b->local_tail, __ATOMIC_RELEASE);
+}
+
+#endif // URING_H
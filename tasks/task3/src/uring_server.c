@@ -0,0 +1,408 @@
+/*
+ * Эхо-сервер на io_uring (альтернатива epoll_server)
+ *
+ * - Один multishot accept с IORING_FILE_INDEX_ALLOC: каждое подключение
+ *   сразу попадает в таблицу зарегистрированных (fixed) файлов, обычный
+ *   дескриптор не создается.
+ * - На каждое соединение один multishot recv с выбором буфера из кольца
+ *   предоставленных буферов: данные ложатся прямо в заранее
+ *   зарегистрированную память, буфер отправляется обратно без копирования
+ *   и возвращается в кольцо после завершения send.
+ * - В соединении одновременно выполняется не больше одного send, чтобы
+ *   эхо не переупорядочилось; остальные буферы ждут в очереди соединения.
+ * - Внутреннее событие (аналог eventfd в epoll_server): на SIGUSR1
+ *   отдельный поток посылает в кольцо сервера IORING_OP_MSG_RING, и оно
+ *   приходит обычным cqe.
+ *
+ * В установившемся режиме один io_uring_enter отправляет все накопленные
+ * sqe и ждет новые cqe; с -S (SQPOLL и активный опрос CQ) системных
+ * вызовов на запрос нет совсем.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "uring.h"
+
+#define SOCKET_PATH   "/tmp/uring_server.sock"
+#define RING_ENTRIES  4096
+#define MAX_CONNS     16384         // Мест в таблице fixed-файлов
+#define BUF_COUNT     8192          // Степень двойки, не больше 32768
+#define BUF_SIZE      4096
+#define BUF_GROUP     0
+#define NO_BUF        0xffff
+
+enum { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_CANCEL, OP_CLOSE, OP_NOTIFY };
+
+#define UD(op, idx, bid) (((uint64_t)(op) << 56) | ((uint64_t)(idx) << 16) | (uint64_t)(bid))
+#define UD_OP(ud)        ((unsigned)((ud) >> 56))
+#define UD_IDX(ud)       ((unsigned)(((ud) >> 16) & 0xffffffu))
+
+typedef struct {
+    unsigned short head;    // Очередь буферов на отправку (связь через buf_next)
+    unsigned short tail;
+    unsigned send_off;      // Отправлено байт из головного буфера
+    unsigned char active;
+    unsigned char sending;
+    unsigned char closing;
+    unsigned char recv_armed;
+} conn_t;
+
+static uring_t ring;
+static uring_bufring_t bufring;
+static char* buf_base;
+static unsigned short buf_next[BUF_COUNT];
+static unsigned buf_len[BUF_COUNT];
+static conn_t conns[MAX_CONNS];
+// Соединения, чей multishot recv остановился из-за нехватки буферов
+static unsigned starved[MAX_CONNS];
+static unsigned n_starved;
+static int listen_fd;
+static uint64_t n_accepted, n_closed, n_bytes, n_cqes;
+static volatile sig_atomic_t done = 0;
+
+static void term(int signum) {
+    (void)signum;
+    done = 1;
+}
+
+static struct io_uring_sqe* get_sqe(void) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&ring);
+    if (!sqe) {
+        perror("io_uring_enter");
+        exit(EXIT_FAILURE);
+    }
+    return sqe;
+}
+
+static void arm_accept(void) {
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->file_index = IORING_FILE_INDEX_ALLOC;
+    sqe->user_data = UD(OP_ACCEPT, 0, 0);
+}
+
+static void arm_recv(unsigned idx) {
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = (int)idx;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = UD(OP_RECV, idx, 0);
+    conns[idx].recv_armed = 1;
+}
+
+static void arm_send(unsigned idx) {
+    conn_t* c = &conns[idx];
+    unsigned short bid = c->head;
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = (int)idx;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = (uint64_t)(uintptr_t)(buf_base + (size_t)bid * BUF_SIZE + c->send_off);
+    sqe->len = buf_len[bid] - c->send_off;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = UD(OP_SEND, idx, bid);
+    c->sending = 1;
+}
+
+static void arm_close(unsigned idx) {
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = idx + 1; // Закрыть место в таблице fixed-файлов
+    sqe->user_data = UD(OP_CLOSE, idx, 0);
+}
+
+static void recycle_buffer(unsigned short bid) {
+    uring_bufring_add(&bufring, buf_base + (size_t)bid * BUF_SIZE, BUF_SIZE, bid);
+}
+
+// Отдать ядру все буферы очереди, кроме того, что сейчас в send
+static void conn_drop_queue(conn_t* c, int keep_head) {
+    unsigned short bid = c->head;
+    if (keep_head && bid != NO_BUF) {
+        bid = buf_next[bid];
+        buf_next[c->head] = NO_BUF;
+        c->tail = c->head;
+    } else {
+        c->head = c->tail = NO_BUF;
+    }
+    while (bid != NO_BUF) {
+        unsigned short next = buf_next[bid];
+        recycle_buffer(bid);
+        bid = next;
+    }
+}
+
+// Закрыть место fixed-файла, когда по соединению не осталось операций
+static void conn_maybe_close(unsigned idx) {
+    conn_t* c = &conns[idx];
+    if (c->closing && c->active && !c->sending && !c->recv_armed) {
+        c->active = 0;
+        arm_close(idx);
+    }
+}
+
+static void conn_shutdown(unsigned idx) {
+    conn_t* c = &conns[idx];
+    if (c->closing) return;
+    c->closing = 1;
+    conn_drop_queue(c, c->sending);
+    if (c->recv_armed) {
+        // Multishot recv сам не завершится, пока клиент не закроет сокет
+        struct io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD(OP_RECV, idx, 0);
+        sqe->user_data = UD(OP_CANCEL, idx, 0);
+    }
+    conn_maybe_close(idx);
+}
+
+static void on_accept(struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) arm_accept();
+    if (cqe->res < 0) return; // -ENFILE: таблица fixed-файлов заполнена
+    unsigned idx = (unsigned)cqe->res;
+    conn_t* c = &conns[idx];
+    memset(c, 0, sizeof(*c));
+    c->head = c->tail = NO_BUF;
+    c->active = 1;
+    n_accepted++;
+    arm_recv(idx);
+}
+
+static void on_recv(struct io_uring_cqe* cqe, unsigned idx) {
+    conn_t* c = &conns[idx];
+    int more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    if (!more) c->recv_armed = 0;
+
+    if (cqe->res > 0) {
+        unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        n_bytes += (uint64_t)cqe->res;
+        if (c->closing) {
+            recycle_buffer(bid);
+        } else {
+            buf_len[bid] = (unsigned)cqe->res;
+            buf_next[bid] = NO_BUF;
+            if (c->tail == NO_BUF) {
+                c->head = bid;
+            } else {
+                buf_next[c->tail] = bid;
+            }
+            c->tail = bid;
+            if (!c->sending) arm_send(idx);
+            if (!more) arm_recv(idx);
+        }
+    } else if (cqe->res == -ENOBUFS && !c->closing) {
+        // Все буферы заняты: перезапустить recv, когда какой-то вернется
+        starved[n_starved++] = idx;
+    } else {
+        conn_shutdown(idx); // 0 - клиент закрыл соединение, < 0 - ошибка
+    }
+    conn_maybe_close(idx);
+}
+
+static void on_send(struct io_uring_cqe* cqe, unsigned idx) {
+    conn_t* c = &conns[idx];
+    c->sending = 0;
+    if (cqe->res < 0) {
+        conn_shutdown(idx);
+    } else {
+        unsigned short bid = c->head;
+        c->send_off += (unsigned)cqe->res;
+        if (c->send_off < buf_len[bid] && !c->closing) {
+            arm_send(idx); // Неполная отправка: дописать остаток
+            return;
+        }
+        c->send_off = 0;
+        c->head = buf_next[bid];
+        if (c->head == NO_BUF) c->tail = NO_BUF;
+        recycle_buffer(bid);
+        if (c->closing) conn_drop_queue(c, 0);
+        if (c->head != NO_BUF) {
+            arm_send(idx);
+            return;
+        }
+    }
+    conn_maybe_close(idx);
+}
+
+static void* notifier_main(void* arg) {
+    (void)arg;
+    // SIGINT/SIGTERM должны прерывать io_uring_enter главного потока, а не этот
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+    uring_t notifier;
+    if (uring_init(&notifier, 4, 0, 0) < 0) {
+        perror("io_uring_setup (notifier)");
+        return NULL;
+    }
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    for (unsigned counter = 1;; ++counter) {
+        int sig;
+        if (sigwait(&set, &sig) != 0) break;
+        // cqe в кольце сервера: user_data = sqe->off, res = sqe->len
+        struct io_uring_sqe* sqe = uring_get_sqe(&notifier);
+        sqe->opcode = IORING_OP_MSG_RING;
+        sqe->fd = ring.fd;
+        sqe->off = UD(OP_NOTIFY, 0, 0);
+        sqe->len = counter;
+        uring_submit(&notifier, 1);
+        struct io_uring_cqe* cqe;
+        while ((cqe = uring_peek_cqe(&notifier)) != NULL) {
+            if (cqe->res < 0) fprintf(stderr, "IORING_OP_MSG_RING: %s\n", strerror(-cqe->res));
+            uring_cqe_seen(&notifier);
+        }
+    }
+    uring_exit(&notifier);
+    return NULL;
+}
+
+static void raise_nofile_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static int create_listener(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    unlink(SOCKET_PATH);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        perror("bind/listen");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    int sqpoll = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "S")) != -1) {
+        switch (opt) {
+        case 'S': sqpoll = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-S]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = term;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // SIGUSR1 принимает только поток-уведомитель
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &usr1, NULL);
+    raise_nofile_limit();
+
+    listen_fd = create_listener();
+    if (uring_init(&ring, RING_ENTRIES, 4 * MAX_CONNS, sqpoll ? IORING_SETUP_SQPOLL : 0) < 0) {
+        perror("io_uring_setup");
+        exit(EXIT_FAILURE);
+    }
+
+    struct io_uring_rsrc_register files;
+    memset(&files, 0, sizeof(files));
+    files.nr = MAX_CONNS;
+    files.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (uring_register(ring.fd, IORING_REGISTER_FILES2, &files, sizeof(files)) < 0) {
+        perror("IORING_REGISTER_FILES2");
+        exit(EXIT_FAILURE);
+    }
+
+    buf_base = mmap(NULL, (size_t)BUF_COUNT * BUF_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (buf_base == MAP_FAILED || uring_bufring_init(&ring, &bufring, BUF_COUNT, BUF_GROUP) < 0) {
+        perror("IORING_REGISTER_PBUF_RING");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned bid = 0; bid < BUF_COUNT; ++bid) recycle_buffer((unsigned short)bid);
+    uring_bufring_publish(&bufring);
+
+    pthread_t notifier;
+    if (pthread_create(&notifier, NULL, notifier_main, NULL) != 0) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Server is listening on socket: %s (%s)\n", SOCKET_PATH,
+           sqpoll ? "SQPOLL, busy-polling CQ" : "io_uring_enter per batch");
+    printf("Internal event: kill -USR1 %d\n", getpid());
+    fflush(stdout);
+
+    arm_accept();
+    while (!done) {
+        if (uring_submit(&ring, !sqpoll) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("io_uring_enter");
+            break;
+        }
+        struct io_uring_cqe* cqe;
+        unsigned seen = 0;
+        while ((cqe = uring_peek_cqe(&ring)) != NULL) {
+            uint64_t ud = cqe->user_data;
+            unsigned idx = UD_IDX(ud);
+            switch (UD_OP(ud)) {
+            case OP_ACCEPT: on_accept(cqe); break;
+            case OP_RECV: on_recv(cqe, idx); break;
+            case OP_SEND: on_send(cqe, idx); break;
+            case OP_CANCEL: break;
+            case OP_CLOSE: n_closed++; break;
+            case OP_NOTIFY:
+                printf("!!! Received internal event (counter=%d) !!!\n", cqe->res);
+                fflush(stdout);
+                break;
+            }
+            uring_cqe_seen(&ring);
+            seen++;
+        }
+        if (!seen) {
+            if (sqpoll) uring_cpu_relax();
+            continue;
+        }
+        n_cqes += seen;
+        uring_bufring_publish(&bufring);
+        // Вернулись буферы - перезапустить остановленные recv
+        while (n_starved > 0) {
+            unsigned idx = starved[--n_starved];
+            if (conns[idx].active && !conns[idx].closing && !conns[idx].recv_armed) arm_recv(idx);
+        }
+    }
+
+    printf("\naccepted %llu, closed %llu, echoed %.1f MB, %llu cqe, %llu io_uring_enter (%.3f per cqe)\n",
+           (unsigned long long)n_accepted, (unsigned long long)n_closed, n_bytes / 1e6,
+           (unsigned long long)n_cqes, (unsigned long long)ring.enters,
+           n_cqes ? (double)ring.enters / n_cqes : 0.0);
+    uring_exit(&ring);
+    close(listen_fd);
+    unlink(SOCKET_PATH);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef INPUT_FRAME_H
+#define INPUT_FRAME_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/*
+ * Кадр событий ввода - то, что поток чтения poll_inputs публикует
+ * потребителям через очереди rt_ring.
+ *
+ * Кадр - события одного устройства до SYN_REPORT (сам SYN_REPORT в кадр
+ * не входит). Кадр длиннее INPUT_FRAME_EVENTS режется на части с флагом
+ * INPUT_FRAME_SPLIT у всех, кроме последней.
+ */
+
+#define INPUT_FRAME_EVENTS 32
+#define INPUT_FRAME_SPLIT  0x1  // Продолжение следует в следующем кадре
+
+typedef struct {
+    int64_t kernel_us;          // Метка SYN_REPORT (CLOCK_MONOTONIC), 0 - неизвестна
+    int64_t read_us;            // Когда поток чтения получил кадр
+    char source[16];            // Имя узла: "event3"
+    uint16_t count;
+    uint16_t flags;
+    struct input_event events[INPUT_FRAME_EVENTS];
+} input_frame_t;
+
+#endif // INPUT_FRAME_H
@@ -1,72 +1,474 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
 #include <linux/input.h>
 #include <sys/ioctl.h>
+#include "input_frame.h"
+#include "rt_ring.h"
 
-#define MAX_DEVICES 16
+/*
+ * Мониторинг нескольких устройств ввода через epoll.
+ *
+ * За один read забирается до READ_BATCH событий; события копятся в кадр
+ * до SYN_REPORT и печатаются кадром вместе с задержкой "ядро -> процесс"
+ * (метки времени событий переключены на CLOCK_MONOTONIC). Без аргументов
+ * отслеживаются все /dev/input/event*, а новые узлы подхватываются через
+ * inotify. Ограничения на число устройств нет.
+ *
+ * Захват отделен от обработки: поток чтения (-p - SCHED_FIFO, -c -
+ * закрепление на ядре) только читает и раскладывает кадры в очереди
+ * rt_ring. Потребители - журнал (печать на терминал) и монитор
+ * задержек - забирают кадры в своем темпе; медленный терминал приводит к
+ * отброшенным кадрам в его очереди (счетчик dropped), а не к задержке
+ * чтения устройств.
+ */
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s /dev/input/eventX1 /dev/input/eventX2 ...\n", argv[0]);
-        return 1;
+#define INPUT_DIR "/dev/input"
+#define READ_BATCH 64   // Событий за один read
+#define MAX_EPOLL_EVENTS 32
+#define PATH_LEN 320    // INPUT_DIR + имя из readdir/inotify
+#define QUEUE_FRAMES 1024
+
+typedef struct device {
+    int fd;
+    char path[PATH_LEN];
+    char name[256];
+    input_frame_t frame;            // Собираемый кадр
+    int dropping;                   // После SYN_DROPPED ждем следующий SYN_REPORT
+    unsigned long frames;
+    unsigned long events;
+    unsigned long reads;
+    long long max_latency_us;
+    struct device *next;
+} device_t;
+
+// Очереди потребителей: поток чтения кладет каждый кадр в обе
+typedef struct {
+    const char *name;
+    RtRing ring;
+} consumer_t;
+
+enum { CONSUMER_LOG, CONSUMER_MONITOR, CONSUMER_COUNT };
+
+static consumer_t consumers[CONSUMER_COUNT] = {
+    [CONSUMER_LOG] = {.name = "log"},
+    [CONSUMER_MONITOR] = {.name = "monitor"},
+};
+
+static device_t *devices = NULL;    // Принадлежит потоку чтения
+static int epfd = -1;
+static int infd = -1;
+static int wake_fd = -1;          // eventfd: main будит поток чтения при выходе
+static int reader_prio = 0;
+static int reader_cpu = -1;
+static atomic_int stop_reader;
+static atomic_int stop_consumers;
+static atomic_int reader_done;
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static long long event_us(const struct input_event *ev) {
+    return (long long)ev->input_event_sec * 1000000 + ev->input_event_usec;
+}
+
+static device_t *find_device(const char *path) {
+    for (device_t *d = devices; d; d = d->next) {
+        if (strcmp(d->path, path) == 0) return d;
     }
+    return NULL;
+}
 
-    if (argc - 1 > MAX_DEVICES) {
-        fprintf(stderr, "Error: Too many devices. Max is %d.\n", MAX_DEVICES);
-        return 1;
+// Открывает устройство и добавляет его в epoll; 0 - успех или уже открыто
+static int add_device(const char *path) {
+    if (find_device(path)) return 0;
+
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC); // O_NONBLOCK важен для epoll
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
     }
 
-    int num_devices = argc - 1;
-    struct pollfd fds[MAX_DEVICES];
-    char device_names[MAX_DEVICES][256];
+    device_t *d = calloc(1, sizeof(*d));
+    if (!d) {
+        close(fd);
+        return -1;
+    }
+    d->fd = fd;
+    snprintf(d->path, sizeof(d->path), "%s", path);
+    const char *base = strrchr(path, '/');
+    snprintf(d->frame.source, sizeof(d->frame.source), "%s", base ? base + 1 : path);
+    if (ioctl(fd, EVIOCGNAME(sizeof(d->name)), d->name) < 0) {
+        snprintf(d->name, sizeof(d->name), "%s", path);
+    }
 
-    // Открыть все переданные устройства
-    for (int i = 0; i < num_devices; i++) {
-        const char *path = argv[i + 1];
-        int fd = open(path, O_RDONLY | O_NONBLOCK); // O_NONBLOCK важен для poll
-        if (fd < 0) {
-            perror("Failed to open device");
-            // В реальном приложении здесь нужна более внимательная обработка ошибок
-            return 1;
+    // Метки событий по CLOCK_MONOTONIC: задержка не зависит от перевода часов
+    int clk = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clk) < 0) {
+        fprintf(stderr, "%s: EVIOCSCLOCKID: %s, latency is not measured\n", path, strerror(errno));
+        d->max_latency_us = -1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = d};
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        close(fd);
+        free(d);
+        return -1;
+    }
+    d->next = devices;
+    devices = d;
+    printf("Added %s: %s\n", d->path, d->name);
+    return 0;
+}
+
+static void print_stats(const device_t *d) {
+    printf("%s (%s): %lu frames, %lu events, %lu reads (%.1f events/read)", d->path, d->name, d->frames,
+           d->events, d->reads, d->reads ? (double)d->events / d->reads : 0.0);
+    if (d->max_latency_us >= 0) printf(", max latency %lld us", d->max_latency_us);
+    printf("\n");
+}
+
+static void remove_device(device_t *d) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, d->fd, NULL);
+    close(d->fd);
+    printf("Removed ");
+    print_stats(d);
+    for (device_t **p = &devices; *p; p = &(*p)->next) {
+        if (*p == d) {
+            *p = d->next;
+            break;
         }
+    }
+    free(d);
+}
 
-        fds[i].fd = fd;
-        fds[i].events = POLLIN; // Ждем только события чтения
+// Публикует накопленный кадр потребителям; syn - завершивший его SYN_REPORT или NULL
+static void flush_frame(device_t *d, const struct input_event *syn) {
+    input_frame_t *f = &d->frame;
+    if (f->count == 0) return;
+    d->frames++;
+    f->read_us = now_us();
+    f->kernel_us = 0;
+    f->flags = syn ? 0 : INPUT_FRAME_SPLIT;
+    if (syn && d->max_latency_us >= 0) {
+        f->kernel_us = event_us(syn);
+        if (f->read_us - f->kernel_us > d->max_latency_us) d->max_latency_us = f->read_us - f->kernel_us;
+    }
+    for (int i = 0; i < CONSUMER_COUNT; i++) rt_ring_push(&consumers[i].ring, f);
+    f->count = 0;
+}
 
-        // Получаем имя устройства для красивого вывода
-        ioctl(fd, EVIOCGNAME(sizeof(device_names[i])), device_names[i]);
+static void handle_event(device_t *d, const struct input_event *ev) {
+    d->events++;
+    if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+        // Буфер ядра переполнился: текущий кадр неполон, отбрасываем до SYN_REPORT
+        fprintf(stderr, "%s: SYN_DROPPED\n", d->name);
+        d->frame.count = 0;
+        d->dropping = 1;
+        return;
+    }
+    if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+        if (d->dropping) {
+            d->dropping = 0;
+            d->frame.count = 0;
+            return;
+        }
+        flush_frame(d, ev);
+        return;
     }
+    if (d->dropping) return;
+    if (d->frame.count == INPUT_FRAME_EVENTS) flush_frame(d, NULL);
+    d->frame.events[d->frame.count++] = *ev;
+}
 
-    printf("Polling %d devices. Press Ctrl+C to exit.\n", num_devices);
+// Читает все, что накопилось; -1 - устройство пропало
+static int read_device(device_t *d) {
+    struct input_event buf[READ_BATCH];
+    for (;;) {
+        ssize_t bytes = read(d->fd, buf, sizeof(buf));
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) return 0;
+            return -1; // ENODEV - устройство отключено
+        }
+        if (bytes == 0) return -1;
+        d->reads++;
+        int count = (int)(bytes / (ssize_t)sizeof(struct input_event));
+        for (int i = 0; i < count; i++) handle_event(d, &buf[i]);
+        if (bytes < (ssize_t)sizeof(buf)) return 0; // Очередь ядра опустела
+    }
+}
+
+// Добавляет все /dev/input/event*
+static void scan_devices(void) {
+    DIR *dir = opendir(INPUT_DIR);
+    if (!dir) {
+        perror("opendir " INPUT_DIR);
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "event", 5) != 0) continue;
+        char path[PATH_LEN];
+        snprintf(path, sizeof(path), INPUT_DIR "/%s", de->d_name);
+        add_device(path);
+    }
+    closedir(dir);
+}
 
-    while (1) {
-        // Вызвать poll() для ожидания событий
-        int ret = poll(fds, num_devices, -1); // -1 означает бесконечное ожидание
-        if (ret < 0) {
-            perror("poll failed");
+// Новые узлы event*: IN_ATTRIB - udev выдал права уже после создания
+static void handle_inotify(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(infd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len;) {
+            struct inotify_event *ie = (struct inotify_event *)p;
+            if (ie->len && strncmp(ie->name, "event", 5) == 0 && !(ie->mask & IN_ISDIR)) {
+                char path[PATH_LEN];
+                snprintf(path, sizeof(path), INPUT_DIR "/%s", ie->name);
+                add_device(path);
+            }
+            p += sizeof(struct inotify_event) + ie->len;
+        }
+    }
+}
+
+// Поток чтения: epoll по устройствам, inotify и wake_fd
+static void *reader_thread(void *arg) {
+    (void)arg;
+    struct epoll_event ready[MAX_EPOLL_EVENTS];
+    while (!atomic_load(&stop_reader)) {
+        int n = epoll_wait(epfd, ready, MAX_EPOLL_EVENTS, -1); // -1 означает бесконечное ожидание
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
             break;
         }
 
-        // Проверить, на каких файловых дескрипторах произошли события
-        for (int i = 0; i < num_devices; i++) {
-            if (fds[i].revents & POLLIN) {
-                struct input_event ev;
-                ssize_t bytes = read(fds[i].fd, &ev, sizeof(ev));
-                if (bytes == sizeof(ev)) {
-                    printf("Event from %s: type %d, code %d, value %d\n",
-                           device_names[i], ev.type, ev.code, ev.value);
-                }
+        for (int i = 0; i < n; i++) {
+            if (ready[i].data.ptr == &wake_fd) continue;
+            device_t *d = ready[i].data.ptr;
+            if (!d) {
+                handle_inotify();
+                continue;
+            }
+            if (read_device(d) < 0 || (ready[i].events & (EPOLLHUP | EPOLLERR))) {
+                remove_device(d); // Отключено; без аргументов вернется через inotify
             }
         }
+        if (infd < 0 && !devices) break; // Все переданные устройства отключены
     }
 
-    // Закрыть все файловые дескрипторы
-    for (int i = 0; i < num_devices; i++) {
-        close(fds[i].fd);
+    // Итоги и закрытие всех файловых дескрипторов
+    while (devices) {
+        device_t *d = devices;
+        devices = d->next;
+        print_stats(d);
+        close(d->fd);
+        free(d);
+    }
+    atomic_store(&reader_done, 1);
+    return NULL;
+}
+
+// Журнал: печать кадров, может отставать от потока чтения
+static void *log_thread(void *arg) {
+    RtRing *ring = arg;
+    input_frame_t f;
+    for (;;) {
+        if (rt_ring_pop(ring, &f) < 0) {
+            if (atomic_load(&stop_consumers)) break;
+            fflush(stdout);
+            rt_ring_wait(ring, 100);
+            continue;
+        }
+        printf("Frame from %s: %d events%s", f.source, f.count, f.flags & INPUT_FRAME_SPLIT ? " (split)" : "");
+        if (f.kernel_us) printf(", latency %lld us", (long long)(f.read_us - f.kernel_us));
+        printf(", queued %lld us\n", (long long)(now_us() - f.read_us));
+        for (int i = 0; i < f.count; i++) {
+            const struct input_event *ev = &f.events[i];
+            printf("  type %d, code %d, value %d\n", ev->type, ev->code, ev->value);
+        }
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+typedef struct {
+    unsigned long frames;
+    long long capture_max_us;       // Ядро -> поток чтения
+    long long capture_sum_us;
+    unsigned long captured;         // Кадров с известной меткой ядра
+    long long queue_max_us;         // Поток чтения -> потребитель
+    long long queue_sum_us;
+} monitor_stats_t;
+
+static monitor_stats_t monitor;
+
+// Монитор задержек: быстрый потребитель без вывода
+static void *monitor_thread(void *arg) {
+    RtRing *ring = arg;
+    input_frame_t f;
+    for (;;) {
+        if (rt_ring_pop(ring, &f) < 0) {
+            if (atomic_load(&stop_consumers)) break;
+            rt_ring_wait(ring, 100);
+            continue;
+        }
+        long long queued = now_us() - f.read_us;
+        monitor.frames++;
+        monitor.queue_sum_us += queued;
+        if (queued > monitor.queue_max_us) monitor.queue_max_us = queued;
+        if (f.kernel_us) {
+            long long capture = f.read_us - f.kernel_us;
+            monitor.captured++;
+            monitor.capture_sum_us += capture;
+            if (capture > monitor.capture_max_us) monitor.capture_max_us = capture;
+        }
+    }
+    return NULL;
+}
+
+static int start_reader(pthread_t *th) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (reader_prio > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = reader_prio;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &sp);
+    }
+    if (reader_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(reader_cpu, &set);
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+    int rc = pthread_create(th, &attr, reader_thread, NULL);
+    pthread_attr_destroy(&attr);
+    return rc;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-p fifo_prio] [-c cpu] [/dev/input/eventX1 /dev/input/eventX2 ...]\n", prog);
+    fprintf(stderr, "Without devices all %s/event* are monitored, including hotplugged ones.\n", INPUT_DIR);
+    fprintf(stderr, "  -p  SCHED_FIFO priority of the reader thread (root)\n");
+    fprintf(stderr, "  -c  pin the reader thread to this CPU (ideally an isolated one)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "p:c:")) != -1) {
+        switch (opt) {
+        case 'p': reader_prio = atoi(optarg); break;
+        case 'c': reader_cpu = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (epfd < 0 || wake_fd < 0) {
+        perror("epoll_create1/eventfd");
+        return 1;
+    }
+    struct epoll_event wake = {.events = EPOLLIN, .data.ptr = &wake_fd};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &wake);
+
+    for (int i = 0; i < CONSUMER_COUNT; i++) {
+        if (rt_ring_init(&consumers[i].ring, sizeof(input_frame_t), QUEUE_FRAMES) < 0) {
+            perror("rt_ring_init");
+            return 1;
+        }
+    }
+
+    if (optind < argc) {
+        // Открыть все переданные устройства
+        for (int i = optind; i < argc; i++) {
+            if (add_device(argv[i]) < 0) return 1;
+        }
+    } else {
+        infd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (infd < 0 || inotify_add_watch(infd, INPUT_DIR, IN_CREATE | IN_ATTRIB) < 0) {
+            perror("inotify " INPUT_DIR);
+            return 1;
+        }
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL}; // NULL - inotify
+        epoll_ctl(epfd, EPOLL_CTL_ADD, infd, &ev);
+        scan_devices();
+    }
+
+    printf("Monitoring input devices%s. Press Ctrl+C to exit.\n", infd >= 0 ? " with hotplug" : "");
+    fflush(stdout);
+
+    // Сигналы принимает только main: потоки наследуют маску
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    pthread_t reader, logger, mon;
+    pthread_create(&logger, NULL, log_thread, &consumers[CONSUMER_LOG].ring);
+    pthread_create(&mon, NULL, monitor_thread, &consumers[CONSUMER_MONITOR].ring);
+    int rc = start_reader(&reader);
+    if (rc != 0) {
+        fprintf(stderr, "reader thread: %s%s\n", strerror(rc), reader_prio > 0 ? " (SCHED_FIFO needs root)" : "");
+        return 1;
+    }
+
+    struct timespec poll_interval = {0, 100 * 1000000};
+    while (!atomic_load(&reader_done)) {
+        if (sigtimedwait(&sigs, NULL, &poll_interval) > 0) break;
+    }
+    atomic_store(&stop_reader, 1);
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) perror("write wake_fd");
+    pthread_join(reader, NULL);
+
+    // Потребители дочитывают очереди и завершаются
+    atomic_store(&stop_consumers, 1);
+    pthread_join(logger, NULL);
+    pthread_join(mon, NULL);
+
+    for (int i = 0; i < CONSUMER_COUNT; i++) {
+        RtRingStats st;
+        rt_ring_get_stats(&consumers[i].ring, &st);
+        printf("Queue %s: %llu frames, %llu dropped, high water %zu of %d\n", consumers[i].name,
+               (unsigned long long)st.pushed, (unsigned long long)st.dropped, st.high_water, QUEUE_FRAMES);
+        rt_ring_destroy(&consumers[i].ring);
+    }
+    printf("Monitor: %lu frames, queue avg/max %.1f/%lld us", monitor.frames,
+           monitor.frames ? (double)monitor.queue_sum_us / monitor.frames : 0.0, monitor.queue_max_us);
+    if (monitor.captured) {
+        printf(", capture avg/max %.1f/%lld us", (double)monitor.capture_sum_us / monitor.captured,
+               monitor.capture_max_us);
     }
+    printf("\n");
 
+    if (infd >= 0) close(infd);
+    close(wake_fd);
+    close(epfd);
     return 0;
 }
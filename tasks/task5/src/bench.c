@@ -0,0 +1,52 @@
+#include "bench.h"
+
+static const double report_percentiles[] = {50.0, 99.0, 99.9, 99.99};
+#define REPORT_PERCENTILES (int)(sizeof(report_percentiles) / sizeof(report_percentiles[0]))
+
+void bench_print_table(FILE* out, const BenchResult* results, int count) {
+    fprintf(out, "%-14s %-16s %3s %10s %9s %7s %7s %7s %8s %9s %10s\n",
+            "scenario", "allocator", "thr", "ops", "Mops/s", "min", "p50", "p99", "p99.9",
+            "p99.99", "max");
+    for (int i = 0; i < count; ++i) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "%-14s %-16s %3d %10llu %9.2f %7lld", r->scenario, r->allocator, r->threads,
+                (unsigned long long)r->ops, r->ops_per_sec / 1e6,
+                (long long)(r->hist.total ? r->hist.min : 0));
+        fprintf(out, " %7lld %7lld %8lld %9lld",
+                (long long)rt_hist_percentile(&r->hist, 50.0), (long long)rt_hist_percentile(&r->hist, 99.0),
+                (long long)rt_hist_percentile(&r->hist, 99.9), (long long)rt_hist_percentile(&r->hist, 99.99));
+        fprintf(out, " %10lld\n", (long long)(r->hist.total ? r->hist.max : 0));
+    }
+    fprintf(out, "(latencies in ns, timer overhead subtracted)\n");
+}
+
+void bench_write_csv(FILE* out, const BenchResult* results, int count, int64_t timer_overhead_ns) {
+    fprintf(out, "scenario,allocator,threads,ops,ops_per_sec,timer_overhead_ns,min_ns,p50_ns,p99_ns,p99_9_ns,p99_99_ns,max_ns\n");
+    for (int i = 0; i < count; ++i) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "%s,%s,%d,%llu,%.0f,%lld,%lld", r->scenario, r->allocator, r->threads,
+                (unsigned long long)r->ops, r->ops_per_sec, (long long)timer_overhead_ns,
+                (long long)(r->hist.total ? r->hist.min : 0));
+        for (int p = 0; p < REPORT_PERCENTILES; ++p) {
+            fprintf(out, ",%lld", (long long)rt_hist_percentile(&r->hist, report_percentiles[p]));
+        }
+        fprintf(out, ",%lld\n", (long long)(r->hist.total ? r->hist.max : 0));
+    }
+}
+
+void bench_write_json(FILE* out, const BenchResult* results, int count, int64_t timer_overhead_ns) {
+    fprintf(out, "{\n  \"timer_overhead_ns\": %lld,\n  \"results\": [\n", (long long)timer_overhead_ns);
+    for (int i = 0; i < count; ++i) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "    {\"scenario\": \"%s\", \"allocator\": \"%s\", \"threads\": %d, "
+                "\"ops\": %llu, \"ops_per_sec\": %.0f, \"min_ns\": %lld, ",
+                r->scenario, r->allocator, r->threads, (unsigned long long)r->ops, r->ops_per_sec,
+                (long long)(r->hist.total ? r->hist.min : 0));
+        fprintf(out, "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p99_9_ns\": %lld, \"p99_99_ns\": %lld, ",
+                (long long)rt_hist_percentile(&r->hist, 50.0), (long long)rt_hist_percentile(&r->hist, 99.0),
+                (long long)rt_hist_percentile(&r->hist, 99.9), (long long)rt_hist_percentile(&r->hist, 99.99));
+        fprintf(out, "\"max_ns\": %lld}%s\n", (long long)(r->hist.total ? r->hist.max : 0),
+                i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "rt_stats.h"
+
+// Результат одного сценария для одного аллокатора
+typedef struct {
+    const char* scenario;
+    const char* allocator;
+    int threads;
+    uint64_t ops;
+    double ops_per_sec;     // по прогону без замеров каждой операции
+    RtHistogram hist;       // уже за вычетом накладных расходов таймера
+} BenchResult;
+
+void bench_print_table(FILE* out, const BenchResult* results, int count);
+void bench_write_csv(FILE* out, const BenchResult* results, int count, int64_t timer_overhead_ns);
+void bench_write_json(FILE* out, const BenchResult* results, int count, int64_t timer_overhead_ns);
+
+#endif // BENCH_H
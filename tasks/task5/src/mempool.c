@@ -1,47 +1,197 @@
 #include "mempool.h"
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Максимальное число потоков с собственным магазином. Остальные потоки
+// работают напрямую с общим списком.
+#define POOL_MAX_THREADS 64
+#define POOL_MAGAZINE_CAPACITY (2 * POOL_MAGAZINE_BATCH)
+// "Пустой" индекс в общем списке
+#define POOL_NIL UINT32_MAX
 
 // Узел в связном списке свободных блоков
 typedef struct Node {
     struct Node* next;
 } Node;
 
+// Узел общего списка: вместо указателя хранится индекс следующего блока
+typedef struct {
+    _Atomic uint32_t next;
+} IndexNode;
+
+// Кэш блоков одного потока. Выровнен по кэш-линии, чтобы магазины
+// соседних потоков не делили одну линию.
+typedef struct {
+    _Alignas(64) MemoryPool* pool;
+    atomic_int in_use;
+    uint32_t count;
+    // Счетчики пишет только владелец магазина, читает pool_get_stats()
+    _Atomic size_t allocs;
+    _Atomic size_t frees;
+    void* blocks[POOL_MAGAZINE_CAPACITY];
+} PoolMagazine;
+
 // Структура, описывающая пул
 struct MemoryPool {
     size_t block_size;
-    Node* free_list_head; 
-    void* memory_start;    
+    Node* free_list_head;
+    void* memory_start;
     size_t memory_total_size;
+    size_t mapping_size;    // Фактический размер отображения (кратен размеру страницы)
+    PoolBacking backing;
+    int locked;
+    PoolFreeOrder order;
+
+    // Битовая карта свободных блоков (POOL_ORDER_BITMAP)
+    uint64_t* bitmap;
+    size_t bitmap_words;
+    size_t bitmap_hint;     // Слова с меньшими номерами заведомо пусты
+
+    // Статистика заполненности (для обычного пула)
+    size_t in_use;
+    size_t peak_in_use;
+    size_t failed_allocs;
+
+    // Потокобезопасный режим (pool_create_concurrent)
+    int concurrent;
+    size_t block_count;
+    // Общий список: возвращенные блоки кладутся в global_head через CAS, а
+    // снимаются под pop_lock - сначала весь global_head переносится в
+    // pop_head, и проходится только эта цепочка, которую больше никто не видит
+    _Atomic uint32_t global_head;
+    pthread_mutex_t pop_lock;
+    uint32_t pop_head;      // Только под pop_lock
+    pthread_key_t tls_key;
+    PoolMagazine* magazines;
+    // Операции потоков, работающих с общим списком напрямую, и все отказы
+    _Atomic size_t shared_allocs;
+    _Atomic size_t shared_frees;
+    _Atomic size_t shared_failed;
 };
 
-MemoryPool* pool_create(size_t block_size, size_t block_count) {
-    // Размер блока должен быть достаточным, чтобы вместить указатель Node
-    if (block_size < sizeof(Node)) {
-        block_size = sizeof(Node);
+// Значение TLS-ключа для потока, которому не хватило магазина
+static PoolMagazine no_magazine;
+
+static inline IndexNode* node_at(MemoryPool* pool, uint32_t index) {
+    return (IndexNode*)((char*)pool->memory_start + (size_t)index * pool->block_size);
+}
+
+static inline uint32_t index_of(MemoryPool* pool, void* block) {
+    return (uint32_t)(((char*)block - (char*)pool->memory_start) / pool->block_size);
+}
+
+// Снять из общего списка до want блоков. Цепочка pop_head принадлежит
+// держателю pop_lock, поэтому next читаются только у блоков, которые еще
+// никому не выданы: чужие (уже занятые) блоки при проходе не трогаются.
+static uint32_t global_pop_batch(MemoryPool* pool, void** out, uint32_t want) {
+    pthread_mutex_lock(&pool->pop_lock);
+    uint32_t index = pool->pop_head;
+    if (index == POOL_NIL) {
+        index = atomic_exchange_explicit(&pool->global_head, POOL_NIL, memory_order_acquire);
+    }
+    uint32_t n = 0;
+    while (n < want && index != POOL_NIL) {
+        out[n++] = node_at(pool, index);
+        index = atomic_load_explicit(&node_at(pool, index)->next, memory_order_relaxed);
     }
+    pool->pop_head = index;
+    pthread_mutex_unlock(&pool->pop_lock);
+    return n;
+}
+
+// Вернуть в общий список блоки blocks[0..n) одной операцией CAS.
+// Читается только голова списка, поэтому ABA здесь безвредна.
+static void global_push_batch(MemoryPool* pool, void** blocks, uint32_t n) {
+    if (n == 0) return;
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+        atomic_store_explicit(&((IndexNode*)blocks[i])->next, index_of(pool, blocks[i + 1]),
+                              memory_order_relaxed);
+    }
+    IndexNode* last = (IndexNode*)blocks[n - 1];
+    uint32_t first = index_of(pool, blocks[0]);
+    uint32_t old_head = atomic_load_explicit(&pool->global_head, memory_order_relaxed);
+    do {
+        atomic_store_explicit(&last->next, old_head, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->global_head, &old_head, first,
+                                                    memory_order_release, memory_order_relaxed));
+}
 
+// Деструктор TLS-ключа: поток завершается, отдаем его блоки остальным
+static void magazine_release(void* arg) {
+    PoolMagazine* mag = (PoolMagazine*)arg;
+    if (!mag || mag == &no_magazine) return;
+    global_push_batch(mag->pool, mag->blocks, mag->count);
+    mag->count = 0;
+    atomic_store_explicit(&mag->in_use, 0, memory_order_release);
+}
+
+// Закрепить за текущим потоком свободный магазин
+static PoolMagazine* magazine_attach(MemoryPool* pool) {
+    for (int i = 0; i < POOL_MAX_THREADS; ++i) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&pool->magazines[i].in_use, &expected, 1)) {
+            pthread_setspecific(pool->tls_key, &pool->magazines[i]);
+            return &pool->magazines[i];
+        }
+    }
+    pthread_setspecific(pool->tls_key, &no_magazine);
+    return &no_magazine;
+}
+
+// Инкремент счетчика, который меняет только один поток: без RMW-инструкций
+static inline void owner_inc(_Atomic size_t* counter) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+static inline PoolMagazine* magazine_get(MemoryPool* pool) {
+    PoolMagazine* mag = (PoolMagazine*)pthread_getspecific(pool->tls_key);
+    return mag ? mag : magazine_attach(pool);
+}
+
+// Общая часть всех конструкторов: разметка памяти в список блоков
+static MemoryPool* pool_setup(void* memory, size_t block_size, size_t block_count,
+                              PoolBacking backing, PoolFreeOrder order) {
     // Выделить память для самой структуры пула
-    MemoryPool* pool = (MemoryPool*)malloc(sizeof(MemoryPool));
+    MemoryPool* pool = (MemoryPool*)calloc(1, sizeof(MemoryPool));
     if (!pool) return NULL;
 
     pool->block_size = block_size;
+    pool->block_count = block_count;
     pool->memory_total_size = block_size * block_count;
+    pool->mapping_size = pool->memory_total_size;
+    pool->memory_start = memory;
+    pool->backing = backing;
+    pool->order = order;
+    pool->free_list_head = NULL;
 
-    // Выделить один большой кусок памяти для всех блоков
-    pool->memory_start = malloc(pool->memory_total_size);
-    if (!pool->memory_start) {
-        free(pool);
-        return NULL;
+    if (order == POOL_ORDER_BITMAP) {
+        // Бит 1 - блок свободен; хвост последнего слова остается нулевым
+        pool->bitmap_words = (block_count + 63) / 64;
+        pool->bitmap = (uint64_t*)malloc(pool->bitmap_words * sizeof(uint64_t));
+        if (!pool->bitmap) {
+            free(pool);
+            return NULL;
+        }
+        for (size_t w = 0; w < pool->bitmap_words; ++w) pool->bitmap[w] = ~0ULL;
+        if (block_count % 64) pool->bitmap[pool->bitmap_words - 1] = (1ULL << (block_count % 64)) - 1;
+        return pool;
     }
 
-    // Заблокировать выделенную память в RAM
-    mlock(pool->memory_start, pool->memory_total_size);
-
-    // Разметить память как связный список свободных блоков
-    pool->free_list_head = NULL;
+    // Разметить память как связный список свободных блоков. В порядке LIFO
+    // первым выдается последний блок, в порядке ADDRESS - первый.
     for (size_t i = 0; i < block_count; ++i) {
-        Node* current_node = (Node*)((char*)pool->memory_start + i * block_size);
+        size_t index = order == POOL_ORDER_ADDRESS ? block_count - 1 - i : i;
+        Node* current_node = (Node*)((char*)pool->memory_start + index * block_size);
         current_node->next = pool->free_list_head;
         pool->free_list_head = current_node;
     }
@@ -49,29 +199,359 @@ MemoryPool* pool_create(size_t block_size, size_t block_count) {
     return pool;
 }
 
+// Заблокировать память пула в RAM. Без strict неудача только печатается,
+// чтобы не менять поведение pool_create, но и не проходить молча.
+static int pool_lock(MemoryPool* pool, int strict) {
+    if (mlock(pool->memory_start, pool->mapping_size) == 0) {
+        pool->locked = 1;
+        return 0;
+    }
+    int err = errno;
+    fprintf(stderr, "mempool: mlock of %zu bytes failed: %s%s\n", pool->mapping_size,
+            strerror(err), strict ? "" : " (continuing unlocked)");
+    errno = err;
+    return strict ? -1 : 0;
+}
+
+// Перевести только что размеченный пул в потокобезопасный режим
+static int pool_enable_concurrent(MemoryPool* pool) {
+    pool->magazines = (PoolMagazine*)aligned_alloc(64, sizeof(PoolMagazine) * POOL_MAX_THREADS);
+    if (!pool->magazines) return -1;
+    if (pthread_key_create(&pool->tls_key, magazine_release) != 0) {
+        free(pool->magazines);
+        pool->magazines = NULL;
+        return -1;
+    }
+    pthread_mutex_init(&pool->pop_lock, NULL);
+    for (int i = 0; i < POOL_MAX_THREADS; ++i) {
+        pool->magazines[i].pool = pool;
+        atomic_init(&pool->magazines[i].in_use, 0);
+        pool->magazines[i].count = 0;
+        atomic_init(&pool->magazines[i].allocs, 0);
+        atomic_init(&pool->magazines[i].frees, 0);
+    }
+    atomic_init(&pool->shared_allocs, 0);
+    atomic_init(&pool->shared_frees, 0);
+    atomic_init(&pool->shared_failed, 0);
+
+    // Переразметить блоки как список индексов (в том же порядке, что и обычный пул)
+    uint32_t last = (uint32_t)(pool->block_count - 1);
+    for (uint32_t i = 0; i <= last; ++i) {
+        uint32_t next;
+        if (pool->order == POOL_ORDER_ADDRESS) next = i == last ? POOL_NIL : i + 1;
+        else next = i == 0 ? POOL_NIL : i - 1;
+        atomic_init(&node_at(pool, i)->next, next);
+    }
+    atomic_init(&pool->global_head, pool->order == POOL_ORDER_ADDRESS ? 0 : last);
+    pool->pop_head = POOL_NIL;
+    pool->free_list_head = NULL;
+    pool->concurrent = 1;
+    return 0;
+}
+
+// Размер huge page из /proc/meminfo (обычно 2 МБ)
+static size_t huge_page_size(void) {
+    size_t size_kb = 2048;
+    FILE* f = fopen("/proc/meminfo", "r");
+    if (f) {
+        char line[128];
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "Hugepagesize: %zu kB", &size_kb) == 1) break;
+        }
+        fclose(f);
+    }
+    return size_kb * 1024;
+}
+
+// Выделить память пула через mmap: MAP_HUGETLB из зарезервированных
+// huge pages, если не вышло - обычные страницы с подсказкой THP
+static void* map_pool_memory(size_t size, unsigned flags, PoolBacking* backing,
+                             size_t* mapping_size, size_t* page_size) {
+    void* memory;
+    if (flags & POOL_OPT_HUGEPAGES) {
+        size_t huge = huge_page_size();
+        size_t rounded = (size + huge - 1) / huge * huge;
+        memory = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            *backing = POOL_BACKING_HUGETLB;
+            *mapping_size = rounded;
+            *page_size = huge;
+            return memory;
+        }
+        flags |= POOL_OPT_THP;
+    }
+
+    *page_size = (size_t)sysconf(_SC_PAGESIZE);
+    *mapping_size = (size + *page_size - 1) / *page_size * *page_size;
+    memory = mmap(NULL, *mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+    *backing = POOL_BACKING_MMAP;
+    if ((flags & POOL_OPT_THP) && madvise(memory, *mapping_size, MADV_HUGEPAGE) == 0) {
+        *backing = POOL_BACKING_THP;
+    }
+    return memory;
+}
+
+// Привязать страницы к узлу NUMA; должно выполняться до первого обращения
+static int bind_numa_node(void* memory, size_t size, int node) {
+    unsigned long nodemask[4] = {0};
+    const unsigned long bits = sizeof(unsigned long) * 8;
+    if (node < 0 || (unsigned long)node >= bits * 4) {
+        errno = EINVAL;
+        return -1;
+    }
+    nodemask[node / bits] = 1UL << (node % bits);
+    return (int)syscall(SYS_mbind, memory, size, MPOL_BIND, nodemask, bits * 4,
+                        MPOL_MF_STRICT | MPOL_MF_MOVE);
+}
+
+MemoryPool* pool_create(size_t block_size, size_t block_count) {
+    // Размер блока должен быть достаточным, чтобы вместить указатель Node
+    if (block_size < sizeof(Node)) {
+        block_size = sizeof(Node);
+    }
+
+    // Выделить один большой кусок памяти для всех блоков
+    void* memory = malloc(block_size * block_count);
+    if (!memory) return NULL;
+
+    MemoryPool* pool = pool_setup(memory, block_size, block_count, POOL_BACKING_HEAP, POOL_ORDER_LIFO);
+    if (!pool) {
+        free(memory);
+        return NULL;
+    }
+    pool_lock(pool, 0);
+    return pool;
+}
+
+MemoryPool* pool_create_at(void* memory, size_t memory_size, size_t block_size) {
+    if (!memory || block_size < sizeof(Node) || block_size % sizeof(Node) != 0) return NULL;
+    MemoryPool* pool = pool_setup(memory, block_size, memory_size / block_size,
+                                  POOL_BACKING_EXTERNAL, POOL_ORDER_LIFO);
+    if (pool) pool_lock(pool, 0);
+    return pool;
+}
+
+MemoryPool* pool_create_concurrent(size_t block_size, size_t block_count) {
+    // Индекс блока должен помещаться в 32 бита и не совпадать с POOL_NIL
+    if (block_count == 0 || block_count >= POOL_NIL) return NULL;
+
+    MemoryPool* pool = pool_create(block_size, block_count);
+    if (!pool) return NULL;
+    if (pool_enable_concurrent(pool) != 0) {
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+MemoryPool* pool_create_ex(size_t block_size, size_t block_count, const PoolOptions* options) {
+    if (!options) return pool_create(block_size, block_count);
+    if (block_size < sizeof(Node)) {
+        block_size = sizeof(Node);
+    }
+    int concurrent = (options->flags & POOL_OPT_CONCURRENT) != 0;
+    size_t alignment = options->alignment;
+    if (block_count == 0 || (concurrent && block_count >= POOL_NIL) ||
+        (concurrent && options->order == POOL_ORDER_BITMAP) ||
+        (alignment & (alignment - 1)) != 0 || alignment > (size_t)sysconf(_SC_PAGESIZE)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // Шаг блоков кратен выравниванию; начало отображения выровнено по странице
+    if (alignment > 1) {
+        block_size = (block_size + alignment - 1) & ~(alignment - 1);
+    }
+
+    size_t size = block_size * block_count;
+    size_t mapping_size, page_size;
+    PoolBacking backing;
+    void* memory = map_pool_memory(size, options->flags, &backing, &mapping_size, &page_size);
+    if (!memory) return NULL;
+
+    if (options->numa_node >= 0 && bind_numa_node(memory, mapping_size, options->numa_node) != 0) {
+        int err = errno;
+        fprintf(stderr, "mempool: binding to NUMA node %d failed: %s\n", options->numa_node, strerror(err));
+        munmap(memory, mapping_size);
+        errno = err;
+        return NULL;
+    }
+
+    MemoryPool* pool = pool_setup(memory, block_size, block_count, backing, options->order);
+    if (!pool) {
+        munmap(memory, mapping_size);
+        return NULL;
+    }
+    pool->mapping_size = mapping_size;
+    if (pool_lock(pool, (options->flags & POOL_OPT_LOCK_STRICT) != 0) != 0) {
+        int err = errno;
+        pool_destroy(pool);
+        errno = err;
+        return NULL;
+    }
+
+    // Пройти по каждой странице, чтобы все minor faults случились сейчас,
+    // а не при первом pool_alloc в цикле реального времени
+    if (options->flags & POOL_OPT_PREFAULT) {
+        volatile char* bytes = (volatile char*)memory;
+        for (size_t offset = 0; offset < mapping_size; offset += page_size) {
+            bytes[offset] = bytes[offset]; // запись того же байта не портит разметку списка
+        }
+    }
+
+    if ((options->flags & POOL_OPT_CONCURRENT) && pool_enable_concurrent(pool) != 0) {
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
 void* pool_alloc(MemoryPool* pool) {
+    if (!pool) return NULL;
+
+    if (pool->concurrent) {
+        PoolMagazine* mag = magazine_get(pool);
+        if (mag == &no_magazine) {
+            void* block;
+            if (!global_pop_batch(pool, &block, 1)) {
+                atomic_fetch_add_explicit(&pool->shared_failed, 1, memory_order_relaxed);
+                return NULL;
+            }
+            atomic_fetch_add_explicit(&pool->shared_allocs, 1, memory_order_relaxed);
+            return block;
+        }
+        // Быстрый путь: блок из магазина потока, без атомарных операций
+        if (mag->count == 0) {
+            mag->count = global_pop_batch(pool, mag->blocks, POOL_MAGAZINE_BATCH);
+            if (mag->count == 0) {
+                atomic_fetch_add_explicit(&pool->shared_failed, 1, memory_order_relaxed);
+                return NULL;
+            }
+            // Магазин выдает с конца: разворачиваем, чтобы сохранить порядок списка
+            for (uint32_t i = 0, j = mag->count - 1; i < j; ++i, --j) {
+                void* tmp = mag->blocks[i];
+                mag->blocks[i] = mag->blocks[j];
+                mag->blocks[j] = tmp;
+            }
+        }
+        owner_inc(&mag->allocs);
+        return mag->blocks[--mag->count];
+    }
+
+    if (pool->bitmap) {
+        // Самый младший свободный блок: выделение всегда идет вперед по адресам
+        for (size_t w = pool->bitmap_hint; w < pool->bitmap_words; ++w) {
+            uint64_t bits = pool->bitmap[w];
+            if (bits) {
+                pool->bitmap[w] = bits & (bits - 1);
+                pool->bitmap_hint = w;
+                if (++pool->in_use > pool->peak_in_use) pool->peak_in_use = pool->in_use;
+                size_t index = w * 64 + (size_t)__builtin_ctzll(bits);
+                return (char*)pool->memory_start + index * pool->block_size;
+            }
+        }
+        pool->bitmap_hint = pool->bitmap_words;
+        pool->failed_allocs++;
+        return NULL;
+    }
+
     // Извлечь первый свободный блок из списка
-    if (!pool || !pool->free_list_head) {
+    if (!pool->free_list_head) {
+        pool->failed_allocs++;
         return NULL;
     }
     Node* block_to_alloc = pool->free_list_head;
     pool->free_list_head = block_to_alloc->next;
+    if (++pool->in_use > pool->peak_in_use) pool->peak_in_use = pool->in_use;
     return (void*)block_to_alloc;
 }
 
 void pool_free(MemoryPool* pool, void* block) {
     if (!pool || !block) return;
 
+    if (pool->concurrent) {
+        PoolMagazine* mag = magazine_get(pool);
+        if (mag == &no_magazine) {
+            global_push_batch(pool, &block, 1);
+            atomic_fetch_add_explicit(&pool->shared_frees, 1, memory_order_relaxed);
+            return;
+        }
+        // Магазин полон: отдать половину в общий список одной операцией
+        if (mag->count == POOL_MAGAZINE_CAPACITY) {
+            mag->count -= POOL_MAGAZINE_BATCH;
+            global_push_batch(pool, &mag->blocks[mag->count], POOL_MAGAZINE_BATCH);
+        }
+        mag->blocks[mag->count++] = block;
+        owner_inc(&mag->frees);
+        return;
+    }
+
+    if (pool->bitmap) {
+        size_t index = ((char*)block - (char*)pool->memory_start) / pool->block_size;
+        pool->bitmap[index / 64] |= 1ULL << (index % 64);
+        if (index / 64 < pool->bitmap_hint) pool->bitmap_hint = index / 64;
+        pool->in_use--;
+        return;
+    }
+
     // Вернуть блок в начало списка свободных блоков
     Node* node_to_free = (Node*)block;
     node_to_free->next = pool->free_list_head;
     pool->free_list_head = node_to_free;
+    pool->in_use--;
+}
+
+void pool_get_stats(MemoryPool* pool, PoolStats* stats) {
+    if (!pool || !stats) return;
+    stats->block_size = pool->block_size;
+    stats->block_count = pool->block_count;
+    stats->backing = pool->backing;
+    stats->locked = pool->locked;
+
+    if (!pool->concurrent) {
+        stats->in_use = pool->in_use;
+        stats->peak_in_use = pool->peak_in_use;
+        stats->failed_allocs = pool->failed_allocs;
+        return;
+    }
+
+    // Сумма по магазинам: точна, когда потоки не работают с пулом
+    size_t allocs = atomic_load_explicit(&pool->shared_allocs, memory_order_relaxed);
+    size_t frees = atomic_load_explicit(&pool->shared_frees, memory_order_relaxed);
+    for (int i = 0; i < POOL_MAX_THREADS; ++i) {
+        allocs += atomic_load_explicit(&pool->magazines[i].allocs, memory_order_relaxed);
+        frees += atomic_load_explicit(&pool->magazines[i].frees, memory_order_relaxed);
+    }
+    stats->in_use = allocs - frees;
+    stats->peak_in_use = 0; // не отслеживается, чтобы не платить за это на быстром пути
+    stats->failed_allocs = atomic_load_explicit(&pool->shared_failed, memory_order_relaxed);
+}
+
+void pool_flush_thread_cache(MemoryPool* pool) {
+    if (!pool || !pool->concurrent) return;
+    PoolMagazine* mag = (PoolMagazine*)pthread_getspecific(pool->tls_key);
+    if (!mag || mag == &no_magazine) return;
+    pthread_setspecific(pool->tls_key, NULL);
+    magazine_release(mag);
 }
 
 void pool_destroy(MemoryPool* pool) {
     if (!pool) return;
+    if (pool->concurrent) {
+        // Ссылка из TLS вызывающего потока не должна пережить магазины
+        pool_flush_thread_cache(pool);
+        pthread_key_delete(pool->tls_key);
+        pthread_mutex_destroy(&pool->pop_lock);
+        free(pool->magazines);
+    }
     // Разблокировать и освободить всю память
-    munlock(pool->memory_start, pool->memory_total_size);
-    free(pool->memory_start);
+    if (pool->locked) munlock(pool->memory_start, pool->mapping_size);
+    switch (pool->backing) {
+        case POOL_BACKING_HEAP:     free(pool->memory_start); break;
+        case POOL_BACKING_EXTERNAL: break;
+        default:                    munmap(pool->memory_start, pool->mapping_size); break;
+    }
+    free(pool->bitmap);
     free(pool);
 }
@@ -3,20 +3,117 @@
 
 #include <stddef.h>
 
+// Сколько блоков магазин потока забирает из общего списка (и отдает в него) за раз
+#define POOL_MAGAZINE_BATCH 32
+
 typedef struct MemoryPool MemoryPool;
 
+// Флаги PoolOptions
+#define POOL_OPT_CONCURRENT  (1u << 0) // Потокобезопасный режим (как pool_create_concurrent)
+#define POOL_OPT_HUGEPAGES   (1u << 1) // MAP_HUGETLB; если huge pages не зарезервированы - THP
+#define POOL_OPT_THP         (1u << 2) // Обычные страницы с madvise(MADV_HUGEPAGE)
+#define POOL_OPT_PREFAULT    (1u << 3) // Коснуться каждой страницы при создании
+#define POOL_OPT_LOCK_STRICT (1u << 4) // Неудачный mlock - ошибка создания пула
+
+// Порядок выдачи свободных блоков
+typedef enum {
+    POOL_ORDER_LIFO,    // Список, размеченный с конца (как pool_create): адреса убывают
+    POOL_ORDER_ADDRESS, // Список, размеченный с начала: первые выделения идут вперед
+    POOL_ORDER_BITMAP   // Битовая карта: всегда самый младший свободный адрес
+} PoolFreeOrder;
+
+// Параметры создания пула для pool_create_ex()
+typedef struct {
+    unsigned flags;         // Комбинация POOL_OPT_*
+    int numa_node;          // Узел NUMA для страниц пула, -1 - без привязки
+    size_t alignment;       // Выравнивание блоков (степень двойки до размера страницы), 0 - нет
+    PoolFreeOrder order;    // POOL_ORDER_BITMAP несовместим с POOL_OPT_CONCURRENT
+} PoolOptions;
+
+// Чем обеспечена память пула
+typedef enum {
+    POOL_BACKING_HEAP,      // malloc (pool_create)
+    POOL_BACKING_EXTERNAL,  // память вызывающего (pool_create_at)
+    POOL_BACKING_MMAP,      // mmap, обычные страницы
+    POOL_BACKING_THP,       // mmap + transparent huge pages
+    POOL_BACKING_HUGETLB    // mmap(MAP_HUGETLB)
+} PoolBacking;
+
+// Снимок заполненности пула
+typedef struct {
+    size_t block_size;
+    size_t block_count;
+    PoolBacking backing;
+    int locked;             // Удалось ли заблокировать память пула в RAM
+    size_t in_use;          // Выдано блоков в данный момент
+    size_t peak_in_use;     // Максимум in_use за время жизни (0 для потокобезопасного пула)
+    size_t failed_allocs;   // Сколько раз pool_alloc вернул NULL
+} PoolStats;
+
 /**
  * @brief Создает пул памяти.
- * 
+ *
  * @param block_size Размер одного блока в байтах.
  * @param block_count Количество блоков в пуле.
  * @return Указатель на созданный пул или NULL в случае ошибки.
  */
 MemoryPool* pool_create(size_t block_size, size_t block_count);
 
+/**
+ * @brief Создает пул с явными параметрами размещения памяти.
+ *
+ * Память берется через mmap (при POOL_OPT_HUGEPAGES - из huge pages),
+ * при необходимости привязывается к узлу NUMA до первого касания,
+ * блокируется в RAM и прогревается, поэтому после возврата обращения
+ * к блокам пула не вызывают page faults.
+ *
+ * При alignment = 64 каждый блок занимает целое число кэш-линий, и блоки,
+ * отданные разным потокам, не попадают в одну линию (false sharing).
+ *
+ * @param block_size Размер одного блока в байтах.
+ * @param block_count Количество блоков в пуле.
+ * @param options Параметры; NULL - то же, что pool_create().
+ * @return Указатель на созданный пул или NULL (errno указывает причину).
+ */
+MemoryPool* pool_create_ex(size_t block_size, size_t block_count, const PoolOptions* options);
+
+/**
+ * @brief Создает пул поверх памяти, выделенной вызывающим.
+ *
+ * Память не освобождается в pool_destroy(). Используется, когда несколько
+ * пулов должны лежать в одной заранее зарезервированной области
+ * (см. slab.h).
+ *
+ * @param memory Начало области.
+ * @param memory_size Размер области в байтах.
+ * @param block_size Размер блока, кратный sizeof(void*).
+ * @return Указатель на созданный пул или NULL в случае ошибки.
+ */
+MemoryPool* pool_create_at(void* memory, size_t memory_size, size_t block_size);
+
+/**
+ * @brief Создает потокобезопасный пул памяти.
+ *
+ * Свободные блоки хранятся в общем стеке: возврат - lock-free CAS, а
+ * снятие идет под мьютексом, который сначала забирает весь стек себе и
+ * только потом проходит его (next читаются лишь у свободных блоков).
+ * Каждый поток получает собственный "магазин" блоков: pool_alloc/pool_free
+ * работают с магазином без атомарных операций и обращаются к общему
+ * стеку только пачками по POOL_MAGAZINE_BATCH блоков.
+ *
+ * Блоки, осевшие в магазине другого потока, недоступны остальным до
+ * pool_flush_thread_cache() или завершения этого потока, поэтому
+ * block_count стоит выбирать с запасом на (число потоков * 2 * batch).
+ *
+ * @param block_size Размер одного блока в байтах.
+ * @param block_count Количество блоков в пуле.
+ * @return Указатель на созданный пул или NULL в случае ошибки.
+ */
+MemoryPool* pool_create_concurrent(size_t block_size, size_t block_count);
+
 /**
  * @brief Выделяет один блок из пула.
- * 
+ *
  * @param pool Указатель на пул.
  * @return Указатель на выделенный блок или NULL, если свободных блоков нет.
  */
@@ -24,15 +121,39 @@ void* pool_alloc(MemoryPool* pool);
 
 /**
  * @brief Возвращает блок обратно в пул.
- * 
+ *
  * @param pool Указатель на пул.
  * @param block Указатель на блок, который нужно освободить.
  */
 void pool_free(MemoryPool* pool, void* block);
 
+/**
+ * @brief Возвращает блоки из магазина текущего потока в общий список.
+ *
+ * Имеет смысл только для пула из pool_create_concurrent(); для обычного
+ * пула ничего не делает. При завершении потока вызывается автоматически.
+ *
+ * @param pool Указатель на пул.
+ */
+void pool_flush_thread_cache(MemoryPool* pool);
+
+/**
+ * @brief Возвращает статистику заполненности пула.
+ *
+ * Для потокобезопасного пула значения собираются по магазинам всех
+ * потоков и точны только в моменты, когда пул никто не использует.
+ *
+ * @param pool Указатель на пул.
+ * @param stats Куда записать статистику.
+ */
+void pool_get_stats(MemoryPool* pool, PoolStats* stats);
+
 /**
  * @brief Уничтожает пул и освобождает всю выделенную под него память.
- * 
+ *
+ * Для потокобезопасного пула вызывающий должен гарантировать, что
+ * другие потоки больше не обращаются к пулу.
+ *
  * @param pool Указатель на пул.
  */
 void pool_destroy(MemoryPool* pool);
@@ -0,0 +1,105 @@
+#include "slab.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SLAB_DEFAULT_BLOCKS 1024
+
+struct SlabAllocator {
+    char* arena;            // Начало области со всеми регионами
+    size_t arena_size;
+    unsigned region_shift;  // Регион класса i: [arena + (i << shift), arena + ((i + 1) << shift))
+    MemoryPool* pools[SLAB_CLASS_COUNT];
+};
+
+int slab_size_class(size_t size) {
+    if (size <= ((size_t)1 << SLAB_MIN_SHIFT)) return 0;
+    if (size > SLAB_MAX_SIZE) return -1;
+    // ceil(log2(size)) через число ведущих нулей
+    int log2_ceil = 64 - __builtin_clzll((unsigned long long)(size - 1));
+    return log2_ceil - SLAB_MIN_SHIFT;
+}
+
+size_t slab_class_size(int cls) {
+    return (size_t)1 << (cls + SLAB_MIN_SHIFT);
+}
+
+SlabAllocator* slab_create(const SlabConfig* config) {
+    SlabAllocator* slab = (SlabAllocator*)calloc(1, sizeof(SlabAllocator));
+    if (!slab) return NULL;
+
+    // Регион должен вместить самый большой из классов
+    size_t counts[SLAB_CLASS_COUNT];
+    size_t region_need = (size_t)sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        counts[i] = config ? config->block_count[i] : SLAB_DEFAULT_BLOCKS;
+        size_t bytes = counts[i] * slab_class_size(i);
+        if (bytes > region_need) region_need = bytes;
+    }
+    slab->region_shift = 64 - __builtin_clzll((unsigned long long)(region_need - 1));
+    slab->arena_size = (size_t)SLAB_CLASS_COUNT << slab->region_shift;
+
+    // Резервируем адресное пространство; физические страницы получат только
+    // реально используемые части регионов (их заблокирует pool_create_at)
+    void* arena = mmap(NULL, slab->arena_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED) {
+        free(slab);
+        return NULL;
+    }
+    slab->arena = (char*)arena;
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        if (counts[i] == 0) continue;
+        size_t block = slab_class_size(i);
+        slab->pools[i] = pool_create_at(slab->arena + ((size_t)i << slab->region_shift),
+                                        counts[i] * block, block);
+        if (!slab->pools[i]) {
+            slab_destroy(slab);
+            return NULL;
+        }
+    }
+    return slab;
+}
+
+void* slab_alloc(SlabAllocator* slab, size_t size) {
+    int cls = slab_size_class(size);
+    if (!slab || cls < 0) return NULL;
+    return pool_alloc(slab->pools[cls]);
+}
+
+void slab_free(SlabAllocator* slab, void* ptr) {
+    if (!slab || !ptr) return;
+    size_t offset = (size_t)((char*)ptr - slab->arena);
+    if (offset >= slab->arena_size) return; // не наш указатель
+    pool_free(slab->pools[offset >> slab->region_shift], ptr);
+}
+
+void slab_get_stats(SlabAllocator* slab, int cls, PoolStats* stats) {
+    if (!stats) return;
+    if (!slab || cls < 0 || cls >= SLAB_CLASS_COUNT || !slab->pools[cls]) {
+        *stats = (PoolStats){.block_size = cls >= 0 ? slab_class_size(cls) : 0};
+        return;
+    }
+    pool_get_stats(slab->pools[cls], stats);
+}
+
+void slab_print_stats(SlabAllocator* slab, FILE* out) {
+    fprintf(out, "%8s %10s %10s %10s %10s\n", "class", "blocks", "in_use", "peak", "failed");
+    for (int i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        PoolStats st;
+        slab_get_stats(slab, i, &st);
+        fprintf(out, "%8zu %10zu %10zu %10zu %10zu\n",
+                slab_class_size(i), st.block_count, st.in_use, st.peak_in_use, st.failed_allocs);
+    }
+}
+
+void slab_destroy(SlabAllocator* slab) {
+    if (!slab) return;
+    for (int i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        pool_destroy(slab->pools[i]);
+    }
+    munmap(slab->arena, slab->arena_size);
+    free(slab);
+}
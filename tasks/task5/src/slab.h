@@ -0,0 +1,72 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "mempool.h"
+
+// Классы размеров: 16, 32, 64, ..., 4096 байт (степени двойки)
+#define SLAB_MIN_SHIFT 4
+#define SLAB_MAX_SHIFT 12
+#define SLAB_CLASS_COUNT (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_MAX_SIZE ((size_t)1 << SLAB_MAX_SHIFT)
+
+typedef struct SlabAllocator SlabAllocator;
+
+// Сколько блоков зарезервировать в каждом классе. Класс с нулем блоков
+// не создается, запросы этого размера завершаются отказом.
+typedef struct {
+    size_t block_count[SLAB_CLASS_COUNT];
+} SlabConfig;
+
+/**
+ * @brief Создает slab-аллокатор из набора пулов фиксированного размера.
+ *
+ * Все пулы лежат в одной области, разделенной на равные регионы размером
+ * в степень двойки, поэтому класс блока вычисляется по адресу сдвигом,
+ * без заголовка перед блоком. Как и MemoryPool, аллокатор не потокобезопасен.
+ *
+ * @param config Число блоков по классам; NULL - по 1024 блока на класс.
+ * @return Указатель на аллокатор или NULL в случае ошибки.
+ */
+SlabAllocator* slab_create(const SlabConfig* config);
+
+/**
+ * @brief Выделяет блок наименьшего класса, вмещающего size байт (O(1)).
+ *
+ * @return Указатель на блок или NULL, если size > SLAB_MAX_SIZE или
+ *         свободных блоков подходящего класса нет (в кучу не уходит).
+ */
+void* slab_alloc(SlabAllocator* slab, size_t size);
+
+/**
+ * @brief Возвращает блок в пул его класса (класс определяется по адресу).
+ */
+void slab_free(SlabAllocator* slab, void* ptr);
+
+/**
+ * @brief Номер класса для запроса size байт или -1, если размер слишком велик.
+ */
+int slab_size_class(size_t size);
+
+/**
+ * @brief Размер блока класса cls в байтах.
+ */
+size_t slab_class_size(int cls);
+
+/**
+ * @brief Статистика заполненности класса cls (нули, если класс не создан).
+ */
+void slab_get_stats(SlabAllocator* slab, int cls, PoolStats* stats);
+
+/**
+ * @brief Выводит таблицу заполненности по классам.
+ */
+void slab_print_stats(SlabAllocator* slab, FILE* out);
+
+/**
+ * @brief Уничтожает аллокатор и освобождает зарезервированную область.
+ */
+void slab_destroy(SlabAllocator* slab);
+
+#endif // SLAB_H
@@ -0,0 +1,278 @@
+/*
+ * Разбор журнала замеров rt_slog после прогона.
+ *
+ * Запуск: slog_analyze file.slog [-t tag] [-b bin_ms] [-T threshold] [-g gap_ms] [-n top] [-c series.csv]
+ *   -t  только записи с этой меткой (номер или имя)
+ *   -b  ширина интервала временного ряда; по умолчанию - длительность / 40
+ *   -T  порог выброса; по умолчанию p99.9 выбранных записей
+ *   -g  выбросы ближе этого промежутка объединяются в одно окно (10 мс)
+ *   -n  сколько худших окон показать (10)
+ *   -c  временной ряд целиком в CSV (t_ms,count,min,p50,p99,max) - для gnuplot
+ *
+ * Выводит сводку по меткам, гистограмму по степеням двойки, временной ряд
+ * (p50/p99/max по интервалам, с полосой max) и окна выбросов: где во
+ * времени сгущались задержки выше порога.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_slog.h"
+#include "rt_stats.h"
+
+#define SERIES_ROWS 40
+#define BAR_WIDTH 40
+#define MAX_TAGS 65536
+
+typedef struct {
+    int64_t start_ns;
+    int64_t end_ns;
+    uint64_t outliers;
+    int64_t max;
+    unsigned max_tag;
+} Window;
+
+static RtSampleLog log_file;
+static long tag_filter = -1;
+
+static int selected(const RtSlogRecord* r) {
+    return tag_filter < 0 || rt_slog_tag(r) == (unsigned)tag_filter;
+}
+
+static long parse_tag(const char* s) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (end != s && *end == '\0') return v;
+    char buf[RT_SLOG_TAG_NAME + 1];
+    for (unsigned t = 0; t < RT_SLOG_MAX_TAGS; ++t) {
+        if (strcmp(rt_slog_tag_name(&log_file, t, buf, sizeof(buf)), s) == 0) return (long)t;
+    }
+    return -1;
+}
+
+static void print_header(uint64_t count) {
+    const RtSlogHeader* h = log_file.hdr;
+    time_t start = (time_t)(h->start_real_ns / 1000000000);
+    char when[64];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    int64_t span = count ? rt_slog_time(&log_file.records[count - 1]) : 0;
+    printf("%.*s\n", (int)sizeof(h->description), h->description);
+    printf("started %s, %llu records over %.3f s, %llu dropped, values in %.*s\n", when,
+           (unsigned long long)count, span / 1e9, (unsigned long long)h->dropped, (int)sizeof(h->unit), h->unit);
+}
+
+// По метке: count и точные перцентили выбором
+static void print_tags(uint64_t count, int64_t* scratch) {
+    static uint64_t per_tag[MAX_TAGS];
+    for (uint64_t i = 0; i < count; ++i) per_tag[rt_slog_tag(&log_file.records[i])]++;
+    printf("\n%-16s %10s %10s %10s %10s %10s %10s %12s\n", "tag", "count", "min", "p50", "p99", "p99.9", "max",
+           "mean");
+    for (unsigned t = 0; t < MAX_TAGS; ++t) {
+        if (!per_tag[t] || (tag_filter >= 0 && t != (unsigned)tag_filter)) continue;
+        size_t n = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (rt_slog_tag(&log_file.records[i]) == t) scratch[n++] = log_file.records[i].value;
+        }
+        RtSampleStats st;
+        rt_stats_compute(scratch, n, &st);
+        static const double pct[] = {50.0, 99.0, 99.9};
+        int64_t q[3];
+        rt_stats_percentiles(scratch, n, pct, 3, q);
+        char name[RT_SLOG_TAG_NAME + 1];
+        printf("%-16s %10zu %10lld %10lld %10lld %10lld %10lld %12.1f\n", rt_slog_tag_name(&log_file, t, name, sizeof(name)),
+               n, (long long)st.min, (long long)q[0], (long long)q[1], (long long)q[2], (long long)st.max, st.mean);
+    }
+}
+
+static void bar(int len) {
+    for (int i = 0; i < len; ++i) putchar('#');
+}
+
+// Корзины по степеням двойки: [2^k, 2^(k+1))
+static void print_histogram(const int64_t* values, size_t n) {
+    uint64_t buckets[65] = {0};
+    for (size_t i = 0; i < n; ++i) {
+        int k = values[i] > 0 ? 64 - __builtin_clzll((uint64_t)values[i]) : 0;
+        buckets[k]++;
+    }
+    uint64_t peak = 0;
+    int first = -1, last = 0;
+    for (int k = 0; k < 65; ++k) {
+        if (!buckets[k]) continue;
+        if (first < 0) first = k;
+        last = k;
+        if (buckets[k] > peak) peak = buckets[k];
+    }
+    if (first < 0) return;
+    printf("\nhistogram (%.*s)\n", (int)sizeof(log_file.hdr->unit), log_file.hdr->unit);
+    for (int k = first; k <= last; ++k) {
+        long long lo = k ? 1ll << (k - 1) : 0, hi = k ? (1ll << k) - 1 : 0;
+        printf("  [%12lld, %12lld] %10llu %6.2f%% ", lo, hi, (unsigned long long)buckets[k], 100.0 * buckets[k] / n);
+        // Хотя бы один символ у непустой корзины: одиночные выбросы не пропадают
+        bar(buckets[k] ? (int)(buckets[k] * BAR_WIDTH / peak) + (buckets[k] * BAR_WIDTH < peak) : 0);
+        putchar('\n');
+    }
+}
+
+/**
+ * Временной ряд: записи идут по времени, поэтому интервал - непрерывный
+ * отрезок журнала. Перцентили каждого - выбором по копии значений.
+ */
+static void print_series(uint64_t count, int64_t bin_ns, int64_t* scratch, FILE* csv) {
+    int64_t span = count ? rt_slog_time(&log_file.records[count - 1]) + 1 : 0;
+    int64_t peak = 1;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (selected(&log_file.records[i]) && log_file.records[i].value > peak) peak = log_file.records[i].value;
+    }
+    long bins = (long)((span + bin_ns - 1) / bin_ns);
+    int print_every = bins > SERIES_ROWS * 4 ? (int)(bins / SERIES_ROWS) : 1;
+    printf("\ntime series, %.3f ms bins%s\n", bin_ns / 1e6,
+           print_every > 1 ? " (every Nth shown, use -c for all)" : "");
+    printf("%10s %8s %10s %10s %10s  max\n", "t, ms", "count", "p50", "p99", "max");
+    if (csv) fprintf(csv, "t_ms,count,min,p50,p99,max\n");
+    uint64_t i = 0;
+    for (long b = 0; b < bins; ++b) {
+        int64_t end = (b + 1) * bin_ns;
+        size_t n = 0;
+        for (; i < count && rt_slog_time(&log_file.records[i]) < end; ++i) {
+            if (selected(&log_file.records[i])) scratch[n++] = log_file.records[i].value;
+        }
+        if (n == 0) continue;
+        RtSampleStats st;
+        rt_stats_compute(scratch, n, &st);
+        static const double pct[] = {50.0, 99.0};
+        int64_t q[2];
+        rt_stats_percentiles(scratch, n, pct, 2, q);
+        if (csv) {
+            fprintf(csv, "%.3f,%zu,%lld,%lld,%lld,%lld\n", b * bin_ns / 1e6, n, (long long)st.min, (long long)q[0],
+                    (long long)q[1], (long long)st.max);
+        }
+        if (b % print_every != 0) continue;
+        printf("%10.1f %8zu %10lld %10lld %10lld  ", b * bin_ns / 1e6, n, (long long)q[0], (long long)q[1],
+               (long long)st.max);
+        bar((int)(st.max * BAR_WIDTH / peak) + 1);
+        putchar('\n');
+    }
+}
+
+static int cmp_window(const void* a, const void* b) {
+    const Window* x = a;
+    const Window* y = b;
+    return (x->max < y->max) - (x->max > y->max);
+}
+
+// Выбросы ближе gap_ns друг к другу - одно окно; худшие окна по max
+static void print_windows(uint64_t count, int64_t threshold, int64_t gap_ns, int top) {
+    size_t cap = 64, n = 0;
+    Window* w = malloc(cap * sizeof(*w));
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count && w; ++i) {
+        const RtSlogRecord* r = &log_file.records[i];
+        if (!selected(r) || r->value <= threshold) continue;
+        total++;
+        int64_t t = rt_slog_time(r);
+        if (n == 0 || t - w[n - 1].end_ns > gap_ns) {
+            if (n == cap) {
+                Window* grown = realloc(w, (cap *= 2) * sizeof(*w));
+                if (!grown) break;
+                w = grown;
+            }
+            w[n++] = (Window){t, t, 0, INT64_MIN, 0};
+        }
+        Window* cur = &w[n - 1];
+        cur->end_ns = t;
+        cur->outliers++;
+        if (r->value > cur->max) {
+            cur->max = r->value;
+            cur->max_tag = rt_slog_tag(r);
+        }
+    }
+    printf("\noutliers > %lld: %llu in %zu windows (gap %.1f ms)\n", (long long)threshold, (unsigned long long)total, n,
+           gap_ns / 1e6);
+    if (n == 0) {
+        free(w);
+        return;
+    }
+    qsort(w, n, sizeof(*w), cmp_window);
+    printf("%12s %12s %10s %12s  tag of max\n", "start, ms", "length, ms", "outliers", "max");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k) {
+        char name[RT_SLOG_TAG_NAME + 1];
+        printf("%12.3f %12.3f %10llu %12lld  %s\n", w[k].start_ns / 1e6, (w[k].end_ns - w[k].start_ns) / 1e6,
+               (unsigned long long)w[k].outliers, (long long)w[k].max,
+               rt_slog_tag_name(&log_file, w[k].max_tag, name, sizeof(name)));
+    }
+    free(w);
+}
+
+int main(int argc, char *argv[]) {
+    const char* tag_arg = NULL;
+    const char* csv_path = NULL;
+    double bin_ms = 0, gap_ms = 10;
+    long long threshold = -1;
+    int top = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:T:g:n:c:")) != -1) {
+        switch (opt) {
+        case 't': tag_arg = optarg; break;
+        case 'b': bin_ms = atof(optarg); break;
+        case 'T': threshold = atoll(optarg); break;
+        case 'g': gap_ms = atof(optarg); break;
+        case 'n': top = atoi(optarg); break;
+        case 'c': csv_path = optarg; break;
+        default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s file.slog [-t tag] [-b bin_ms] [-T threshold] [-g gap_ms] [-n top] [-c series.csv]\n",
+                argv[0]);
+        return 1;
+    }
+    if (rt_slog_open(&log_file, argv[optind]) != 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (tag_arg && (tag_filter = parse_tag(tag_arg)) < 0) {
+        fprintf(stderr, "unknown tag '%s'\n", tag_arg);
+        return 1;
+    }
+
+    uint64_t count = rt_slog_count(&log_file);
+    print_header(count);
+    int64_t* scratch = malloc((count ? count : 1) * sizeof(int64_t));
+    if (!scratch) {
+        perror("malloc");
+        return 1;
+    }
+    print_tags(count, scratch);
+
+    size_t n = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (selected(&log_file.records[i])) scratch[n++] = log_file.records[i].value;
+    }
+    if (n == 0) {
+        printf("no records%s\n", tag_filter >= 0 ? " with this tag" : "");
+        return 0;
+    }
+    print_histogram(scratch, n);
+    if (threshold < 0) {
+        static const double p999 = 99.9;
+        int64_t q;
+        rt_stats_percentiles(scratch, n, &p999, 1, &q);
+        threshold = q;
+    }
+
+    int64_t span = rt_slog_time(&log_file.records[count - 1]) + 1;
+    int64_t bin_ns = bin_ms > 0 ? (int64_t)(bin_ms * 1e6) : (span + SERIES_ROWS - 1) / SERIES_ROWS;
+    if (bin_ns < 1) bin_ns = 1;
+    FILE* csv = csv_path ? fopen(csv_path, "w") : NULL;
+    if (csv_path && !csv) perror(csv_path);
+    print_series(count, bin_ns, scratch, csv);
+    if (csv) fclose(csv);
+    print_windows(count, threshold, (int64_t)(gap_ms * 1e6), top);
+
+    free(scratch);
+    rt_slog_close(&log_file);
+    return 0;
+}
@@ -1,18 +1,55 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
 #include <sys/resource.h>
+#include "rt_clock.h"
+#include "rt_perf.h"
+#include "rt_slog.h"
+#include "rt_stats.h"
 
 #define ARRAY_SIZE (512 * 1024 * 1024) // 512 MB
 #define PAGE_SIZE 4096
 #define NUM_ITERATIONS 1000
+#define DEFAULT_LOG "task1_latency.slog"
 
-long long timespec_diff_ns(struct timespec start, struct timespec end) {
-    return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+// Метки записей журнала: что случилось во время доступа
+enum { TAG_RESIDENT, TAG_MINOR_FAULT, TAG_MAJOR_FAULT };
+
+static RtPerf perf;
+
+// Счетчики faults и переключений: perf_event_open (одно чтение группы)
+// или, если он недоступен, getrusage - он дороже самого замеряемого доступа
+static void read_counters(RtPerfSample* out) {
+    if (rt_perf_has(&perf, RT_PERF_MINOR_FAULTS)) {
+        rt_perf_read(&perf, out);
+        return;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    memset(out, 0, sizeof(*out));
+    out->value[RT_PERF_MINOR_FAULTS] = (uint64_t)usage.ru_minflt;
+    out->value[RT_PERF_MAJOR_FAULTS] = (uint64_t)usage.ru_majflt;
+    out->value[RT_PERF_CONTEXT_SWITCHES] = (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    long iterations = NUM_ITERATIONS;
+    const char* log_path = DEFAULT_LOG;
+    int verbose = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:v")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atol(optarg); break;
+        case 'l': log_path = optarg; break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-n iterations] [-l log.slog] [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0) iterations = NUM_ITERATIONS;
     printf("Task 1: Demonstrating Page Faults\n");
 
     // Выделить большой массив с помощью malloc
@@ -22,36 +59,96 @@ int main() {
         return 1;
     }
 
-    struct timespec start_time, end_time;
-    struct rusage usage_before, usage_after;
+    RtPerfSample before, after, delta;
 
-    printf("Iter\tLatency (ns)\tMinor Faults\tMajor Faults\n");
+    rt_clock_init();
+    printf("Clock source: %s (overhead %lld ns)\n", rt_clock_source(), (long long)rt_clock_overhead_ns());
+    if (rt_perf_open(&perf, 1u << RT_PERF_MINOR_FAULTS | 1u << RT_PERF_MAJOR_FAULTS |
+                                1u << RT_PERF_CONTEXT_SWITCHES) == 0) {
+        perror("perf_event_open (falling back to getrusage)");
+    }
+    rt_perf_print_status(stdout, &perf);
 
-    for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        // Получить статистику использования ресурсов ДО доступа к памяти (getrusage)
-        getrusage(RUSAGE_SELF, &usage_before);
+    // Итерации пишутся в журнал, а не в stdout: форматирование и write на
+    // каждой итерации сами сдвигали бы замеряемые задержки
+    RtSampleLog log;
+    if (rt_slog_create(&log, log_path, (uint64_t)iterations, "task5 task1_latency: page-stride write latency") != 0) {
+        perror(log_path);
+        rt_perf_close(&perf);
+        free(array);
+        return 1;
+    }
+    rt_slog_set_tag_name(&log, TAG_RESIDENT, "resident");
+    rt_slog_set_tag_name(&log, TAG_MINOR_FAULT, "minor fault");
+    rt_slog_set_tag_name(&log, TAG_MAJOR_FAULT, "major fault");
+
+    // Счетчики каждой итерации для -v - в памяти рядом с журналом (в записи
+    // только метка); страницы тронуты до цикла, чтобы запись не давала faults
+    RtPerfSample* deltas = calloc((size_t)iterations, sizeof(RtPerfSample));
+    if (!deltas) {
+        perror("calloc");
+        rt_slog_close(&log);
+        rt_perf_close(&perf);
+        free(array);
+        return 1;
+    }
+    memset(deltas, 0, (size_t)iterations * sizeof(RtPerfSample));
+
+    for (long i = 0; i < iterations; ++i) {
+        // Счетчики ДО доступа к памяти
+        read_counters(&before);
 
         // Замерить время ДО доступа
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        int64_t start_ns = rt_clock_now_ns();
 
         // Обратиться к элементу массива с шагом, равным размеру страницы
         // Это спровоцирует page fault, если страница еще не в памяти
-        int index = (i * PAGE_SIZE) % ARRAY_SIZE;
+        long index = (i * PAGE_SIZE) % ARRAY_SIZE;
         array[index] = 1;
 
         // Замерить время ПОСЛЕ доступа
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        int64_t end_ns = rt_clock_end_ns();
 
-        // Получить статистику использования ресурсов ПОСЛЕ доступа
-        getrusage(RUSAGE_SELF, &usage_after);
+        // Счетчики ПОСЛЕ доступа
+        read_counters(&after);
+        rt_perf_delta(&before, &after, &delta);
+        deltas[i] = delta;
 
-        long long latency = timespec_diff_ns(start_time, end_time);
-        long minor_faults = usage_after.ru_minflt - usage_before.ru_minflt;
-        long major_faults = usage_after.ru_majflt - usage_before.ru_majflt;
+        int tag = delta.value[RT_PERF_MAJOR_FAULTS] ? TAG_MAJOR_FAULT :
+                  delta.value[RT_PERF_MINOR_FAULTS] ? TAG_MINOR_FAULT : TAG_RESIDENT;
+        rt_slog_append(&log, start_ns, (unsigned)tag, end_ns - start_ns - rt_clock_overhead_ns());
+    }
 
-        printf("%d\t%lld\t\t%ld\t\t%ld\n", i, latency, minor_faults, major_faults);
+    // Разбор - после цикла, по журналу: остаток кольца переносится в файл
+    rt_slog_flush(&log);
+    RtHistogram faulted, resident;
+    rt_hist_init(&faulted);
+    rt_hist_init(&resident);
+    uint64_t count = rt_slog_count(&log);
+    if (verbose) printf("Iter\tTime (us)\tLatency (ns)\tMinor Faults\tMajor Faults\tSwitches\tAccess\n");
+    for (uint64_t i = 0; i < count; ++i) {
+        const RtSlogRecord* r = &log.records[i];
+        char name[RT_SLOG_TAG_NAME + 1];
+        if (verbose) {
+            const RtPerfSample* d = &deltas[i];
+            printf("%llu\t%.1f\t\t%lld\t\t%llu\t\t%llu\t\t%llu\t\t%s\n", (unsigned long long)i,
+                   rt_slog_time(r) / 1e3, (long long)r->value, (unsigned long long)d->value[RT_PERF_MINOR_FAULTS],
+                   (unsigned long long)d->value[RT_PERF_MAJOR_FAULTS],
+                   (unsigned long long)d->value[RT_PERF_CONTEXT_SWITCHES],
+                   rt_slog_tag_name(&log, rt_slog_tag(r), name, sizeof(name)));
+        }
+        rt_hist_record(rt_slog_tag(r) == TAG_RESIDENT ? &resident : &faulted, r->value);
     }
 
+    printf("\n");
+    rt_hist_print_summary(stdout, "With page fault", &faulted);
+    rt_hist_print_summary(stdout, "Without fault  ", &resident);
+    printf("Log: %s (%llu records) - analyze with ./slog_analyze %s\n", log_path, (unsigned long long)count,
+           log_path);
+
+    rt_slog_close(&log);
+    rt_perf_close(&perf);
+    free(deltas);
     free(array);
     return 0;
 }
@@ -3,55 +3,117 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/resource.h>
-#include <sys/mman.h>
+#include <sched.h>
+#include "mempool.h"
+#include "rt_clock.h"
+#include "rt_init.h"
 
 #define ARRAY_SIZE (512 * 1024 * 1024) // 512 MB
 #define PAGE_SIZE 4096
 #define NUM_ITERATIONS 1000
 
-long long timespec_diff_ns(struct timespec start, struct timespec end) {
-    return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+static const char *backing_name(PoolBacking backing) {
+    switch (backing) {
+        case POOL_BACKING_HUGETLB: return "hugetlb";
+        case POOL_BACKING_THP:     return "thp";
+        case POOL_BACKING_MMAP:    return "mmap";
+        default:                   return "heap";
+    }
 }
 
-int main() {
-    printf("Task 2: Preventing Page Faults with mlockall\n");
+static void usage(const char *progname) {
+    fprintf(stderr, "Usage: %s [-p] [-H] [-n node]\n", progname);
+    fprintf(stderr, "  -p       measure blocks of a prefaulted MemoryPool instead of malloc+mlockall\n");
+    fprintf(stderr, "  -H       back the pool with huge pages (MAP_HUGETLB, THP fallback)\n");
+    fprintf(stderr, "  -n node  bind the pool to a NUMA node\n");
+}
 
-    // Заблокировать текущую и будущую память процесса в RAM
-    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
-        perror("mlockall failed. Try running with sudo.");
-        return 1;
+int main(int argc, char *argv[]) {
+    int use_pool = 0;
+    PoolOptions options = {.flags = POOL_OPT_PREFAULT | POOL_OPT_LOCK_STRICT, .numa_node = -1};
+    int opt;
+    while ((opt = getopt(argc, argv, "pHn:")) != -1) {
+        switch (opt) {
+            case 'p': use_pool = 1; break;
+            case 'H': options.flags |= POOL_OPT_HUGEPAGES; break;
+            case 'n': options.numa_node = atoi(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
     }
 
-    char *array = (char *)malloc(ARRAY_SIZE);
-    if (!array) {
-        perror("malloc failed");
-        return 1;
+    MemoryPool *pool = NULL;
+    char *array = NULL;
+
+    if (use_pool) {
+        // Пул сам блокирует и прогревает свою память, mlockall не нужен
+        printf("Task 2: Preventing Page Faults with a prefaulted memory pool\n");
+        PoolStats st;
+        pool = pool_create_ex(PAGE_SIZE, ARRAY_SIZE / PAGE_SIZE, &options);
+        if (!pool) {
+            perror("pool_create_ex failed. Try running with sudo.");
+            return 1;
+        }
+        pool_get_stats(pool, &st);
+        printf("Pool: %zu blocks of %zu bytes, backing=%s, locked=%d\n",
+               st.block_count, st.block_size, backing_name(st.backing), st.locked);
+    } else {
+        printf("Task 2: Preventing Page Faults with mlockall\n");
+
+        // Заблокировать текущую и будущую память процесса в RAM (mlockall)
+        // и прогреть стек; политику планирования не трогаем
+        RtInitConfig init;
+        rt_init_config_default(&init);
+        init.policy = SCHED_OTHER;
+        RtInitReport report;
+        // Фатален только отказ mlockall: без него замер теряет смысл
+        if (rt_init(&init, &report) != 0) {
+            rt_init_print_report(stderr, &report);
+            if (report.memlock.status == RT_INIT_FAILED) {
+                fprintf(stderr, "mlockall failed. Try running with sudo.\n");
+                return 1;
+            }
+        }
+
+        array = (char *)malloc(ARRAY_SIZE);
+        if (!array) {
+            perror("malloc failed");
+            return 1;
+        }
+
+        // "Прогреть" память, чтобы вызвать все minor faults на этапе инициализации
+        printf("Pre-faulting memory...\n");
+        for (size_t i = 0; i < ARRAY_SIZE; i += PAGE_SIZE) {
+            array[i] = 0;
+        }
+        printf("Memory pre-faulting complete.\n");
     }
 
-    // "Прогреть" память, чтобы вызвать все minor faults на этапе инициализации
-    printf("Pre-faulting memory...\n");
-    for (size_t i = 0; i < ARRAY_SIZE; i += PAGE_SIZE) {
-        array[i] = 0;
-    }
-    printf("Memory pre-faulting complete.\n");
+    rt_clock_init();
+    printf("Clock source: %s (overhead %lld ns)\n", rt_clock_source(), (long long)rt_clock_overhead_ns());
 
-    struct timespec start_time, end_time;
     struct rusage usage_before, usage_after;
 
     printf("Iter\tLatency (ns)\tMinor Faults\tMajor Faults\n");
 
     // Сбрасываем статистику перед основным циклом
     getrusage(RUSAGE_SELF, &usage_before);
+    struct rusage usage_start = usage_before;
 
     for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        int64_t start_ns = rt_clock_now_ns();
 
-        int index = (i * PAGE_SIZE) % ARRAY_SIZE;
-        array[index] = 1;
+        if (pool) {
+            // Каждый блок пула занимает отдельную страницу
+            char *block = (char *)pool_alloc(pool);
+            block[0] = 1;
+        } else {
+            int index = (i * PAGE_SIZE) % ARRAY_SIZE;
+            array[index] = 1;
+        }
 
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        int64_t end_ns = rt_clock_end_ns();
 
-        long long latency = timespec_diff_ns(start_time, end_time);
+        long long latency = end_ns - start_ns - rt_clock_overhead_ns();
 
         // Замеряем общее количество отказов после цикла
         // В идеале, оно не должно меняться внутри цикла
@@ -63,6 +125,11 @@ int main() {
         usage_before = usage_after; // Обновляем для следующей итерации
     }
 
+    printf("Faults after startup: minor=%ld, major=%ld\n",
+           usage_before.ru_minflt - usage_start.ru_minflt,
+           usage_before.ru_majflt - usage_start.ru_majflt);
+
+    pool_destroy(pool);
     free(array);
     // munlockall() вызывается неявно при завершении процесса
     return 0;
@@ -1,78 +1,483 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include "mempool.h"
+#include "slab.h"
+#include "bench.h"
+#include "rt_clock.h"
+#include "rt_init.h"
 
 #define BENCH_ITERATIONS 1000000
 #define BLOCK_SIZE 128
+#define CHURN_LIVE_SET 1024
+#define SLAB_LIVE_SET 256
+#define TOUCH_BLOCKS (1 << 18)
+#define TOUCH_BLOCK_SIZE 48
+#define DEFAULT_THREADS 4
+#define MAX_RESULTS 32
 
-long long timespec_diff_ns(struct timespec start, struct timespec end) {
-    return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+// Единый интерфейс для сравниваемых аллокаторов
+typedef struct {
+    const char* name;
+    void* (*alloc)(void* ctx, size_t size);
+    void (*free)(void* ctx, void* ptr);
+    void* ctx;
+} Allocator;
+
+static void* malloc_alloc(void* ctx, size_t size) { (void)ctx; return malloc(size); }
+static void malloc_free(void* ctx, void* ptr) { (void)ctx; free(ptr); }
+
+static void* pool_alloc_fn(void* ctx, size_t size) { (void)size; return pool_alloc(ctx); }
+static void pool_free_fn(void* ctx, void* ptr) { pool_free(ctx, ptr); }
+
+static void* slab_alloc_fn(void* ctx, size_t size) { return slab_alloc(ctx, size); }
+static void slab_free_fn(void* ctx, void* ptr) { slab_free(ctx, ptr); }
+
+// Обычный пул под одним мьютексом - то, что было до pool_create_concurrent
+typedef struct {
+    MemoryPool* pool;
+    pthread_mutex_t lock;
+} LockedPool;
+
+static void* locked_alloc(void* ctx, size_t size) {
+    (void)size;
+    LockedPool* lp = ctx;
+    pthread_mutex_lock(&lp->lock);
+    void* block = pool_alloc(lp->pool);
+    pthread_mutex_unlock(&lp->lock);
+    return block;
 }
 
-void benchmark_malloc() {
-    printf("Benchmarking malloc/free...\n");
-    struct timespec start, end;
-    long long max_latency = 0;
-    void* ptrs[BENCH_ITERATIONS];
+static void locked_free(void* ctx, void* ptr) {
+    LockedPool* lp = ctx;
+    pthread_mutex_lock(&lp->lock);
+    pool_free(lp->pool, ptr);
+    pthread_mutex_unlock(&lp->lock);
+}
+
+// Параметры одного прогона сценария
+typedef struct {
+    const Allocator* allocator;
+    size_t size;            // 0 - случайные размеры 16..SLAB_MAX_SIZE
+    int ops;
+    int live;               // Размер живого набора для churn
+    unsigned seed;
+    RtHistogram* hist; // NULL - прогон на пропускную способность, без замеров
+    int64_t overhead;       // Стоимость пары замеров времени
+} RunParams;
+
+typedef int64_t (*ScenarioFn)(const RunParams* p);
+
+static BenchResult results[MAX_RESULTS];
+static int result_count;
+static int64_t timer_overhead;
+
+// Размеры сообщений 16..4096 байт, детерминированная последовательность
+static size_t next_message_size(unsigned* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return 16 + (*seed >> 8) % (SLAB_MAX_SIZE - 16 + 1);
+}
 
-    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        ptrs[i] = malloc(BLOCK_SIZE);
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        long long latency = timespec_diff_ns(start, end);
-        if (latency > max_latency) max_latency = latency;
+static size_t next_size(const RunParams* p, unsigned* seed) {
+    return p->size ? p->size : next_message_size(seed);
+}
+
+static void record(const RunParams* p, int64_t start, int64_t end) {
+    rt_hist_record(p->hist, end - start - p->overhead);
+}
+
+static int64_t scenario_alloc(const RunParams* p) {
+    const Allocator* a = p->allocator;
+    void** ptrs = malloc(sizeof(void*) * p->ops);
+    if (!ptrs) return -1;
+    unsigned seed = p->seed;
+
+    int64_t begin = rt_clock_now_ns();
+    for (int i = 0; i < p->ops; ++i) {
+        size_t size = next_size(p, &seed);
+        if (p->hist) {
+            int64_t start = rt_clock_now_ns();
+            ptrs[i] = a->alloc(a->ctx, size);
+            record(p, start, rt_clock_end_ns());
+        } else {
+            ptrs[i] = a->alloc(a->ctx, size);
+        }
     }
+    int64_t elapsed = rt_clock_now_ns() - begin;
 
-    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
-        free(ptrs[i]);
+    for (int i = p->ops - 1; i >= 0; --i) a->free(a->ctx, ptrs[i]);
+    free(ptrs);
+    return elapsed;
+}
+
+static int64_t scenario_free(const RunParams* p) {
+    const Allocator* a = p->allocator;
+    void** ptrs = malloc(sizeof(void*) * p->ops);
+    if (!ptrs) return -1;
+    unsigned seed = p->seed;
+    for (int i = 0; i < p->ops; ++i) ptrs[i] = a->alloc(a->ctx, next_size(p, &seed));
+
+    // Освобождение в обратном порядке возвращает пул в исходное состояние
+    int64_t begin = rt_clock_now_ns();
+    for (int i = p->ops - 1; i >= 0; --i) {
+        if (p->hist) {
+            int64_t start = rt_clock_now_ns();
+            a->free(a->ctx, ptrs[i]);
+            record(p, start, rt_clock_end_ns());
+        } else {
+            a->free(a->ctx, ptrs[i]);
+        }
     }
+    int64_t elapsed = rt_clock_now_ns() - begin;
+    free(ptrs);
+    return elapsed;
+}
+
+// Освободить случайный элемент живого набора и сразу выделить на его место новый
+static int64_t scenario_churn(const RunParams* p) {
+    const Allocator* a = p->allocator;
+    void** live = malloc(sizeof(void*) * p->live);
+    if (!live) return -1;
+    unsigned seed = p->seed;
+    for (int i = 0; i < p->live; ++i) live[i] = a->alloc(a->ctx, next_size(p, &seed));
 
-    printf("malloc/free max latency: %lld ns\n", max_latency);
+    int64_t begin = rt_clock_now_ns();
+    for (int i = 0; i < p->ops; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        int slot = (seed >> 8) % p->live;
+        size_t size = next_size(p, &seed);
+        if (p->hist) {
+            int64_t start = rt_clock_now_ns();
+            a->free(a->ctx, live[slot]);
+            live[slot] = a->alloc(a->ctx, size);
+            record(p, start, rt_clock_end_ns());
+        } else {
+            a->free(a->ctx, live[slot]);
+            live[slot] = a->alloc(a->ctx, size);
+        }
+    }
+    int64_t elapsed = rt_clock_now_ns() - begin;
+
+    for (int i = 0; i < p->live; ++i) a->free(a->ctx, live[i]);
+    free(live);
+    return elapsed;
+}
+
+// Прогон без замеров дает пропускную способность, с замерами - гистограмму
+static void run_scenario(const char* scenario, ScenarioFn fn, RunParams params) {
+    if (result_count == MAX_RESULTS) return;
+    BenchResult* r = &results[result_count];
+
+    params.hist = NULL;
+    int64_t elapsed = fn(&params);
+    if (elapsed <= 0) {
+        printf("%-14s %-16s failed\n", scenario, params.allocator->name);
+        return;
+    }
+    rt_hist_init(&r->hist);
+    params.hist = &r->hist;
+    fn(&params);
+
+    r->scenario = scenario;
+    r->allocator = params.allocator->name;
+    r->threads = 1;
+    r->ops = params.ops;
+    r->ops_per_sec = params.ops / (elapsed / 1e9);
+    result_count++;
+}
+
+typedef struct {
+    RunParams params;
+    ScenarioFn fn;
+    pthread_barrier_t* barrier;
+    RtHistogram hist;
+    int64_t start_ns;
+    int64_t end_ns;
+} ContentionThread;
+
+static void* contention_thread(void* arg) {
+    ContentionThread* t = arg;
+    if (t->params.hist) {
+        rt_hist_init(&t->hist);
+        t->params.hist = &t->hist;
+    }
+    pthread_barrier_wait(t->barrier);
+    t->start_ns = rt_clock_now_ns();
+    t->fn(&t->params);
+    t->end_ns = rt_clock_now_ns();
+    return NULL;
+}
+
+// Все потоки одновременно гоняют churn на одном общем аллокаторе.
+// @return Длительность прохода в нс или -1, если не хватило памяти.
+static int64_t contention_pass(const Allocator* a, int threads, int ops, RtHistogram* merged) {
+    ContentionThread* ts = calloc(threads, sizeof(*ts));
+    pthread_t* tids = calloc(threads, sizeof(*tids));
+    if (!ts || !tids) {
+        free(ts);
+        free(tids);
+        return -1;
+    }
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+
+    for (int i = 0; i < threads; ++i) {
+        ts[i].params = (RunParams){.allocator = a, .size = BLOCK_SIZE, .ops = ops,
+                                   .live = CHURN_LIVE_SET, .seed = 1 + i,
+                                   .hist = merged ? &ts[i].hist : NULL, .overhead = timer_overhead};
+        ts[i].fn = scenario_churn;
+        ts[i].barrier = &barrier;
+        pthread_create(&tids[i], NULL, contention_thread, &ts[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < threads; ++i) pthread_join(tids[i], NULL);
+    // Отсчет - в самих потоках: после барьера главный поток может получить
+    // процессор, когда рабочие уже почти закончили
+    int64_t begin = ts[0].start_ns, end = ts[0].end_ns;
+    for (int i = 1; i < threads; ++i) {
+        if (ts[i].start_ns < begin) begin = ts[i].start_ns;
+        if (ts[i].end_ns > end) end = ts[i].end_ns;
+    }
+    int64_t elapsed = end - begin;
+
+    if (merged) {
+        for (int i = 0; i < threads; ++i) rt_hist_merge(merged, &ts[i].hist);
+    }
+    pthread_barrier_destroy(&barrier);
+    free(tids);
+    free(ts);
+    return elapsed;
 }
 
-void benchmark_mempool() {
-    printf("Benchmarking memory pool...\n");
-    struct timespec start, end;
-    long long max_latency = 0;
-    void* ptrs[BENCH_ITERATIONS];
+static void run_contention(const Allocator* a, int threads, int ops) {
+    if (result_count == MAX_RESULTS) return;
+    BenchResult* r = &results[result_count];
+    int64_t elapsed = contention_pass(a, threads, ops, NULL);
+    rt_hist_init(&r->hist);
+    if (elapsed < 0 || contention_pass(a, threads, ops, &r->hist) < 0) {
+        printf("contention %s: out of memory, skipped\n", a->name);
+        return;
+    }
+    result_count++;
+
+    r->scenario = "contention";
+    r->allocator = a->name;
+    r->threads = threads;
+    r->ops = (uint64_t)ops * threads;
+    r->ops_per_sec = r->ops / (elapsed / 1e9);
+}
 
-    // Создать пул с достаточным количеством блоков
-    MemoryPool* pool = pool_create(BLOCK_SIZE, BENCH_ITERATIONS);
+void benchmark_fixed_size(int ops) {
+    printf("Benchmarking alloc / free / churn (%d bytes, %d ops)...\n", BLOCK_SIZE, ops);
+    MemoryPool* pool = pool_create(BLOCK_SIZE, ops);
     if (!pool) {
         printf("Failed to create memory pool\n");
         return;
     }
+    const Allocator allocators[] = {
+        {"malloc", malloc_alloc, malloc_free, NULL},
+        {"pool", pool_alloc_fn, pool_free_fn, pool},
+    };
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); ++i) {
+        RunParams params = {.allocator = &allocators[i], .size = BLOCK_SIZE, .ops = ops,
+                            .live = CHURN_LIVE_SET, .seed = 1, .overhead = timer_overhead};
+        run_scenario("alloc", scenario_alloc, params);
+        run_scenario("free", scenario_free, params);
+        run_scenario("churn", scenario_churn, params);
+    }
+    pool_destroy(pool);
+}
+
+void benchmark_slab(int ops) {
+    printf("Benchmarking slab allocator (mixed sizes 16..%zu)...\n", SLAB_MAX_SIZE);
 
-    // Провести бенчмарк для pool_alloc
-    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        ptrs[i] = pool_alloc(pool);
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        long long latency = timespec_diff_ns(start, end);
-        if (latency > max_latency) max_latency = latency;
+    // Каждому классу хватает блоков на весь живой набор
+    SlabConfig config;
+    for (int i = 0; i < SLAB_CLASS_COUNT; ++i) config.block_count[i] = SLAB_LIVE_SET;
+    SlabAllocator* slab = slab_create(&config);
+    if (!slab) {
+        printf("Failed to create slab allocator\n");
+        return;
+    }
+    const Allocator allocators[] = {
+        {"malloc", malloc_alloc, malloc_free, NULL},
+        {"slab", slab_alloc_fn, slab_free_fn, slab},
+    };
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); ++i) {
+        RunParams params = {.allocator = &allocators[i], .size = 0, .ops = ops,
+                            .live = SLAB_LIVE_SET, .seed = 1, .overhead = timer_overhead};
+        run_scenario("churn-mixed", scenario_churn, params);
     }
 
-    // Освободить блоки
-    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
-        pool_free(pool, ptrs[i]);
+    // Занятость классов на пике: живой набор целиком
+    void* live[SLAB_LIVE_SET];
+    unsigned seed = 1;
+    for (int i = 0; i < SLAB_LIVE_SET; ++i) live[i] = slab_alloc(slab, next_message_size(&seed));
+    printf("Slab occupancy (live set of %d):\n", SLAB_LIVE_SET);
+    slab_print_stats(slab, stdout);
+    for (int i = 0; i < SLAB_LIVE_SET; ++i) slab_free(slab, live[i]);
+    slab_destroy(slab);
+}
+
+void benchmark_contention(int threads, int ops) {
+    printf("Benchmarking contention (%d threads, churn of %d bytes)...\n", threads, BLOCK_SIZE);
+
+    // Запас на живые наборы всех потоков и их магазины
+    size_t capacity = (size_t)threads * (CHURN_LIVE_SET + 4 * POOL_MAGAZINE_BATCH);
+    LockedPool locked = {.pool = pool_create(BLOCK_SIZE, capacity)};
+    MemoryPool* concurrent = pool_create_concurrent(BLOCK_SIZE, capacity);
+    if (!locked.pool || !concurrent) {
+        printf("Failed to create memory pool\n");
+        pool_destroy(locked.pool);
+        pool_destroy(concurrent);
+        return;
+    }
+    pthread_mutex_init(&locked.lock, NULL);
+
+    const Allocator allocators[] = {
+        {"malloc", malloc_alloc, malloc_free, NULL},
+        {"pool+mutex", locked_alloc, locked_free, &locked},
+        {"pool-concurrent", pool_alloc_fn, pool_free_fn, concurrent},
+    };
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); ++i) {
+        run_contention(&allocators[i], threads, ops);
     }
 
-    printf("pool_alloc max latency: %lld ns\n", max_latency);
+    pthread_mutex_destroy(&locked.lock);
+    pool_destroy(locked.pool);
+    pool_destroy(concurrent);
+}
+
+// Выделить все блоки подряд и сразу записать каждый целиком
+static void touch_run(const char* name, const PoolOptions* options) {
+    if (result_count == MAX_RESULTS) return;
+    void** blocks = malloc(sizeof(void*) * TOUCH_BLOCKS);
+    MemoryPool* pool = pool_create_ex(TOUCH_BLOCK_SIZE, TOUCH_BLOCKS, options);
+    if (!pool || !blocks) {
+        printf("%-16s failed to create pool\n", name);
+        free(blocks);
+        pool_destroy(pool);
+        return;
+    }
+
+    // Пропускная способность: цикл без замеров на каждой операции
+    int64_t begin = rt_clock_now_ns();
+    for (int i = 0; i < TOUCH_BLOCKS; ++i) {
+        blocks[i] = pool_alloc(pool);
+        memset(blocks[i], i, TOUCH_BLOCK_SIZE);
+    }
+    int64_t elapsed = rt_clock_now_ns() - begin;
+    for (int i = TOUCH_BLOCKS - 1; i >= 0; --i) pool_free(pool, blocks[i]);
+
+    // Хвостовая задержка: тот же шаблон с замером каждой операции
+    BenchResult* r = &results[result_count++];
+    rt_hist_init(&r->hist);
+    for (int i = 0; i < TOUCH_BLOCKS; ++i) {
+        int64_t start = rt_clock_now_ns();
+        blocks[i] = pool_alloc(pool);
+        memset(blocks[i], i, TOUCH_BLOCK_SIZE);
+        rt_hist_record(&r->hist, rt_clock_end_ns() - start - timer_overhead);
+    }
+    for (int i = TOUCH_BLOCKS - 1; i >= 0; --i) pool_free(pool, blocks[i]);
+
+    r->scenario = "touch";
+    r->allocator = name;
+    r->threads = 1;
+    r->ops = TOUCH_BLOCKS;
+    r->ops_per_sec = TOUCH_BLOCKS / (elapsed / 1e9);
 
-    // Уничтожить пул
     pool_destroy(pool);
+    free(blocks);
+}
+
+void benchmark_sequential_touch() {
+    printf("Benchmarking sequential allocate-then-touch (%d blocks of %d bytes)...\n",
+           TOUCH_BLOCKS, TOUCH_BLOCK_SIZE);
+    const struct {
+        const char* name;
+        PoolOptions options;
+    } runs[] = {
+        {"pool/lifo",          {.flags = POOL_OPT_PREFAULT, .numa_node = -1, .order = POOL_ORDER_LIFO}},
+        {"pool/address",       {.flags = POOL_OPT_PREFAULT, .numa_node = -1, .order = POOL_ORDER_ADDRESS}},
+        {"pool/bitmap",        {.flags = POOL_OPT_PREFAULT, .numa_node = -1, .order = POOL_ORDER_BITMAP}},
+        {"pool/addr+al64",     {.flags = POOL_OPT_PREFAULT, .numa_node = -1, .alignment = 64,
+                                .order = POOL_ORDER_ADDRESS}},
+    };
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); ++i) {
+        touch_run(runs[i].name, &runs[i].options);
+    }
+}
+
+static void write_report(const char* path, int json) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return;
+    }
+    if (json) {
+        bench_write_json(out, results, result_count, timer_overhead);
+    } else {
+        bench_write_csv(out, results, result_count, timer_overhead);
+    }
+    fclose(out);
+    printf("Results written to %s\n", path);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-n ops] [-t threads] [-c results.csv] [-j results.json]\n", prog);
 }
 
-int main() {
-    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
-        perror("mlockall failed. Try with sudo");
+int main(int argc, char* argv[]) {
+    int ops = BENCH_ITERATIONS;
+    int threads = DEFAULT_THREADS;
+    const char* csv_path = NULL;
+    const char* json_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:c:j:")) != -1) {
+        switch (opt) {
+        case 'n': ops = atoi(optarg); break;
+        case 't': threads = atoi(optarg); break;
+        case 'c': csv_path = optarg; break;
+        case 'j': json_path = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (ops <= 0 || threads <= 0) {
+        usage(argv[0]);
         return 1;
     }
 
-    benchmark_malloc();
+    // Память заблокирована и прогрета до замеров; планирование обычное
+    RtInitConfig init;
+    rt_init_config_default(&init);
+    init.policy = SCHED_OTHER;
+    RtInitReport report;
+    // Фатален, как и раньше, только отказ mlockall; остальное - предупреждение
+    if (rt_init(&init, &report) != 0) {
+        rt_init_print_report(stderr, &report);
+        if (report.memlock.status == RT_INIT_FAILED) {
+            fprintf(stderr, "mlockall failed. Try with sudo\n");
+            return 1;
+        }
+    }
+
+    rt_clock_init();
+    timer_overhead = rt_clock_overhead_ns();
+    printf("Clock source: %s, overhead %lld ns per measurement (subtracted)\n\n",
+           rt_clock_source(), (long long)timer_overhead);
+
+    benchmark_fixed_size(ops);
+    benchmark_slab(ops);
+    benchmark_contention(threads, ops / threads);
+    benchmark_sequential_touch();
+
     printf("\n");
-    benchmark_mempool();
+    bench_print_table(stdout, results, result_count);
+    if (csv_path) write_report(csv_path, 0);
+    if (json_path) write_report(json_path, 1);
 
     return 0;
 }
@@ -1,86 +1,383 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
 #include <sched.h>
 #include <math.h>
+#include <pthread.h>
+#include "rt_clock.h"
+#include "rt_init.h"
+#include "rt_perf.h"
+#include "rt_stats.h"
+#include "rt_stress.h"
 
 #define NUM_ITERATIONS 1000
+#define GAP_SCAN_MS 1000         // Длительность поиска разрывов на каждом ядре
+#define GAP_THRESHOLD_NS 2000    // Разрыв между чтениями часов больше порога - прерывание
+#define MAX_PROC_LINE 4096
+#define OUTLIER_PERCENTILE 99.0
+#define WORST_SHOWN 5
 
-long long timespec_diff_ns(struct timespec start, struct timespec end) {
-    return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
-}
+// Результат не должен выбрасываться оптимизатором, иначе замеряется пустой цикл
+static volatile double work_sink;
 
 void work_function() {
     double result = 0.0;
     for (int i = 0; i < 100000; ++i) {
         result += sin(i) * cos(i);
     }
+    work_sink = result;
+}
+
+/* --- РЕЖИМ ОБХОДА ЯДЕР: по потоку на каждое ядро одновременно --- */
+
+typedef struct {
+    int cpu;
+    long iterations;
+    pthread_barrier_t* barrier;
+    int pinned;
+    int realtime;
+    RtHistogram latencies;
+    RtHistogram gaps;            // Длительности разрывов в потоке отметок времени
+    int64_t scan_ns;
+} CoreProbe;
+
+// Суммы счетчиков /proc/interrupts или /proc/softirqs по столбцам CPU
+static int read_irq_counts(const char* path, unsigned long long* per_cpu, int max_cpus) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char line[MAX_PROC_LINE];
+    int columns[CPU_SETSIZE];
+    int ncols = 0;
+
+    memset(per_cpu, 0, sizeof(*per_cpu) * max_cpus);
+    if (fgets(line, sizeof(line), f)) {
+        // Заголовок: "CPU0 CPU1 ..." - номера ядер по столбцам (офлайн-ядра пропущены)
+        for (char* tok = strtok(line, " \t\n"); tok && ncols < CPU_SETSIZE; tok = strtok(NULL, " \t\n")) {
+            columns[ncols++] = atoi(tok + 3);
+        }
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char* p = strchr(line, ':');
+        if (!p) continue;
+        ++p;
+        unsigned long long values[CPU_SETSIZE];
+        int n = 0;
+        while (n < ncols) {
+            char* end;
+            unsigned long long v = strtoull(p, &end, 10);
+            if (end == p) break;
+            values[n++] = v;
+            p = end;
+        }
+        // Строки ERR/MIS содержат одно общее число, а не значения по ядрам
+        if (n < ncols) continue;
+        for (int i = 0; i < ncols; ++i) {
+            if (columns[i] < max_cpus) per_cpu[columns[i]] += values[i];
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static void* probe_thread(void* arg) {
+    CoreProbe* probe = arg;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(probe->cpu, &mask);
+    probe->pinned = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+    struct sched_param sp = {.sched_priority = 50};
+    probe->realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+
+    rt_hist_init(&probe->latencies);
+    rt_hist_init(&probe->gaps);
+    pthread_barrier_wait(probe->barrier);
+
+    int64_t overhead = rt_clock_overhead_ns();
+    for (long i = 0; i < probe->iterations; ++i) {
+        int64_t start = rt_clock_now_ns();
+        work_function();
+        rt_hist_record(&probe->latencies, rt_clock_end_ns() - start - overhead);
+    }
+
+    // Непрерывно читать часы: все, что отняло процессор дольше порога, - разрыв
+    int64_t begin = rt_clock_now_ns();
+    int64_t prev = begin;
+    int64_t until = begin + GAP_SCAN_MS * 1000000LL;
+    while (prev < until) {
+        int64_t now = rt_clock_now_ns();
+        if (now - prev > GAP_THRESHOLD_NS) rt_hist_record(&probe->gaps, now - prev);
+        prev = now;
+    }
+    probe->scan_ns = prev - begin;
+    return NULL;
+}
+
+// "0,2-5" -> список ядер; без строки - все ядра, доступные процессу
+static int parse_cpu_list(const char* list, int* cpus, int max) {
+    int count = 0;
+    if (!list) {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+        for (int cpu = 0; cpu < CPU_SETSIZE && count < max; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus[count++] = cpu;
+        }
+        return count;
+    }
+    const char* p = list;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) return -1;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return -1;
+        }
+        for (long cpu = first; cpu <= last && count < max; ++cpu) cpus[count++] = (int)cpu;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return count;
+}
+
+static int run_sweep(const char* cpu_list, long iterations) {
+    static int cpus[CPU_SETSIZE];
+    int count = parse_cpu_list(cpu_list, cpus, CPU_SETSIZE);
+    if (count <= 0) {
+        fprintf(stderr, "Invalid CPU list '%s'\n", cpu_list ? cpu_list : "");
+        return 1;
+    }
+
+    CoreProbe* probes = calloc(count, sizeof(*probes));
+    pthread_t* threads = calloc(count, sizeof(*threads));
+    unsigned long long* irq_before = calloc(CPU_SETSIZE, sizeof(unsigned long long));
+    unsigned long long* irq_after = calloc(CPU_SETSIZE, sizeof(unsigned long long));
+    unsigned long long* soft_before = calloc(CPU_SETSIZE, sizeof(unsigned long long));
+    unsigned long long* soft_after = calloc(CPU_SETSIZE, sizeof(unsigned long long));
+    if (!probes || !threads || !irq_before || !irq_after || !soft_before || !soft_after) {
+        perror("calloc");
+        return 1;
+    }
+
+    printf("Sweeping %d CPUs: %ld iterations + %d ms gap scan per CPU...\n", count, iterations, GAP_SCAN_MS);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, count + 1);
+    int have_irq = read_irq_counts("/proc/interrupts", irq_before, CPU_SETSIZE) == 0;
+    int have_soft = read_irq_counts("/proc/softirqs", soft_before, CPU_SETSIZE) == 0;
+    for (int i = 0; i < count; ++i) {
+        probes[i].cpu = cpus[i];
+        probes[i].iterations = iterations;
+        probes[i].barrier = &barrier;
+        pthread_create(&threads[i], NULL, probe_thread, &probes[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < count; ++i) pthread_join(threads[i], NULL);
+    if (have_irq) read_irq_counts("/proc/interrupts", irq_after, CPU_SETSIZE);
+    if (have_soft) read_irq_counts("/proc/softirqs", soft_after, CPU_SETSIZE);
+    pthread_barrier_destroy(&barrier);
+
+    printf("\n%4s %10s %10s %10s %10s %10s | %7s %10s %8s | %8s %8s\n",
+           "cpu", "min_ns", "p50_ns", "p99_ns", "max_ns", "jitter_ns",
+           "gaps", "gap_max", "lost_%", "irqs", "softirqs");
+    for (int i = 0; i < count; ++i) {
+        const CoreProbe* p = &probes[i];
+        double gap_total = rt_hist_mean(&p->gaps) * (double)p->gaps.total;
+        int cpu = p->cpu;
+        printf("%3d%c %10lld %10lld %10lld %10lld %10lld | %7llu %10lld %8.3f | %8llu %8llu\n",
+               cpu, p->pinned ? (p->realtime ? ' ' : '*') : '!',
+               (long long)p->latencies.min, (long long)rt_hist_percentile(&p->latencies, 50.0),
+               (long long)rt_hist_percentile(&p->latencies, 99.0), (long long)p->latencies.max,
+               (long long)(p->latencies.max - p->latencies.min),
+               (unsigned long long)p->gaps.total, (long long)(p->gaps.total ? p->gaps.max : 0),
+               p->scan_ns > 0 ? gap_total * 100.0 / (double)p->scan_ns : 0.0,
+               have_irq ? irq_after[cpu] - irq_before[cpu] : 0ULL,
+               have_soft ? soft_after[cpu] - soft_before[cpu] : 0ULL);
+    }
+    printf("('*' - no SCHED_FIFO, '!' - affinity failed; gaps > %d ns in the timestamp stream,\n"
+           " lost_%% - share of the scan spent in them; irqs/softirqs - deltas for the whole run)\n",
+           GAP_THRESHOLD_NS);
+
+    free(soft_after);
+    free(soft_before);
+    free(irq_after);
+    free(irq_before);
+    free(threads);
+    free(probes);
+    return 0;
+}
+
+// Останавливает нагрузку и печатает, какой она получилась за время замера
+static void finish_load(RtStress* stress) {
+    if (!stress) return;
+    rt_stress_stop(stress);
+    printf("\n--- Background load achieved ---\n");
+    rt_stress_print_report(stdout, stress);
+    rt_stress_destroy(stress);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-L profile] [cpu [iterations]]\n"
+                    "       %s -s [-c cpulist] [-n iterations] [-L profile]   # all CPUs (or cpulist) at once\n"
+                    "  -L  background load for the run: light, mixed, heavy or rt_stress spec\n",
+            prog, prog);
 }
 
 int main(int argc, char *argv[]) {
     int target_cpu = -1;
-    if (argc > 1) {
-        target_cpu = atoi(argv[1]);
+    long iterations = NUM_ITERATIONS;
+    int sweep = 0;
+    const char* cpu_list = NULL;
+    const char* load_spec = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "sc:n:L:")) != -1) {
+        switch (opt) {
+        case 's': sweep = 1; break;
+        case 'c': cpu_list = optarg; sweep = 1; break;
+        case 'n': iterations = atol(optarg); break;
+        case 'L': load_spec = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind < argc) {
+        target_cpu = atoi(argv[optind]);
         printf("Target CPU specified: %d\n", target_cpu);
     }
+    if (optind + 1 < argc) {
+        iterations = atol(argv[optind + 1]);
+    }
+    if (iterations <= 0) iterations = NUM_ITERATIONS;
 
-    /* --- ЗАДАНИЕ 2: УСТАНОВКА CPU AFFINITY --- */
-    if (target_cpu != -1) {
-        // Создать и инициализировать маску CPU
-        cpu_set_t mask;
-        CPU_ZERO(&mask);
-        CPU_SET(target_cpu, &mask);
+    rt_clock_init();
+    printf("Clock source: %s (overhead %lld ns, subtracted)\n", rt_clock_source(),
+           (long long)rt_clock_overhead_ns());
 
-        // Привязать текущий процесс к ядру, указанному в маске
-        if (sched_setaffinity(0, sizeof(cpu_set_t), &mask) == -1) {
-            perror("sched_setaffinity failed. Try with sudo.");
+    // Нагрузка запускается до rt_init: ее потоки не наследуют привязку к
+    // измеряемому ядру, а отчет в конце показывает, сколько ее было на деле
+    RtStress* stress = NULL;
+    if (load_spec) {
+        RtStressProfile profile;
+        char err[128];
+        if (rt_stress_parse(load_spec, &profile, err, sizeof(err)) != 0) {
+            fprintf(stderr, "Bad load profile: %s\n", err);
             return 1;
         }
-        printf("Process pinned to CPU %d\n", target_cpu);
+        if (!(stress = rt_stress_start(&profile))) {
+            perror("rt_stress_start");
+            return 1;
+        }
+        printf("Background load '%s': %d workers\n", load_spec, rt_stress_workers(stress));
+    }
+    if (sweep) {
+        int rc = run_sweep(cpu_list, iterations);
+        finish_load(stress);
+        return rc;
+    }
+
+    /* --- ЗАДАНИЯ 1 и 2: SCHED_FIFO 50 И ПРИВЯЗКА К ЯДРУ --- */
+    // Плюс блокировка и прогрев памяти: замер не ловит page faults
+    RtInitConfig init;
+    rt_init_config_default(&init);
+    init.cpu = target_cpu;
+    RtInitReport report;
+    rt_init(&init, &report);
+    rt_init_print_report(stdout, &report);
+    // Фатальны, как и раньше, привязка и SCHED_FIFO; память - предупреждение
+    if (report.affinity.status == RT_INIT_FAILED || report.sched.status == RT_INIT_FAILED) {
+        fprintf(stderr, "%s failed. Try with sudo.\n",
+                report.sched.status == RT_INIT_FAILED ? "sched_setscheduler" : "sched_setaffinity");
+        return 1;
     }
 
-    /* --- ЗАДАНИЕ 1: УСТАНОВКА REAL-TIME ПРИОРИТЕТА --- */
-    struct sched_param sp;
-    sp.sched_priority = 50; // Приоритет от 1 до 99 для SCHED_FIFO
-    // Установить политику планирования SCHED_FIFO для текущего процесса
-    if (sched_setscheduler(0, SCHED_FIFO, &sp) == -1) {
-        perror("sched_setscheduler failed. Try with sudo.");
+    // Счетчики вокруг каждой итерации: выброс объясняется тем, что
+    // случилось внутри нее, а не догадкой
+    RtPerf perf;
+    rt_perf_open(&perf, RT_PERF_ALL);
+    rt_perf_print_status(stdout, &perf);
+    int64_t* sample_ns = calloc((size_t)iterations, sizeof(int64_t));
+    RtPerfSample* sample_perf = calloc((size_t)iterations, sizeof(RtPerfSample));
+    if (!sample_ns || !sample_perf) {
+        perror("calloc");
         return 1;
     }
-    printf("Scheduler policy set to SCHED_FIFO with priority %d\n", sp.sched_priority);
 
-    long long latencies[NUM_ITERATIONS];
-    long long min_latency = -1, max_latency = 0, total_latency = 0;
+    RtHistogram latencies, cache_misses;
+    rt_hist_init(&latencies);
+    rt_hist_init(&cache_misses);
+
+    printf("Starting benchmark (%ld iterations)...\n", iterations);
+    for (long i = 0; i < iterations; ++i) {
+        RtPerfSample before, after;
+        rt_perf_read(&perf, &before);
+        int64_t start = rt_clock_now_ns();
 
-    printf("Starting benchmark...\n");
-    for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        struct timespec start, end;
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        
         work_function();
-        
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        latencies[i] = timespec_diff_ns(start, end);
 
-        if (min_latency == -1 || latencies[i] < min_latency) {
-            min_latency = latencies[i];
-        }
-        if (latencies[i] > max_latency) {
-            max_latency = latencies[i];
-        }
-        total_latency += latencies[i];
+        int64_t latency = rt_clock_end_ns() - start - rt_clock_overhead_ns();
+        rt_perf_read(&perf, &after);
+        rt_perf_delta(&before, &after, &sample_perf[i]);
+        sample_ns[i] = latency;
+        rt_hist_record(&cache_misses, (int64_t)sample_perf[i].value[RT_PERF_CACHE_MISSES]);
     }
+    // Гистограмма задержек - одним векторным проходом после замера
+    rt_hist_record_bulk(&latencies, sample_ns, (size_t)iterations);
 
-    double avg_latency = (double)total_latency / NUM_ITERATIONS;
-    long long jitter = max_latency - min_latency;
+    long long jitter = latencies.max - latencies.min;
 
     printf("\n--- Benchmark Results ---\n");
-    printf("Min latency:    %lld ns\n", min_latency);
-    printf("Max latency:    %lld ns\n", max_latency);
-    printf("Avg latency:    %.2f ns\n", avg_latency);
+    printf("Min latency:    %lld ns\n", (long long)latencies.min);
+    printf("Max latency:    %lld ns\n", (long long)latencies.max);
+    printf("Avg latency:    %.2f ns\n", rt_hist_mean(&latencies));
+    printf("Std deviation:  %.2f ns\n", rt_hist_stddev(&latencies));
+    printf("p50 / p99 / p99.9: %lld / %lld / %lld ns\n",
+           (long long)rt_hist_percentile(&latencies, 50.0),
+           (long long)rt_hist_percentile(&latencies, 99.0),
+           (long long)rt_hist_percentile(&latencies, 99.9));
     printf("Jitter (max-min): %lld ns\n", jitter);
 
+    // Выбросы - выше p99; промахи кэша считаются причиной, если их больше
+    // двух медиан по всем итерациям
+    int64_t threshold = rt_hist_percentile(&latencies, OUTLIER_PERCENTILE);
+    uint64_t cache_limit = 2 * (uint64_t)rt_hist_percentile(&cache_misses, 50.0);
+    long by_cause[RT_PERF_CAUSE_COUNT] = {0};
+    long outliers = 0;
+    long worst[WORST_SHOWN];
+    int n_worst = 0;
+    for (long i = 0; i < iterations; ++i) {
+        if (sample_ns[i] <= threshold) continue;
+        outliers++;
+        by_cause[rt_perf_classify(&perf, &sample_perf[i], cache_limit)]++;
+        // Вставка в короткий список худших по убыванию
+        int pos = n_worst < WORST_SHOWN ? n_worst++ : WORST_SHOWN;
+        while (pos > 0 && sample_ns[worst[pos - 1]] < sample_ns[i]) {
+            if (pos < WORST_SHOWN) worst[pos] = worst[pos - 1];
+            pos--;
+        }
+        if (pos < WORST_SHOWN) worst[pos] = i;
+    }
+
+    printf("\n--- Outliers (> p%.0f = %lld ns): %ld ---\n", OUTLIER_PERCENTILE, (long long)threshold, outliers);
+    for (int c = 0; c < RT_PERF_CAUSE_COUNT; ++c) {
+        printf("  %-14s %ld\n", rt_perf_cause_name((RtPerfCause)c), by_cause[c]);
+    }
+    if (n_worst > 0) printf("%8s %12s %8s %9s %13s %12s  cause\n", "iter", "latency ns", "faults", "switches",
+                            "cache misses", "cycles");
+    for (int k = 0; k < n_worst; ++k) {
+        const RtPerfSample* d = &sample_perf[worst[k]];
+        printf("%8ld %12lld %8llu %9llu %13llu %12llu  %s\n", worst[k], (long long)sample_ns[worst[k]],
+               (unsigned long long)(d->value[RT_PERF_MINOR_FAULTS] + d->value[RT_PERF_MAJOR_FAULTS]),
+               (unsigned long long)d->value[RT_PERF_CONTEXT_SWITCHES],
+               (unsigned long long)d->value[RT_PERF_CACHE_MISSES], (unsigned long long)d->value[RT_PERF_CYCLES],
+               rt_perf_cause_name(rt_perf_classify(&perf, d, cache_limit)));
+    }
+
+    free(sample_ns);
+    free(sample_perf);
+    rt_perf_close(&perf);
+    finish_load(stress);
     return 0;
 }
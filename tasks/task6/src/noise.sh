@@ -1,5 +1,12 @@
 #!/bin/bash
 
+# С собранным ../stress - воспроизводимая нагрузка по профилю
+# (./noise.sh [light|mixed|heavy|spec]); без него - прежний цикл
+STRESS="$(dirname "$0")/../stress"
+if [ -x "$STRESS" ]; then
+    exec "$STRESS" -p "${1:-mixed}"
+fi
+
 echo "Starting background noise generation... (PID: $$)"
 echo "Press Ctrl+C in this terminal to stop."
 
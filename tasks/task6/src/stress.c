@@ -0,0 +1,76 @@
+/*
+ * Фоновая нагрузка по профилю rt_stress - воспроизводимая замена noise.sh.
+ *
+ * Запуск: stress [-p profile] [-t seconds] [-i interval_s]
+ *   profile - light, mixed, heavy или запись вида
+ *             cpu:cpu=1:duty=50,membw:size=64M,irq:rate=20000
+ *   -t      - время работы; по умолчанию до Ctrl+C
+ *   -i      - печатать отчет каждые interval секунд
+ * В конце - отчет: что заказано и сколько нагрузки реально получилось.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "rt_stress.h"
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char* spec = "mixed";
+    long seconds = 0, interval = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:t:i:")) != -1) {
+        switch (opt) {
+        case 'p': spec = optarg; break;
+        case 't': seconds = atol(optarg); break;
+        case 'i': interval = atol(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-p light|mixed|heavy|spec] [-t seconds] [-i interval_s]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    RtStressProfile profile;
+    char err[128];
+    if (rt_stress_parse(spec, &profile, err, sizeof(err)) != 0) {
+        fprintf(stderr, "Bad profile: %s\n", err);
+        return 1;
+    }
+    struct sigaction sa = {.sa_handler = on_signal};
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    RtStress* stress = rt_stress_start(&profile);
+    if (!stress) {
+        perror("rt_stress_start");
+        return 1;
+    }
+    printf("Load '%s' running (PID: %d), %d workers. Press Ctrl+C to stop.\n", spec, (int)getpid(),
+           rt_stress_workers(stress));
+    fflush(stdout);
+
+    // Сон по секунде: сигнал прерывает его, и проверка stop срабатывает сразу
+    for (long elapsed = 0; !stop && (seconds == 0 || elapsed < seconds);) {
+        struct timespec one = {1, 0};
+        if (nanosleep(&one, NULL) != 0) continue;
+        elapsed++;
+        if (interval > 0 && elapsed % interval == 0) {
+            rt_stress_print_report(stdout, stress);
+            fflush(stdout);
+        }
+    }
+
+    rt_stress_stop(stress);
+    rt_stress_print_report(stdout, stress);
+    rt_stress_destroy(stress);
+    return 0;
+}
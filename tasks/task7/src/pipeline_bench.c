@@ -0,0 +1,706 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "input_frame.h"
+#include "rt_init.h"
+#include "rt_ring.h"
+#include "rt_slog.h"
+#include "rt_stats.h"
+#include "rt_stress.h"
+#include "rt_time.h"
+#include "shm_spsc.h"
+#include "tc_engine.h"
+#include "tc_plan.h"
+
+/*
+ * Сквозной путь события: ввод (task4) -> контроллер (tc_engine) -> IPC
+ * (task3) -> потребитель в другом процессе, с замером на каждой границе.
+ *
+ * Границы и метки времени (rt_now_ns, у каждого события своя строка в
+ * таблице меток, общей для процессов):
+ *
+ *   inject    главный поток - "устройство": с частотой -r пишет в pipe кадр
+ *             в формате evdev (MSC_SERIAL с номером события, KEY, SYN_REPORT)
+ *   read      поток чтения, как в poll_inputs: epoll, read, сборка кадра до
+ *             SYN_REPORT, публикация input_frame_t в кольцо rt_ring
+ *   dispatch  обработчик ввода забрал кадр и отдал запрос движку
+ *             (tc_engine_request: включить или снять ЧС перекрестка)
+ *   control   рабочий поток движка выполнил переход (actual_ns самого движка);
+ *             в on_change новое состояние уходит в IPC
+ *   output    процесс-потребитель получил состояние из shm_spsc (-i shm) или
+ *             очереди POSIX (-i mq) - "выставил сигналы"
+ *
+ * Ни одна стадия не ждет следующую: полный pipe, кольцо, очередь IPC или
+ * еще не выполненный запрос к тому же перекрестку - событие теряется и
+ * считается на своей стадии. Так перегрузка видна как потери, а задержки
+ * остаются задержками пути, а не очереди перед генератором.
+ *
+ * Процесс готовится rt_init (SCHED_FIFO -p, привязка -c, mlockall); без
+ * прав шаги отказывают, и замер идет с обычным планированием (видно в
+ * отчете rt_init). -L - фоновая нагрузка rt_stress. -l - журнал rt_slog
+ * с задержкой каждого перехода по меткам-стадиям для task5/slog_analyze.
+ *
+ * Запуск: pipeline_bench [-r events/s] [-t sec] [-n intersections]
+ *         [-w workers] [-i shm|mq] [-s] [-p prio] [-c cpu] [-L load]
+ *         [-l log] [plan_file]
+ */
+
+#define MAX_EVENTS      (4u << 20)  // Строк таблицы меток: 4M x 40 байт
+#define QUEUE_FRAMES    1024
+#define IPC_SLOTS       4096
+#define MQ_DEPTH        10          // msg_max по умолчанию для непривилегированных
+#define READ_BATCH      64
+#define DRAIN_MS        1000        // Ждать после генератора, пока дойдут события в пути
+#define PIPE_SHM_NAME   "/pipeline_bench"
+#define PIPE_MQ_NAME    "/pipeline_bench"
+#define IPC_BYE         UINT64_MAX
+#define BYE_TIMEOUT_MS  1000        // Потребитель, не освободивший место для BYE за это время, снимается
+
+enum { ST_INJECT, ST_READ, ST_DISPATCH, ST_CONTROL, ST_OUTPUT, ST_COUNT };
+
+// Участки пути: от стадии hop к hop + 1; последний - весь путь
+enum { HOP_INPUT, HOP_QUEUE, HOP_CONTROL, HOP_IPC, HOP_TOTAL, HOP_COUNT };
+
+static const char* const hop_names[HOP_COUNT] = {"input", "queue", "controller", "ipc", "end-to-end"};
+static const char* const hop_spans[HOP_COUNT] = {
+    "inject -> read", "read -> dispatch", "dispatch -> control", "control -> output", "inject -> output"};
+
+typedef struct {
+    int64_t t[ST_COUNT];    // 0 - стадия не пройдена
+} stamp_t;
+
+// Общая с процессом-потребителем часть
+typedef struct {
+    _Atomic uint64_t received;
+    _Atomic uint64_t bad;   // Номер вне таблицы
+    int64_t first_ns;
+    int64_t last_ns;
+    stamp_t stamps[];
+} shared_t;
+
+typedef enum { IPC_SHM, IPC_MQ } ipc_kind_t;
+
+typedef struct {
+    uint64_t seq;
+    uint32_t id;
+    uint8_t state;
+} ipc_msg_t;
+
+static shared_t* shared;
+static uint32_t max_events;
+static uint32_t n_intersections = 1024;
+static TcPlan plan;
+static TcEngine* engine;
+
+static int pipe_fds[2] = {-1, -1};
+static RtRing frames;
+static atomic_int reader_done;
+
+static ipc_kind_t ipc_kind = IPC_SHM;
+static int consumer_spin;
+static shm_spsc_t* ipc_ring;
+static shm_spsc_end_t ipc_writer;
+static pthread_mutex_t ipc_lock = PTHREAD_MUTEX_INITIALIZER;   // Писателей shm_spsc - по рабочему потоку
+static int ipc_locked;
+static mqd_t ipc_mq = (mqd_t)-1;           // Писатель, неблокирующий: рабочие потоки не ждут
+static mqd_t ipc_mq_reader = (mqd_t)-1;    // Потребитель, блокирующий
+
+// pending[id] - номер события + 1, которое ждет перехода на перекрестке id
+static _Atomic uint64_t* pending;
+static uint8_t* want_emergency;     // Принадлежит обработчику ввода
+
+static atomic_uint_fast64_t n_injected, n_input_drops, n_read, n_dispatched, n_busy, n_rejected;
+static atomic_uint_fast64_t n_controlled, n_ipc_drops;
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-r events/s] [-t sec] [-n intersections] [-w workers] [-i shm|mq] [-s]\n"
+            "          [-p fifo_prio] [-c cpu] [-L load] [-l log] [plan_file]\n"
+            "  -i  controller -> consumer IPC: shared-memory SPSC ring (default) or POSIX mq\n"
+            "  -s  consumer spins on the shm ring instead of sleeping on a futex\n"
+            "  -p  SCHED_FIFO priority of the whole pipeline, 0 - normal scheduling (default 50)\n"
+            "  -L  background load: light, mixed, heavy or rt_stress spec\n"
+            "  -l  binary log of per-hop latencies for task5/slog_analyze\n",
+            prog);
+}
+
+// ---------------------------------------------------------------- стадия read
+
+// Поток чтения: события из pipe в кадры до SYN_REPORT, кадр - в кольцо
+static void* reader_thread(void* arg) {
+    (void)arg;
+    rt_prefault_stack(64 << 10);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN};
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, pipe_fds[0], &ev) < 0) {
+        perror("epoll");
+        atomic_store(&reader_done, 1);
+        return NULL;
+    }
+
+    input_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    snprintf(frame.source, sizeof(frame.source), "synthetic");
+    int64_t seq = -1;
+    struct input_event buf[READ_BATCH];
+    for (int eof = 0; !eof;) {
+        struct epoll_event ready;
+        if (epoll_wait(epfd, &ready, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (;;) {
+            ssize_t bytes = read(pipe_fds[0], buf, sizeof(buf));
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes < 0) break;   // EAGAIN: pipe пуст
+            if (bytes == 0) {
+                eof = 1;            // Генератор закончил
+                break;
+            }
+            int count = (int)(bytes / (ssize_t)sizeof(struct input_event));
+            for (int i = 0; i < count; i++) {
+                const struct input_event* e = &buf[i];
+                if (e->type == EV_SYN && e->code == SYN_REPORT) {
+                    int64_t now = rt_now_ns();
+                    if (seq >= 0 && seq < (int64_t)max_events) {
+                        shared->stamps[seq].t[ST_READ] = now;
+                        frame.kernel_us = (int64_t)e->input_event_sec * 1000000 + e->input_event_usec;
+                        frame.read_us = now / 1000;
+                        atomic_fetch_add_explicit(&n_read, 1, memory_order_relaxed);
+                        rt_ring_push(&frames, &frame);
+                    }
+                    frame.count = 0;
+                    seq = -1;
+                    continue;
+                }
+                if (e->type == EV_MSC && e->code == MSC_SERIAL) seq = (uint32_t)e->value;
+                if (frame.count < INPUT_FRAME_EVENTS) frame.events[frame.count++] = *e;
+            }
+            if (bytes < (ssize_t)sizeof(buf)) break;
+        }
+    }
+    close(epfd);
+    atomic_store(&reader_done, 1);
+    return NULL;
+}
+
+// ------------------------------------------------------------ стадия dispatch
+
+static int64_t frame_seq(const input_frame_t* f) {
+    for (int i = 0; i < f->count; i++) {
+        if (f->events[i].type == EV_MSC && f->events[i].code == MSC_SERIAL) return (uint32_t)f->events[i].value;
+    }
+    return -1;
+}
+
+// Обработчик ввода: кадр -> запрос ЧС к перекрестку номер события % n
+static void* dispatch_thread(void* arg) {
+    (void)arg;
+    rt_prefault_stack(64 << 10);
+    input_frame_t f;
+    for (;;) {
+        if (rt_ring_pop(&frames, &f) < 0) {
+            if (atomic_load(&reader_done) && rt_ring_count(&frames) == 0) break;
+            rt_ring_wait(&frames, 100);
+            continue;
+        }
+        int64_t seq = frame_seq(&f);
+        if (seq < 0) continue;
+        uint32_t id = (uint32_t)(seq % n_intersections);
+        uint64_t none = 0;
+        // Запрос к перекрестку, который еще не выполнил прошлый, движок
+        // слил бы с ним - такое событие теряется, а не искажает замер
+        if (!atomic_compare_exchange_strong(&pending[id], &none, (uint64_t)seq + 1)) {
+            atomic_fetch_add_explicit(&n_busy, 1, memory_order_relaxed);
+            continue;
+        }
+        want_emergency[id] = !want_emergency[id];
+        shared->stamps[seq].t[ST_DISPATCH] = rt_now_ns();
+        if (tc_engine_request(engine, id, want_emergency[id] ? TC_REQ_EMERGENCY_ON : TC_REQ_EMERGENCY_OFF) < 0) {
+            want_emergency[id] = !want_emergency[id];
+            shared->stamps[seq].t[ST_DISPATCH] = 0;
+            atomic_store(&pending[id], 0);
+            atomic_fetch_add_explicit(&n_rejected, 1, memory_order_relaxed);
+            continue;
+        }
+        atomic_fetch_add_explicit(&n_dispatched, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------- стадия control
+
+// 0 или -1 - IPC полон, сообщение не отправлено
+static int ipc_send(uint64_t seq, uint32_t id, uint8_t state) {
+    if (ipc_kind == IPC_MQ) {
+        ipc_msg_t msg = {.seq = seq, .id = id, .state = state};
+        return mq_send(ipc_mq, (const char*)&msg, sizeof(msg), 0);
+    }
+    if (ipc_locked) pthread_mutex_lock(&ipc_lock);
+    int rc = shm_spsc_try_push(&ipc_writer, seq << 8 | state);
+    if (ipc_locked) pthread_mutex_unlock(&ipc_lock);
+    return rc;
+}
+
+// В рабочем потоке движка: переход в ЧС или из нее закрывает событие перекрестка
+static void on_change(uint32_t id, uint8_t old_state, uint8_t new_state, int64_t sched_ns, int64_t actual_ns,
+                      void* arg) {
+    (void)sched_ns; (void)arg;
+    if ((old_state == plan.emergency_state) == (new_state == plan.emergency_state)) return; // Таймер цикла
+    uint64_t p = atomic_exchange(&pending[id], 0);
+    if (p == 0) return;
+    uint64_t seq = p - 1;
+    shared->stamps[seq].t[ST_CONTROL] = actual_ns;
+    atomic_fetch_add_explicit(&n_controlled, 1, memory_order_relaxed);
+    if (ipc_send(seq, id, new_state) < 0) atomic_fetch_add_explicit(&n_ipc_drops, 1, memory_order_relaxed);
+}
+
+// -------------------------------------------------------------- стадия output
+
+static void consume(uint64_t seq) {
+    int64_t now = rt_now_ns();
+    if (seq >= max_events) {
+        atomic_fetch_add_explicit(&shared->bad, 1, memory_order_relaxed);
+        return;
+    }
+    shared->stamps[seq].t[ST_OUTPUT] = now;
+    if (!shared->first_ns) shared->first_ns = now;
+    shared->last_ns = now;
+    atomic_fetch_add_explicit(&shared->received, 1, memory_order_relaxed);
+}
+
+// Процесс-потребитель: только системные вызовы и память, общая с родителем
+static void consumer_main(int lock_memory) {
+    // Блокировка памяти не наследуется через fork
+    if (lock_memory) mlockall(MCL_CURRENT | MCL_FUTURE);
+    // Опрос без сна на SCHED_FIFO не отдал бы ядро потокам пути с тем же
+    // приоритетом: крутимся с обычным планированием
+    if (consumer_spin) {
+        struct sched_param sp = {.sched_priority = 0};
+        sched_setscheduler(0, SCHED_OTHER, &sp);
+    }
+    if (ipc_kind == IPC_MQ) {
+        ipc_msg_t msg;
+        for (;;) {
+            ssize_t n = mq_receive(ipc_mq_reader, (char*)&msg, sizeof(msg), NULL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                _exit(1);
+            }
+            if (msg.seq == IPC_BYE) break;
+            consume(msg.seq);
+        }
+        _exit(0);
+    }
+    shm_spsc_end_t reader;
+    shm_spsc_consumer_init(&reader, ipc_ring);
+    uint64_t value;
+    while (shm_spsc_pop(&reader, &value, !consumer_spin) == 0) consume(value >> 8);
+    _exit(errno == EPIPE ? 0 : 1);
+}
+
+static int ipc_open(void) {
+    if (ipc_kind == IPC_MQ) {
+        struct mq_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.mq_maxmsg = MQ_DEPTH;
+        attr.mq_msgsize = sizeof(ipc_msg_t);
+        mq_unlink(PIPE_MQ_NAME);
+        // O_NONBLOCK - свойство открытого описания, общего после fork:
+        // у каждой стороны свой дескриптор
+        ipc_mq_reader = mq_open(PIPE_MQ_NAME, O_CREAT | O_RDONLY | O_CLOEXEC, 0600, &attr);
+        if (ipc_mq_reader == (mqd_t)-1) return -1;
+        ipc_mq = mq_open(PIPE_MQ_NAME, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        mq_unlink(PIPE_MQ_NAME);
+        return ipc_mq == (mqd_t)-1 ? -1 : 0;
+    }
+    ipc_ring = shm_spsc_create(PIPE_SHM_NAME, IPC_SLOTS);
+    if (!ipc_ring) return -1;
+    shm_unlink(PIPE_SHM_NAME); // Отображение переживет имя; потребитель получит его через fork
+    shm_spsc_producer_init(&ipc_writer, ipc_ring);
+    return 0;
+}
+
+// Писатель закончил: потребитель дочитывает остаток и выходит; status - его код для waitpid
+static void ipc_finish(pid_t child, int* status) {
+    if (ipc_kind == IPC_SHM) {
+        shm_spsc_close_writer(ipc_ring);
+        waitpid(child, status, 0);
+        return;
+    }
+    // Дескриптор писателя неблокирующий: ждем места сами, но очередь может
+    // остаться полной навсегда, если потребитель уже вышел или завис
+    ipc_msg_t bye = {.seq = IPC_BYE};
+    int64_t deadline = rt_now_ns() + BYE_TIMEOUT_MS * RT_NSEC_PER_MSEC;
+    while (mq_send(ipc_mq, (const char*)&bye, sizeof(bye), 0) < 0 && (errno == EAGAIN || errno == EINTR)) {
+        if (waitpid(child, status, WNOHANG) == child) return;
+        if (rt_now_ns() >= deadline) {
+            fprintf(stderr, "consumer did not take BYE in %d ms, killing it\n", BYE_TIMEOUT_MS);
+            kill(child, SIGKILL);
+            break;
+        }
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+    waitpid(child, status, 0);
+}
+
+// Ошибка подготовки после fork: потребитель иначе ждал бы в IPC вечно
+static int abort_consumer(pid_t child) {
+    ipc_finish(child, NULL);
+    return 1;
+}
+
+// -------------------------------------------------------------- стадия inject
+
+// Кадр устройства: номер события, нажатие, SYN_REPORT с меткой как у evdev
+static int inject(uint32_t seq, int64_t now) {
+    struct input_event ev[3];
+    memset(ev, 0, sizeof(ev));
+    ev[0].type = EV_MSC;
+    ev[0].code = MSC_SERIAL;
+    ev[0].value = (int32_t)seq;
+    ev[1].type = EV_KEY;
+    ev[1].code = KEY_S;
+    ev[1].value = 1;
+    ev[2].type = EV_SYN;
+    ev[2].code = SYN_REPORT;
+    ev[2].input_event_sec = (time_t)(now / RT_NSEC_PER_SEC);
+    ev[2].input_event_usec = (suseconds_t)(now % RT_NSEC_PER_SEC / 1000);
+    shared->stamps[seq].t[ST_INJECT] = now;
+    // Меньше PIPE_BUF - запись атомарна; полный pipe - как переполнение буфера evdev
+    if (write(pipe_fds[1], ev, sizeof(ev)) != (ssize_t)sizeof(ev)) {
+        shared->stamps[seq].t[ST_INJECT] = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Генератор с постоянной частотой по абсолютным моментам: опоздание одного
+// события не сдвигает расписание остальных
+static int64_t run_injector(double rate, int seconds, uint32_t* injected) {
+    int64_t period = (int64_t)(RT_NSEC_PER_SEC / rate);
+    if (period < 1) period = 1;
+    int64_t start = rt_now_ns();
+    int64_t end = start + (int64_t)seconds * RT_NSEC_PER_SEC;
+    uint32_t seq = 0;
+    int64_t next = start;
+    while (next < end && seq < max_events) {
+        int64_t now = rt_now_ns();
+        if (now < next) {
+            struct timespec ts;
+            rt_ns_to_timespec(next, &ts);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            now = rt_now_ns();
+        }
+        if (inject(seq, now) == 0) {
+            seq++;
+            atomic_fetch_add_explicit(&n_injected, 1, memory_order_relaxed);
+        } else {
+            atomic_fetch_add_explicit(&n_input_drops, 1, memory_order_relaxed);
+        }
+        next += period;
+    }
+    *injected = seq;
+    return rt_now_ns() - start;
+}
+
+// --------------------------------------------------------------------- отчет
+
+static int64_t hop_value(const stamp_t* s, int hop) {
+    if (hop == HOP_TOTAL) return s->t[ST_OUTPUT] - s->t[ST_INJECT];
+    return s->t[hop + 1] - s->t[hop];
+}
+
+// log - журнал, созданный до прогона (его время отсчитывается от создания), или NULL
+static void print_report(uint32_t injected, RtSampleLog* log) {
+    // Только события, прошедшие все стадии: у всех участков одна выборка
+    size_t done = 0;
+    for (uint32_t i = 0; i < injected; i++) {
+        const stamp_t* s = &shared->stamps[i];
+        int complete = 1;
+        for (int st = 0; st < ST_COUNT; st++) complete &= s->t[st] != 0;
+        if (complete) done++;
+    }
+    if (done == 0) {
+        printf("no events completed the pipeline\n");
+        return;
+    }
+    int64_t* values[HOP_COUNT];
+    for (int h = 0; h < HOP_COUNT; h++) {
+        if (!(values[h] = malloc(done * sizeof(int64_t)))) {
+            perror("malloc");
+            return;
+        }
+    }
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < injected; i++) {
+        const stamp_t* s = &shared->stamps[i];
+        int complete = 1;
+        for (int st = 0; st < ST_COUNT; st++) complete &= s->t[st] != 0;
+        if (!complete) continue;
+        for (int h = 0; h < HOP_COUNT; h++) {
+            values[h][n] = hop_value(s, h);
+            if (log) rt_slog_append(log, s->t[ST_INJECT], (unsigned)h, values[h][n]);
+        }
+        n++;
+    }
+
+    static const double pct[] = {50.0, 90.0, 99.0, 99.9, 100.0};
+    enum { PCT_COUNT = sizeof(pct) / sizeof(pct[0]) };
+    int64_t q[HOP_COUNT][PCT_COUNT];
+    double mean[HOP_COUNT];
+    printf("\n%-11s %-20s %9s %9s %9s %9s %9s %9s %9s\n", "hop", "span", "mean_us", "min_us", "p50_us", "p90_us",
+           "p99_us", "p99.9_us", "max_us");
+    for (int h = 0; h < HOP_COUNT; h++) {
+        RtSampleStats st;
+        rt_stats_compute(values[h], n, &st);
+        rt_stats_percentiles(values[h], n, pct, PCT_COUNT, q[h]);
+        mean[h] = st.mean;
+        printf("%-11s %-20s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", hop_names[h], hop_spans[h], st.mean / 1e3,
+               st.min / 1e3, q[h][0] / 1e3, q[h][1] / 1e3, q[h][2] / 1e3, q[h][3] / 1e3, q[h][4] / 1e3);
+    }
+
+    // Какой участок больше всех вносит в среднее и в хвост
+    int by_mean = 0, by_tail = 0;
+    for (int h = 1; h < HOP_TOTAL; h++) {
+        if (mean[h] > mean[by_mean]) by_mean = h;
+        if (q[h][2] > q[by_tail][2]) by_tail = h;
+    }
+    printf("dominant hop: %s (%.0f%% of mean end-to-end), at p99: %s\n", hop_names[by_mean],
+           mean[HOP_TOTAL] > 0 ? 100.0 * mean[by_mean] / mean[HOP_TOTAL] : 0.0, hop_names[by_tail]);
+
+    for (int h = 0; h < HOP_COUNT; h++) free(values[h]);
+}
+
+int main(int argc, char* argv[]) {
+    double rate = 1000;
+    int seconds = 5, workers = 1, prio = 50, cpu = -1;
+    const char* load_spec = NULL;
+    const char* log_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:t:n:w:i:sp:c:L:l:")) != -1) {
+        switch (opt) {
+            case 'r': rate = atof(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'n': n_intersections = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'w': workers = atoi(optarg); break;
+            case 'i':
+                if (strcmp(optarg, "shm") == 0) {
+                    ipc_kind = IPC_SHM;
+                } else if (strcmp(optarg, "mq") == 0) {
+                    ipc_kind = IPC_MQ;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's': consumer_spin = 1; break;
+            case 'p': prio = atoi(optarg); break;
+            case 'c': cpu = atoi(optarg); break;
+            case 'L': load_spec = optarg; break;
+            case 'l': log_path = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (rate <= 0 || seconds < 1 || n_intersections < 1 || workers < 1 || prio < 0 || prio > 99 ||
+        optind + 1 < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    double planned = rate * seconds;
+    max_events = planned < MAX_EVENTS ? (uint32_t)planned + 1 : MAX_EVENTS;
+    if (planned > MAX_EVENTS) {
+        fprintf(stderr, "warning: %.0f events requested, stamp table holds %u; the run stops early\n", planned,
+                MAX_EVENTS);
+    }
+
+    char err[128];
+    int rc = optind < argc ? tc_plan_load(&plan, argv[optind], err, sizeof(err))
+                           : tc_plan_parse(&plan, tc_plan_default_text, err, sizeof(err));
+    if (rc < 0) {
+        fprintf(stderr, "plan: %s\n", err);
+        return 1;
+    }
+    if (plan.emergency_state == TC_NONE) {
+        fprintf(stderr, "plan: no emergency state, nothing for input events to switch\n");
+        return 1;
+    }
+
+    // Нагрузка - до rt_init, как в task6/jitter_benchmark: ее потоки не
+    // наследуют привязку и приоритет пути
+    RtStress* stress = NULL;
+    if (load_spec) {
+        RtStressProfile profile;
+        if (rt_stress_parse(load_spec, &profile, err, sizeof(err)) != 0) {
+            fprintf(stderr, "Bad load profile: %s\n", err);
+            return 1;
+        }
+        if (!(stress = rt_stress_start(&profile))) {
+            perror("rt_stress_start");
+            return 1;
+        }
+        printf("Background load '%s': %d workers\n", load_spec, rt_stress_workers(stress));
+    }
+
+    // Все потоки пути создаются после и наследуют привязку и политику
+    RtInitConfig init;
+    rt_init_config_default(&init);
+    init.cpu = cpu;
+    init.priority = prio;
+    if (prio == 0) init.policy = SCHED_OTHER;
+    RtInitReport report;
+    if (rt_init(&init, &report) != 0) fprintf(stderr, "rt_init: not everything applied, see below\n");
+    rt_init_print_report(stdout, &report);
+    if (report.sched.status != RT_INIT_APPLIED) prio = 0;
+
+    // Таблица меток общая с потребителем; MAP_POPULATE - без отказов страниц в замере
+    size_t shared_bytes = sizeof(shared_t) + (size_t)max_events * sizeof(stamp_t);
+    shared = mmap(NULL, shared_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    pending = calloc(n_intersections, sizeof(*pending));
+    want_emergency = calloc(n_intersections, 1);
+    if (shared == MAP_FAILED || !pending || !want_emergency) {
+        perror("mmap/calloc");
+        return 1;
+    }
+    if (ipc_open() < 0) {
+        perror(ipc_kind == IPC_MQ ? "mq_open" : "shm_spsc_create");
+        return 1;
+    }
+    ipc_locked = ipc_kind == IPC_SHM && workers > 1;
+
+    // Потребитель - до потоков пути: fork копирует только вызывающий поток
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0) consumer_main(report.memlock.status == RT_INIT_APPLIED);
+    if (ipc_kind == IPC_MQ) mq_close(ipc_mq_reader);
+
+    if (pipe2(pipe_fds, O_CLOEXEC | O_NONBLOCK) < 0 || rt_ring_init(&frames, sizeof(input_frame_t), QUEUE_FRAMES) < 0) {
+        perror("pipe2/rt_ring_init");
+        return abort_consumer(child);
+    }
+
+    // Журнал заполняется после прогона, но создается до него: отсчет его
+    // времени - раньше первого события
+    RtSampleLog log;
+    if (log_path) {
+        if (rt_slog_create(&log, log_path, (uint64_t)max_events * HOP_COUNT, "task7 pipeline_bench: per-hop latency") !=
+            0) {
+            perror(log_path);
+            return abort_consumer(child);
+        }
+        for (int h = 0; h < HOP_COUNT; h++) rt_slog_set_tag_name(&log, (unsigned)h, hop_names[h]);
+    }
+
+    TcEngineConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.plan = &plan;
+    cfg.count = n_intersections;
+    cfg.workers = workers;
+    cfg.worker_prio = prio;
+    cfg.on_change = on_change;
+    if (!(engine = tc_engine_create(&cfg)) || (rc = tc_engine_start(engine)) != 0) {
+        fprintf(stderr, "tc_engine: %s\n", strerror(engine ? rc : errno));
+        return abort_consumer(child);
+    }
+    pthread_t reader, dispatcher;
+    if (pthread_create(&reader, NULL, reader_thread, NULL) != 0 ||
+        pthread_create(&dispatcher, NULL, dispatch_thread, NULL) != 0) {
+        perror("pthread_create");
+        tc_engine_stop(engine);
+        return abort_consumer(child);
+    }
+
+    printf("pipeline: %.0f events/s for %d s, %u intersections, %d workers, ipc %s%s, %s\n", rate, seconds,
+           n_intersections, workers, ipc_kind == IPC_MQ ? "mq" : "shm", consumer_spin ? " (spin)" : "",
+           prio ? "SCHED_FIFO" : "SCHED_OTHER");
+    fflush(stdout);
+
+    uint32_t injected;
+    int64_t inject_ns = run_injector(rate, seconds, &injected);
+    close(pipe_fds[1]);
+    pthread_join(reader, NULL);
+    pthread_join(dispatcher, NULL);
+
+    // Дождаться событий, уже отданных движку и потребителю
+    int64_t deadline = rt_now_ns() + DRAIN_MS * RT_NSEC_PER_MSEC;
+    while (rt_now_ns() < deadline) {
+        uint64_t controlled = atomic_load(&n_controlled);
+        uint64_t delivered = atomic_load(&shared->received) + atomic_load(&n_ipc_drops);
+        if (controlled == atomic_load(&n_dispatched) && delivered == controlled) break;
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+    tc_engine_stop(engine);
+    int status = 0;
+    ipc_finish(child, &status);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) fprintf(stderr, "consumer exited abnormally\n");
+    if (stress) {
+        rt_stress_stop(stress);
+        printf("\n--- Background load achieved ---\n");
+        rt_stress_print_report(stdout, stress);
+        rt_stress_destroy(stress);
+    }
+
+    RtRingStats ring_st;
+    rt_ring_get_stats(&frames, &ring_st);
+    uint64_t received = atomic_load(&shared->received);
+    printf("\nevents: %llu injected (%.0f/s offered, %.0f/s achieved)\n", (unsigned long long)injected, rate,
+           injected / (inject_ns / 1e9));
+    printf("losses: input %llu (pipe full), queue %llu (ring full, high water %zu of %d), "
+           "controller %llu busy + %llu rejected, ipc %llu (%s full)\n",
+           (unsigned long long)atomic_load(&n_input_drops), (unsigned long long)ring_st.dropped, ring_st.high_water,
+           QUEUE_FRAMES, (unsigned long long)atomic_load(&n_busy), (unsigned long long)atomic_load(&n_rejected),
+           (unsigned long long)atomic_load(&n_ipc_drops), ipc_kind == IPC_MQ ? "mq" : "ring");
+    printf("stages: %llu read, %llu dispatched, %llu controlled, %llu delivered\n",
+           (unsigned long long)atomic_load(&n_read), (unsigned long long)atomic_load(&n_dispatched),
+           (unsigned long long)atomic_load(&n_controlled), (unsigned long long)received);
+    if (received > 1 && shared->last_ns > shared->first_ns) {
+        printf("sustained throughput: %.0f events/s delivered\n",
+               (received - 1) / ((shared->last_ns - shared->first_ns) / 1e9));
+    }
+    TcEngineStats st;
+    tc_engine_get_stats(engine, &st);
+    printf("engine: %llu transitions, %llu wakeups, %llu emergency requests\n",
+           (unsigned long long)st.transitions, (unsigned long long)st.wakeups, (unsigned long long)st.requests);
+
+    print_report(injected, log_path ? &log : NULL);
+    if (log_path) {
+        rt_slog_flush(&log);
+        printf("log: %llu records in %s\n", (unsigned long long)rt_slog_count(&log), log_path);
+        rt_slog_close(&log);
+    }
+
+    tc_engine_destroy(engine);
+    rt_ring_destroy(&frames);
+    close(pipe_fds[0]);
+    if (ipc_kind == IPC_MQ) {
+        mq_close(ipc_mq);
+    } else {
+        shm_spsc_close(ipc_ring);
+    }
+    munmap(shared, shared_bytes);
+    free(pending);
+    free(want_emergency);
+    return 0;
+}
@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include "tc_engine.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "rt_ring.h"
+#include "rt_time.h"
+#include "rt_timer_wheel.h"
+
+#define TC_HEARTBEAT_DEFAULT_NS (100 * RT_NSEC_PER_MSEC)
+
+// Отметки пульса рабочего потока
+enum { TC_CP_WAIT, TC_CP_REQUESTS, TC_CP_TIMERS };
+static const char* const tc_checkpoint_names[] = {"wait", "requests", "timers"};
+
+typedef struct TcWorker TcWorker;
+
+typedef struct {
+    RtTimer timer;          // Конец текущего состояния
+    TcWorker* worker;
+    int64_t deadline_ns;    // Запланированный конец состояния, 0 - держится
+    int64_t offset_ns;      // Фаза в "зеленой волне"
+    atomic_uint requests;   // Нажатые кнопки: TC_PED_NS | TC_PED_EW
+    atomic_int want_emergency;
+    _Atomic int64_t emergency_req_ns; // Момент последнего запроса ЧС
+    _Atomic uint8_t state;
+    uint8_t emergency;      // Рабочий поток уже в ЧС
+    uint32_t id;
+} TcIntersection;
+
+struct TcWorker {
+    TcEngine* engine;
+    pthread_t thread;
+    RtTimerWheel* wheel;
+    int timer_fd;
+    int event_fd;
+    uint32_t first;         // Перекрестки [first, last)
+    uint32_t last;
+    pthread_mutex_t inbox_lock;
+    uint32_t* inbox;        // id с изменившимся запросом ЧС
+    size_t inbox_len;
+    size_t inbox_cap;
+    RtRing trace;           // Записи переходов, если trace_capacity > 0
+    int index;
+    TcEngineStats stats;
+    RtHeartbeat* hb;        // Пульс для сторожа, если cfg.watchdog
+    int wd_id;
+    RtTimer hb_timer;
+    char wd_name[24];
+    atomic_int failsafe;    // Сторож перевел перекрестки в ЧС, поток еще не разобрал запросы
+    atomic_uint_fast64_t failsafes;
+};
+
+struct TcEngine {
+    TcEngineConfig cfg;
+    TcIntersection* ix;
+    TcWorker* workers;
+    int64_t base_ns;
+    atomic_int stopping;
+    int running;
+};
+
+static int64_t mod_ns(int64_t a, int64_t m) {
+    int64_t r = a % m;
+    return r < 0 ? r + m : r;
+}
+
+// Подстройка фазы при входе в sync-состояние в момент start
+static int64_t sync_extension(TcWorker* w, TcIntersection* ix, int64_t start) {
+    const TcPlan* plan = w->engine->cfg.plan;
+    int64_t phase = mod_ns(start - (w->engine->base_ns + ix->offset_ns), plan->cycle_ns);
+    if (phase == 0) return 0;
+    int64_t wait = plan->cycle_ns - phase; // Ждать до своего начала цикла
+    int64_t limit = (int64_t)plan->sync_max_ms * RT_NSEC_PER_MSEC;
+    w->stats.sync_corrections++;
+    return wait < limit ? wait : limit;
+}
+
+// Переход в state, которое по плану началось в start. sched - когда
+// переход должен был произойти: для таймера это start, для ЧС - запрос
+static void enter_state(TcWorker* w, TcIntersection* ix, uint8_t state, int64_t start, TcCause cause,
+                        int64_t sched) {
+    const TcPlan* plan = w->engine->cfg.plan;
+    uint8_t old = atomic_load_explicit(&ix->state, memory_order_relaxed);
+    atomic_store_explicit(&ix->state, state, memory_order_release);
+
+    int64_t duration = tc_state_duration_ns(plan, state);
+    if (duration > 0 && state == plan->sync_state) duration += sync_extension(w, ix, start);
+    if (duration > 0) {
+        ix->deadline_ns = start + duration;
+        rt_wheel_schedule(w->wheel, &ix->timer, ix->deadline_ns);
+    } else {
+        ix->deadline_ns = 0;
+        rt_wheel_cancel(w->wheel, &ix->timer);
+    }
+
+    int64_t now = rt_now_ns();
+    w->stats.transitions++;
+    int timed = cause == TC_CAUSE_TIMER || cause == TC_CAUSE_PED;
+    if (timed && now - sched > w->stats.max_late_ns) w->stats.max_late_ns = now - sched;
+    if (w->trace.slots) {
+        TcTraceRecord rec = {
+            .sched_ns = sched,
+            .actual_ns = now,
+            .id = ix->id,
+            .old_state = old,
+            .new_state = state,
+            .cause = (uint8_t)cause,
+            .worker = (uint8_t)w->index,
+        };
+        rt_ring_push(&w->trace, &rec);
+    }
+    if (w->engine->cfg.on_change) w->engine->cfg.on_change(ix->id, old, state, sched, now, w->engine->cfg.arg);
+}
+
+// Таймер состояния: переход по таблице
+static void on_state_timer(RtTimer* timer, void* arg) {
+    (void)timer;
+    TcIntersection* ix = arg;
+    const TcState* st = &ix->worker->engine->cfg.plan->states[ix->state];
+    uint8_t next = st->next;
+    TcCause cause = TC_CAUSE_TIMER;
+    // Снимаются только кнопки, которые обслуживает это состояние
+    if (st->ped_buttons && (atomic_fetch_and_explicit(&ix->requests, ~(unsigned)st->ped_buttons, memory_order_acq_rel) &
+                            st->ped_buttons)) {
+        next = st->ped_next;
+        cause = TC_CAUSE_PED;
+    }
+    enter_state(ix->worker, ix, next, ix->deadline_ns, cause, ix->deadline_ns);
+}
+
+// Переход в ЧС и обратно по запросам из очереди потока
+static void drain_inbox(TcWorker* w) {
+    const TcPlan* plan = w->engine->cfg.plan;
+    uint64_t count;
+    if (read(w->event_fd, &count, sizeof(count)) != sizeof(count)) return;
+    // Сторож ставит запросы ЧС до флага, поэтому флаг снимается до того, как
+    // забрать очередь: его запросы попадут в эту очередь или в следующую
+    atomic_store_explicit(&w->failsafe, 0, memory_order_release);
+
+    pthread_mutex_lock(&w->inbox_lock);
+    uint32_t* ids = w->inbox;
+    size_t len = w->inbox_len;
+    w->inbox = NULL;
+    w->inbox_len = w->inbox_cap = 0;
+    pthread_mutex_unlock(&w->inbox_lock);
+
+    for (size_t i = 0; i < len; i++) {
+        TcIntersection* ix = &w->engine->ix[ids[i]];
+        int want = atomic_load_explicit(&ix->want_emergency, memory_order_acquire);
+        int64_t requested = atomic_load_explicit(&ix->emergency_req_ns, memory_order_relaxed);
+        if (want && !ix->emergency) {
+            ix->emergency = 1;
+            w->stats.requests++;
+            enter_state(w, ix, plan->emergency_state, rt_now_ns(), TC_CAUSE_EMERGENCY_ON, requested);
+        } else if (!want && ix->emergency) {
+            ix->emergency = 0;
+            w->stats.requests++;
+            enter_state(w, ix, plan->resume_state, rt_now_ns(), TC_CAUSE_EMERGENCY_OFF, requested);
+        }
+    }
+    free(ids);
+}
+
+// Таймер пульса: будит поток, даже если переходов долго нет
+static void on_heartbeat_timer(RtTimer* timer, void* arg) {
+    TcWorker* w = arg;
+    rt_wheel_schedule(w->wheel, timer, rt_now_ns() + w->engine->cfg.heartbeat_ns);
+}
+
+// В потоке сторожа: поток w завис
+static void on_worker_stall(const RtWatchdogEvent* event, void* arg) {
+    TcWorker* w = arg;
+    TcEngine* engine = w->engine;
+    if (event->kind != RT_WD_MISS || !engine->cfg.failsafe || engine->cfg.plan->emergency_state == TC_NONE) return;
+    for (uint32_t id = w->first; id < w->last; id++) {
+        if (!atomic_load_explicit(&engine->ix[id].want_emergency, memory_order_relaxed)) {
+            tc_engine_request(engine, id, TC_REQ_EMERGENCY_ON);
+        }
+    }
+    atomic_store_explicit(&w->failsafe, 1, memory_order_release);
+    atomic_fetch_add_explicit(&w->failsafes, 1, memory_order_relaxed);
+}
+
+// Начальная фаза: где в цикле должен быть перекресток в момент now
+static void place_intersection(TcWorker* w, TcIntersection* ix, int64_t now) {
+    int64_t elapsed;
+    uint8_t state = tc_plan_state_at(w->engine->cfg.plan, now - (w->engine->base_ns + ix->offset_ns), &elapsed);
+    enter_state(w, ix, state, now - elapsed, TC_CAUSE_START, now);
+}
+
+static void* worker_main(void* arg) {
+    TcWorker* w = arg;
+    TcEngine* engine = w->engine;
+    int64_t now = rt_now_ns();
+    for (uint32_t id = w->first; id < w->last; id++) place_intersection(w, &engine->ix[id], now);
+    if (w->hb) rt_wheel_schedule(w->wheel, &w->hb_timer, now + engine->cfg.heartbeat_ns);
+
+    struct pollfd fds[2] = {
+        {.fd = w->timer_fd, .events = POLLIN},
+        {.fd = w->event_fd, .events = POLLIN},
+    };
+    while (!atomic_load_explicit(&engine->stopping, memory_order_acquire)) {
+        rt_wheel_timerfd_arm(w->wheel, w->timer_fd);
+        if (w->hb) rt_heartbeat(w->hb, TC_CP_WAIT);
+        // Единственная точка ожидания на все перекрестки потока
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        w->stats.wakeups++;
+        if (w->hb) rt_heartbeat(w->hb, TC_CP_REQUESTS);
+        if (fds[1].revents & POLLIN) drain_inbox(w);
+        if (w->hb) rt_heartbeat(w->hb, TC_CP_TIMERS);
+        if (fds[0].revents & POLLIN) rt_wheel_timerfd_fire(w->wheel, w->timer_fd, rt_now_ns());
+    }
+    return NULL;
+}
+
+TcEngine* tc_engine_create(const TcEngineConfig* cfg) {
+    if (!cfg->plan || cfg->count == 0 || cfg->count > UINT32_MAX || cfg->workers < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    TcEngine* engine = calloc(1, sizeof(*engine));
+    if (!engine) return NULL;
+    engine->cfg = *cfg;
+    if (engine->cfg.workers == 0) engine->cfg.workers = 1;
+    if ((size_t)engine->cfg.workers > cfg->count) engine->cfg.workers = (int)cfg->count;
+    if (engine->cfg.tick_ns <= 0) engine->cfg.tick_ns = RT_NSEC_PER_MSEC;
+    if (engine->cfg.heartbeat_ns <= 0) engine->cfg.heartbeat_ns = TC_HEARTBEAT_DEFAULT_NS;
+    if (engine->cfg.stall_ns <= 0) engine->cfg.stall_ns = 3 * engine->cfg.heartbeat_ns;
+
+    engine->ix = calloc(cfg->count, sizeof(TcIntersection));
+    // Кольцо трассы выровнено по кэш-линиям - calloc этого не гарантирует
+    engine->workers = aligned_alloc(RT_RING_CACHELINE, (size_t)engine->cfg.workers * sizeof(TcWorker));
+    if (engine->workers) memset(engine->workers, 0, (size_t)engine->cfg.workers * sizeof(TcWorker));
+    if (!engine->ix || !engine->workers) {
+        tc_engine_destroy(engine);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    int64_t now = rt_now_ns();
+    for (int i = 0; i < engine->cfg.workers; i++) {
+        TcWorker* w = &engine->workers[i];
+        w->engine = engine;
+        w->index = i;
+        w->timer_fd = w->event_fd = -1;
+        w->wd_id = -1;
+        rt_timer_init(&w->hb_timer, on_heartbeat_timer, w);
+        w->first = (uint32_t)(cfg->count * (size_t)i / (size_t)engine->cfg.workers);
+        w->last = (uint32_t)(cfg->count * (size_t)(i + 1) / (size_t)engine->cfg.workers);
+        pthread_mutex_init(&w->inbox_lock, NULL);
+        w->wheel = rt_wheel_create(engine->cfg.tick_ns, now);
+        w->timer_fd = rt_wheel_timerfd_create();
+        w->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        int trace_failed = cfg->trace_capacity && rt_ring_init(&w->trace, sizeof(TcTraceRecord), cfg->trace_capacity) < 0;
+        if (!w->wheel || w->timer_fd < 0 || w->event_fd < 0 || trace_failed) {
+            int saved = errno;
+            tc_engine_destroy(engine);
+            errno = saved;
+            return NULL;
+        }
+        for (uint32_t id = w->first; id < w->last; id++) {
+            TcIntersection* ix = &engine->ix[id];
+            ix->id = id;
+            ix->worker = w;
+            ix->state = cfg->plan->sync_state;
+            rt_timer_init(&ix->timer, on_state_timer, ix);
+        }
+    }
+    return engine;
+}
+
+void tc_engine_set_offset(TcEngine* engine, uint32_t id, int64_t offset_ns) {
+    if (id < engine->cfg.count) engine->ix[id].offset_ns = offset_ns;
+}
+
+// Пульсы регистрируются при первом старте: отсчет молчания идет от регистрации
+static int watch_workers(TcEngine* engine) {
+    for (int i = 0; i < engine->cfg.workers; i++) {
+        TcWorker* w = &engine->workers[i];
+        if (w->wd_id >= 0) {
+            rt_watchdog_set_active(engine->cfg.watchdog, w->wd_id, 1);
+            continue;
+        }
+        snprintf(w->wd_name, sizeof(w->wd_name), "tc worker %d", i);
+        RtWatchdogTarget target = {
+            .name = w->wd_name,
+            .period_ns = engine->cfg.heartbeat_ns,
+            .timeout_ns = engine->cfg.stall_ns,
+            .checkpoint_names = tc_checkpoint_names,
+            .checkpoint_count = sizeof(tc_checkpoint_names) / sizeof(tc_checkpoint_names[0]),
+            .on_miss = on_worker_stall,
+            .arg = w,
+        };
+        w->wd_id = rt_watchdog_add(engine->cfg.watchdog, &target);
+        if (w->wd_id < 0) return errno;
+        w->hb = rt_watchdog_heartbeat(engine->cfg.watchdog, w->wd_id);
+    }
+    return 0;
+}
+
+int tc_engine_start(TcEngine* engine) {
+    engine->base_ns = engine->cfg.base_ns ? engine->cfg.base_ns : rt_now_ns();
+    atomic_store(&engine->stopping, 0);
+    if (engine->cfg.watchdog) {
+        int rc = watch_workers(engine);
+        if (rc != 0) return rc;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (engine->cfg.worker_prio > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = engine->cfg.worker_prio;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &sp);
+    }
+    int rc = 0;
+    for (int i = 0; i < engine->cfg.workers; i++) {
+        rc = pthread_create(&engine->workers[i].thread, &attr, worker_main, &engine->workers[i]);
+        if (rc != 0) {
+            engine->running = i;
+            tc_engine_stop(engine);
+            break;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    if (rc == 0) engine->running = engine->cfg.workers;
+    return rc;
+}
+
+void tc_engine_stop(TcEngine* engine) {
+    atomic_store_explicit(&engine->stopping, 1, memory_order_release);
+    for (int i = 0; i < engine->running; i++) {
+        if (engine->workers[i].wd_id >= 0) rt_watchdog_set_active(engine->cfg.watchdog, engine->workers[i].wd_id, 0);
+    }
+    for (int i = 0; i < engine->running; i++) {
+        uint64_t one = 1;
+        ssize_t n = write(engine->workers[i].event_fd, &one, sizeof(one));
+        (void)n; // Переполнить eventfd одной записью нельзя
+    }
+    for (int i = 0; i < engine->running; i++) pthread_join(engine->workers[i].thread, NULL);
+    engine->running = 0;
+}
+
+void tc_engine_destroy(TcEngine* engine) {
+    if (!engine) return;
+    if (engine->running) tc_engine_stop(engine);
+    if (engine->workers) {
+        for (int i = 0; i < engine->cfg.workers; i++) {
+            TcWorker* w = &engine->workers[i];
+            if (!w->engine) continue;
+            if (w->wheel) rt_wheel_destroy(w->wheel);
+            if (w->timer_fd >= 0) close(w->timer_fd);
+            if (w->event_fd >= 0) close(w->event_fd);
+            pthread_mutex_destroy(&w->inbox_lock);
+            free(w->inbox);
+            if (w->trace.slots) rt_ring_destroy(&w->trace);
+        }
+    }
+    free(engine->workers);
+    free(engine->ix);
+    free(engine);
+}
+
+int tc_engine_request(TcEngine* engine, uint32_t id, TcRequest request) {
+    if (id >= engine->cfg.count) return -1;
+    TcIntersection* ix = &engine->ix[id];
+    if (request == TC_REQ_PED_NS || request == TC_REQ_PED_EW) {
+        // Кнопка только взводит флаг: таблица проверит его на выходе из состояния
+        atomic_fetch_or_explicit(&ix->requests, request == TC_REQ_PED_NS ? TC_PED_NS : TC_PED_EW,
+                                 memory_order_release);
+        return 0;
+    }
+    if (engine->cfg.plan->emergency_state == TC_NONE) return -1;
+
+    atomic_store_explicit(&ix->emergency_req_ns, rt_now_ns(), memory_order_relaxed);
+    atomic_store_explicit(&ix->want_emergency, request == TC_REQ_EMERGENCY_ON, memory_order_release);
+    TcWorker* w = ix->worker;
+    pthread_mutex_lock(&w->inbox_lock);
+    if (w->inbox_len == w->inbox_cap) {
+        size_t cap = w->inbox_cap ? w->inbox_cap * 2 : 64;
+        uint32_t* grown = realloc(w->inbox, cap * sizeof(uint32_t));
+        if (!grown) {
+            pthread_mutex_unlock(&w->inbox_lock);
+            return -1;
+        }
+        w->inbox = grown;
+        w->inbox_cap = cap;
+    }
+    w->inbox[w->inbox_len++] = id;
+    pthread_mutex_unlock(&w->inbox_lock);
+
+    uint64_t one = 1;
+    return write(w->event_fd, &one, sizeof(one)) == (ssize_t)sizeof(one) ? 0 : -1;
+}
+
+uint8_t tc_engine_state(const TcEngine* engine, uint32_t id) {
+    if (id >= engine->cfg.count) return TC_NONE;
+    if (atomic_load_explicit(&engine->ix[id].worker->failsafe, memory_order_acquire)) {
+        return engine->cfg.plan->emergency_state;
+    }
+    return atomic_load_explicit(&engine->ix[id].state, memory_order_acquire);
+}
+
+int64_t tc_engine_base(const TcEngine* engine) {
+    return engine->base_ns;
+}
+
+int tc_engine_workers(const TcEngine* engine) {
+    return engine->cfg.workers;
+}
+
+int tc_engine_trace_pop(TcEngine* engine, int worker, TcTraceRecord* out) {
+    if (worker < 0 || worker >= engine->cfg.workers || !engine->workers[worker].trace.slots) return -1;
+    return rt_ring_pop(&engine->workers[worker].trace, out);
+}
+
+int tc_engine_trace_wait(TcEngine* engine, int worker, int timeout_ms) {
+    if (worker < 0 || worker >= engine->cfg.workers || !engine->workers[worker].trace.slots) return 0;
+    return rt_ring_wait(&engine->workers[worker].trace, timeout_ms);
+}
+
+void tc_engine_get_stats(const TcEngine* engine, TcEngineStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < engine->cfg.workers; i++) {
+        const TcEngineStats* s = &engine->workers[i].stats;
+        stats->transitions += s->transitions;
+        stats->wakeups += s->wakeups;
+        stats->requests += s->requests;
+        stats->sync_corrections += s->sync_corrections;
+        if (s->max_late_ns > stats->max_late_ns) stats->max_late_ns = s->max_late_ns;
+        stats->failsafes += atomic_load_explicit(&engine->workers[i].failsafes, memory_order_relaxed);
+        if (engine->workers[i].trace.slots) {
+            RtRingStats rs;
+            rt_ring_get_stats((RtRing*)&engine->workers[i].trace, &rs);
+            stats->traced += rs.pushed;
+            stats->trace_dropped += rs.dropped;
+        }
+    }
+}
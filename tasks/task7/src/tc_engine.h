@@ -0,0 +1,142 @@
+#ifndef TC_ENGINE_H
+#define TC_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rt_watchdog.h"
+#include "tc_plan.h"
+
+/*
+ * Движок светофорных объектов: тысячи перекрестков на нескольких потоках.
+ *
+ * Перекрестки делятся между рабочими потоками непрерывными блоками. У
+ * каждого потока одно колесо таймеров (rt_timer_wheel) с одним timerfd и
+ * eventfd для внешних запросов - одна точка ожидания на все его
+ * перекрестки вместо потока и POSIX-таймера на каждый. Переход выполняет
+ * таблица плана (tc_plan.h).
+ *
+ * Время - общая база base_ns по CLOCK_MONOTONIC. Фаза перекрестка в цикле
+ * задается смещением от базы (tc_engine_set_offset): соседи со смещением
+ * на время проезда между ними дают "зеленую волну". При старте каждый
+ * перекресток сразу встает в свою фазу; сбитая пешеходом или ЧС фаза
+ * подтягивается задержкой в sync-состоянии плана. Конец состояния
+ * отсчитывается от запланированного конца предыдущего, поэтому фаза не
+ * уходит из-за задержек пробуждения.
+ *
+ * Трасса: при trace_capacity > 0 каждый рабочий поток пишет запись о
+ * каждом переходе в свое кольцо rt_ring (без блокировок, на полном кольце
+ * запись отбрасывается и считается). Читают трассу другие потоки -
+ * tc_engine_trace_pop/tc_engine_trace_wait, например писатель tc_trace.h;
+ * ввода-вывода на пути управления нет.
+ *
+ * Сторож: при cfg.watchdog каждый рабочий поток регистрирует пульс
+ * (rt_watchdog.h) и отмечается перед ожиданием, разбором запросов и
+ * таймерами; таймер пульса в колесе будит поток не реже heartbeat_ns.
+ * Если поток завис (молчит stall_ns), при cfg.failsafe сторож ставит все
+ * его перекрестки в ЧС: tc_engine_state() сразу отдает состояние ЧС, а
+ * запросы ЧС выполнятся, когда поток вернется. Выход из ЧС - обычным
+ * TC_REQ_EMERGENCY_OFF.
+ */
+
+typedef struct TcEngine TcEngine;
+
+// Вызывается в рабочем потоке после смены состояния; sched_ns - когда
+// переход был запланирован, actual_ns - когда выполнен
+typedef void (*TcChangeFn)(uint32_t id, uint8_t old_state, uint8_t new_state, int64_t sched_ns,
+                           int64_t actual_ns, void* arg);
+
+// Почему произошел переход
+typedef enum {
+    TC_CAUSE_START,         // Начальная фаза
+    TC_CAUSE_TIMER,         // Конец состояния по таблице
+    TC_CAUSE_PED,           // Конец состояния, переход по ped=
+    TC_CAUSE_EMERGENCY_ON,
+    TC_CAUSE_EMERGENCY_OFF,
+    TC_CAUSE_COUNT
+} TcCause;
+
+// Запись трассы, 24 байта
+typedef struct {
+    int64_t sched_ns;       // Когда переход должен был произойти (для ЧС - момент запроса)
+    int64_t actual_ns;      // Когда произошел
+    uint32_t id;
+    uint8_t old_state;
+    uint8_t new_state;
+    uint8_t cause;          // TcCause
+    uint8_t worker;
+} TcTraceRecord;
+
+static inline const char* tc_cause_name(TcCause cause) {
+    static const char* const names[TC_CAUSE_COUNT] = {"start", "timer", "ped", "emergency_on", "emergency_off"};
+    return (unsigned)cause < TC_CAUSE_COUNT ? names[cause] : "?";
+}
+
+typedef struct {
+    const TcPlan* plan;     // Должен жить дольше движка
+    size_t count;           // Перекрестков
+    int workers;            // Рабочих потоков (1, если 0)
+    int64_t base_ns;        // Общая база времени; 0 - момент tc_engine_start
+    int64_t tick_ns;        // Разрешение колеса; 0 - 1 мс
+    int worker_prio;        // SCHED_FIFO рабочих потоков; 0 - обычное планирование
+    TcChangeFn on_change;   // Может быть NULL
+    void* arg;
+    size_t trace_capacity;  // Записей в кольце трассы каждого потока; 0 - без трассы
+    RtWatchdog* watchdog;   // Сторож рабочих потоков; NULL - без пульса
+    int64_t heartbeat_ns;   // Период пульса; 0 - 100 мс
+    int64_t stall_ns;       // Молчание, после которого поток завис; 0 - три периода пульса
+    int failsafe;           // Перекрестки зависшего потока - в ЧС (нужно состояние ЧС в плане)
+} TcEngineConfig;
+
+typedef enum {
+    TC_REQ_PED_NS,          // Кнопка пешехода NS: учитывается при выходе из состояния с ped= или ped_ns=
+    TC_REQ_PED_EW,          // То же для EW: ped= или ped_ew=
+    TC_REQ_EMERGENCY_ON,    // Немедленно в состояние ЧС плана
+    TC_REQ_EMERGENCY_OFF    // Из ЧС в состояние выхода
+} TcRequest;
+
+typedef struct {
+    uint64_t transitions;
+    uint64_t wakeups;       // Пробуждений рабочих потоков
+    uint64_t requests;      // Обработанных запросов ЧС
+    uint64_t sync_corrections; // Входов в sync-состояние с подстройкой фазы
+    int64_t max_late_ns;    // Худшее опоздание перехода относительно плана
+    uint64_t traced;        // Записей, попавших в трассу
+    uint64_t trace_dropped; // Отброшено на полном кольце
+    uint64_t failsafes;     // Переводов в ЧС сторожем
+} TcEngineStats;
+
+/**
+ * @brief Создает движок; перекрестки со смещением 0, потоки не запущены.
+ * @return Движок или NULL (errno).
+ */
+TcEngine* tc_engine_create(const TcEngineConfig* cfg);
+
+// Только до tc_engine_start
+void tc_engine_set_offset(TcEngine* engine, uint32_t id, int64_t offset_ns);
+
+// Запускает рабочие потоки; 0 или код ошибки pthread
+int tc_engine_start(TcEngine* engine);
+
+// Останавливает и дожидается рабочих потоков
+void tc_engine_stop(TcEngine* engine);
+void tc_engine_destroy(TcEngine* engine);
+
+// Из любого потока. 0 или -1 (неверный id, нет состояния ЧС в плане)
+int tc_engine_request(TcEngine* engine, uint32_t id, TcRequest request);
+
+// Текущее состояние перекрестка (из любого потока); ЧС, пока поток в failsafe
+uint8_t tc_engine_state(const TcEngine* engine, uint32_t id);
+
+int64_t tc_engine_base(const TcEngine* engine);
+int tc_engine_workers(const TcEngine* engine);
+
+// Один читатель на поток worker. 0 - запись в out, -1 - кольцо пусто или трасса выключена
+int tc_engine_trace_pop(TcEngine* engine, int worker, TcTraceRecord* out);
+
+// Ждет записей в кольце worker до timeout_ms; 1 - есть записи
+int tc_engine_trace_wait(TcEngine* engine, int worker, int timeout_ms);
+
+// Сумма по рабочим потокам; точна после tc_engine_stop
+void tc_engine_get_stats(const TcEngine* engine, TcEngineStats* stats);
+
+#endif // TC_ENGINE_H
@@ -0,0 +1,238 @@
+#define _GNU_SOURCE
+#include "tc_plan.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char tc_plan_default_text[] =
+    "# Перекресток двух дорог: NS и EW по очереди, между ними всем красный\n"
+    "state ALL_RED_NS  1000  NS_GREEN    R R  ped_ns=PED_NS\n"
+    "state NS_GREEN   10000  NS_YELLOW   G R\n"
+    "state NS_YELLOW   2000  ALL_RED_EW  Y R\n"
+    "state ALL_RED_EW  1000  EW_GREEN    R R  ped_ew=PED_EW\n"
+    "state EW_GREEN   10000  EW_YELLOW   R G\n"
+    "state EW_YELLOW   2000  ALL_RED_NS  R Y\n"
+    "state PED_NS      8000  NS_GREEN    R R  walk\n"
+    "state PED_EW      8000  EW_GREEN    R R  walk\n"
+    "state EMERGENCY      0  ALL_RED_NS  R R\n"
+    "sync ALL_RED_NS 2000\n"
+    "emergency EMERGENCY ALL_RED_NS\n";
+
+static int fail(char* err, size_t err_len, int line, const char* fmt, ...) {
+    if (err && err_len) {
+        int n = line > 0 ? snprintf(err, err_len, "line %d: ", line) : 0;
+        if (n < 0) n = 0;
+        if ((size_t)n < err_len) {
+            va_list ap;
+            va_start(ap, fmt);
+            vsnprintf(err + n, err_len - (size_t)n, fmt, ap);
+            va_end(ap);
+        }
+    }
+    return -1;
+}
+
+static int find_state(const TcPlan* plan, const char* name) {
+    for (int i = 0; i < plan->count; i++) {
+        if (strcmp(plan->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int parse_color(const char* s) {
+    if (strcmp(s, "R") == 0) return TC_RED;
+    if (strcmp(s, "Y") == 0) return TC_YELLOW;
+    if (strcmp(s, "G") == 0) return TC_GREEN;
+    return -1;
+}
+
+// Суффикс после "ped": пусто - любая кнопка, _ns/_ew - своя; 0 - ошибка
+static uint8_t parse_ped_buttons(const char* s, size_t len) {
+    if (len == 0) return TC_PED_NS | TC_PED_EW;
+    if (len == 3 && strncmp(s, "_ns", 3) == 0) return TC_PED_NS;
+    if (len == 3 && strncmp(s, "_ew", 3) == 0) return TC_PED_EW;
+    return 0;
+}
+
+static int parse_ms(const char* s, uint32_t* out) {
+    char* end;
+    errno = 0;
+    unsigned long v = strtoul(s, &end, 10);
+    if (errno || end == s || *end || v > UINT32_MAX) return -1;
+    *out = (uint32_t)v;
+    return 0;
+}
+
+#define MAX_TOKENS 8
+
+// Разбивает строку на слова на месте, отрезая комментарий
+static int tokenize(char* line, char* tok[MAX_TOKENS]) {
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    int n = 0;
+    char* save;
+    for (char* t = strtok_r(line, " \t\r", &save); t; t = strtok_r(NULL, " \t\r", &save)) {
+        if (n == MAX_TOKENS) return -1;
+        tok[n++] = t;
+    }
+    return n;
+}
+
+// Один проход по строкам: pass 0 собирает имена состояний, pass 1 - остальное
+static int parse_pass(TcPlan* plan, char* text, int pass, char* err, size_t err_len) {
+    int line_no = 0;
+    int have_sync = 0;
+    for (char* line = text; line;) {
+        char* nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        line_no++;
+        char* tok[MAX_TOKENS];
+        int n = tokenize(line, tok);
+        if (n < 0) return fail(err, err_len, line_no, "too many fields");
+        line = nl ? nl + 1 : NULL;
+        if (n == 0) continue;
+
+        if (strcmp(tok[0], "state") == 0) {
+            if (n < 6) return fail(err, err_len, line_no, "state <name> <ms> <next> <NS> <EW> [walk] [ped[_ns|_ew]=<state>]");
+            if (pass == 0) {
+                if (strlen(tok[1]) >= TC_NAME_LEN) return fail(err, err_len, line_no, "name too long: %s", tok[1]);
+                if (find_state(plan, tok[1]) >= 0) return fail(err, err_len, line_no, "duplicate state %s", tok[1]);
+                if (plan->count == TC_MAX_STATES) return fail(err, err_len, line_no, "more than %d states", TC_MAX_STATES);
+                snprintf(plan->names[plan->count], TC_NAME_LEN, "%s", tok[1]);
+                plan->count++;
+                continue;
+            }
+            TcState* st = &plan->states[find_state(plan, tok[1])];
+            int next = find_state(plan, tok[3]);
+            int ns = parse_color(tok[4]);
+            int ew = parse_color(tok[5]);
+            if (parse_ms(tok[2], &st->duration_ms) < 0) return fail(err, err_len, line_no, "bad duration %s", tok[2]);
+            if (next < 0) return fail(err, err_len, line_no, "unknown state %s", tok[3]);
+            if (ns < 0 || ew < 0) return fail(err, err_len, line_no, "signal must be R, Y or G");
+            st->next = (uint8_t)next;
+            st->ped_next = TC_NONE;
+            st->ped_buttons = 0;
+            st->lights = (uint8_t)(ns | ew << 2);
+            for (int i = 6; i < n; i++) {
+                if (strcmp(tok[i], "walk") == 0) {
+                    st->lights |= TC_LIGHT_WALK;
+                } else if (strncmp(tok[i], "ped", 3) == 0 && strchr(tok[i], '=')) {
+                    const char* eq = strchr(tok[i], '=');
+                    uint8_t buttons = parse_ped_buttons(tok[i] + 3, (size_t)(eq - tok[i] - 3));
+                    if (!buttons) return fail(err, err_len, line_no, "unknown option %s", tok[i]);
+                    if (st->ped_buttons) return fail(err, err_len, line_no, "more than one ped option");
+                    int ped = find_state(plan, eq + 1);
+                    if (ped < 0) return fail(err, err_len, line_no, "unknown state %s", eq + 1);
+                    st->ped_next = (uint8_t)ped;
+                    st->ped_buttons = buttons;
+                } else {
+                    return fail(err, err_len, line_no, "unknown option %s", tok[i]);
+                }
+            }
+        } else if (strcmp(tok[0], "sync") == 0) {
+            if (n != 3) return fail(err, err_len, line_no, "sync <state> <max correction ms>");
+            if (pass == 0) continue;
+            int s = find_state(plan, tok[1]);
+            if (s < 0) return fail(err, err_len, line_no, "unknown state %s", tok[1]);
+            if (parse_ms(tok[2], &plan->sync_max_ms) < 0) return fail(err, err_len, line_no, "bad duration %s", tok[2]);
+            plan->sync_state = (uint8_t)s;
+            have_sync = 1;
+        } else if (strcmp(tok[0], "emergency") == 0) {
+            if (n != 3) return fail(err, err_len, line_no, "emergency <state> <resume state>");
+            if (pass == 0) continue;
+            int s = find_state(plan, tok[1]);
+            int r = find_state(plan, tok[2]);
+            if (s < 0 || r < 0) return fail(err, err_len, line_no, "unknown state %s", s < 0 ? tok[1] : tok[2]);
+            plan->emergency_state = (uint8_t)s;
+            plan->resume_state = (uint8_t)r;
+        } else {
+            return fail(err, err_len, line_no, "unknown directive %s", tok[0]);
+        }
+    }
+    if (pass == 1 && !have_sync) return fail(err, err_len, 0, "no sync directive");
+    return 0;
+}
+
+// Длина цикла: цепочка next от sync_state должна вернуться в него
+static int compute_cycle(TcPlan* plan, char* err, size_t err_len) {
+    int64_t cycle = 0;
+    uint8_t s = plan->sync_state;
+    for (int steps = 0; steps < plan->count; steps++) {
+        if (plan->states[s].duration_ms == 0) {
+            return fail(err, err_len, 0, "cycle state %s has zero duration", plan->names[s]);
+        }
+        cycle += tc_state_duration_ns(plan, s);
+        s = plan->states[s].next;
+        if (s == plan->sync_state) {
+            plan->cycle_ns = cycle;
+            return 0;
+        }
+    }
+    return fail(err, err_len, 0, "states after %s do not return to it", plan->names[plan->sync_state]);
+}
+
+int tc_plan_parse(TcPlan* plan, const char* text, char* err, size_t err_len) {
+    memset(plan, 0, sizeof(*plan));
+    plan->emergency_state = TC_NONE;
+    plan->resume_state = TC_NONE;
+    if (err && err_len) err[0] = '\0';
+
+    // strtok_r портит строку: каждый проход - по своей копии
+    for (int pass = 0; pass < 2; pass++) {
+        char* copy = strdup(text);
+        if (!copy) return fail(err, err_len, 0, "out of memory");
+        int rc = parse_pass(plan, copy, pass, err, err_len);
+        free(copy);
+        if (rc < 0) return -1;
+    }
+    if (plan->count == 0) return fail(err, err_len, 0, "no states");
+    return compute_cycle(plan, err, err_len);
+}
+
+int tc_plan_load(TcPlan* plan, const char* path, char* err, size_t err_len) {
+    FILE* f = fopen(path, "r");
+    if (!f) return fail(err, err_len, 0, "%s: %s", path, strerror(errno));
+    char* text = NULL;
+    size_t len = 0;
+    // getdelim с '\0' читает весь текстовый файл одним куском
+    ssize_t n = getdelim(&text, &len, '\0', f);
+    fclose(f);
+    if (n < 0) {
+        free(text);
+        return fail(err, err_len, 0, "%s: empty or unreadable", path);
+    }
+    int rc = tc_plan_parse(plan, text, err, err_len);
+    free(text);
+    return rc;
+}
+
+int tc_plan_scale(TcPlan* plan, uint32_t divisor) {
+    if (divisor == 0) return -1;
+    for (int i = 0; i < plan->count; i++) {
+        uint32_t d = plan->states[i].duration_ms;
+        if (d) plan->states[i].duration_ms = d / divisor > 0 ? d / divisor : 1;
+    }
+    plan->sync_max_ms /= divisor;
+    return compute_cycle(plan, NULL, 0);
+}
+
+uint8_t tc_plan_state_at(const TcPlan* plan, int64_t pos_ns, int64_t* elapsed_ns) {
+    int64_t elapsed = pos_ns % plan->cycle_ns;
+    if (elapsed < 0) elapsed += plan->cycle_ns;
+    uint8_t state = plan->sync_state;
+    while (elapsed >= tc_state_duration_ns(plan, state)) {
+        elapsed -= tc_state_duration_ns(plan, state);
+        state = plan->states[state].next;
+    }
+    if (elapsed_ns) *elapsed_ns = elapsed;
+    return state;
+}
+
+void tc_plan_format_lights(const TcPlan* plan, uint8_t state, char* buf, size_t len) {
+    static const char* colors[] = {"RED,   ", "YELLOW,", "GREEN, "};
+    uint8_t l = plan->states[state].lights;
+    snprintf(buf, len, "NS: %s EW: %.*s%s", colors[TC_LIGHT_NS(l)], (int)strcspn(colors[TC_LIGHT_EW(l)], ","),
+             colors[TC_LIGHT_EW(l)], l & TC_LIGHT_WALK ? "  | WALK" : "");
+}
@@ -0,0 +1,96 @@
+#ifndef TC_PLAN_H
+#define TC_PLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * План светофорного объекта - таблица состояний вместо switch в коде.
+ *
+ * Состояние - 8 байт: длительность, следующее состояние по таймеру,
+ * состояние по запросу пешехода и сигналы. Вся таблица (до 32 состояний)
+ * занимает 256 байт - четыре кэш-линии на все перекрестки с этим планом;
+ * имена лежат отдельно и нужны только для вывода.
+ *
+ * Текстовый формат (по строке на директиву, '#' - комментарий):
+ *
+ *   state <имя> <мс> <следующее> <NS> <EW> [walk] [ped[_ns|_ew]=<состояние>]
+ *   sync <состояние> <мс>
+ *   emergency <состояние> <куда выйти>
+ *
+ * NS/EW - R, Y или G. Длительность 0 - состояние держится до внешнего
+ * события (режим ЧС). ped= - куда перейти по окончании состояния, если
+ * нажата любая кнопка пешехода; ped_ns= и ped_ew= - только кнопка своего
+ * направления, остальные запросы ждут своего состояния. sync - начало
+ * цикла: цепочка "следующих" от него должна вернуться в него же, ее
+ * сумма - длина цикла. При входе в это
+ * состояние перекресток, отставший от своей фазы в "зеленой волне",
+ * задерживается в нем не более чем на <мс> за цикл. emergency - состояние
+ * ЧС и состояние, в которое контроллер выходит после отмены ЧС.
+ */
+
+#define TC_MAX_STATES 32
+#define TC_NAME_LEN   16
+#define TC_NONE       0xFF
+
+// Сигнал одного направления
+enum { TC_RED = 0, TC_YELLOW = 1, TC_GREEN = 2 };
+
+#define TC_LIGHT_NS(l)   ((l) & 3)
+#define TC_LIGHT_EW(l)   (((l) >> 2) & 3)
+#define TC_LIGHT_WALK    0x10
+
+// Кнопки пешехода: биты TcState.ped_buttons
+#define TC_PED_NS        0x1
+#define TC_PED_EW        0x2
+
+typedef struct {
+    uint32_t duration_ms;   // 0 - без таймера
+    uint8_t next;           // По истечении длительности
+    uint8_t ped_next;       // Вместо next при запросе пешехода, TC_NONE - нет
+    uint8_t lights;         // TC_LIGHT_NS | TC_LIGHT_EW << 2 | TC_LIGHT_WALK
+    uint8_t ped_buttons;    // TC_PED_NS | TC_PED_EW: чьи запросы ведут в ped_next
+} TcState;
+
+typedef struct {
+    TcState states[TC_MAX_STATES];
+    uint8_t count;
+    uint8_t sync_state;     // Начало цикла и начальное состояние
+    uint8_t emergency_state;
+    uint8_t resume_state;   // Куда выйти после ЧС
+    uint32_t sync_max_ms;   // Предел подстройки фазы за цикл
+    int64_t cycle_ns;       // Длина цикла от sync_state до него же
+    char names[TC_MAX_STATES][TC_NAME_LEN];
+} TcPlan;
+
+// План по умолчанию: перекресток двух дорог, как в задании
+extern const char tc_plan_default_text[];
+
+/**
+ * @brief Разбирает план из текста.
+ * @return 0 или -1; в err - строка с номером строки и причиной.
+ */
+int tc_plan_parse(TcPlan* plan, const char* text, char* err, size_t err_len);
+
+// Читает и разбирает файл плана
+int tc_plan_load(TcPlan* plan, const char* path, char* err, size_t err_len);
+
+// Делит все длительности на divisor (ускоренная модель); 0 - успех
+int tc_plan_scale(TcPlan* plan, uint32_t divisor);
+
+static inline int64_t tc_state_duration_ns(const TcPlan* plan, uint8_t state) {
+    return (int64_t)plan->states[state].duration_ms * 1000000;
+}
+
+/**
+ * @brief Состояние цикла в позиции pos_ns от начала sync-состояния.
+ *
+ * pos_ns приводится к [0, cycle_ns). В elapsed_ns (если не NULL) - сколько
+ * прошло от начала найденного состояния.
+ */
+uint8_t tc_plan_state_at(const TcPlan* plan, int64_t pos_ns, int64_t* elapsed_ns);
+
+// "NS: GREEN,  EW: RED  | WALK"
+void tc_plan_format_lights(const TcPlan* plan, uint8_t state, char* buf, size_t len);
+
+#endif // TC_PLAN_H
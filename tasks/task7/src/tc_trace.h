@@ -0,0 +1,61 @@
+#ifndef TC_TRACE_H
+#define TC_TRACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "tc_engine.h"
+
+/*
+ * Трасса переходов в файл или сокет.
+ *
+ * Писатель - отдельный поток с обычным планированием и nice 10: он
+ * забирает записи TcTraceRecord из колец всех рабочих потоков движка,
+ * копит их в буфере и пишет большими write(). Рабочие потоки в это время
+ * только кладут 24 байта в свое кольцо; медленный диск или сеть видны как
+ * trace_dropped в статистике движка, а не как опоздание перехода.
+ *
+ * Формат: заголовок TcTraceHeader, за ним записи TcTraceRecord подряд, в
+ * порядке платформы (читается на той же архитектуре). Записи разных
+ * рабочих потоков в файле перемешаны, внутри одного потока идут по
+ * порядку. Разбор - tc_trace_report.
+ */
+
+#define TC_TRACE_MAGIC   "TCTR"
+#define TC_TRACE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;   // sizeof(TcTraceRecord)
+    uint32_t workers;
+    uint32_t reserved;
+    int64_t base_ns;        // База времени движка
+} TcTraceHeader;
+
+static inline int tc_trace_header_valid(const TcTraceHeader* h) {
+    return memcmp(h->magic, TC_TRACE_MAGIC, 4) == 0 && h->version == TC_TRACE_VERSION &&
+           h->record_size == sizeof(TcTraceRecord);
+}
+
+typedef struct TcTraceWriter TcTraceWriter;
+
+/**
+ * @brief Пишет заголовок в fd и запускает поток-писатель.
+ *
+ * Вызывать после tc_engine_start (в заголовок идет база времени);
+ * движок должен быть создан с trace_capacity > 0 и жить дольше писателя.
+ * period_ms - пауза писателя на пустых кольцах (0 - 10 мс). fd не
+ * закрывается.
+ * @return Писатель или NULL (errno).
+ */
+TcTraceWriter* tc_trace_writer_start(TcEngine* engine, int fd, int period_ms);
+
+/**
+ * @brief Дописывает оставшееся в кольцах и останавливает писателя.
+ *
+ * Вызывать после tc_engine_stop, чтобы в файл попали все переходы.
+ * @return Записано записей; -1, если была ошибка записи (errno).
+ */
+int64_t tc_trace_writer_stop(TcTraceWriter* writer);
+
+#endif // TC_TRACE_H
@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rt_stats.h"
+#include "tc_trace.h"
+
+/*
+ * Разбор трассы tc_trace: опоздание перехода (actual - sched) по причинам,
+ * перцентили по гистограмме rt_stats и худший переход. Для таймерных
+ * переходов это опоздание относительно плана, для ЧС - реакция от запроса
+ * до смены сигналов. С -l limit_us считает переходы (таймер и ЧС) с
+ * опозданием больше предела и завершается с кодом 2, если такие есть, -
+ * проверку соблюдения сроков можно поставить в скрипт.
+ *
+ * Запуск: tc_trace_report [-l limit_us] trace_file|-
+ */
+
+#define READ_RECORDS 4096
+
+typedef struct {
+    RtHistogram hist;
+    TcTraceRecord worst;
+    int64_t worst_late;
+} cause_stats_t;
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-l limit_us] trace_file|-\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    double limit_us = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:")) != -1) {
+        switch (opt) {
+            case 'l': limit_us = atof(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* path = argv[optind];
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    TcTraceHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || !tc_trace_header_valid(&h)) {
+        fprintf(stderr, "%s: not a tc_trace v%d file\n", path, TC_TRACE_VERSION);
+        return 1;
+    }
+
+    // ~30 КБ на гистограмму - не на стек
+    cause_stats_t* stats = calloc(TC_CAUSE_COUNT, sizeof(cause_stats_t));
+    static TcTraceRecord recs[READ_RECORDS];
+    if (!stats) {
+        perror("calloc");
+        return 1;
+    }
+    for (int c = 0; c < TC_CAUSE_COUNT; c++) {
+        rt_hist_init(&stats[c].hist);
+        stats[c].worst_late = INT64_MIN;
+    }
+    int64_t limit_ns = limit_us >= 0 ? (int64_t)(limit_us * 1000) : INT64_MAX;
+    uint64_t total = 0, over = 0, unknown = 0;
+    int64_t first_ns = INT64_MAX, last_ns = INT64_MIN;
+    size_t n;
+    while ((n = fread(recs, sizeof(TcTraceRecord), READ_RECORDS, f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const TcTraceRecord* r = &recs[i];
+            total++;
+            if (r->cause >= TC_CAUSE_COUNT) {
+                unknown++;
+                continue;
+            }
+            if (r->actual_ns < first_ns) first_ns = r->actual_ns;
+            if (r->actual_ns > last_ns) last_ns = r->actual_ns;
+            cause_stats_t* s = &stats[r->cause];
+            int64_t late = r->actual_ns - r->sched_ns;
+            rt_hist_record(&s->hist, late);
+            if (late > s->worst_late) {
+                s->worst_late = late;
+                s->worst = *r;
+            }
+            if (r->cause != TC_CAUSE_START && late > limit_ns) over++;
+        }
+    }
+    if (ferror(f)) {
+        perror(path);
+        return 1;
+    }
+    if (f != stdin) fclose(f);
+
+    printf("%llu records from %u workers over %.3f s\n", (unsigned long long)total, h.workers,
+           total > unknown ? (last_ns - first_ns) / 1e9 : 0.0);
+    printf("%-14s %10s %10s %10s %10s %10s %10s  (lateness, us)\n", "cause", "count", "p50", "p90", "p99", "p99.9",
+           "max");
+    for (int c = 0; c < TC_CAUSE_COUNT; c++) {
+        const RtHistogram* hist = &stats[c].hist;
+        if (hist->total == 0) continue;
+        // Для начальной фазы sched = actual: опоздания нет, только число
+        if (c == TC_CAUSE_START) {
+            printf("%-14s %10llu\n", tc_cause_name((TcCause)c), (unsigned long long)hist->total);
+            continue;
+        }
+        printf("%-14s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", tc_cause_name((TcCause)c),
+               (unsigned long long)hist->total, rt_hist_percentile(hist, 50) / 1e3, rt_hist_percentile(hist, 90) / 1e3,
+               rt_hist_percentile(hist, 99) / 1e3, rt_hist_percentile(hist, 99.9) / 1e3, hist->max / 1e3);
+    }
+    for (int c = TC_CAUSE_START + 1; c < TC_CAUSE_COUNT; c++) {
+        const cause_stats_t* s = &stats[c];
+        if (s->hist.total == 0) continue;
+        printf("worst %s: intersection %u, state %u -> %u, worker %u, %.1f us late at +%.3f s\n",
+               tc_cause_name((TcCause)c), s->worst.id, s->worst.old_state, s->worst.new_state, s->worst.worker,
+               s->worst_late / 1e3, (s->worst.actual_ns - h.base_ns) / 1e9);
+    }
+    if (unknown) printf("%llu records with unknown cause skipped\n", (unsigned long long)unknown);
+    free(stats);
+
+    if (limit_us >= 0) {
+        printf("limit %.1f us: %llu transitions over\n", limit_us, (unsigned long long)over);
+        return over ? 2 : 0;
+    }
+    return 0;
+}
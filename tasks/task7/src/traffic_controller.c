@@ -1,127 +1,160 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
 #include <pthread.h>
-#include <signal.h>
+#include <stdatomic.h>
 #include <time.h>
 
-#include "common.h"
+#include "tc_engine.h"
+#include "tc_plan.h"
+#include "rt_watchdog.h"
+
+/*
+ * Один перекресток на движке tc_engine: переходы задает таблица плана
+ * (по умолчанию tc_plan_default_text, или файл из аргумента), рабочий
+ * поток движка ждет в одной точке - poll() по timerfd колеса таймеров и
+ * eventfd запросов. Поток ввода только передает запросы движку.
+ *
+ * Рабочий поток сам ничего не печатает: переходы он кладет в кольцо
+ * трассы движка, а печатает их поток вывода - консоль не стоит на пути
+ * управления и не держит никаких блокировок движка.
+ *
+ * Рабочий поток под сторожем (rt_watchdog): 'h' заставляет его зависнуть
+ * на HANG_MS в ближайшем переходе. Через STALL_MS молчания сторож
+ * переводит перекресток в ЧС (все красные), не дожидаясь рабочего потока;
+ * ЧС держится, пока ее не снимут клавишей 's'.
+ */
+
+#define TRACE_RECORDS 256
+#define HEARTBEAT_MS  100
+#define STALL_MS      300
+#define HANG_MS       1500
 
 // Глобальные переменные
-SharedData shared_data; // Разделяемые данные
-timer_t timer;          // POSIX таймер
-volatile sig_atomic_t timer_expired = 0; // Флаг, устанавливаемый по сигналу таймера
+static TcPlan plan;         // Таблица состояний
+static TcEngine* engine;    // Один перекресток, один рабочий поток
+static RtWatchdog* watchdog;
+static atomic_int stopping;
+static atomic_int hang_requested;  // 'h': зависнуть в следующем переходе
 
-// Обработчик сигнала от таймера
-void timer_handler(int sig) {
-    timer_expired = 1;
+// Функция для вывода текущего состояния светофоров
+void print_lights(uint8_t state) {
+    char lights[64];
+    tc_plan_format_lights(&plan, state, lights, sizeof(lights));
+    printf("State: %-10s | %s%s\n", plan.names[state], state == plan.emergency_state ? "EMERGENCY! " : "", lights);
+    fflush(stdout);
 }
 
-// Функция для вывода текущего состояния светофоров
-void print_lights(TrafficState state) {
-    // TODO: Реализовать красивый вывод в консоль
-    printf("State: %d | ", state);
-    switch (state) {
-        case STATE_NS_GREEN:    printf("NS: GREEN,  EW: RED\n"); break;
-        case STATE_NS_YELLOW:   printf("NS: YELLOW, EW: RED\n"); break;
-        case STATE_EW_GREEN:    printf("NS: RED,    EW: GREEN\n"); break;
-        case STATE_EW_YELLOW:   printf("NS: RED,    EW: YELLOW\n"); break;
-        case STATE_ALL_RED:     printf("NS: RED,    EW: RED\n"); break;
-        case STATE_PED_CROSS:   printf("NS: RED,    EW: RED  | WALK\n"); break;
-        case STATE_EMERGENCY:   printf("EMERGENCY! NS: RED,    EW: RED\n"); break;
-        default:                printf("Unknown state\n"); break;
+// В рабочем потоке после перехода: имитация зависания по 'h'
+static void on_change(uint32_t id, uint8_t old_state, uint8_t new_state, int64_t sched_ns, int64_t actual_ns,
+                      void* arg) {
+    (void)id; (void)old_state; (void)new_state; (void)sched_ns; (void)actual_ns; (void)arg;
+    if (atomic_exchange(&hang_requested, 0)) {
+        struct timespec ts = {HANG_MS / 1000, (HANG_MS % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
     }
 }
 
-// Функция потока контроллера (FSM)
-void* controller_thread_func(void* arg) {
-    TrafficState next_state = STATE_ALL_RED;
-
-    while (1) {
-        pthread_mutex_lock(&shared_data.mutex);
-        shared_data.current_state = next_state;
-        print_lights(shared_data.current_state);
-        pthread_mutex_unlock(&shared_data.mutex);
-
-        struct itimerspec its;
-        timer_expired = 0;
-
-        // Логика конечного автомата
-        switch (shared_data.current_state) {
-            // Реализовать логику переходов FSM
-            // Пример для одного состояния:
-            case STATE_NS_GREEN:
-                its.it_value.tv_sec = GREEN_DURATION;
-                its.it_value.tv_nsec = 0;
-                next_state = STATE_NS_YELLOW;
-                break;
-
-            // ... другие состояния ...
-
-            default:
-                its.it_value.tv_sec = 1; // Безопасная задержка по умолчанию
-                next_state = STATE_ALL_RED;
-                break;
-        }
-
-        // Взводим таймер
-        its.it_interval.tv_sec = 0; // Не повторяющийся таймер
-        its.it_interval.tv_nsec = 0;
-        timer_settime(timer, 0, &its, NULL);
-
-        // Ожидаем истечения таймера
-        while (!timer_expired) {
-            // Здесь можно проверять асинхронные события (режим ЧС)
-            usleep(10000); // Спим недолго, чтобы не грузить CPU
+// Функция потока вывода: забирает переходы из трассы и события сторожа и печатает их
+void* display_thread_func(void* arg) {
+    (void)arg;
+    TcTraceRecord rec;
+    RtWatchdogEvent ev;
+    char line[160];
+    for (;;) {
+        while (rt_watchdog_pop_event(watchdog, &ev) == 0) {
+            rt_watchdog_format_event(watchdog, &ev, line, sizeof(line));
+            printf("%s\n", line);
+            fflush(stdout);
+            if (ev.kind == RT_WD_MISS) print_lights(tc_engine_state(engine, 0));
         }
+        while (tc_engine_trace_pop(engine, 0, &rec) == 0) print_lights(rec.new_state);
+        if (atomic_load(&stopping)) return NULL;
+        tc_engine_trace_wait(engine, 0, 100);
     }
-    return NULL;
 }
 
 // Функция потока для пользовательского ввода
 void* input_thread_func(void* arg) {
-    printf("Input keys: n (NS ped), e (EW ped), s (siren)\n");
-    while (1) {
-        char c = getchar();
-        // Реализовать обработку нажатий и потокобезопасную установку флагов
-        // в shared_data
+    (void)arg;
+    printf("Input keys: n (NS ped), e (EW ped), s (siren), h (hang worker), q (quit)\n");
+    fflush(stdout);
+    int c;
+    while ((c = getchar()) != EOF) {
+        switch (c) {
+            case 'n': tc_engine_request(engine, 0, TC_REQ_PED_NS); break;
+            case 'e': tc_engine_request(engine, 0, TC_REQ_PED_EW); break;
+            case 's':
+                // ЧС могла включить и сторож - смотрим на фактическое состояние
+                tc_engine_request(engine, 0, tc_engine_state(engine, 0) == plan.emergency_state
+                                                 ? TC_REQ_EMERGENCY_OFF : TC_REQ_EMERGENCY_ON);
+                break;
+            case 'h': atomic_store(&hang_requested, 1); break;
+            case 'q': return NULL;
+            default: break;
+        }
     }
     return NULL;
 }
 
-int main() {
-    // Инициализировать мьютекс
-    pthread_mutex_init(&shared_data.mutex, NULL);
-
-    // Настроить обработчик сигнала для таймера (sigaction)
-    struct sigaction sa;
-    sa.sa_handler = timer_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGRTMIN, &sa, NULL);
-
-    // Создать POSIX таймер (timer_create)
-    struct sigevent sev;
-    sev.sigev_notify = SIGEV_SIGNAL;
-    sev.sigev_signo = SIGRTMIN;
-    sev.sigev_value.sival_ptr = &timer;
-    if (timer_create(CLOCK_REALTIME, &sev, &timer) == -1) {
-        perror("timer_create failed");
+int main(int argc, char* argv[]) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        fprintf(stderr, "Usage: %s [plan_file]\n", argv[0]);
         return 1;
     }
 
-    // Создать потоки контроллера и пользовательского ввода
-    pthread_t controller_thread, input_thread;
-    pthread_create(&controller_thread, NULL, controller_thread_func, NULL);
-    // pthread_create(&input_thread, NULL, input_thread_func, NULL);
-
-    // Дождаться завершения потоков
-    pthread_join(controller_thread, NULL);
-    // pthread_join(input_thread, NULL);
+    // Таблица состояний: из файла или встроенная
+    char err[128];
+    int rc = argc == 2 ? tc_plan_load(&plan, argv[1], err, sizeof(err))
+                       : tc_plan_parse(&plan, tc_plan_default_text, err, sizeof(err));
+    if (rc < 0) {
+        fprintf(stderr, "plan: %s\n", err);
+        return 1;
+    }
 
-    // Уничтожить мьютекс и таймер
-    pthread_mutex_destroy(&shared_data.mutex);
-    timer_delete(timer);
+    RtWatchdogConfig wd_cfg;
+    rt_watchdog_config_default(&wd_cfg);
+    watchdog = rt_watchdog_create(&wd_cfg);
+    if (!watchdog) {
+        perror("rt_watchdog_create");
+        return 1;
+    }
 
+    TcEngineConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.plan = &plan;
+    cfg.count = 1;
+    cfg.workers = 1;
+    cfg.on_change = on_change;
+    cfg.trace_capacity = TRACE_RECORDS;
+    cfg.watchdog = watchdog;
+    cfg.heartbeat_ns = HEARTBEAT_MS * 1000000LL;
+    cfg.stall_ns = STALL_MS * 1000000LL;
+    cfg.failsafe = 1;
+    engine = tc_engine_create(&cfg);
+    if (!engine || tc_engine_start(engine) != 0 || rt_watchdog_start(watchdog) != 0) {
+        perror("tc_engine");
+        return 1;
+    }
+    pthread_t display_thread;
+    pthread_create(&display_thread, NULL, display_thread_func, NULL);
+
+    // Поток ввода; по 'q' или концу ввода останавливаем движок
+    pthread_t input_thread;
+    pthread_create(&input_thread, NULL, input_thread_func, NULL);
+    pthread_join(input_thread, NULL);
+
+    tc_engine_stop(engine);
+    rt_watchdog_stop(watchdog);
+    atomic_store(&stopping, 1);
+    pthread_join(display_thread, NULL);
+    TcEngineStats st;
+    tc_engine_get_stats(engine, &st);
+    rt_watchdog_print_stats(stdout, watchdog);
+    printf("failsafe activations: %llu\n", (unsigned long long)st.failsafes);
+    tc_engine_destroy(engine);
+    rt_watchdog_destroy(watchdog);
     return 0;
 }
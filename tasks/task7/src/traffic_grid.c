@@ -0,0 +1,260 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "rt_time.h"
+#include "rt_watchdog.h"
+#include "tc_engine.h"
+#include "tc_plan.h"
+#include "tc_trace.h"
+
+/*
+ * Сетка города: rows x cols перекрестков на нескольких рабочих потоках
+ * движка tc_engine. Смещение перекрестка в столбце c - c * travel: машина,
+ * проехавшая зеленый, подъезжает к соседу к началу его цикла ("зеленая
+ * волна" вдоль EW). Главный поток нажимает кнопки пешеходов и включает ЧС
+ * на случайных перекрестках; в конце печатает статистику движка и сколько
+ * перекрестков вернулись в свою фазу.
+ *
+ * -o - трасса всех переходов (tc_trace.h) в файл или в TCP-сокет
+ * (tcp:host:port); разбирает ее tc_trace_report.
+ *
+ * -W stall_ms - рабочие потоки под сторожем (rt_watchdog, приоритет на 1
+ * выше -f): пульс каждую треть stall_ms, в конце - промахи по потокам.
+ * Перекрестки в ЧС сторож не переводит, чтобы не сбивать фазы замера.
+ *
+ * Запуск: traffic_grid [-r rows] [-c cols] [-w workers] [-t sec] [-x scale]
+ *         [-v travel_ms] [-P ped/s] [-E emergencies/s] [-f fifo_prio]
+ *         [-o trace_file|tcp:host:port] [-W stall_ms] [plan_file]
+ */
+
+#define MAX_EMERGENCIES 64
+#define TRACE_RECORDS   65536   // На рабочий поток: ~1.5 МБ, сотни мс переходов большой сетки
+
+typedef struct {
+    uint32_t id;
+    int64_t end_ns;
+} emergency_t;
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-r rows] [-c cols] [-w workers] [-t sec] [-x scale] [-v travel_ms]\n"
+            "          [-P ped/s] [-E emergencies/s] [-f fifo_prio] [-o trace_file|tcp:host:port] [-W stall_ms]\n"
+            "          [plan_file]\n",
+            prog);
+}
+
+// Файл или tcp:host:port; дескриптор или -1
+static int open_trace(const char* target) {
+    if (strncmp(target, "tcp:", 4) != 0) {
+        int fd = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) perror(target);
+        return fd;
+    }
+    char host[256];
+    snprintf(host, sizeof(host), "%s", target + 4);
+    char* port = strrchr(host, ':');
+    if (!port) {
+        fprintf(stderr, "%s: expected tcp:host:port\n", target);
+        return -1;
+    }
+    *port++ = '\0';
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo* res;
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "%s: %s\n", target, gai_strerror(rc));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) perror(target);
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    int rows = 32, cols = 32, workers = 2, seconds = 10, prio = 0;
+    uint32_t scale = 100;
+    long travel_ms = 4000;
+    double ped_rate = 100, emergency_rate = 1;
+    const char* trace_target = NULL;
+    long stall_ms = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:c:w:t:x:v:P:E:f:o:W:")) != -1) {
+        switch (opt) {
+            case 'r': rows = atoi(optarg); break;
+            case 'c': cols = atoi(optarg); break;
+            case 'w': workers = atoi(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'x': scale = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'v': travel_ms = atol(optarg); break;
+            case 'P': ped_rate = atof(optarg); break;
+            case 'E': emergency_rate = atof(optarg); break;
+            case 'f': prio = atoi(optarg); break;
+            case 'o': trace_target = optarg; break;
+            case 'W': stall_ms = atol(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (rows < 1 || cols < 1 || workers < 1 || seconds < 1 || scale < 1 || stall_ms < 0 || optind + 1 < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TcPlan plan;
+    char err[128];
+    int rc = optind < argc ? tc_plan_load(&plan, argv[optind], err, sizeof(err))
+                           : tc_plan_parse(&plan, tc_plan_default_text, err, sizeof(err));
+    if (rc < 0 || tc_plan_scale(&plan, scale) < 0) {
+        fprintf(stderr, "plan: %s\n", err);
+        return 1;
+    }
+
+    size_t count = (size_t)rows * (size_t)cols;
+    TcEngineConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.plan = &plan;
+    cfg.count = count;
+    cfg.workers = workers;
+    cfg.worker_prio = prio;
+    cfg.base_ns = rt_now_ns();
+    cfg.trace_capacity = trace_target ? TRACE_RECORDS : 0;
+    RtWatchdog* watchdog = NULL;
+    if (stall_ms > 0) {
+        RtWatchdogConfig wd_cfg;
+        rt_watchdog_config_default(&wd_cfg);
+        wd_cfg.priority = prio > 0 && prio < 99 ? prio + 1 : prio;
+        if (!(watchdog = rt_watchdog_create(&wd_cfg))) {
+            perror("rt_watchdog_create");
+            return 1;
+        }
+        cfg.watchdog = watchdog;
+        cfg.stall_ns = stall_ms * RT_NSEC_PER_MSEC;
+        cfg.heartbeat_ns = cfg.stall_ns / 3;
+    }
+    TcEngine* engine = tc_engine_create(&cfg);
+    if (!engine) {
+        perror("tc_engine_create");
+        return 1;
+    }
+    int64_t travel_ns = travel_ms * RT_NSEC_PER_MSEC / scale;
+    for (size_t id = 0; id < count; id++) {
+        tc_engine_set_offset(engine, (uint32_t)id, (int64_t)(id % (size_t)cols) * travel_ns);
+    }
+
+    printf("grid %dx%d = %zu intersections, %d workers, cycle %.1f ms (x%u), travel %.1f ms\n", rows, cols, count,
+           workers, plan.cycle_ns / 1e6, scale, travel_ns / 1e6);
+    int trace_fd = -1;
+    if (trace_target && (trace_fd = open_trace(trace_target)) < 0) return 1;
+    struct rusage ru0;
+    getrusage(RUSAGE_SELF, &ru0);
+    if ((rc = tc_engine_start(engine)) != 0) {
+        fprintf(stderr, "tc_engine_start: %s%s\n", strerror(rc), prio ? " (SCHED_FIFO needs root)" : "");
+        return 1;
+    }
+    if (watchdog && rt_watchdog_start(watchdog) != 0) {
+        perror("rt_watchdog_start");
+        return 1;
+    }
+    TcTraceWriter* writer = NULL;
+    if (trace_fd >= 0 && !(writer = tc_trace_writer_start(engine, trace_fd, 0))) {
+        perror("tc_trace_writer_start");
+        return 1;
+    }
+
+    // Внешние события: шаг 1 мс, нажатия и ЧС с заданной частотой
+    emergency_t active[MAX_EMERGENCIES];
+    int n_active = 0;
+    unsigned long peds = 0, emergencies = 0;
+    double ped_acc = 0, emergency_acc = 0;
+    int64_t start = rt_now_ns();
+    int64_t end = start + (int64_t)seconds * RT_NSEC_PER_SEC;
+    int64_t emergency_ns = 2 * plan.cycle_ns;
+    srand(1);
+    for (int64_t now = start; now < end; now = rt_now_ns()) {
+        ped_acc += ped_rate / 1000.0;
+        for (; ped_acc >= 1.0; ped_acc -= 1.0, peds++) {
+            tc_engine_request(engine, (uint32_t)rand() % (uint32_t)count, rand() & 1 ? TC_REQ_PED_NS : TC_REQ_PED_EW);
+        }
+        emergency_acc += emergency_rate / 1000.0;
+        for (; emergency_acc >= 1.0 && n_active < MAX_EMERGENCIES; emergency_acc -= 1.0, emergencies++) {
+            active[n_active].id = (uint32_t)rand() % (uint32_t)count;
+            active[n_active].end_ns = now + emergency_ns;
+            tc_engine_request(engine, active[n_active].id, TC_REQ_EMERGENCY_ON);
+            n_active++;
+        }
+        for (int i = 0; i < n_active;) {
+            if (active[i].end_ns <= now) {
+                tc_engine_request(engine, active[i].id, TC_REQ_EMERGENCY_OFF);
+                active[i] = active[--n_active];
+            } else {
+                i++;
+            }
+        }
+        struct timespec step = {0, 1000000};
+        nanosleep(&step, NULL);
+    }
+    for (int i = 0; i < n_active; i++) tc_engine_request(engine, active[i].id, TC_REQ_EMERGENCY_OFF);
+
+    // Дать сбитым перекресткам время на подстройку: до цикла отставания,
+    // не больше sync_max_ms за цикл
+    int64_t sync_max_ns = (int64_t)plan.sync_max_ms * RT_NSEC_PER_MSEC;
+    int64_t settle_cycles = (sync_max_ns > 0 ? plan.cycle_ns / sync_max_ns : 0) + 2;
+    struct timespec settle;
+    rt_ns_to_timespec(settle_cycles * plan.cycle_ns, &settle);
+    nanosleep(&settle, NULL);
+    tc_engine_stop(engine);
+    if (watchdog) rt_watchdog_stop(watchdog);
+    int64_t stop_ns = rt_now_ns();
+
+    struct rusage ru1;
+    getrusage(RUSAGE_SELF, &ru1);
+    double cpu_ms = (ru1.ru_utime.tv_sec - ru0.ru_utime.tv_sec + ru1.ru_stime.tv_sec - ru0.ru_stime.tv_sec) * 1e3 +
+                    (ru1.ru_utime.tv_usec - ru0.ru_utime.tv_usec + ru1.ru_stime.tv_usec - ru0.ru_stime.tv_usec) / 1e3;
+
+    // В фазе - состояние совпадает с тем, что дает расписание от общей базы
+    size_t in_phase = 0;
+    for (size_t id = 0; id < count; id++) {
+        int64_t pos = stop_ns - cfg.base_ns - (int64_t)(id % (size_t)cols) * travel_ns;
+        if (tc_engine_state(engine, (uint32_t)id) == tc_plan_state_at(&plan, pos, NULL)) in_phase++;
+    }
+
+    TcEngineStats st;
+    tc_engine_get_stats(engine, &st);
+    double wall_s = (stop_ns - start) / 1e9;
+    printf("%.1f s: %llu transitions (%.0f/s), %llu wakeups (%.1f transitions/wakeup), max late %.3f ms\n", wall_s,
+           (unsigned long long)st.transitions, st.transitions / wall_s, (unsigned long long)st.wakeups,
+           st.wakeups ? (double)st.transitions / st.wakeups : 0.0, st.max_late_ns / 1e6);
+    printf("requests: %lu ped, %lu emergencies; %llu sync corrections; in phase %zu of %zu\n", peds, emergencies,
+           (unsigned long long)st.sync_corrections, in_phase, count);
+    printf("cpu %.1f ms (%.2f%% of one core)\n", cpu_ms, cpu_ms / (wall_s * 10.0));
+
+    if (writer) {
+        int64_t written = tc_trace_writer_stop(writer);
+        if (written < 0) perror("trace");
+        printf("trace: %lld records written, %llu dropped\n", (long long)(written < 0 ? 0 : written),
+               (unsigned long long)st.trace_dropped);
+        close(trace_fd);
+    }
+
+    if (watchdog) rt_watchdog_print_stats(stdout, watchdog);
+
+    tc_engine_destroy(engine);
+    rt_watchdog_destroy(watchdog);
+    return 0;
+}